@@ -5,16 +5,12 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include "wd_util.h"
 #include "hash_mb.h"
 
 #define MIN(a, b)		(((a) > (b)) ? (b) : (a))
 #define IPAD_VALUE		0x36
 #define OPAD_VALUE		0x5C
-#define HASH_KEY_LEN		64
-#define HASH_BLOCK_OFFSET	6
-#define HASH_BLOCK_SIZE		64
-#define HASH_PADLENGTHFIELD_SIZE 56
-#define HASH_PADDING_SIZE	120
 #define HASH_HIGH_32BITS	32
 #define HASH_PADDING_BLOCKS	2
 #define HASH_NENO_PROCESS_JOBS	4
@@ -23,8 +19,17 @@
 
 #define MD5_DIGEST_DATA_SIZE	16
 #define SM3_DIGEST_DATA_SIZE	32
+#define SHA1_DIGEST_DATA_SIZE	20
+#define SHA224_DIGEST_DATA_SIZE	28
+#define SHA256_DIGEST_DATA_SIZE	32
+#define SHA384_DIGEST_DATA_SIZE	48
+#define SHA512_DIGEST_DATA_SIZE	64
+#define SHA512_BLOCK_SIZE	128
+#define HASH_LEN_FIELD_SIZE	8
+#define SHA512_LEN_FIELD_SIZE	16
 #define HASH_MAX_LANES		32
 #define SM3_MAX_LANES		16
+#define HASH_MB_ALG_NUM		(WD_DIGEST_SHA512 + 1)
 
 #define PUTU32(p, V) \
 	((p)[0] = (uint8_t)((V) >> 24), \
@@ -32,15 +37,25 @@
 	 (p)[2] = (uint8_t)((V) >>  8), \
 	 (p)[3] = (uint8_t)(V))
 
+/*
+ * iv_bytes is the size of the state, which is kept in result_digest and in
+ * the out of long hash. digest_bytes is the size of the inner hash of HMAC,
+ * it is less than iv_bytes for SHA-224 and SHA-384.
+ */
 struct hash_mb_ops {
 	int (*max_lanes)(void);
-	void (*asimd_x4)(struct hash_job *job1, struct hash_job *job2,
-			 struct hash_job *job3, struct hash_job *job4, int len);
-	void (*asimd_x1)(struct hash_job *job, int len);
-	void (*sve)(int blocks, int total_lanes, struct hash_job **job_vec);
+	void (*x4)(struct hash_job *job1, struct hash_job *job2,
+		   struct hash_job *job3, struct hash_job *job4, int len);
+	void (*x1)(struct hash_job *job, int len);
+	void (*lanes)(int blocks, int total_lanes, struct hash_job **job_vec);
 	__u8 *iv_data;
 	int iv_bytes;
+	int digest_bytes;
 	int max_jobs;
+	__u32 block_size;
+	__u32 len_field_size;
+	/* The length is padded in big-endian */
+	bool is_transfer;
 };
 
 struct hash_mb_poll_queue {
@@ -52,8 +67,15 @@ struct hash_mb_poll_queue {
 };
 
 struct hash_mb_queue {
-	struct hash_mb_poll_queue sm3_poll_queue;
-	struct hash_mb_poll_queue md5_poll_queue;
+	/* One job queue per algorithm, indexed by enum wd_digest_type */
+	struct hash_mb_poll_queue poll_queue[HASH_MB_ALG_NUM];
+	/*
+	 * The jobs of async mode. A message tag of the async pool is unique
+	 * among the messages in flight on the ctx, so the job of tag n is
+	 * jobs[n - 1] and send/recv never allocate.
+	 */
+	struct hash_job *jobs;
+	__u32 jobs_num;
 	pthread_spinlock_t r_lock;
 	struct hash_job *recv_head;
 	struct hash_job *recv_tail;
@@ -77,24 +99,111 @@ static __u8 md5_iv_data[MD5_DIGEST_DATA_SIZE] = {
 	0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10,
 };
 
-static struct hash_mb_ops md5_ops = {
+/* The SHA states are loaded and stored in big-endian by sha_mb.c */
+static __u8 sha1_iv_data[SHA1_DIGEST_DATA_SIZE] = {
+	0x67, 0x45, 0x23, 0x01, 0xef, 0xcd, 0xab, 0x89,
+	0x98, 0xba, 0xdc, 0xfe, 0x10, 0x32, 0x54, 0x76,
+	0xc3, 0xd2, 0xe1, 0xf0,
+};
+
+static __u8 sha224_iv_data[SHA256_DIGEST_DATA_SIZE] = {
+	0xc1, 0x05, 0x9e, 0xd8, 0x36, 0x7c, 0xd5, 0x07,
+	0x30, 0x70, 0xdd, 0x17, 0xf7, 0x0e, 0x59, 0x39,
+	0xff, 0xc0, 0x0b, 0x31, 0x68, 0x58, 0x15, 0x11,
+	0x64, 0xf9, 0x8f, 0xa7, 0xbe, 0xfa, 0x4f, 0xa4,
+};
+
+static __u8 sha256_iv_data[SHA256_DIGEST_DATA_SIZE] = {
+	0x6a, 0x09, 0xe6, 0x67, 0xbb, 0x67, 0xae, 0x85,
+	0x3c, 0x6e, 0xf3, 0x72, 0xa5, 0x4f, 0xf5, 0x3a,
+	0x51, 0x0e, 0x52, 0x7f, 0x9b, 0x05, 0x68, 0x8c,
+	0x1f, 0x83, 0xd9, 0xab, 0x5b, 0xe0, 0xcd, 0x19,
+};
+
+static __u8 sha384_iv_data[SHA512_DIGEST_DATA_SIZE] = {
+	0xcb, 0xbb, 0x9d, 0x5d, 0xc1, 0x05, 0x9e, 0xd8,
+	0x62, 0x9a, 0x29, 0x2a, 0x36, 0x7c, 0xd5, 0x07,
+	0x91, 0x59, 0x01, 0x5a, 0x30, 0x70, 0xdd, 0x17,
+	0x15, 0x2f, 0xec, 0xd8, 0xf7, 0x0e, 0x59, 0x39,
+	0x67, 0x33, 0x26, 0x67, 0xff, 0xc0, 0x0b, 0x31,
+	0x8e, 0xb4, 0x4a, 0x87, 0x68, 0x58, 0x15, 0x11,
+	0xdb, 0x0c, 0x2e, 0x0d, 0x64, 0xf9, 0x8f, 0xa7,
+	0x47, 0xb5, 0x48, 0x1d, 0xbe, 0xfa, 0x4f, 0xa4,
+};
+
+static __u8 sha512_iv_data[SHA512_DIGEST_DATA_SIZE] = {
+	0x6a, 0x09, 0xe6, 0x67, 0xf3, 0xbc, 0xc9, 0x08,
+	0xbb, 0x67, 0xae, 0x85, 0x84, 0xca, 0xa7, 0x3b,
+	0x3c, 0x6e, 0xf3, 0x72, 0xfe, 0x94, 0xf8, 0x2b,
+	0xa5, 0x4f, 0xf5, 0x3a, 0x5f, 0x1d, 0x36, 0xf1,
+	0x51, 0x0e, 0x52, 0x7f, 0xad, 0xe6, 0x82, 0xd1,
+	0x9b, 0x05, 0x68, 0x8c, 0x2b, 0x3e, 0x6c, 0x1f,
+	0x1f, 0x83, 0xd9, 0xab, 0xfb, 0x41, 0xbd, 0x6b,
+	0x5b, 0xe0, 0xcd, 0x19, 0x13, 0x7e, 0x21, 0x79,
+};
+
+static const struct hash_mb_ops md5_ops = {
 	.max_lanes = md5_mb_sve_max_lanes,
-	.asimd_x4 = md5_mb_asimd_x4,
-	.asimd_x1 = md5_mb_asimd_x1,
-	.sve = md5_mb_sve,
+	.x4 = md5_mb_asimd_x4,
+	.x1 = md5_mb_asimd_x1,
+	.lanes = md5_mb_sve,
 	.iv_data = md5_iv_data,
 	.iv_bytes = MD5_DIGEST_DATA_SIZE,
+	.digest_bytes = MD5_DIGEST_DATA_SIZE,
 	.max_jobs = HASH_MAX_LANES,
+	.block_size = HASH_BLOCK_SIZE,
+	.len_field_size = HASH_LEN_FIELD_SIZE,
+	.is_transfer = false,
 };
 
-static struct hash_mb_ops sm3_ops = {
+static const struct hash_mb_ops sm3_ops = {
 	.max_lanes = sm3_mb_sve_max_lanes,
-	.asimd_x4 = sm3_mb_asimd_x4,
-	.asimd_x1 = sm3_mb_asimd_x1,
-	.sve = sm3_mb_sve,
+	.x4 = sm3_mb_asimd_x4,
+	.x1 = sm3_mb_asimd_x1,
+	.lanes = sm3_mb_sve,
 	.iv_data = sm3_iv_data,
 	.iv_bytes = SM3_DIGEST_DATA_SIZE,
+	.digest_bytes = SM3_DIGEST_DATA_SIZE,
 	.max_jobs = SM3_MAX_LANES,
+	.block_size = HASH_BLOCK_SIZE,
+	.len_field_size = HASH_LEN_FIELD_SIZE,
+	.is_transfer = true,
+};
+
+#define GEN_SHA_MB_OPS(name, kernel, iv, iv_len, digest_len, block, len_field) \
+static const struct hash_mb_ops name##_ops = {\
+	.max_lanes = kernel##_mb_max_lanes,\
+	.x4 = kernel##_mb_x4,\
+	.x1 = kernel##_mb_x1,\
+	.lanes = kernel##_mb_lanes,\
+	.iv_data = (iv),\
+	.iv_bytes = (iv_len),\
+	.digest_bytes = (digest_len),\
+	.max_jobs = HASH_MAX_LANES,\
+	.block_size = (block),\
+	.len_field_size = (len_field),\
+	.is_transfer = true,\
+}
+
+GEN_SHA_MB_OPS(sha1, sha1, sha1_iv_data, SHA1_DIGEST_DATA_SIZE,
+	       SHA1_DIGEST_DATA_SIZE, HASH_BLOCK_SIZE, HASH_LEN_FIELD_SIZE);
+GEN_SHA_MB_OPS(sha224, sha256, sha224_iv_data, SHA256_DIGEST_DATA_SIZE,
+	       SHA224_DIGEST_DATA_SIZE, HASH_BLOCK_SIZE, HASH_LEN_FIELD_SIZE);
+GEN_SHA_MB_OPS(sha256, sha256, sha256_iv_data, SHA256_DIGEST_DATA_SIZE,
+	       SHA256_DIGEST_DATA_SIZE, HASH_BLOCK_SIZE, HASH_LEN_FIELD_SIZE);
+GEN_SHA_MB_OPS(sha384, sha512, sha384_iv_data, SHA512_DIGEST_DATA_SIZE,
+	       SHA384_DIGEST_DATA_SIZE, SHA512_BLOCK_SIZE, SHA512_LEN_FIELD_SIZE);
+GEN_SHA_MB_OPS(sha512, sha512, sha512_iv_data, SHA512_DIGEST_DATA_SIZE,
+	       SHA512_DIGEST_DATA_SIZE, SHA512_BLOCK_SIZE, SHA512_LEN_FIELD_SIZE);
+
+static const struct hash_mb_ops *hash_mb_alg_ops[HASH_MB_ALG_NUM] = {
+	[WD_DIGEST_SM3] = &sm3_ops,
+	[WD_DIGEST_MD5] = &md5_ops,
+	[WD_DIGEST_SHA1] = &sha1_ops,
+	[WD_DIGEST_SHA256] = &sha256_ops,
+	[WD_DIGEST_SHA224] = &sha224_ops,
+	[WD_DIGEST_SHA384] = &sha384_ops,
+	[WD_DIGEST_SHA512] = &sha512_ops,
 };
 
 static void hash_mb_uninit_poll_queue(struct hash_mb_poll_queue *poll_queue)
@@ -106,14 +215,15 @@ static void hash_mb_queue_uninit(struct wd_ctx_config_internal *config, int ctx_
 {
 	struct hash_mb_queue *mb_queue;
 	struct wd_soft_ctx *ctx;
-	int i;
+	int i, j;
 
 	for (i = 0; i < ctx_num; i++) {
 		ctx = (struct wd_soft_ctx *)config->ctxs[i].ctx;
 		mb_queue = ctx->priv;
 		pthread_spin_destroy(&mb_queue->r_lock);
-		hash_mb_uninit_poll_queue(&mb_queue->sm3_poll_queue);
-		hash_mb_uninit_poll_queue(&mb_queue->md5_poll_queue);
+		for (j = 0; j < HASH_MB_ALG_NUM; j++)
+			hash_mb_uninit_poll_queue(&mb_queue->poll_queue[j]);
+		free(mb_queue->jobs);
 		free(mb_queue);
 	}
 }
@@ -135,12 +245,30 @@ static int hash_mb_init_poll_queue(struct hash_mb_poll_queue *poll_queue)
 	return WD_SUCCESS;
 }
 
+static int hash_mb_init_jobs(struct hash_mb_queue *mb_queue, __u32 jobs_num)
+{
+	mb_queue->jobs = aligned_alloc(HASH_JOB_ALIGN, sizeof(struct hash_job) * jobs_num);
+	if (!mb_queue->jobs) {
+		WD_ERR("failed to alloc %u hash mb jobs!\n", jobs_num);
+		return -WD_ENOMEM;
+	}
+
+	mb_queue->jobs_num = jobs_num;
+
+	return WD_SUCCESS;
+}
+
 static int hash_mb_queue_init(struct wd_ctx_config_internal *config)
 {
+	__u32 jobs_num = WD_POOL_MAX_ENTRIES;
 	struct hash_mb_queue *mb_queue;
 	int ctx_num = config->ctx_num;
 	struct wd_soft_ctx *ctx;
-	int i, ret;
+	int i, j, ret;
+
+	/* One job for each message of the ctx's async pool */
+	if (config->pool && config->pool->msg_num)
+		jobs_num = config->pool->msg_num;
 
 	for (i = 0; i < ctx_num; i++) {
 		mb_queue = calloc(1, sizeof(struct hash_mb_queue));
@@ -150,24 +278,30 @@ static int hash_mb_queue_init(struct wd_ctx_config_internal *config)
 		}
 
 		mb_queue->ctx_mode = config->ctxs[i].ctx_mode;
+		if (mb_queue->ctx_mode == CTX_MODE_ASYNC) {
+			ret = hash_mb_init_jobs(mb_queue, jobs_num);
+			if (ret) {
+				free(mb_queue);
+				goto free_mb_queue;
+			}
+		}
+
 		ctx = (struct wd_soft_ctx *)config->ctxs[i].ctx;
 		ctx->priv = mb_queue;
-		ret = hash_mb_init_poll_queue(&mb_queue->sm3_poll_queue);
-		if (ret)
-			goto free_mem;
+		for (j = 0; j < HASH_MB_ALG_NUM; j++) {
+			ret = hash_mb_init_poll_queue(&mb_queue->poll_queue[j]);
+			if (ret)
+				goto uninit_poll;
 
-		ret = hash_mb_init_poll_queue(&mb_queue->md5_poll_queue);
-		if (ret)
-			goto uninit_sm3_poll;
+			mb_queue->poll_queue[j].ops = hash_mb_alg_ops[j];
+		}
 
 		ret = pthread_spin_init(&mb_queue->r_lock, PTHREAD_PROCESS_SHARED);
 		if (ret) {
 			WD_ERR("failed to init r_lock!\n");
-			goto uninit_md5_poll;
+			goto uninit_poll;
 		}
 
-		mb_queue->sm3_poll_queue.ops = &sm3_ops;
-		mb_queue->md5_poll_queue.ops = &md5_ops;
 		mb_queue->recv_head = NULL;
 		mb_queue->recv_tail = NULL;
 		mb_queue->complete_cnt = 0;
@@ -175,11 +309,10 @@ static int hash_mb_queue_init(struct wd_ctx_config_internal *config)
 
 	return WD_SUCCESS;
 
-uninit_md5_poll:
-	hash_mb_uninit_poll_queue(&mb_queue->md5_poll_queue);
-uninit_sm3_poll:
-	hash_mb_uninit_poll_queue(&mb_queue->sm3_poll_queue);
-free_mem:
+uninit_poll:
+	while (j--)
+		hash_mb_uninit_poll_queue(&mb_queue->poll_queue[j]);
+	free(mb_queue->jobs);
 	free(mb_queue);
 free_mb_queue:
 	hash_mb_queue_uninit(config, i);
@@ -227,42 +360,43 @@ static void hash_mb_exit(struct wd_alg_driver *drv)
 	drv->priv = NULL;
 }
 
-static void hash_mb_pad_data(struct hash_pad *hash_pad, __u8 *in, __u32 partial,
-		     __u64 total_len, bool transfer)
+/*
+ * The length field is the last len_field_size bytes of the padding, the
+ * bit length is never more than 64 bits, so only the low 8 bytes are set
+ * and the high bytes of the 16 bytes field of SHA-384/512 are zero.
+ */
+static void hash_mb_pad_data(const struct hash_mb_ops *ops, struct hash_pad *hash_pad,
+			     __u8 *in, __u32 partial, __u64 total_len)
 {
 	__u64 size = total_len << BYTES_TO_BITS_OFFSET;
 	__u8 *buffer = hash_pad->pad;
+	__u32 pad_size;
 
 	if (partial)
 		memcpy(buffer, in, partial);
 
 	buffer[partial++] = 0x80;
-	if (partial <= HASH_PADLENGTHFIELD_SIZE) {
-		memset(buffer + partial, 0, HASH_PADLENGTHFIELD_SIZE - partial);
-		if (transfer) {
-			PUTU32(buffer + HASH_PADLENGTHFIELD_SIZE, size >> HASH_HIGH_32BITS);
-			PUTU32(buffer + HASH_PADLENGTHFIELD_SIZE + sizeof(__u32), size);
-		} else {
-			memcpy(buffer + HASH_PADLENGTHFIELD_SIZE, &size, sizeof(__u64));
-		}
+	if (partial <= ops->block_size - ops->len_field_size)
 		hash_pad->pad_len = 1;
-	} else {
-		memset(buffer + partial, 0, HASH_PADDING_SIZE - partial);
-		if (transfer) {
-			PUTU32(buffer + HASH_PADDING_SIZE, size >> HASH_HIGH_32BITS);
-			PUTU32(buffer + HASH_PADDING_SIZE + sizeof(__u32), size);
-		} else {
-			memcpy(buffer + HASH_PADDING_SIZE, &size, sizeof(__u64));
-		}
+	else
 		hash_pad->pad_len = HASH_PADDING_BLOCKS;
+
+	pad_size = hash_pad->pad_len * ops->block_size - sizeof(__u64);
+	memset(buffer + partial, 0, pad_size - partial);
+	if (ops->is_transfer) {
+		PUTU32(buffer + pad_size, size >> HASH_HIGH_32BITS);
+		PUTU32(buffer + pad_size + sizeof(__u32), size);
+	} else {
+		memcpy(buffer + pad_size, &size, sizeof(__u64));
 	}
 }
 
-static inline void hash_xor(__u8 *key_out, __u8 *key_in, __u32 key_len, __u8 xor_value)
+static inline void hash_xor(__u8 *key_out, __u8 *key_in, __u32 key_len,
+			    __u32 block_size, __u8 xor_value)
 {
 	__u32 i;
 
-	for (i = 0; i < HASH_KEY_LEN; i++) {
+	for (i = 0; i < block_size; i++) {
 		if (i < key_len)
 			key_out[i] = key_in[i] ^ xor_value;
 		else
@@ -274,33 +408,35 @@ static int hash_middle_block_process(struct hash_mb_poll_queue *poll_queue,
 				     struct wd_digest_msg *d_msg,
 				     struct hash_job *job)
 {
+	const struct hash_mb_ops *ops = poll_queue->ops;
 	__u8 *buffer = d_msg->partial_block + d_msg->partial_bytes;
 	__u64 length = (__u64)d_msg->partial_bytes + d_msg->in_bytes;
+	__u32 block_size = ops->block_size;
 
-	if (length < HASH_BLOCK_SIZE) {
+	if (length < block_size) {
 		memcpy(buffer, d_msg->in, d_msg->in_bytes);
 		d_msg->partial_bytes = length;
 		return -WD_EAGAIN;
 	}
 
 	if (d_msg->partial_bytes) {
-		memcpy(buffer, d_msg->in, HASH_BLOCK_SIZE - d_msg->partial_bytes);
+		memcpy(buffer, d_msg->in, block_size - d_msg->partial_bytes);
 		job->buffer = d_msg->partial_block;
-		poll_queue->ops->asimd_x1(job, 1);
-		length = d_msg->in_bytes - (HASH_BLOCK_SIZE - d_msg->partial_bytes);
-		buffer = d_msg->in + (HASH_BLOCK_SIZE - d_msg->partial_bytes);
+		ops->x1(job, 1);
+		length = d_msg->in_bytes - (block_size - d_msg->partial_bytes);
+		buffer = d_msg->in + (block_size - d_msg->partial_bytes);
 	} else {
 		buffer = d_msg->in;
 	}
 
-	job->len = length >> HASH_BLOCK_OFFSET;
-	d_msg->partial_bytes = length & (HASH_BLOCK_SIZE - 1);
+	job->len = length / block_size;
+	d_msg->partial_bytes = length & (block_size - 1);
 	if (d_msg->partial_bytes)
-		memcpy(d_msg->partial_block, buffer + (job->len << HASH_BLOCK_OFFSET),
+		memcpy(d_msg->partial_block, buffer + job->len * block_size,
 			d_msg->partial_bytes);
 
 	if (!job->len) {
-		memcpy(d_msg->out, job->result_digest, poll_queue->ops->iv_bytes);
+		memcpy(d_msg->out, job->result_digest, ops->iv_bytes);
 		return -WD_EAGAIN;
 	}
 
@@ -310,15 +446,16 @@ static int hash_middle_block_process(struct hash_mb_poll_queue *poll_queue,
 	return WD_SUCCESS;
 }
 
-static void hash_signle_block_process(struct wd_digest_msg *d_msg,
+static void hash_signle_block_process(const struct hash_mb_ops *ops,
+				      struct wd_digest_msg *d_msg,
 				      struct hash_job *job, __u64 total_len)
 {
-	__u32 hash_partial = d_msg->in_bytes & (HASH_BLOCK_SIZE - 1);
+	__u32 hash_partial = d_msg->in_bytes & (ops->block_size - 1);
 	__u8 *buffer;
 
-	job->len = d_msg->in_bytes >> HASH_BLOCK_OFFSET;
-	buffer = d_msg->in + (job->len << HASH_BLOCK_OFFSET);
-	hash_mb_pad_data(&job->pad, buffer, hash_partial, total_len, job->is_transfer);
+	job->len = d_msg->in_bytes / ops->block_size;
+	buffer = d_msg->in + job->len * ops->block_size;
+	hash_mb_pad_data(ops, &job->pad, buffer, hash_partial, total_len);
 	if (!job->len) {
 		job->buffer = job->pad.pad;
 		job->len = job->pad.pad_len;
@@ -333,24 +470,26 @@ static void hash_final_block_process(struct hash_mb_poll_queue *poll_queue,
 				     struct wd_digest_msg *d_msg,
 				     struct hash_job *job)
 {
+	const struct hash_mb_ops *ops = poll_queue->ops;
 	__u8 *buffer = d_msg->partial_block + d_msg->partial_bytes;
 	__u64 length = (__u64)d_msg->partial_bytes + d_msg->in_bytes;
-	__u32 hash_partial = length & (HASH_BLOCK_SIZE - 1);
+	__u32 block_size = ops->block_size;
+	__u32 hash_partial = length & (block_size - 1);
 	__u64 total_len = d_msg->long_data_len;
 
 	if (job->opad.opad_size)
-		total_len += HASH_BLOCK_SIZE;
+		total_len += block_size;
 
 	if (!d_msg->partial_bytes) {
-		hash_signle_block_process(d_msg, job, total_len);
+		hash_signle_block_process(ops, d_msg, job, total_len);
 		return;
 	}
 
-	if (length <= HASH_BLOCK_SIZE) {
+	if (length <= block_size) {
 		memcpy(buffer, d_msg->in, d_msg->in_bytes);
-		job->len = length >> HASH_BLOCK_OFFSET;
-		buffer = d_msg->partial_block + (job->len << HASH_BLOCK_OFFSET);
-		hash_mb_pad_data(&job->pad, buffer, hash_partial, total_len, job->is_transfer);
+		job->len = length / block_size;
+		buffer = d_msg->partial_block + job->len * block_size;
+		hash_mb_pad_data(ops, &job->pad, buffer, hash_partial, total_len);
 		if (!job->len) {
 			job->buffer = job->pad.pad;
 			job->len = job->pad.pad_len;
@@ -362,15 +501,15 @@ static void hash_final_block_process(struct hash_mb_poll_queue *poll_queue,
 		return;
 	}
 
-	memcpy(buffer, d_msg->in, (HASH_BLOCK_SIZE - d_msg->partial_bytes));
+	memcpy(buffer, d_msg->in, (block_size - d_msg->partial_bytes));
 	job->buffer = d_msg->partial_block;
-	poll_queue->ops->asimd_x1(job, 1);
-	job->buffer = d_msg->in + (HASH_BLOCK_SIZE - d_msg->partial_bytes);
-	length = d_msg->in_bytes - (HASH_BLOCK_SIZE - d_msg->partial_bytes);
-	job->len = length >> HASH_BLOCK_OFFSET;
-	buffer = job->buffer + (job->len << HASH_BLOCK_OFFSET);
-	hash_partial = length & (HASH_BLOCK_SIZE - 1);
-	hash_mb_pad_data(&job->pad, buffer, hash_partial, total_len, job->is_transfer);
+	ops->x1(job, 1);
+	job->buffer = d_msg->in + (block_size - d_msg->partial_bytes);
+	length = d_msg->in_bytes - (block_size - d_msg->partial_bytes);
+	job->len = length / block_size;
+	buffer = job->buffer + job->len * block_size;
+	hash_partial = length & (block_size - 1);
+	hash_mb_pad_data(ops, &job->pad, buffer, hash_partial, total_len);
 	if (!job->len) {
 		job->buffer = job->pad.pad;
 		job->len = job->pad.pad_len;
@@ -378,25 +517,25 @@ static void hash_final_block_process(struct hash_mb_poll_queue *poll_queue,
 	}
 }
 
-static int hash_first_block_process(struct wd_digest_msg *d_msg,
-				    struct hash_job *job,
-				    __u32 iv_bytes)
+static int hash_first_block_process(const struct hash_mb_ops *ops,
+				    struct wd_digest_msg *d_msg,
+				    struct hash_job *job)
 {
 	__u8 *buffer;
 
-	job->len = d_msg->in_bytes >> HASH_BLOCK_OFFSET;
-	d_msg->partial_bytes = d_msg->in_bytes & (HASH_BLOCK_SIZE - 1);
+	job->len = d_msg->in_bytes / ops->block_size;
+	d_msg->partial_bytes = d_msg->in_bytes & (ops->block_size - 1);
 	if (d_msg->partial_bytes) {
-		buffer = d_msg->in + (job->len << HASH_BLOCK_OFFSET);
+		buffer = d_msg->in + job->len * ops->block_size;
 		memcpy(d_msg->partial_block, buffer, d_msg->partial_bytes);
 	}
 
 	/*
-	 * Long hash mode, if first block is less than HASH_BLOCK_SIZE,
+	 * Long hash mode, if first block is less than the block size,
 	 * copy ikey hash result to out.
 	 */
 	if (!job->len) {
-		memcpy(d_msg->out, job->result_digest, iv_bytes);
+		memcpy(d_msg->out, job->result_digest, ops->iv_bytes);
 		return -WD_EAGAIN;
 	}
 	job->buffer = d_msg->in;
@@ -414,7 +553,7 @@ static int hash_do_partial(struct hash_mb_poll_queue *poll_queue,
 
 	switch (bd_type) {
 	case HASH_FIRST_BLOCK:
-		ret = hash_first_block_process(d_msg, job, poll_queue->ops->iv_bytes);
+		ret = hash_first_block_process(poll_queue->ops, d_msg, job);
 		break;
 	case HASH_MIDDLE_BLOCK:
 		ret = hash_middle_block_process(poll_queue, d_msg, job);
@@ -424,8 +563,8 @@ static int hash_do_partial(struct hash_mb_poll_queue *poll_queue,
 		break;
 	case HASH_SINGLE_BLOCK:
 		if (job->opad.opad_size)
-			total_len += HASH_BLOCK_SIZE;
-		hash_signle_block_process(d_msg, job, total_len);
+			total_len += poll_queue->ops->block_size;
+		hash_signle_block_process(poll_queue->ops, d_msg, job, total_len);
 		break;
 	}
 
@@ -436,74 +575,85 @@ static void hash_mb_init_iv(struct hash_mb_poll_queue *poll_queue,
 			    struct wd_digest_msg *d_msg, struct hash_job *job)
 {
 	enum hash_block_type bd_type = get_hash_block_type(d_msg);
-	__u8 key_ipad[HASH_KEY_LEN];
-	__u8 key_opad[HASH_KEY_LEN];
+	const struct hash_mb_ops *ops = poll_queue->ops;
+	__u8 key_ipad[HASH_MAX_BLOCK_SIZE];
+	__u8 key_opad[HASH_MAX_BLOCK_SIZE];
 
 	job->opad.opad_size = 0;
 	switch (bd_type) {
 	case HASH_FIRST_BLOCK:
-		memcpy(job->result_digest, poll_queue->ops->iv_data, poll_queue->ops->iv_bytes);
+		memcpy(job->result_digest, ops->iv_data, ops->iv_bytes);
 		if (d_msg->mode != WD_DIGEST_HMAC)
 			return;
 
-		hash_xor(key_ipad, d_msg->key, d_msg->key_bytes, IPAD_VALUE);
+		hash_xor(key_ipad, d_msg->key, d_msg->key_bytes, ops->block_size, IPAD_VALUE);
 		job->buffer = key_ipad;
-		poll_queue->ops->asimd_x1(job, 1);
+		ops->x1(job, 1);
 		break;
 	case HASH_MIDDLE_BLOCK:
-		memcpy(job->result_digest, d_msg->out, poll_queue->ops->iv_bytes);
+		memcpy(job->result_digest, d_msg->out, ops->iv_bytes);
 		break;
 	case HASH_END_BLOCK:
 		if (d_msg->mode != WD_DIGEST_HMAC) {
-			memcpy(job->result_digest, d_msg->out, poll_queue->ops->iv_bytes);
+			memcpy(job->result_digest, d_msg->out, ops->iv_bytes);
 			return;
 		}
-		memcpy(job->result_digest, poll_queue->ops->iv_data, poll_queue->ops->iv_bytes);
-		hash_xor(key_opad, d_msg->key, d_msg->key_bytes, OPAD_VALUE);
+		memcpy(job->result_digest, ops->iv_data, ops->iv_bytes);
+		hash_xor(key_opad, d_msg->key, d_msg->key_bytes, ops->block_size, OPAD_VALUE);
 		job->buffer = key_opad;
-		poll_queue->ops->asimd_x1(job, 1);
-		memcpy(job->opad.opad, job->result_digest, poll_queue->ops->iv_bytes);
-		job->opad.opad_size = poll_queue->ops->iv_bytes;
-		memcpy(job->result_digest, d_msg->out, poll_queue->ops->iv_bytes);
+		ops->x1(job, 1);
+		memcpy(job->opad.opad, job->result_digest, ops->iv_bytes);
+		job->opad.opad_size = ops->iv_bytes;
+		memcpy(job->result_digest, d_msg->out, ops->iv_bytes);
 		break;
 	case HASH_SINGLE_BLOCK:
-		memcpy(job->result_digest, poll_queue->ops->iv_data, poll_queue->ops->iv_bytes);
+		memcpy(job->result_digest, ops->iv_data, ops->iv_bytes);
 		if (d_msg->mode != WD_DIGEST_HMAC)
 			return;
 
-		hash_xor(key_ipad, d_msg->key, d_msg->key_bytes, IPAD_VALUE);
-		hash_xor(key_opad, d_msg->key, d_msg->key_bytes, OPAD_VALUE);
+		hash_xor(key_ipad, d_msg->key, d_msg->key_bytes, ops->block_size, IPAD_VALUE);
+		hash_xor(key_opad, d_msg->key, d_msg->key_bytes, ops->block_size, OPAD_VALUE);
 		job->buffer = key_opad;
-		poll_queue->ops->asimd_x1(job, 1);
-		memcpy(job->opad.opad, job->result_digest, poll_queue->ops->iv_bytes);
-		job->opad.opad_size = poll_queue->ops->iv_bytes;
+		ops->x1(job, 1);
+		memcpy(job->opad.opad, job->result_digest, ops->iv_bytes);
+		job->opad.opad_size = ops->iv_bytes;
 		job->buffer = key_ipad;
-		memcpy(job->result_digest, poll_queue->ops->iv_data, poll_queue->ops->iv_bytes);
-		poll_queue->ops->asimd_x1(job, 1);
+		memcpy(job->result_digest, ops->iv_data, ops->iv_bytes);
+		ops->x1(job, 1);
 		break;
 	}
 }
 
+/*
+ * The outer hash of HMAC: pad the inner digest as the message after the
+ * opad block, then restart from the opad state.
+ */
+static void hash_mb_opad_stage(const struct hash_mb_ops *ops, struct hash_job *job)
+{
+	__u32 length = ops->block_size + ops->digest_bytes;
+
+	hash_mb_pad_data(ops, &job->pad, job->result_digest, ops->digest_bytes, length);
+	memcpy(job->result_digest, job->opad.opad, ops->iv_bytes);
+	job->opad.opad_size = 0;
+	job->buffer = job->pad.pad;
+	job->len = job->pad.pad_len;
+	job->pad.pad_len = 0;
+}
+
 static void hash_do_sync(struct hash_mb_poll_queue *poll_queue, struct hash_job *job)
 {
-	__u32 iv_bytes = poll_queue->ops->iv_bytes;
-	__u32 length;
+	const struct hash_mb_ops *ops = poll_queue->ops;
 
-	poll_queue->ops->asimd_x1(job, job->len);
+	ops->x1(job, job->len);
 
 	if (job->pad.pad_len) {
 		job->buffer = job->pad.pad;
-		poll_queue->ops->asimd_x1(job, job->pad.pad_len);
+		ops->x1(job, job->pad.pad_len);
 	}
 
 	if (job->opad.opad_size) {
-		job->buffer = job->opad.opad + job->opad.opad_size;
-		memcpy(job->buffer, job->result_digest, iv_bytes);
-		memcpy(job->result_digest, job->opad.opad, iv_bytes);
-		length = HASH_BLOCK_SIZE + iv_bytes;
-		hash_mb_pad_data(&job->pad, job->buffer, iv_bytes, length, job->is_transfer);
-		job->buffer = job->pad.pad;
-		poll_queue->ops->asimd_x1(job, job->pad.pad_len);
+		hash_mb_opad_stage(ops, job);
+		ops->x1(job, job->len);
 	}
 }
 
@@ -547,54 +697,50 @@ static int hash_mb_check_param(struct hash_mb_queue *mb_queue, struct wd_digest_
 		return -WD_EINVAL;
 	}
 
+	if (unlikely(d_msg->alg >= HASH_MB_ALG_NUM)) {
+		WD_ERR("invalid: alg type %u not support!\n", d_msg->alg);
+		return -WD_EINVAL;
+	}
+
 	return WD_SUCCESS;
 }
 
 static int hash_mb_send(struct wd_alg_driver *drv, handle_t ctx, void *drv_msg)
 {
 	struct wd_soft_ctx *s_ctx = (struct wd_soft_ctx *)ctx;
-	struct hash_mb_queue *mb_queue = s_ctx->priv;
 	struct wd_digest_msg *d_msg = drv_msg;
 	struct hash_mb_poll_queue *poll_queue;
+	struct hash_mb_queue *mb_queue;
 	struct hash_job hash_sync_job;
 	struct hash_job *hash_job;
 	int ret;
 
+	/* The job queues belong to ctxs, a fallback is given a sync soft ctx */
+	if (unlikely(!s_ctx)) {
+		WD_ERR("invalid: hash mb ctx is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	mb_queue = s_ctx->priv;
 	ret = hash_mb_check_param(mb_queue, d_msg);
 	if (ret)
 		return ret;
 
 	if (mb_queue->ctx_mode == CTX_MODE_ASYNC) {
-		hash_job = malloc(sizeof(struct hash_job));
-		if (unlikely(!hash_job))
-			return -WD_ENOMEM;
+		if (unlikely(!d_msg->tag || d_msg->tag > mb_queue->jobs_num)) {
+			WD_ERR("invalid: hash mb msg tag %u is out of range!\n", d_msg->tag);
+			return -WD_EINVAL;
+		}
+		hash_job = &mb_queue->jobs[d_msg->tag - 1];
 	} else {
 		hash_job = &hash_sync_job;
 	}
 
-	switch (d_msg->alg) {
-	case WD_DIGEST_SM3:
-		poll_queue = &mb_queue->sm3_poll_queue;
-		hash_job->is_transfer = true;
-		break;
-	case WD_DIGEST_MD5:
-		poll_queue = &mb_queue->md5_poll_queue;
-		hash_job->is_transfer = false;
-		break;
-	default:
-		WD_ERR("invalid: alg type %u not support!\n", d_msg->alg);
-		if (mb_queue->ctx_mode == CTX_MODE_ASYNC)
-			free(hash_job);
-		return -WD_EINVAL;
-	}
-
+	poll_queue = &mb_queue->poll_queue[d_msg->alg];
 	hash_mb_init_iv(poll_queue, d_msg, hash_job);
 	/* If block not need process, return directly. */
 	ret = hash_do_partial(poll_queue, d_msg, hash_job);
 	if (ret == -WD_EAGAIN) {
-		if (mb_queue->ctx_mode == CTX_MODE_ASYNC)
-			free(hash_job);
-
 		d_msg->result = WD_SUCCESS;
 		return WD_SUCCESS;
 	}
@@ -634,35 +780,20 @@ static int hash_recv_complete_job(struct hash_mb_queue *mb_queue, struct wd_dige
 {
 	struct hash_mb_poll_queue *poll_queue;
 	struct hash_job *hash_job;
-	__u32 total_len;
 
 	hash_job = hash_mb_find_complete_job(mb_queue);
 	if (!hash_job)
 		return -WD_EAGAIN;
 
 	if (!hash_job->opad.opad_size) {
-		msg->tag = hash_job->msg->tag;
+		msg->tag = hash_job - mb_queue->jobs + 1;
 		memcpy(hash_job->msg->out, hash_job->result_digest, hash_job->msg->out_bytes);
-		free(hash_job);
 		msg->result = WD_SUCCESS;
 		return WD_SUCCESS;
 	}
 
-	if (hash_job->msg->alg == WD_DIGEST_SM3)
-		poll_queue = &mb_queue->sm3_poll_queue;
-	else
-		poll_queue = &mb_queue->md5_poll_queue;
-	hash_job->buffer = hash_job->opad.opad + poll_queue->ops->iv_bytes;
-	memcpy(hash_job->buffer, hash_job->result_digest, poll_queue->ops->iv_bytes);
-	total_len = poll_queue->ops->iv_bytes + HASH_BLOCK_SIZE;
-	hash_mb_pad_data(&hash_job->pad, hash_job->buffer, poll_queue->ops->iv_bytes,
-			 total_len, hash_job->is_transfer);
-	memcpy(hash_job->result_digest, hash_job->opad.opad, poll_queue->ops->iv_bytes);
-	hash_job->opad.opad_size = 0;
-	hash_job->buffer = hash_job->pad.pad;
-	hash_job->len = hash_job->pad.pad_len;
-	hash_job->pad.pad_len = 0;
-
+	poll_queue = &mb_queue->poll_queue[hash_job->msg->alg];
+	hash_mb_opad_stage(poll_queue->ops, hash_job);
 	hash_mb_add_job_head(poll_queue, hash_job);
 
 	return -WD_EAGAIN;
@@ -700,16 +831,21 @@ static void hash_mb_add_finish_job(struct hash_mb_queue *mb_queue, struct hash_j
 	pthread_spin_unlock(&mb_queue->r_lock);
 }
 
+/* Process the fullest queue first, it fills the most lanes */
 static struct hash_mb_poll_queue *hash_get_poll_queue(struct hash_mb_queue *mb_queue)
 {
-	if (!mb_queue->sm3_poll_queue.job_num &&
-	    !mb_queue->md5_poll_queue.job_num)
-		return NULL;
+	struct hash_mb_poll_queue *poll_queue = NULL;
+	__u32 job_num = 0;
+	int i;
 
-	if (mb_queue->md5_poll_queue.job_num >= mb_queue->sm3_poll_queue.job_num)
-		return &mb_queue->md5_poll_queue;
+	for (i = 0; i < HASH_MB_ALG_NUM; i++) {
+		if (mb_queue->poll_queue[i].job_num > job_num) {
+			job_num = mb_queue->poll_queue[i].job_num;
+			poll_queue = &mb_queue->poll_queue[i];
+		}
+	}
 
-	return &mb_queue->sm3_poll_queue;
+	return poll_queue;
 }
 
 static int hash_mb_do_jobs(struct hash_mb_queue *mb_queue)
@@ -742,13 +878,13 @@ static int hash_mb_do_jobs(struct hash_mb_queue *mb_queue)
 		return -WD_EAGAIN;
 
 	if (j > HASH_NENO_PROCESS_JOBS) {
-		poll_queue->ops->sve(len, j, job_vecs);
+		poll_queue->ops->lanes(len, j, job_vecs);
 	} else if (j == HASH_NENO_PROCESS_JOBS) {
-		poll_queue->ops->asimd_x4(job_vecs[0], job_vecs[1],
-					  job_vecs[2], job_vecs[3], len);
+		poll_queue->ops->x4(job_vecs[0], job_vecs[1],
+				    job_vecs[2], job_vecs[3], len);
 	} else {
 		while (i < j)
-			poll_queue->ops->asimd_x1(job_vecs[i++], len);
+			poll_queue->ops->x1(job_vecs[i++], len);
 	}
 
 	for (i = 0; i < j; i++) {
@@ -763,7 +899,7 @@ static int hash_mb_do_jobs(struct hash_mb_queue *mb_queue)
 			}
 		} else {
 			job_vecs[i]->len -= len;
-			job_vecs[i]->buffer += len << HASH_BLOCK_OFFSET;
+			job_vecs[i]->buffer += len * poll_queue->ops->block_size;
 			hash_mb_add_job_head(poll_queue, job_vecs[i]);
 		}
 	}
@@ -799,11 +935,11 @@ static int hash_mb_get_usage(void *param)
 	return 0;
 }
 
-#define GEN_HASH_ALG_DRIVER(hash_alg_name) \
+#define GEN_HASH_ALG_DRIVER(hash_alg_name, type) \
 {\
 	.drv_name = "hash_mb",\
 	.alg_name = (hash_alg_name),\
-	.calc_type = UADK_ALG_SVE_INSTR,\
+	.calc_type = (type),\
 	.priority = 100,\
 	.queue_num = 1,\
 	.op_type_num = 1,\
@@ -816,8 +952,14 @@ static int hash_mb_get_usage(void *param)
 }
 
 static struct wd_alg_driver hash_mb_driver[] = {
-	GEN_HASH_ALG_DRIVER("sm3"),
-	GEN_HASH_ALG_DRIVER("md5"),
+	GEN_HASH_ALG_DRIVER("sm3", UADK_ALG_SVE_INSTR),
+	GEN_HASH_ALG_DRIVER("md5", UADK_ALG_SVE_INSTR),
+	/* The SHA kernels are plain C, they don't need SVE */
+	GEN_HASH_ALG_DRIVER("sha1", UADK_ALG_SOFT),
+	GEN_HASH_ALG_DRIVER("sha224", UADK_ALG_SOFT),
+	GEN_HASH_ALG_DRIVER("sha256", UADK_ALG_SOFT),
+	GEN_HASH_ALG_DRIVER("sha384", UADK_ALG_SOFT),
+	GEN_HASH_ALG_DRIVER("sha512", UADK_ALG_SOFT),
 };
 
 static void __attribute__((constructor)) hash_mb_probe(void)
@@ -14,21 +14,24 @@ extern "C" {
 #endif
 
 #define HASH_BLOCK_SIZE		64
-#define HASH_DIGEST_NWORDS	32
+#define HASH_MAX_BLOCK_SIZE	128
+#define HASH_DIGEST_NWORDS	64
+
+#define HASH_JOB_ALIGN		64
 
 #if __STDC_VERSION__ >= 201112L
-#	define	 __ALIGN_END	__attribute__((aligned(64)))
+#	define	 __ALIGN_END	__attribute__((aligned(HASH_JOB_ALIGN)))
 #else
-#	define __ALIGN_END	__aligned(64)
+#	define __ALIGN_END	__aligned(HASH_JOB_ALIGN)
 #endif
 
 struct hash_pad {
-	__u8 pad[HASH_BLOCK_SIZE * 2];
+	__u8 pad[HASH_MAX_BLOCK_SIZE * 2];
 	__u32 pad_len;
 };
 
 struct hash_opad {
-	__u8 opad[HASH_BLOCK_SIZE];
+	__u8 opad[HASH_DIGEST_NWORDS];
 	__u32 opad_size;
 };
 
@@ -40,7 +43,6 @@ struct hash_job {
 	struct hash_opad opad;
 	struct hash_job *next;
 	struct wd_digest_msg *msg;
-	bool is_transfer;
 };
 
 void sm3_mb_sve(int blocks, int total_lanes, struct hash_job **job_vec);
@@ -54,6 +56,23 @@ void md5_mb_asimd_x4(struct hash_job *job1, struct hash_job *job2,
 void md5_mb_asimd_x1(struct hash_job *job, int len);
 int md5_mb_sve_max_lanes(void);
 
+/* Portable C kernels of sha_mb.c, the lanes are vectorized by the compiler */
+void sha1_mb_lanes(int blocks, int total_lanes, struct hash_job **job_vec);
+void sha1_mb_x4(struct hash_job *job1, struct hash_job *job2,
+		struct hash_job *job3, struct hash_job *job4, int len);
+void sha1_mb_x1(struct hash_job *job, int len);
+int sha1_mb_max_lanes(void);
+void sha256_mb_lanes(int blocks, int total_lanes, struct hash_job **job_vec);
+void sha256_mb_x4(struct hash_job *job1, struct hash_job *job2,
+		  struct hash_job *job3, struct hash_job *job4, int len);
+void sha256_mb_x1(struct hash_job *job, int len);
+int sha256_mb_max_lanes(void);
+void sha512_mb_lanes(int blocks, int total_lanes, struct hash_job **job_vec);
+void sha512_mb_x4(struct hash_job *job1, struct hash_job *job2,
+		  struct hash_job *job3, struct hash_job *job4, int len);
+void sha512_mb_x1(struct hash_job *job, int len);
+int sha512_mb_max_lanes(void);
+
 #ifdef __cplusplus
 }
 #endif
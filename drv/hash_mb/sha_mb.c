@@ -0,0 +1,342 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved. */
+
+/*
+ * Multi-buffer SHA-1, SHA-256 and SHA-512 in portable C. The state and the
+ * message words of all lanes are kept lane by lane, so each step of a round
+ * is one loop over the lanes, which the compiler turns into NEON, SVE or
+ * AVX2 instructions of the target. SHA-224 and SHA-384 use the same kernels
+ * with their own IV.
+ */
+#include <endian.h>
+#include <string.h>
+#include "hash_mb.h"
+
+#define SHA_MB_LANES		8
+#define SHA1_STATE_WORDS	5
+#define SHA2_STATE_WORDS	8
+#define SHA_SCHED_WORDS		16
+#define SHA_SCHED_MASK		(SHA_SCHED_WORDS - 1)
+#define SHA1_ROUNDS		80
+#define SHA256_ROUNDS		64
+#define SHA512_ROUNDS		80
+#define SHA1_ROUND_STAGE	20
+#define SHA256_BLOCK_SIZE	64
+#define SHA512_BLOCK_SIZE	128
+
+static const __u32 sha1_k[SHA1_ROUNDS / SHA1_ROUND_STAGE] = {
+	0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
+};
+
+static const __u32 sha256_k[SHA256_ROUNDS] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const __u64 sha512_k[SHA512_ROUNDS] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+static inline __u32 rol32(__u32 x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static inline __u32 ror32(__u32 x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+static inline __u64 ror64(__u64 x, int n)
+{
+	return (x >> n) | (x << (64 - n));
+}
+
+static inline __u32 load_be32(const __u8 *p)
+{
+	__u32 v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return be32toh(v);
+}
+
+static inline __u64 load_be64(const __u8 *p)
+{
+	__u64 v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return be64toh(v);
+}
+
+static inline void store_be32(__u8 *p, __u32 v)
+{
+	v = htobe32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void store_be64(__u8 *p, __u64 v)
+{
+	v = htobe64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+/* The state is kept in result_digest as big-endian words, as the output */
+static void sha32_load_state(struct hash_job **jobs, int n, int words,
+			     __u32 st[][SHA_MB_LANES])
+{
+	int i, l;
+
+	for (l = 0; l < n; l++)
+		for (i = 0; i < words; i++)
+			st[i][l] = load_be32(jobs[l]->result_digest + i * sizeof(__u32));
+}
+
+static void sha32_store_state(struct hash_job **jobs, int n, int words,
+			      __u32 st[][SHA_MB_LANES])
+{
+	int i, l;
+
+	for (l = 0; l < n; l++)
+		for (i = 0; i < words; i++)
+			store_be32(jobs[l]->result_digest + i * sizeof(__u32), st[i][l]);
+}
+
+static void sha32_load_words(struct hash_job **jobs, int n, __u32 block,
+			     __u32 w[][SHA_MB_LANES])
+{
+	const __u8 *p;
+	int i, l;
+
+	for (l = 0; l < n; l++) {
+		p = (const __u8 *)jobs[l]->buffer + block * SHA256_BLOCK_SIZE;
+		for (i = 0; i < SHA_SCHED_WORDS; i++)
+			w[i][l] = load_be32(p + i * sizeof(__u32));
+	}
+}
+
+static void sha1_mb_lanes_n(struct hash_job **jobs, int n, int blocks)
+{
+	__u32 st[SHA1_STATE_WORDS][SHA_MB_LANES];
+	__u32 w[SHA_SCHED_WORDS][SHA_MB_LANES];
+	__u32 a[SHA_MB_LANES], b[SHA_MB_LANES], c[SHA_MB_LANES];
+	__u32 d[SHA_MB_LANES], e[SHA_MB_LANES];
+	__u32 f, k, t, x;
+	int i, l, blk;
+
+	sha32_load_state(jobs, n, SHA1_STATE_WORDS, st);
+
+	for (blk = 0; blk < blocks; blk++) {
+		sha32_load_words(jobs, n, blk, w);
+		for (l = 0; l < n; l++) {
+			a[l] = st[0][l];
+			b[l] = st[1][l];
+			c[l] = st[2][l];
+			d[l] = st[3][l];
+			e[l] = st[4][l];
+		}
+
+		for (i = 0; i < SHA1_ROUNDS; i++) {
+			k = sha1_k[i / SHA1_ROUND_STAGE];
+			for (l = 0; l < n; l++) {
+				if (i >= SHA_SCHED_WORDS) {
+					x = w[(i - 3) & SHA_SCHED_MASK][l] ^ w[(i - 8) & SHA_SCHED_MASK][l] ^
+					    w[(i - 14) & SHA_SCHED_MASK][l] ^ w[i & SHA_SCHED_MASK][l];
+					w[i & SHA_SCHED_MASK][l] = rol32(x, 1);
+				}
+
+				if (i < SHA1_ROUND_STAGE)
+					f = (b[l] & c[l]) | (~b[l] & d[l]);
+				else if (i >= SHA1_ROUND_STAGE * 2 && i < SHA1_ROUND_STAGE * 3)
+					f = (b[l] & c[l]) | (b[l] & d[l]) | (c[l] & d[l]);
+				else
+					f = b[l] ^ c[l] ^ d[l];
+
+				t = rol32(a[l], 5) + f + e[l] + k + w[i & SHA_SCHED_MASK][l];
+				e[l] = d[l];
+				d[l] = c[l];
+				c[l] = rol32(b[l], 30);
+				b[l] = a[l];
+				a[l] = t;
+			}
+		}
+
+		for (l = 0; l < n; l++) {
+			st[0][l] += a[l];
+			st[1][l] += b[l];
+			st[2][l] += c[l];
+			st[3][l] += d[l];
+			st[4][l] += e[l];
+		}
+	}
+
+	sha32_store_state(jobs, n, SHA1_STATE_WORDS, st);
+}
+
+static void sha256_mb_lanes_n(struct hash_job **jobs, int n, int blocks)
+{
+	__u32 st[SHA2_STATE_WORDS][SHA_MB_LANES];
+	__u32 w[SHA_SCHED_WORDS][SHA_MB_LANES];
+	__u32 v[SHA2_STATE_WORDS][SHA_MB_LANES];
+	__u32 s0, s1, t1, t2, x;
+	int i, j, l, blk;
+
+	sha32_load_state(jobs, n, SHA2_STATE_WORDS, st);
+
+	for (blk = 0; blk < blocks; blk++) {
+		sha32_load_words(jobs, n, blk, w);
+		memcpy(v, st, sizeof(v));
+
+		for (i = 0; i < SHA256_ROUNDS; i++) {
+			/* v[7 - j] is the variable a ~ h of round i, rotated by i */
+			j = i & (SHA2_STATE_WORDS - 1);
+			for (l = 0; l < n; l++) {
+				if (i >= SHA_SCHED_WORDS) {
+					x = w[(i - 15) & SHA_SCHED_MASK][l];
+					s0 = ror32(x, 7) ^ ror32(x, 18) ^ (x >> 3);
+					x = w[(i - 2) & SHA_SCHED_MASK][l];
+					s1 = ror32(x, 17) ^ ror32(x, 19) ^ (x >> 10);
+					w[i & SHA_SCHED_MASK][l] += s0 + s1 +
+								    w[(i - 7) & SHA_SCHED_MASK][l];
+				}
+
+#define V(m)	v[((m) - j) & (SHA2_STATE_WORDS - 1)][l]
+				x = V(4);
+				t1 = V(7) + (ror32(x, 6) ^ ror32(x, 11) ^ ror32(x, 25)) +
+				     ((x & V(5)) ^ (~x & V(6))) + sha256_k[i] +
+				     w[i & SHA_SCHED_MASK][l];
+				x = V(0);
+				t2 = (ror32(x, 2) ^ ror32(x, 13) ^ ror32(x, 22)) +
+				     ((x & V(1)) ^ (x & V(2)) ^ (V(1) & V(2)));
+				V(3) += t1;
+				V(7) = t1 + t2;
+#undef V
+			}
+		}
+
+		for (i = 0; i < SHA2_STATE_WORDS; i++)
+			for (l = 0; l < n; l++)
+				st[i][l] += v[i][l];
+	}
+
+	sha32_store_state(jobs, n, SHA2_STATE_WORDS, st);
+}
+
+static void sha512_mb_lanes_n(struct hash_job **jobs, int n, int blocks)
+{
+	__u64 st[SHA2_STATE_WORDS][SHA_MB_LANES];
+	__u64 w[SHA_SCHED_WORDS][SHA_MB_LANES];
+	__u64 v[SHA2_STATE_WORDS][SHA_MB_LANES];
+	__u64 s0, s1, t1, t2, x;
+	const __u8 *p;
+	int i, j, l, blk;
+
+	for (l = 0; l < n; l++)
+		for (i = 0; i < SHA2_STATE_WORDS; i++)
+			st[i][l] = load_be64(jobs[l]->result_digest + i * sizeof(__u64));
+
+	for (blk = 0; blk < blocks; blk++) {
+		for (l = 0; l < n; l++) {
+			p = (const __u8 *)jobs[l]->buffer + blk * SHA512_BLOCK_SIZE;
+			for (i = 0; i < SHA_SCHED_WORDS; i++)
+				w[i][l] = load_be64(p + i * sizeof(__u64));
+		}
+		memcpy(v, st, sizeof(v));
+
+		for (i = 0; i < SHA512_ROUNDS; i++) {
+			j = i & (SHA2_STATE_WORDS - 1);
+			for (l = 0; l < n; l++) {
+				if (i >= SHA_SCHED_WORDS) {
+					x = w[(i - 15) & SHA_SCHED_MASK][l];
+					s0 = ror64(x, 1) ^ ror64(x, 8) ^ (x >> 7);
+					x = w[(i - 2) & SHA_SCHED_MASK][l];
+					s1 = ror64(x, 19) ^ ror64(x, 61) ^ (x >> 6);
+					w[i & SHA_SCHED_MASK][l] += s0 + s1 +
+								    w[(i - 7) & SHA_SCHED_MASK][l];
+				}
+
+#define V(m)	v[((m) - j) & (SHA2_STATE_WORDS - 1)][l]
+				x = V(4);
+				t1 = V(7) + (ror64(x, 14) ^ ror64(x, 18) ^ ror64(x, 41)) +
+				     ((x & V(5)) ^ (~x & V(6))) + sha512_k[i] +
+				     w[i & SHA_SCHED_MASK][l];
+				x = V(0);
+				t2 = (ror64(x, 28) ^ ror64(x, 34) ^ ror64(x, 39)) +
+				     ((x & V(1)) ^ (x & V(2)) ^ (V(1) & V(2)));
+				V(3) += t1;
+				V(7) = t1 + t2;
+#undef V
+			}
+		}
+
+		for (i = 0; i < SHA2_STATE_WORDS; i++)
+			for (l = 0; l < n; l++)
+				st[i][l] += v[i][l];
+	}
+
+	for (l = 0; l < n; l++)
+		for (i = 0; i < SHA2_STATE_WORDS; i++)
+			store_be64(jobs[l]->result_digest + i * sizeof(__u64), st[i][l]);
+}
+
+/* The jobs are hashed SHA_MB_LANES by SHA_MB_LANES */
+#define GEN_SHA_MB_KERNEL(name) \
+void name##_mb_lanes(int blocks, int total_lanes, struct hash_job **job_vec) \
+{ \
+	int n; \
+\
+	while (total_lanes > 0) { \
+		n = total_lanes < SHA_MB_LANES ? total_lanes : SHA_MB_LANES; \
+		name##_mb_lanes_n(job_vec, n, blocks); \
+		job_vec += n; \
+		total_lanes -= n; \
+	} \
+} \
+\
+void name##_mb_x4(struct hash_job *job1, struct hash_job *job2, \
+		  struct hash_job *job3, struct hash_job *job4, int len) \
+{ \
+	struct hash_job *jobs[] = {job1, job2, job3, job4}; \
+\
+	name##_mb_lanes_n(jobs, ARRAY_SIZE(jobs), len); \
+} \
+\
+void name##_mb_x1(struct hash_job *job, int len) \
+{ \
+	name##_mb_lanes_n(&job, 1, len); \
+} \
+\
+int name##_mb_max_lanes(void) \
+{ \
+	return SHA_MB_LANES; \
+}
+
+GEN_SHA_MB_KERNEL(sha1)
+GEN_SHA_MB_KERNEL(sha256)
+GEN_SHA_MB_KERNEL(sha512)
@@ -1006,16 +1006,13 @@ static void get_ctx_buf(struct hisi_zip_sqe *sqe,
 static int parse_zip_sqe(struct hisi_qp *qp, struct hisi_zip_sqe *sqe,
 			 struct wd_comp_msg *msg)
 {
-	__u32 buf_type = (sqe->dw9 & HZ_BUF_TYPE_MASK) >> BUF_TYPE_SHIFT;
-	__u16 ctx_st = sqe->ctx_dw0 & HZ_CTX_ST_MASK;
-	__u16 lstblk = sqe->dw3 & HZ_LSTBLK_MASK;
-	__u32 status = sqe->dw3 & HZ_STATUS_MASK;
-	__u32 type = sqe->dw9 & HZ_REQ_TYPE_MASK;
 	struct wd_comp_msg *recv_msg = msg;
 	bool need_debug = wd_need_debug();
+	__u32 buf_type, status, type, tag;
+	__u16 ctx_st, lstblk;
 	int alg_type, ret;
-	__u32 tag;
 
+	type = sqe->dw9 & HZ_REQ_TYPE_MASK;
 	alg_type = get_alg_type(type);
 	if (unlikely(alg_type < 0)) {
 		WD_ERR("invalid: hardware type is %u!\n", type);
@@ -1023,10 +1020,19 @@ static int parse_zip_sqe(struct hisi_qp *qp, struct hisi_zip_sqe *sqe,
 	}
 
 	tag = ops[alg_type].get_tag(sqe);
-	ret = hisi_check_bd_id((handle_t)qp, recv_msg->tag, tag);
+	ret = hisi_check_bd_id((handle_t)qp, sqe, recv_msg->tag, tag);
 	if (ret)
 		return ret;
 
+	/* The sqe may be swapped with the stashed one, whose type was checked */
+	type = sqe->dw9 & HZ_REQ_TYPE_MASK;
+	alg_type = get_alg_type(type);
+	tag = ops[alg_type].get_tag(sqe);
+
+	buf_type = (sqe->dw9 & HZ_BUF_TYPE_MASK) >> BUF_TYPE_SHIFT;
+	ctx_st = sqe->ctx_dw0 & HZ_CTX_ST_MASK;
+	lstblk = sqe->dw3 & HZ_LSTBLK_MASK;
+	status = sqe->dw3 & HZ_STATUS_MASK;
 	recv_msg->tag = tag;
 
 	if (qp->q_info.qp_mode == CTX_MODE_ASYNC) {
@@ -1107,6 +1113,7 @@ static int hisi_zip_comp_recv(struct wd_alg_driver *drv, handle_t ctx, void *com
 	.exit = hisi_zip_exit,\
 	.send = hisi_zip_comp_send,\
 	.recv = hisi_zip_comp_recv,\
+	.send_batch = hisi_qm_send_batch,\
 }
 
 static struct wd_alg_driver zip_alg_driver[] = {
@@ -667,8 +667,11 @@ static int hashagg_recv(struct wd_alg_driver *drv, handle_t ctx, void *hashagg_m
 	if (ret)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, msg->tag, sqe.low_tag);
-	if (ret)
+	ret = hisi_check_bd_id(h_qp, &sqe, msg->tag, sqe.low_tag);
+	/* The stashed sqe of another msg keeps its extend addr */
+	if (ret == -WD_EAGAIN)
+		return ret;
+	else if (ret)
 		goto out;
 
 	msg->tag = sqe.low_tag;
@@ -671,7 +671,7 @@ static int rsa_recv(struct wd_alg_driver *drv, handle_t ctx, void *rsa_msg)
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, msg->tag, hw_msg.low_tag);
+	ret = hisi_check_bd_id(h_qp, &hw_msg, msg->tag, hw_msg.low_tag);
 	if (ret)
 		return ret;
 
@@ -814,7 +814,7 @@ static int dh_recv(struct wd_alg_driver *drv, handle_t ctx, void *dh_msg)
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, msg->tag, hw_msg.low_tag);
+	ret = hisi_check_bd_id(h_qp, &hw_msg, msg->tag, hw_msg.low_tag);
 	if (ret)
 		return ret;
 
@@ -2474,7 +2474,7 @@ static int ecc_recv(struct wd_alg_driver *drv, handle_t ctx, void *ecc_msg)
 	if (ret)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, msg->tag, hw_msg.low_tag);
+	ret = hisi_check_bd_id(h_qp, &hw_msg, msg->tag, hw_msg.low_tag);
 	if (ret)
 		return ret;
 
@@ -2507,6 +2507,7 @@ static int hpre_get_usage(void *param)
 	.send = ecc_send,\
 	.recv = ecc_recv,\
 	.get_usage = hpre_get_usage,\
+	.send_batch = hisi_qm_send_batch,\
 }
 
 static struct wd_alg_driver hpre_ecc_driver[] = {
@@ -2530,6 +2531,7 @@ static struct wd_alg_driver hpre_rsa_driver = {
 	.send = rsa_send,
 	.recv = rsa_recv,
 	.get_usage = hpre_get_usage,
+	.send_batch = hisi_qm_send_batch,
 };
 
 static struct wd_alg_driver hpre_dh_driver = {
@@ -2545,6 +2547,7 @@ static struct wd_alg_driver hpre_dh_driver = {
 	.send = dh_send,
 	.recv = dh_recv,
 	.get_usage = hpre_get_usage,
+	.send_batch = hisi_qm_send_batch,
 };
 
 #ifdef WD_STATIC_DRV
@@ -141,6 +141,17 @@ static int hacc_db_v2(struct hisi_qm_queue_info *q, __u8 cmd,
 	return 0;
 }
 
+/* The queue is emulated in userspace, the doorbell goes to the emulator. */
+static int hacc_db_emu(struct hisi_qm_queue_info *q, __u8 cmd,
+		       __u16 idx, __u8 priority)
+{
+	struct hisi_qp *qp = container_of(q, struct hisi_qp, q_info);
+
+	wd_ctx_emu_db(qp->h_ctx, cmd, idx);
+
+	return 0;
+}
+
 static struct hisi_qm_type qm_type[] = {
 	{
 		.qm_ver		= HISI_QM_API_VER_BASE,
@@ -231,6 +242,12 @@ static int hisi_qm_setup_db(handle_t h_ctx, struct hisi_qm_queue_info *q_info)
 		return -WD_EINVAL;
 
 	q_info->hw_type = ver_id;
+	if (wd_ctx_is_emu(h_ctx)) {
+		q_info->db = hacc_db_emu;
+		q_info->db_base = q_info->mmio_base;
+		return 0;
+	}
+
 	size = ARRAY_SIZE(qm_type);
 	for (i = 0; i < size; i++) {
 		if (qm_type[i].qm_ver == ver_id) {
@@ -345,10 +362,30 @@ static int hisi_qm_setup_info(struct hisi_qp *qp, struct hisi_qm_priv *config)
 		q_info->region_size[UACCE_QFRT_DUS] - sizeof(uint32_t);
 	q_info->ds_rx_base = q_info->ds_tx_base - sizeof(uint32_t);
 
+	/*
+	 * With epoll, each msg should match one wakeup, so the ready cqes
+	 * are not cached in advance.
+	 */
+	if (!q_info->epoll_en) {
+		q_info->rx_cache = calloc(HISI_QM_RECV_BATCH, q_info->sqe_size);
+		if (!q_info->rx_cache) {
+			ret = -WD_ENOMEM;
+			goto err_out;
+		}
+	}
+
+	if (q_info->qp_mode == CTX_MODE_SYNC) {
+		q_info->sync_stash = calloc(HISI_QM_SYNC_STASH_NUM, q_info->sqe_size);
+		if (!q_info->sync_stash) {
+			ret = -WD_ENOMEM;
+			goto err_free_cache;
+		}
+	}
+
 	ret = pthread_spin_init(&q_info->rv_lock, PTHREAD_PROCESS_SHARED);
 	if (ret) {
 		WD_DEV_ERR(qp->h_ctx, "failed to init qinfo rv_lock!\n");
-		goto err_out;
+		goto err_free_cache;
 	}
 
 	ret = pthread_spin_init(&q_info->sd_lock, PTHREAD_PROCESS_SHARED);
@@ -361,6 +398,11 @@ static int hisi_qm_setup_info(struct hisi_qp *qp, struct hisi_qm_priv *config)
 
 err_destroy_lock:
 	pthread_spin_destroy(&q_info->rv_lock);
+err_free_cache:
+	free(q_info->sync_stash);
+	q_info->sync_stash = NULL;
+	free(q_info->rx_cache);
+	q_info->rx_cache = NULL;
 err_out:
 	hisi_qm_unset_region(qp->h_ctx, q_info);
 	return ret;
@@ -372,6 +414,10 @@ static void hisi_qm_clear_info(struct hisi_qp *qp)
 
 	pthread_spin_destroy(&q_info->sd_lock);
 	pthread_spin_destroy(&q_info->rv_lock);
+	free(q_info->sync_stash);
+	q_info->sync_stash = NULL;
+	free(q_info->rx_cache);
+	q_info->rx_cache = NULL;
 	hisi_qm_unset_region(qp->h_ctx, q_info);
 }
 
@@ -482,6 +528,16 @@ int hisi_qm_send(handle_t h_qp, const void *req, __u16 expect, __u16 *count)
 	hisi_qm_fill_sqe(req, q_info, tail, send_num);
 	tail = (tail + send_num) % q_info->sq_depth;
 
+	/* In a send batch, the doorbell is rung once by hisi_qm_send_batch. */
+	if (q_info->db_defer) {
+		q_info->sq_tail_index = tail;
+		q_info->db_pending = true;
+		__atomic_add_fetch(&q_info->used_num, send_num, __ATOMIC_RELAXED);
+		pthread_spin_unlock(&q_info->sd_lock);
+		*count = send_num;
+		return 0;
+	}
+
 	/*
 	 * Before sending doorbell, check the queue status,
 	 * if the queue is disable, return failure.
@@ -505,46 +561,117 @@ int hisi_qm_send(handle_t h_qp, const void *req, __u16 expect, __u16 *count)
 	return 0;
 }
 
-static int hisi_qm_recv_single(struct hisi_qm_queue_info *q_info, handle_t h_ctx,
-			       void *resp, __u16 idx)
+static int hisi_qm_flush_sq(struct hisi_qp *qp)
 {
-	__u16 i, j, cqe_phase;
-	struct cqe *cqe;
+	struct hisi_qm_queue_info *q_info = &qp->q_info;
+	int ret = 0;
 
-	pthread_spin_lock(&q_info->rv_lock);
-	i = q_info->cq_head_index;
-	cqe = q_info->cq_base + i * sizeof(struct cqe);
-	cqe_phase = CQE_PHASE(cqe);
-	/* Use dsb to read from memory and improve the receiving efficiency. */
-	rmb();
+	pthread_spin_lock(&q_info->sd_lock);
+	q_info->db_defer--;
+	if (q_info->db_defer || !q_info->db_pending)
+		goto out;
 
-	if (q_info->cqc_phase != cqe_phase) {
-		pthread_spin_unlock(&q_info->rv_lock);
-		return -WD_EAGAIN;
+	q_info->db_pending = false;
+	if (unlikely(wd_ioread32(q_info->ds_tx_base) == 1)) {
+		WD_DEV_ERR(qp->h_ctx, "wd queue hw error happened before qm send!\n");
+		ret = -WD_HW_EACCESS;
+		goto out;
 	}
 
-	j = CQE_SQ_HEAD_INDEX(cqe);
-	if (unlikely(j >= q_info->sq_depth)) {
-		pthread_spin_unlock(&q_info->rv_lock);
-		WD_DEV_ERR(h_ctx, "CQE_SQ_HEAD_INDEX(%u) error!\n", j);
-		return -WD_EIO;
+	/* Make sure sqes are filled before db ring and queue status check is complete. */
+	mb();
+	q_info->db(q_info, QM_DBELL_CMD_SQ, q_info->sq_tail_index, 0);
+out:
+	pthread_spin_unlock(&q_info->sd_lock);
+
+	return ret;
+}
+
+int hisi_qm_send_batch(struct wd_alg_driver *drv, handle_t ctx,
+		       void **msgs, __u32 num, __u32 *count)
+{
+	struct hisi_qp *qp = (struct hisi_qp *)wd_ctx_get_priv(ctx);
+	struct hisi_qm_queue_info *q_info;
+	int send_ret = 0;
+	int ret;
+	__u32 i;
+
+	if (unlikely(!qp || !msgs || !count))
+		return -WD_EINVAL;
+
+	q_info = &qp->q_info;
+	pthread_spin_lock(&q_info->sd_lock);
+	q_info->db_defer++;
+	pthread_spin_unlock(&q_info->sd_lock);
+
+	for (i = 0; i < num; i++) {
+		send_ret = drv->send(drv, ctx, msgs[i]);
+		if (unlikely(send_ret < 0))
+			break;
 	}
-	memcpy((void *)((uintptr_t)resp + idx * q_info->sqe_size),
-	       (void *)((uintptr_t)q_info->sq_base + j * q_info->sqe_size), q_info->sqe_size);
 
-	if (i == q_info->cq_depth - 1) {
-		q_info->cqc_phase = !(q_info->cqc_phase);
-		i = 0;
-	} else {
-		i++;
+	/* The filled sqes stay in the sq even if the doorbell fails */
+	ret = hisi_qm_flush_sq(qp);
+	*count = i;
+
+	return ret ? ret : send_ret;
+}
+
+/*
+ * Drain up to @expect ready cqes into @resp, the cq doorbell is rung and the
+ * queue status is checked once for all of them. Called with rv_lock held.
+ */
+static int hisi_qm_drain_cq(struct hisi_qm_queue_info *q_info, handle_t h_ctx,
+			    void *resp, __u16 expect, __u16 *count)
+{
+	bool cqc_phase = q_info->cqc_phase;
+	__u16 i = q_info->cq_head_index;
+	__u16 j, cqe_phase, num = 0;
+	struct cqe *cqe;
+	int ret = 0;
+
+	*count = 0;
+	if (unlikely(wd_ioread32(q_info->ds_rx_base) == 1)) {
+		WD_DEV_ERR(h_ctx, "wd queue hw error happened before qm receive!\n");
+		return -WD_HW_EACCESS;
+	}
+
+	while (num < expect) {
+		cqe = q_info->cq_base + i * sizeof(struct cqe);
+		cqe_phase = CQE_PHASE(cqe);
+		/* Use dsb to read from memory and improve the receiving efficiency. */
+		rmb();
+
+		if (cqc_phase != cqe_phase)
+			break;
+
+		j = CQE_SQ_HEAD_INDEX(cqe);
+		if (unlikely(j >= q_info->sq_depth)) {
+			WD_DEV_ERR(h_ctx, "CQE_SQ_HEAD_INDEX(%u) error!\n", j);
+			ret = -WD_EIO;
+			break;
+		}
+		memcpy((void *)((uintptr_t)resp + num * q_info->sqe_size),
+		       (void *)((uintptr_t)q_info->sq_base + j * q_info->sqe_size),
+		       q_info->sqe_size);
+		num++;
+
+		if (i == q_info->cq_depth - 1) {
+			cqc_phase = !cqc_phase;
+			i = 0;
+		} else {
+			i++;
+		}
 	}
 
+	if (!num)
+		return ret ? ret : -WD_EAGAIN;
+
 	/*
 	 * Before sending doorbell, check the queue status,
 	 * if the queue is disable, return failure.
 	 */
 	if (unlikely(wd_ioread32(q_info->ds_rx_base) == 1)) {
-		pthread_spin_unlock(&q_info->rv_lock);
 		WD_DEV_ERR(h_ctx, "wd queue hw error happened before qm receive!\n");
 		return -WD_HW_EACCESS;
 	}
@@ -553,22 +680,36 @@ static int hisi_qm_recv_single(struct hisi_qm_queue_info *q_info, handle_t h_ctx
 	rmb();
 	q_info->db(q_info, QM_DBELL_CMD_CQ, i, q_info->epoll_en);
 
-	/* only support one thread poll one queue, so no need protect */
 	q_info->cq_head_index = i;
-
-	__atomic_sub_fetch(&q_info->used_num, 1, __ATOMIC_RELAXED);
-	pthread_spin_unlock(&q_info->rv_lock);
+	q_info->cqc_phase = cqc_phase;
+	__atomic_sub_fetch(&q_info->used_num, num, __ATOMIC_RELAXED);
+	*count = num;
 
 	return 0;
 }
 
+static __u16 hisi_qm_recv_from_cache(struct hisi_qm_queue_info *q_info,
+				     void *resp, __u16 expect)
+{
+	__u16 num = expect > q_info->rx_cache_num ? q_info->rx_cache_num : expect;
+
+	if (!num)
+		return 0;
+
+	memcpy(resp, (void *)((uintptr_t)q_info->rx_cache +
+	       q_info->rx_cache_head * q_info->sqe_size), num * q_info->sqe_size);
+	q_info->rx_cache_head += num;
+	q_info->rx_cache_num -= num;
+
+	return num;
+}
+
 int hisi_qm_recv(handle_t h_qp, void *resp, __u16 expect, __u16 *count)
 {
 	struct hisi_qp *qp = (struct hisi_qp *)h_qp;
 	struct hisi_qm_queue_info *q_info;
-	__u16 recv_num = 0;
-	__u16 i;
-	int ret;
+	__u16 recv_num, drain_num = 0;
+	int ret = 0;
 
 	if (unlikely(!resp || !qp || !count))
 		return -WD_EINVAL;
@@ -577,35 +718,101 @@ int hisi_qm_recv(handle_t h_qp, void *resp, __u16 expect, __u16 *count)
 		return 0;
 
 	q_info = &qp->q_info;
-	if (unlikely(wd_ioread32(q_info->ds_rx_base) == 1)) {
-		WD_DEV_ERR(qp->h_ctx, "wd queue hw error happened before qm receive!\n");
-		return -WD_HW_EACCESS;
+
+	pthread_spin_lock(&q_info->rv_lock);
+	recv_num = hisi_qm_recv_from_cache(q_info, resp, expect);
+	if (recv_num == expect)
+		goto out;
+
+	resp = (void *)((uintptr_t)resp + recv_num * q_info->sqe_size);
+	if (!q_info->rx_cache || expect - recv_num >= HISI_QM_RECV_BATCH) {
+		ret = hisi_qm_drain_cq(q_info, qp->h_ctx, resp,
+				       expect - recv_num, &drain_num);
+		recv_num += drain_num;
+	} else {
+		ret = hisi_qm_drain_cq(q_info, qp->h_ctx, q_info->rx_cache,
+				       HISI_QM_RECV_BATCH, &drain_num);
+		q_info->rx_cache_head = 0;
+		q_info->rx_cache_num = drain_num;
+		recv_num += hisi_qm_recv_from_cache(q_info, resp, expect - recv_num);
 	}
 
-	for (i = 0; i < expect; i++) {
-		ret = hisi_qm_recv_single(q_info, qp->h_ctx, resp, i);
-		if (ret)
-			break;
-		recv_num++;
+	/*
+	 * Nothing new is ready, hand back one stashed response, and
+	 * hisi_check_bd_id() looks up the whole stash for the awaited msg.
+	 * It is done once until the awaited msg changes.
+	 */
+	if (!recv_num && ret == -WD_EAGAIN && q_info->sync_stash_check &&
+	    q_info->sync_stash_num) {
+		q_info->sync_stash_check = false;
+		q_info->sync_stash_num--;
+		memcpy(resp, (void *)((uintptr_t)q_info->sync_stash +
+		       q_info->sync_stash_num * q_info->sqe_size), q_info->sqe_size);
+		recv_num = 1;
 	}
 
+	/* The received msgs are returned, the error is reported in next call. */
+	if (recv_num)
+		ret = 0;
+out:
+	pthread_spin_unlock(&q_info->rv_lock);
 	*count = recv_num;
 
 	return ret;
 }
 
-int hisi_check_bd_id(handle_t h_qp, __u32 mid, __u32 bid)
+static void hisi_qm_swap_sqe(void *a, void *b, int size)
+{
+	__u8 *x = a, *y = b;
+	__u8 tmp;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		tmp = x[i];
+		x[i] = y[i];
+		y[i] = tmp;
+	}
+}
+
+int hisi_check_bd_id(handle_t h_qp, void *sqe, __u32 mid, __u32 bid)
 {
 	struct hisi_qp *qp = (struct hisi_qp *)h_qp;
-	__u8 mode = qp->q_info.qp_mode;
+	struct hisi_qm_queue_info *q_info = &qp->q_info;
+	void *slot;
+	__u16 i;
 
-	if (mode == CTX_MODE_SYNC && mid != bid) {
-		WD_DEV_ERR(qp->h_ctx, "failed to recv self bd, send id: %u, recv id: %u\n",
-			    mid, bid);
-		return -WD_EINVAL;
+	if (q_info->qp_mode != CTX_MODE_SYNC)
+		return 0;
+
+	/* The caller holds the sync ctx, so the stash needs no lock */
+	q_info->sync_stash_drop = true;
+	if (mid == bid) {
+		q_info->sync_stash_check = true;
+		return 0;
 	}
 
-	return 0;
+	for (i = 0; i < q_info->sync_stash_num; i++) {
+		if (q_info->sync_stash_id[i] != mid)
+			continue;
+
+		slot = (void *)((uintptr_t)q_info->sync_stash + i * q_info->sqe_size);
+		hisi_qm_swap_sqe(sqe, slot, q_info->sqe_size);
+		q_info->sync_stash_id[i] = bid;
+		q_info->sync_stash_check = true;
+		return 0;
+	}
+
+	if (q_info->sync_stash_num < HISI_QM_SYNC_STASH_NUM) {
+		slot = (void *)((uintptr_t)q_info->sync_stash +
+				q_info->sync_stash_num * q_info->sqe_size);
+		memcpy(slot, sqe, q_info->sqe_size);
+		q_info->sync_stash_id[q_info->sync_stash_num++] = bid;
+		return -WD_EAGAIN;
+	}
+
+	WD_DEV_ERR(qp->h_ctx, "failed to recv self bd, send id: %u, recv id: %u\n",
+		    mid, bid);
+	return -WD_EINVAL;
 }
 
 void hisi_set_msg_id(handle_t h_qp, __u32 *tag)
@@ -622,6 +829,16 @@ void hisi_set_msg_id(handle_t h_qp, __u32 *tag)
 	 * that 1024 packets on a queue will not have duplicate id
 	 */
 	if (mode == CTX_MODE_SYNC) {
+		/*
+		 * A new sync task sends, the responses left in the stash
+		 * belong to the msgs of former tasks which were given up.
+		 */
+		if (qp->q_info.sync_stash_drop) {
+			qp->q_info.sync_stash_drop = false;
+			qp->q_info.sync_stash_check = false;
+			qp->q_info.sync_stash_num = 0;
+		}
+
 		seeds[0] = LW_U16(rand_seed);
 		seeds[1] = LW_U16(rand_seed >> 16);
 		id = nrand48(seeds);
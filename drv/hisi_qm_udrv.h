@@ -17,6 +17,10 @@ extern "C" {
 #endif
 
 #define WD_CAPA_PRIV_DATA_SIZE		64
+/* Max number of cqes drained into the rx cache of a qp at a time */
+#define HISI_QM_RECV_BATCH		16
+/* Responses of a sync batch which arrive before the one being waited for */
+#define HISI_QM_SYNC_STASH_NUM		WD_MAX_BATCH_NUM
 
 #define QM_L32BITS_MASK		0xffffffff
 #define QM_L16BITS_MASK		0xffff
@@ -75,7 +79,22 @@ struct hisi_qm_queue_info {
 	__u16 used_num;
 	__u16 hw_type;
 	__u32 idx;
+	/* Number of open send batches, the sq doorbell is deferred if not 0 */
+	__u32 db_defer;
+	bool db_pending;
 	bool cqc_phase;
+	/* Drained sqes which are not returned to the alg driver yet */
+	void *rx_cache;
+	__u16 rx_cache_head;
+	__u16 rx_cache_num;
+	/* Sync responses received out of order, and their bd ids */
+	void *sync_stash;
+	__u32 sync_stash_id[HISI_QM_SYNC_STASH_NUM];
+	__u16 sync_stash_num;
+	/* The awaited msg changed, the stash is looked up once for it */
+	bool sync_stash_check;
+	/* Responses were checked, the stash is stale at the next send */
+	bool sync_stash_drop;
 	pthread_spinlock_t sd_lock;
 	pthread_spinlock_t rv_lock;
 	unsigned long region_size[UACCE_QFRT_MAX];
@@ -113,12 +132,34 @@ struct hisi_qm_capa {
  */
 int hisi_qm_send(handle_t h_qp, const void *req, __u16 expect, __u16 *count);
 
+/**
+ * hisi_qm_send_batch - Send a group of msgs with one sq doorbell.
+ * @drv: The alg driver, its send callback is used to fill each msg.
+ * @ctx: The handle of the ctx.
+ * @msgs: Msgs of the alg driver.
+ * @num: Number of msgs.
+ * @count: The count of actual sending msgs.
+ *
+ * It can be used as the send_batch callback of the hisi alg drivers.
+ * If the hardware error happens before the doorbell, no msg is sent.
+ */
+int hisi_qm_send_batch(struct wd_alg_driver *drv, handle_t ctx,
+		       void **msgs, __u32 num, __u32 *count);
+
 /**
  * hisi_qm_recv - Recieve msg from qm of the device.
  * @h_qp: Handle of the qp.
  * @resp: Msg out buffer of the user.
  * @expect: User recieve req num.
  * @count: The count of actual recieving message.
+ *
+ * The ready cqes are drained in batch, with one lock and one cq doorbell.
+ * If @expect is less than HISI_QM_RECV_BATCH, up to HISI_QM_RECV_BATCH
+ * cqes are drained into the rx cache of the qp, and the following calls
+ * are served from the cache without accessing the queue. The cache is
+ * not used when epoll is enabled. For a sync qp, a stashed response is
+ * returned once per awaited msg if no new one is ready, see
+ * hisi_check_bd_id().
  */
 int hisi_qm_recv(handle_t h_qp, void *resp, __u16 expect, __u16 *count);
 
@@ -128,10 +169,18 @@ void hisi_qm_free_qp(handle_t h_qp);
 /**
  * hisi_check_bd_id - Check the SQE BD's id and send msg id.
  * @h_qp: Handle of the qp.
+ * @sqe: the received SQE.
  * @mid: send message id.
  * @bid: recv BD id.
+ *
+ * The msgs of a sync batch may complete out of order. If @sqe belongs to
+ * another msg, it is stashed and the stashed SQE of @mid is returned in
+ * @sqe instead, or -WD_EAGAIN if it has not arrived yet. The sync tasks of
+ * a qp are serialized, so the stash is dropped by hisi_set_msg_id() when
+ * the next task sends: what is left there belongs to msgs which timed out
+ * or failed.
  */
-int hisi_check_bd_id(handle_t h_qp, __u32 mid, __u32 bid);
+int hisi_check_bd_id(handle_t h_qp, void *sqe, __u32 mid, __u32 bid);
 
 /**
  * hisi_set_msg_id - set the message tag id.
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 /* Copyright 2020-2021 Huawei Technologies Co.,Ltd. All rights reserved. */
 
+#include <endian.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -64,15 +65,12 @@
 #define SEC_AUTH_LEN_MASK	0x3F
 
 #define DES3_BLOCK_SIZE		8
-#define AES_BLOCK_SIZE		16
 #define CTR_128BIT_COUNTER	16
 #define GCM_FINAL_COUNTER	0x1000000
 #define GCM_FINAL_COUNTER_LEN	4
 #define GCM_STREAM_MAC_OFFSET	32
 #define GCM_FULL_MAC_LEN	16
-#define GCM_AUTH_MAC_OFFSET	47
 #define GCM_BLOCK_SIZE		AES_BLOCK_SIZE
-#define GCM_BLOCK_OFFSET	(AES_BLOCK_SIZE - 1)
 #define AKEY_LEN(c_key_len)	(2 * (c_key_len) + 0x4)
 #define MAC_LEN			4
 #define LONG_AUTH_DATA_OFFSET   24
@@ -614,6 +612,7 @@ static int hisi_sec_get_usage(void *param)
 	.send = alg_type##_send,\
 	.recv = alg_type##_recv,\
 	.get_usage = hisi_sec_get_usage,\
+	.send_batch = hisi_qm_send_batch,\
 }
 
 static struct wd_alg_driver cipher_alg_driver[] = {
@@ -1214,7 +1213,7 @@ static int hisi_sec_cipher_recv(struct wd_alg_driver *drv, handle_t ctx, void *w
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, (__u16)recv_msg->tag, sqe.type2.tag);
+	ret = hisi_check_bd_id(h_qp, &sqe, (__u16)recv_msg->tag, sqe.type2.tag);
 	if (ret)
 		return ret;
 
@@ -1462,7 +1461,7 @@ static int hisi_sec_cipher_recv_v3(struct wd_alg_driver *drv, handle_t ctx, void
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, recv_msg->tag, sqe.tag);
+	ret = hisi_check_bd_id(h_qp, &sqe, recv_msg->tag, sqe.tag);
 	if (ret)
 		return ret;
 
@@ -1783,7 +1782,7 @@ static int hisi_sec_digest_recv(struct wd_alg_driver *drv, handle_t ctx, void *w
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, (__u16)recv_msg->tag, sqe.type2.tag);
+	ret = hisi_check_bd_id(h_qp, &sqe, (__u16)recv_msg->tag, sqe.type2.tag);
 	if (ret)
 		return ret;
 
@@ -2059,7 +2058,7 @@ static int hisi_sec_digest_recv_v3(struct wd_alg_driver *drv, handle_t ctx, void
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, recv_msg->tag, sqe.tag);
+	ret = hisi_check_bd_id(h_qp, &sqe, recv_msg->tag, sqe.tag);
 	if (ret)
 		return ret;
 
@@ -2357,72 +2356,67 @@ static void fill_gcm_middle_bd2(struct wd_aead_msg *msg, struct hisi_sec_sqe *sq
 	sqe->type2.a_key_addr = (__u64)(uintptr_t)msg->ckey;
 }
 
-static void get_galois_vector_s(struct wd_aead_msg *msg, __u8 *s)
+static void get_galois_len_block(struct wd_aead_msg *msg, __u8 *s)
 {
-	__u8 a_c[GCM_BLOCK_SIZE] = {0};
 	__u64 cipher_len, aad_len;
-	__u32 i;
 
-	aad_len = msg->assoc_bytes * BYTE_BITS;
-	memcpy(&a_c[BYTE_BITS], &aad_len, sizeof(__u64));
+	/* The bit lengths of AAD and ciphertext, both are big-endian */
+	aad_len = htobe64(msg->assoc_bytes * BYTE_BITS);
+	memcpy(&s[0], &aad_len, sizeof(__u64));
 
-	cipher_len = msg->long_data_len * BYTE_BITS;
-	memcpy(&a_c[0], &cipher_len, sizeof(__u64));
+	cipher_len = htobe64(msg->long_data_len * BYTE_BITS);
+	memcpy(&s[BYTE_BITS], &cipher_len, sizeof(__u64));
+}
 
-	/* Based the little-endian operation */
-	for (i = 0; i < GCM_BLOCK_SIZE; i++)
-		s[i] = a_c[i] ^ msg->aiv_stream[(__u8)(GCM_AUTH_MAC_OFFSET - i)];
+static int gcm_init_soft_key(struct wd_aead_msg *msg)
+{
+	int ret;
+
+	/* The keys are expanded at the first final message of the session */
+	ret = wd_aead_soft_key_init(msg->soft_key, msg->ckey, msg->ckey_bytes);
+	if (ret)
+		WD_ERR("failed to set the gcm soft key!\n");
+
+	return ret;
 }
 
 static int gcm_do_soft_mac(struct wd_aead_msg *msg)
 {
+	__u8 *mac = msg->aiv_stream + GCM_STREAM_MAC_OFFSET;
+	struct wd_aead_soft_key *key = msg->soft_key;
 	__u8 ctr_r[GCM_BLOCK_SIZE] = {0};
-	__u8 data[GCM_BLOCK_SIZE] = {0};
-	__u8 H[GCM_BLOCK_SIZE] = {0};
-	__u8 K[GCM_BLOCK_SIZE] = {0};
+	__u8 ctr[GCM_BLOCK_SIZE] = {0};
 	__u8 S[GCM_BLOCK_SIZE] = {0};
 	__u8 g[GCM_BLOCK_SIZE] = {0};
-	__u8 G[GCM_BLOCK_SIZE] = {0};
-	__u32 i, len, block, offset;
-	__u8 *out;
+	__u32 i, blocks;
 	int ret;
 
-	aes_encrypt(msg->ckey, msg->ckey_bytes, data, H);
-
-	len = msg->in_bytes;
-	offset = 0;
-	while (len) {
-		memset(data, 0, GCM_BLOCK_SIZE);
-		block = len >= GCM_BLOCK_SIZE ? GCM_BLOCK_SIZE : len;
-		memcpy(data, msg->in + offset, block);
-		ctr_iv_inc(msg->iv, GCM_BLOCK_SIZE >> CTR_MODE_LEN_SHIFT);
-		aes_encrypt(msg->ckey, msg->ckey_bytes, msg->iv, K);
-		out = msg->out + offset;
-		for (i = 0; i < block; i++)
-			out[i] = K[i] ^ data[i];
-
-		if (msg->op_type == WD_CIPHER_ENCRYPTION_DIGEST)
-			memcpy(data, out, block);
+	ret = gcm_init_soft_key(msg);
+	if (ret) {
+		msg->result = WD_IN_EPARA;
+		return ret;
+	}
 
-		/*
-		 * Mac and data is based on big-endian, the first argument of galois_compute
-		 * must be converted to little-endian.
-		 */
-		for (i = 0; i < GCM_BLOCK_SIZE; i++)
-			G[i] = data[GCM_BLOCK_OFFSET - i] ^
-			       msg->aiv_stream[(__u8)(GCM_AUTH_MAC_OFFSET - i)];
+	/* The MAC is over the ciphertext, hash it before out overwrites it */
+	if (msg->op_type == WD_CIPHER_DECRYPTION_DIGEST)
+		galois_ghash(&key->hkey, mac, msg->in, msg->in_bytes);
 
-		galois_compute(G, H, msg->aiv_stream + GCM_STREAM_MAC_OFFSET, GCM_BLOCK_SIZE);
-		len -= block;
-		offset += block;
-	}
+	/* msg->iv is the counter of the last block, it ends at the new last one */
+	memcpy(ctr, msg->iv, GCM_BLOCK_SIZE);
+	ctr_iv_inc(ctr, 1);
+	aes_ctr_encrypt(&key->ckey, ctr, msg->in, msg->out, msg->in_bytes);
+	blocks = (msg->in_bytes + GCM_BLOCK_SIZE - 1) >> CTR_MODE_LEN_SHIFT;
+	ctr_iv_inc(msg->iv, blocks);
 
-	get_galois_vector_s(msg, S);
+	if (msg->op_type == WD_CIPHER_ENCRYPTION_DIGEST)
+		galois_ghash(&key->hkey, mac, msg->out, msg->in_bytes);
 
-	galois_compute(S, H, g, GCM_BLOCK_SIZE);
+	get_galois_len_block(msg, S);
+	memcpy(g, mac, GCM_BLOCK_SIZE);
+	galois_ghash(&key->hkey, g, S, GCM_BLOCK_SIZE);
 
 	/* Encrypt ctr0 based on AES_ECB */
-	aes_encrypt(msg->ckey, msg->ckey_bytes, msg->aiv_stream, ctr_r);
+	aes_encrypt_block(&key->ckey, msg->aiv_stream, ctr_r);
 
 	/* Get the GMAC tag final */
 	for (i = 0; i < GCM_BLOCK_SIZE; i++)
@@ -2693,7 +2687,7 @@ static int hisi_sec_aead_recv(struct wd_alg_driver *drv, handle_t ctx, void *wd_
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, (__u16)recv_msg->tag, sqe.type2.tag);
+	ret = hisi_check_bd_id(h_qp, &sqe, (__u16)recv_msg->tag, sqe.type2.tag);
 	if (ret)
 		return ret;
 
@@ -3064,7 +3058,7 @@ static int hisi_sec_aead_recv_v3(struct wd_alg_driver *drv, handle_t ctx, void *
 	if (ret < 0)
 		return ret;
 
-	ret = hisi_check_bd_id(h_qp, recv_msg->tag, sqe.tag);
+	ret = hisi_check_bd_id(h_qp, &sqe, recv_msg->tag, sqe.tag);
 	if (ret)
 		return ret;
 
@@ -0,0 +1,590 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crypto/aes.h"
+#include "crypto/galois.h"
+#include "crypto/sm4.h"
+#include "drv/wd_aead_drv.h"
+#include "drv/wd_cipher_drv.h"
+#include "wd_util.h"
+
+#define SOFT_BLOCK_SIZE		16
+#define SOFT_BATCH		8
+#define SOFT_BATCH_BYTES	(SOFT_BATCH * SOFT_BLOCK_SIZE)
+#define SOFT_GCM_IV_SIZE	12
+#define SOFT_XTS_POLY		0x87
+#define SOFT_MSB_SHIFT		7
+
+/* Encrypt or decrypt whole blocks with an expanded key */
+typedef void (*soft_block_t)(const void *key, const __u8 *in, __u8 *out,
+			     __u32 blocks);
+
+/*
+ * struct soft_cipher_key - the key of a block cipher, and the function of
+ * the direction the key was expanded for. The AES one runs on the AES
+ * instructions of the CPU if there are.
+ */
+struct soft_cipher_key {
+	union {
+		struct aes_key aes;
+		struct sm4_key sm4;
+	};
+	soft_block_t crypt;
+};
+
+static int soft_cipher_get_usage(void *param)
+{
+	return WD_SUCCESS;
+}
+
+/* The round keys on the stack are cleared, the barrier keeps the memset */
+static void soft_key_clear(void *key, __u32 size)
+{
+	memset(key, 0, size);
+	__asm__ __volatile__("" : : "r"(key) : "memory");
+}
+
+static void soft_aes_encrypt(const void *key, const __u8 *in, __u8 *out,
+			     __u32 blocks)
+{
+	aes_ecb_encrypt(key, in, out, blocks);
+}
+
+static void soft_aes_decrypt(const void *key, const __u8 *in, __u8 *out,
+			     __u32 blocks)
+{
+	aes_ecb_decrypt(key, in, out, blocks);
+}
+
+static void soft_sm4_crypt(const void *key, const __u8 *in, __u8 *out,
+			   __u32 blocks)
+{
+	sm4_ecb_crypt(key, in, out, blocks);
+}
+
+static int soft_set_key(struct soft_cipher_key *key, __u8 alg,
+			const __u8 *userkey, __u32 key_len, bool enc)
+{
+	int ret;
+
+	switch (alg) {
+	case WD_CIPHER_AES:
+		if (enc) {
+			ret = aes_set_key(&key->aes, userkey, key_len);
+			key->crypt = soft_aes_encrypt;
+		} else {
+			ret = aes_set_decrypt_key(&key->aes, userkey, key_len);
+			key->crypt = soft_aes_decrypt;
+		}
+		return ret;
+	case WD_CIPHER_SM4:
+		if (key_len != SM4_KEY_BYTES)
+			return -WD_EINVAL;
+		if (enc)
+			sm4_set_key(&key->sm4, userkey);
+		else
+			sm4_set_dec_key(&key->sm4, userkey);
+		key->crypt = soft_sm4_crypt;
+		return 0;
+	default:
+		return -WD_EINVAL;
+	}
+}
+
+static void soft_xor(__u8 *dst, const __u8 *a, const __u8 *b, __u32 len)
+{
+	__u32 i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = a[i] ^ b[i];
+}
+
+static void soft_ctr_inc(__u8 *ctr)
+{
+	int i;
+
+	for (i = SOFT_BLOCK_SIZE - 1; i >= 0; i--) {
+		if (++ctr[i])
+			break;
+	}
+}
+
+static void soft_ecb_crypt(const struct soft_cipher_key *key, const __u8 *in,
+			   __u8 *out, __u32 len)
+{
+	key->crypt(key, in, out, len / SOFT_BLOCK_SIZE);
+}
+
+static void soft_cbc_encrypt(const struct soft_cipher_key *key, const __u8 *in,
+			     __u8 *out, __u32 len, __u8 *iv)
+{
+	const __u8 *prev = iv;
+	__u32 i;
+
+	/* Each block depends on the last one, so it is done one by one */
+	for (i = 0; i < len; i += SOFT_BLOCK_SIZE) {
+		soft_xor(out + i, in + i, prev, SOFT_BLOCK_SIZE);
+		key->crypt(key, out + i, out + i, 1);
+		prev = out + i;
+	}
+
+	memcpy(iv, prev, SOFT_BLOCK_SIZE);
+}
+
+static void soft_cbc_decrypt(const struct soft_cipher_key *key, const __u8 *in,
+			     __u8 *out, __u32 len, __u8 *iv)
+{
+	__u8 buf[SOFT_BATCH_BYTES];
+	__u32 bytes;
+
+	/* The blocks are independent here, keep a copy in case in is out */
+	while (len) {
+		bytes = len < SOFT_BATCH_BYTES ? len : SOFT_BATCH_BYTES;
+		memcpy(buf, in, bytes);
+		key->crypt(key, buf, out, bytes / SOFT_BLOCK_SIZE);
+		soft_xor(out, out, iv, SOFT_BLOCK_SIZE);
+		soft_xor(out + SOFT_BLOCK_SIZE, out + SOFT_BLOCK_SIZE, buf,
+			 bytes - SOFT_BLOCK_SIZE);
+		memcpy(iv, buf + bytes - SOFT_BLOCK_SIZE, SOFT_BLOCK_SIZE);
+
+		in += bytes;
+		out += bytes;
+		len -= bytes;
+	}
+}
+
+/*
+ * The counter is 128 bits big-endian, it ends at the counter after the last
+ * full block. As the hardware does, a last partial block does not move it.
+ */
+static void soft_ctr_crypt(const struct soft_cipher_key *key, const __u8 *in,
+			   __u8 *out, __u32 len, __u8 *ctr)
+{
+	__u8 ks[SOFT_BATCH_BYTES];
+	__u32 i, n, bytes;
+
+	while (len) {
+		bytes = len < SOFT_BATCH_BYTES ? len : SOFT_BATCH_BYTES;
+		n = (bytes + SOFT_BLOCK_SIZE - 1) / SOFT_BLOCK_SIZE;
+		for (i = 0; i < n; i++) {
+			memcpy(ks + i * SOFT_BLOCK_SIZE, ctr, SOFT_BLOCK_SIZE);
+			if ((i + 1) * SOFT_BLOCK_SIZE <= bytes)
+				soft_ctr_inc(ctr);
+		}
+
+		key->crypt(key, ks, ks, n);
+		soft_xor(out, in, ks, bytes);
+
+		in += bytes;
+		out += bytes;
+		len -= bytes;
+	}
+}
+
+/* t = t * x in GF(2^128) of IEEE 1619, the tweak is little-endian */
+static void soft_xts_mulx(__u8 *t)
+{
+	__u8 carry = t[SOFT_BLOCK_SIZE - 1] >> SOFT_MSB_SHIFT;
+	int i;
+
+	for (i = SOFT_BLOCK_SIZE - 1; i > 0; i--)
+		t[i] = (t[i] << 1) | (t[i - 1] >> SOFT_MSB_SHIFT);
+
+	t[0] = (t[0] << 1) ^ (SOFT_XTS_POLY & (0 - carry));
+}
+
+static void soft_xts_blocks(const struct soft_cipher_key *key, const __u8 *in,
+			    __u8 *out, __u32 blocks, __u8 *tweak)
+{
+	__u8 t[SOFT_BATCH_BYTES];
+	__u32 i, n;
+
+	while (blocks) {
+		n = blocks < SOFT_BATCH ? blocks : SOFT_BATCH;
+		for (i = 0; i < n; i++) {
+			memcpy(t + i * SOFT_BLOCK_SIZE, tweak, SOFT_BLOCK_SIZE);
+			soft_xts_mulx(tweak);
+		}
+
+		soft_xor(out, in, t, n * SOFT_BLOCK_SIZE);
+		key->crypt(key, out, out, n);
+		soft_xor(out, out, t, n * SOFT_BLOCK_SIZE);
+
+		in += n * SOFT_BLOCK_SIZE;
+		out += n * SOFT_BLOCK_SIZE;
+		blocks -= n;
+	}
+}
+
+/*
+ * XTS of IEEE 1619, the last partial block is done by ciphertext stealing.
+ * The tweak of decryption is used in the reverse order for the last two
+ * blocks, as the encryption swapped them.
+ */
+static int soft_xts_crypt(const struct soft_cipher_key *key, struct wd_cipher_msg *msg,
+			  const __u8 *in, __u8 *out, __u32 len)
+{
+	__u32 half = msg->key_bytes >> 1;
+	__u32 tail = len % SOFT_BLOCK_SIZE;
+	__u32 blocks = len / SOFT_BLOCK_SIZE;
+	struct soft_cipher_key tkey;
+	__u8 tweak[SOFT_BLOCK_SIZE];
+	__u8 stolen[SOFT_BLOCK_SIZE];
+	__u8 last[SOFT_BLOCK_SIZE];
+	__u8 next[SOFT_BLOCK_SIZE];
+	__u8 *cur;
+	int ret;
+
+	if (len < SOFT_BLOCK_SIZE) {
+		WD_ERR("invalid: soft xts input bytes is %u!\n", len);
+		return -WD_EINVAL;
+	}
+
+	ret = soft_set_key(&tkey, msg->alg, msg->key + half, half, true);
+	if (ret)
+		return ret;
+
+	tkey.crypt(&tkey, msg->iv, tweak, 1);
+	soft_key_clear(&tkey, sizeof(tkey));
+
+	if (!tail) {
+		soft_xts_blocks(key, in, out, blocks, tweak);
+		return 0;
+	}
+
+	soft_xts_blocks(key, in, out, blocks - 1, tweak);
+	in += (blocks - 1) * SOFT_BLOCK_SIZE;
+	cur = out + (blocks - 1) * SOFT_BLOCK_SIZE;
+
+	memcpy(next, tweak, SOFT_BLOCK_SIZE);
+	soft_xts_mulx(next);
+	if (msg->op_type == WD_CIPHER_DECRYPTION)
+		soft_xts_blocks(key, in, last, 1, next);
+	else
+		soft_xts_blocks(key, in, last, 1, tweak);
+
+	/* The last full block steals the tail of the one before it */
+	memcpy(stolen, in + SOFT_BLOCK_SIZE, tail);
+	memcpy(cur + SOFT_BLOCK_SIZE, last, tail);
+	memcpy(last, stolen, tail);
+	if (msg->op_type == WD_CIPHER_DECRYPTION)
+		soft_xts_blocks(key, last, cur, 1, tweak);
+	else
+		soft_xts_blocks(key, last, cur, 1, next);
+
+	return 0;
+}
+
+static int soft_cipher_check(struct wd_cipher_msg *msg)
+{
+	if (unlikely(msg->data_fmt == WD_SGL_BUF)) {
+		WD_ERR("invalid: soft cipher driver do not support sgl data format!\n");
+		return -WD_EINVAL;
+	}
+
+	switch (msg->mode) {
+	case WD_CIPHER_ECB:
+	case WD_CIPHER_CBC:
+		if (msg->in_bytes % SOFT_BLOCK_SIZE)
+			break;
+		return 0;
+	case WD_CIPHER_CTR:
+	case WD_CIPHER_XTS:
+		return 0;
+	default:
+		WD_ERR("invalid: soft cipher mode %u is not supported!\n", msg->mode);
+		return -WD_EINVAL;
+	}
+
+	WD_ERR("invalid: soft cipher input bytes is %u!\n", msg->in_bytes);
+	return -WD_EINVAL;
+}
+
+static int soft_cipher_send(struct wd_alg_driver *drv, handle_t ctx, void *cipher_msg)
+{
+	struct wd_cipher_msg *msg = cipher_msg;
+	struct soft_cipher_key key;
+	__u32 key_len;
+	bool enc;
+	int ret;
+
+	if (unlikely(!msg)) {
+		WD_ERR("invalid: cipher_msg is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = soft_cipher_check(msg);
+	if (ret)
+		return ret;
+
+	/* CTR only uses the encryption of the block cipher */
+	enc = msg->op_type == WD_CIPHER_ENCRYPTION || msg->mode == WD_CIPHER_CTR;
+	key_len = msg->mode == WD_CIPHER_XTS ? msg->key_bytes >> 1 : msg->key_bytes;
+	ret = soft_set_key(&key, msg->alg, msg->key, key_len, enc);
+	if (ret) {
+		WD_ERR("failed to set soft cipher key, alg = %u!\n", msg->alg);
+		return -WD_EINVAL;
+	}
+
+	switch (msg->mode) {
+	case WD_CIPHER_ECB:
+		soft_ecb_crypt(&key, msg->in, msg->out, msg->in_bytes);
+		break;
+	case WD_CIPHER_CBC:
+		if (enc)
+			soft_cbc_encrypt(&key, msg->in, msg->out, msg->in_bytes, msg->iv);
+		else
+			soft_cbc_decrypt(&key, msg->in, msg->out, msg->in_bytes, msg->iv);
+		break;
+	case WD_CIPHER_CTR:
+		soft_ctr_crypt(&key, msg->in, msg->out, msg->in_bytes, msg->iv);
+		break;
+	default:
+		ret = soft_xts_crypt(&key, msg, msg->in, msg->out, msg->in_bytes);
+		break;
+	}
+
+	soft_key_clear(&key, sizeof(key));
+	if (ret)
+		return ret;
+
+	msg->out_bytes = msg->in_bytes;
+	msg->result = WD_SUCCESS;
+
+	return WD_SUCCESS;
+}
+
+static int soft_cipher_recv(struct wd_alg_driver *drv, handle_t ctx, void *cipher_msg)
+{
+	return WD_SUCCESS;
+}
+
+static void soft_gcm_len_block(struct wd_aead_msg *msg, __u8 *block)
+{
+	__u64 bits;
+
+	bits = htobe64((__u64)msg->assoc_bytes * BYTE_BITS);
+	memcpy(block, &bits, sizeof(bits));
+	bits = htobe64((__u64)msg->in_bytes * BYTE_BITS);
+	memcpy(block + sizeof(bits), &bits, sizeof(bits));
+}
+
+/* Compare the MAC in constant time, not to leak the matched length */
+static bool soft_mac_equal(const __u8 *a, const __u8 *b, __u32 len)
+{
+	__u8 diff = 0;
+	__u32 i;
+
+	for (i = 0; i < len; i++)
+		diff |= a[i] ^ b[i];
+
+	return !diff;
+}
+
+/* The AES keys are cached in the session, the SM4 ones are expanded each time */
+static int soft_gcm_set_key(struct wd_aead_msg *msg, struct soft_cipher_key *ckey,
+			    struct galois_key *hkey, const struct galois_key **hk)
+{
+	struct wd_aead_soft_key *skey = msg->soft_key;
+	__u8 h[SOFT_BLOCK_SIZE] = {0};
+	int ret;
+
+	if (msg->calg == WD_CIPHER_AES && skey) {
+		ret = wd_aead_soft_key_init(skey, msg->ckey, msg->ckey_bytes);
+		if (ret)
+			return ret;
+		memcpy(&ckey->aes, &skey->ckey, sizeof(skey->ckey));
+		ckey->crypt = soft_aes_encrypt;
+		*hk = &skey->hkey;
+		return 0;
+	}
+
+	ret = soft_set_key(ckey, msg->calg, msg->ckey, msg->ckey_bytes, true);
+	if (ret)
+		return ret;
+
+	ckey->crypt(ckey, h, h, 1);
+	galois_set_key(hkey, h);
+	*hk = hkey;
+
+	return 0;
+}
+
+/*
+ * GCM of NIST SP 800-38D with the 96 bits IV, J0 = IV || 0^31 || 1.
+ * The data is counted by 32 bits, so the 128 bits counter of CTR is the
+ * same as inc32 here.
+ */
+static int soft_gcm_crypt(struct wd_aead_msg *msg)
+{
+	__u8 *in = msg->in + msg->assoc_bytes;
+	__u8 *out = msg->out + msg->assoc_bytes;
+	const struct galois_key *hk = NULL;
+	struct soft_cipher_key ckey;
+	struct galois_key hkey;
+	__u8 s[SOFT_BLOCK_SIZE] = {0};
+	__u8 j0[SOFT_BLOCK_SIZE] = {0};
+	__u8 ctr[SOFT_BLOCK_SIZE];
+	__u8 tag[SOFT_BLOCK_SIZE];
+	bool enc;
+	int ret;
+
+	if (msg->iv_bytes != SOFT_GCM_IV_SIZE || !msg->auth_bytes ||
+	    msg->auth_bytes > SOFT_BLOCK_SIZE) {
+		WD_ERR("invalid: soft gcm iv bytes %u or auth bytes %u!\n",
+		       msg->iv_bytes, msg->auth_bytes);
+		return -WD_EINVAL;
+	}
+
+	ret = soft_gcm_set_key(msg, &ckey, &hkey, &hk);
+	if (ret) {
+		WD_ERR("failed to set soft gcm key, alg = %u!\n", msg->calg);
+		return -WD_EINVAL;
+	}
+
+	enc = msg->op_type == WD_CIPHER_ENCRYPTION_DIGEST;
+	if (msg->out != msg->in)
+		memcpy(msg->out, msg->in, msg->assoc_bytes);
+
+	memcpy(j0, msg->iv, SOFT_GCM_IV_SIZE);
+	j0[SOFT_BLOCK_SIZE - 1] = 1;
+	memcpy(ctr, j0, SOFT_BLOCK_SIZE);
+	soft_ctr_inc(ctr);
+
+	galois_ghash(hk, s, msg->in, msg->assoc_bytes);
+	/* The MAC is over the ciphertext, hash it before out overwrites it */
+	if (!enc)
+		galois_ghash(hk, s, in, msg->in_bytes);
+
+	soft_ctr_crypt(&ckey, in, out, msg->in_bytes, ctr);
+	if (enc)
+		galois_ghash(hk, s, out, msg->in_bytes);
+
+	soft_gcm_len_block(msg, tag);
+	galois_ghash(hk, s, tag, SOFT_BLOCK_SIZE);
+	ckey.crypt(&ckey, j0, tag, 1);
+	soft_xor(tag, tag, s, SOFT_BLOCK_SIZE);
+
+	soft_key_clear(&ckey, sizeof(ckey));
+	if (hk == &hkey)
+		soft_key_clear(&hkey, sizeof(hkey));
+
+	if (enc) {
+		memcpy(msg->mac, tag, msg->auth_bytes);
+	} else if (!soft_mac_equal(tag, msg->mac, msg->auth_bytes)) {
+		/* Report it in the result of the request, as the hardware does */
+		WD_ERR("failed to verify the soft gcm mac!\n");
+		msg->result = WD_IN_EPARA;
+		return WD_SUCCESS;
+	}
+
+	msg->out_bytes = msg->assoc_bytes + msg->in_bytes;
+	msg->result = WD_SUCCESS;
+
+	return WD_SUCCESS;
+}
+
+static int soft_aead_send(struct wd_alg_driver *drv, handle_t ctx, void *aead_msg)
+{
+	struct wd_aead_msg *msg = aead_msg;
+
+	if (unlikely(!msg)) {
+		WD_ERR("invalid: aead_msg is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(msg->data_fmt == WD_SGL_BUF)) {
+		WD_ERR("invalid: soft aead driver do not support sgl data format!\n");
+		return -WD_EINVAL;
+	}
+
+	/* The stream state is kept in the format of the hardware */
+	if (unlikely(msg->cmode != WD_CIPHER_GCM || msg->msg_state != AEAD_MSG_BLOCK)) {
+		WD_ERR("invalid: soft aead mode %u, msg state %d is not supported!\n",
+		       msg->cmode, msg->msg_state);
+		return -WD_EINVAL;
+	}
+
+	return soft_gcm_crypt(msg);
+}
+
+static int soft_aead_recv(struct wd_alg_driver *drv, handle_t ctx, void *aead_msg)
+{
+	return WD_SUCCESS;
+}
+
+static int soft_cipher_init(struct wd_alg_driver *drv, void *conf)
+{
+	struct wd_ctx_config_internal *config = conf;
+
+	/* Fallback init is NULL */
+	if (!drv || !conf)
+		return 0;
+
+	config->epoll_en = 0;
+
+	return WD_SUCCESS;
+}
+
+static void soft_cipher_exit(struct wd_alg_driver *drv)
+{
+}
+
+#define GEN_SOFT_CIPHER_DRIVER(soft_alg_name, alg_type) \
+{\
+	.drv_name = "soft_cipher",\
+	.alg_name = (soft_alg_name),\
+	.calc_type = UADK_ALG_SOFT,\
+	.priority = 0,\
+	.queue_num = 1,\
+	.op_type_num = 1,\
+	.fallback = 0,\
+	.init = soft_cipher_init,\
+	.exit = soft_cipher_exit,\
+	.send = soft_##alg_type##_send,\
+	.recv = soft_##alg_type##_recv,\
+	.get_usage = soft_cipher_get_usage,\
+}
+
+static struct wd_alg_driver soft_cipher_driver[] = {
+	GEN_SOFT_CIPHER_DRIVER("ecb(aes)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("cbc(aes)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("ctr(aes)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("xts(aes)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("ecb(sm4)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("cbc(sm4)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("ctr(sm4)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("xts(sm4)", cipher),
+	GEN_SOFT_CIPHER_DRIVER("gcm(aes)", aead),
+	GEN_SOFT_CIPHER_DRIVER("gcm(sm4)", aead),
+};
+
+static void __attribute__((constructor)) soft_cipher_probe(void)
+{
+	int alg_num = ARRAY_SIZE(soft_cipher_driver);
+	int i, ret;
+
+	WD_INFO("Info: register soft cipher alg drivers!\n");
+
+	for (i = 0; i < alg_num; i++) {
+		ret = wd_alg_driver_register(&soft_cipher_driver[i]);
+		if (ret && ret != -WD_ENODEV)
+			WD_ERR("Error: register soft cipher %s failed!\n",
+				soft_cipher_driver[i].alg_name);
+	}
+}
+
+static void __attribute__((destructor)) soft_cipher_remove(void)
+{
+	int alg_num = ARRAY_SIZE(soft_cipher_driver);
+	int i;
+
+	WD_INFO("Info: unregister soft cipher alg drivers!\n");
+	for (i = 0; i < alg_num; i++)
+		wd_alg_driver_unregister(&soft_cipher_driver[i]);
+}
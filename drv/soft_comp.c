@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "drv/wd_comp_drv.h"
+#include "wd_comp.h"
+#include "wd_util.h"
+
+#define SOFT_COMP_MEM_LEVEL		8
+#define DEFLATE_WBITS_MAX		15
+#define GZIP_WBITS_OFFSET		16
+#define SOFT_STRM_MAGIC			0x5a4c4942
+
+/*
+ * The stream state is kept in the ctx_buf of the session, the zlib
+ * internal state is released when the stream ends, when a new stream
+ * starts on the same session, or when the session is reset or freed.
+ */
+struct soft_comp_strm {
+	__u32 magic;
+	enum wd_comp_op_type op_type;
+	z_stream zs;
+};
+
+static int soft_comp_get_usage(void *param)
+{
+	return WD_SUCCESS;
+}
+
+/* The window size of deflate is 2^wbits, 4K ~ 32K */
+static int soft_comp_get_wbits(struct wd_comp_msg *msg, int max_bits)
+{
+	static const int wbits[] = {
+		[WD_COMP_WS_4K] = 12,
+		[WD_COMP_WS_8K] = 13,
+		[WD_COMP_WS_16K] = 14,
+		[WD_COMP_WS_24K] = 15,
+		[WD_COMP_WS_32K] = 15,
+	};
+	int bits = max_bits;
+
+	if (!max_bits && msg->win_sz <= WD_COMP_WS_32K)
+		bits = wbits[msg->win_sz];
+	else if (!max_bits)
+		bits = DEFLATE_WBITS_MAX;
+
+	switch (msg->alg_type) {
+	case WD_DEFLATE:
+		return -bits;
+	case WD_GZIP:
+		return bits + GZIP_WBITS_OFFSET;
+	default:
+		return bits;
+	}
+}
+
+static int soft_comp_get_level(struct wd_comp_msg *msg)
+{
+	if (msg->comp_lv < WD_COMP_L1)
+		return Z_DEFAULT_COMPRESSION;
+
+	if (msg->comp_lv > Z_BEST_COMPRESSION)
+		return Z_BEST_COMPRESSION;
+
+	return msg->comp_lv;
+}
+
+static int soft_comp_strm_init(z_stream *zs, struct wd_comp_msg *msg)
+{
+	int wbits, ret;
+
+	memset(zs, 0, sizeof(*zs));
+	if (msg->req.op_type == WD_DIR_COMPRESS) {
+		wbits = soft_comp_get_wbits(msg, 0);
+		ret = deflateInit2(zs, soft_comp_get_level(msg), Z_DEFLATED, wbits,
+				   SOFT_COMP_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+	} else {
+		/* Use the max window to inflate data from any compressor */
+		wbits = soft_comp_get_wbits(msg, DEFLATE_WBITS_MAX);
+		ret = inflateInit2(zs, wbits);
+	}
+	if (ret != Z_OK) {
+		WD_ERR("failed to init zlib stream, ret = %d!\n", ret);
+		return -WD_ENOMEM;
+	}
+
+	return 0;
+}
+
+static void soft_comp_strm_end(z_stream *zs, enum wd_comp_op_type op_type)
+{
+	if (op_type == WD_DIR_COMPRESS)
+		(void)deflateEnd(zs);
+	else
+		(void)inflateEnd(zs);
+}
+
+/*
+ * The checksum and isize are returned in the same form as the hardware,
+ * so that wd_comp can append the tail of an empty last block.
+ */
+static void soft_comp_fill_checksum(struct wd_comp_msg *msg, z_stream *zs)
+{
+	__u32 x = (__u32)zs->adler;
+
+	msg->isize = (__u32)zs->total_in;
+	if (msg->alg_type != WD_GZIP) {
+		msg->checksum = x;
+		return;
+	}
+
+	x = ((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1);
+	x = ((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2);
+	x = ((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4);
+	x = ((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8);
+	msg->checksum = ~((x >> 16) | (x << 16));
+}
+
+static int soft_comp_do(z_stream *zs, struct wd_comp_msg *msg, int flush)
+{
+	struct wd_comp_req *req = &msg->req;
+	int ret;
+
+	zs->next_in = req->src;
+	zs->avail_in = req->src_len;
+	zs->next_out = req->dst;
+	zs->avail_out = msg->avail_out;
+
+	if (req->op_type == WD_DIR_COMPRESS)
+		ret = deflate(zs, flush);
+	else
+		ret = inflate(zs, flush);
+
+	msg->in_cons = req->src_len - zs->avail_in;
+	msg->produced = msg->avail_out - zs->avail_out;
+	req->status = 0;
+
+	if (ret == Z_STREAM_END) {
+		if (req->op_type == WD_DIR_DECOMPRESS)
+			req->status = WD_STREAM_END;
+		return ret;
+	}
+
+	/* No progress is possible, such as no more input or output space */
+	if (ret == Z_BUF_ERROR)
+		return Z_OK;
+
+	if (ret != Z_OK) {
+		WD_ERR("failed to do zlib %s, ret = %d!\n",
+		       req->op_type == WD_DIR_COMPRESS ? "deflate" : "inflate", ret);
+		req->status = WD_IN_EPARA;
+	}
+
+	return ret;
+}
+
+static int soft_comp_stateless(struct wd_comp_msg *msg)
+{
+	z_stream zs;
+	int ret;
+
+	ret = soft_comp_strm_init(&zs, msg);
+	if (ret)
+		return ret;
+
+	ret = soft_comp_do(&zs, msg, Z_FINISH);
+	/* The whole block must be done in one request */
+	if (ret != Z_STREAM_END && !msg->req.status)
+		msg->req.status = WD_IN_EPARA;
+
+	soft_comp_fill_checksum(msg, &zs);
+	soft_comp_strm_end(&zs, msg->req.op_type);
+
+	return 0;
+}
+
+static int soft_comp_stateful(struct wd_comp_msg *msg)
+{
+	struct soft_comp_strm *strm = msg->ctx_buf;
+	int flush = Z_SYNC_FLUSH;
+	int ret;
+
+	if (unlikely(!strm)) {
+		WD_ERR("invalid: soft comp stream ctx_buf is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (msg->stream_pos == WD_COMP_STREAM_NEW || strm->magic != SOFT_STRM_MAGIC) {
+		if (strm->magic == SOFT_STRM_MAGIC)
+			soft_comp_strm_end(&strm->zs, strm->op_type);
+
+		strm->magic = 0;
+		ret = soft_comp_strm_init(&strm->zs, msg);
+		if (ret)
+			return ret;
+
+		strm->magic = SOFT_STRM_MAGIC;
+		strm->op_type = msg->req.op_type;
+	}
+
+	/*
+	 * Flush each compressed block to a byte boundary, so that the stream
+	 * can be closed later by an empty last block.
+	 */
+	if (msg->req.op_type == WD_DIR_COMPRESS && msg->req.last)
+		flush = Z_FINISH;
+
+	ret = soft_comp_do(&strm->zs, msg, flush);
+	soft_comp_fill_checksum(msg, &strm->zs);
+
+	/* The output buffer is not enough to finish the stream */
+	if (ret == Z_OK && flush == Z_FINISH && msg->in_cons == msg->req.src_len)
+		msg->req.status = WD_EAGAIN;
+
+	if (ret != Z_OK) {
+		soft_comp_strm_end(&strm->zs, strm->op_type);
+		strm->magic = 0;
+	}
+
+	return 0;
+}
+
+static void soft_comp_sess_reset(void *ctx_buf)
+{
+	struct soft_comp_strm *strm = ctx_buf;
+
+	if (!strm || strm->magic != SOFT_STRM_MAGIC)
+		return;
+
+	soft_comp_strm_end(&strm->zs, strm->op_type);
+	strm->magic = 0;
+}
+
+static int soft_comp_get_extend_ops(void *ops)
+{
+	struct wd_comp_ops *comp_ops = (struct wd_comp_ops *)ops;
+
+	if (!comp_ops)
+		return -WD_EINVAL;
+
+	comp_ops->sess_reset = soft_comp_sess_reset;
+
+	return WD_SUCCESS;
+}
+
+static int soft_comp_send(struct wd_alg_driver *drv, handle_t ctx, void *comp_msg)
+{
+	struct wd_comp_msg *msg = comp_msg;
+
+	if (unlikely(!msg)) {
+		WD_ERR("invalid: comp_msg is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(msg->req.data_fmt != WD_FLAT_BUF)) {
+		WD_ERR("invalid: soft comp driver do not support sgl data format!\n");
+		return -WD_EINVAL;
+	}
+
+	if (unlikely(msg->alg_type > WD_GZIP)) {
+		WD_ERR("invalid: soft comp alg type %d is not supported!\n",
+		       msg->alg_type);
+		return -WD_EINVAL;
+	}
+
+	if (msg->stream_mode == WD_COMP_STATEFUL)
+		return soft_comp_stateful(msg);
+
+	return soft_comp_stateless(msg);
+}
+
+static int soft_comp_recv(struct wd_alg_driver *drv, handle_t ctx, void *comp_msg)
+{
+	/* The request is done in send */
+	return WD_SUCCESS;
+}
+
+static int soft_comp_init(struct wd_alg_driver *drv, void *conf)
+{
+	struct wd_ctx_config_internal *config = conf;
+
+	/* Fallback init is NULL */
+	if (!drv || !conf)
+		return 0;
+
+	config->epoll_en = 0;
+
+	return WD_SUCCESS;
+}
+
+static void soft_comp_exit(struct wd_alg_driver *drv)
+{
+}
+
+#define GEN_SOFT_COMP_DRIVER(soft_alg_name) \
+{\
+	.drv_name = "soft_comp",\
+	.alg_name = (soft_alg_name),\
+	.calc_type = UADK_ALG_SOFT,\
+	.priority = 0,\
+	.queue_num = 1,\
+	.op_type_num = 1,\
+	.fallback = 0,\
+	.init = soft_comp_init,\
+	.exit = soft_comp_exit,\
+	.send = soft_comp_send,\
+	.recv = soft_comp_recv,\
+	.get_usage = soft_comp_get_usage,\
+	.get_extend_ops = soft_comp_get_extend_ops,\
+}
+
+static struct wd_alg_driver soft_comp_driver[] = {
+	GEN_SOFT_COMP_DRIVER("zlib"),
+	GEN_SOFT_COMP_DRIVER("gzip"),
+	GEN_SOFT_COMP_DRIVER("deflate"),
+};
+
+static void __attribute__((constructor)) soft_comp_probe(void)
+{
+	int alg_num = ARRAY_SIZE(soft_comp_driver);
+	int i, ret;
+
+	WD_INFO("Info: register soft comp alg drivers!\n");
+
+	for (i = 0; i < alg_num; i++) {
+		ret = wd_alg_driver_register(&soft_comp_driver[i]);
+		if (ret && ret != -WD_ENODEV)
+			WD_ERR("Error: register soft comp %s failed!\n",
+				soft_comp_driver[i].alg_name);
+	}
+}
+
+static void __attribute__((destructor)) soft_comp_remove(void)
+{
+	int alg_num = ARRAY_SIZE(soft_comp_driver);
+	int i;
+
+	WD_INFO("Info: unregister soft comp alg drivers!\n");
+	for (i = 0; i < alg_num; i++)
+		wd_alg_driver_unregister(&soft_comp_driver[i]);
+}
@@ -0,0 +1,1350 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "drv/wd_agg_drv.h"
+#include "wd_agg.h"
+#include "wd_util.h"
+
+#define SOFT_DAE_MAX_KEY_COLS		16
+#define SOFT_DAE_MAX_OUTPUT_COLS	16
+#define SOFT_DAE_DEF_VCHAR_SIZE		30
+#define SOFT_DAE_MAX_VCHAR_SIZE		1000
+#define SOFT_DAE_MIN_ROW_SIZE		32
+#define SOFT_DAE_MAX_ROW_SIZE		2048
+#define SOFT_DAE_CACHE_LINE		64
+#define SOFT_DAE_MAX_PROBE		4
+#define SOFT_DAE_BATCH_ROWS		256
+#define SOFT_DAE_INT_SIZE		4
+#define SOFT_DAE_LONG_SIZE		8
+#define SOFT_DAE_DECIMAL128_SIZE	16
+
+#define SOFT_HASH_SEED			0x2d358dccaa6c78a5ULL
+#define SOFT_HASH_MUL			0x9e3779b97f4a7c15ULL
+#define SOFT_HASH_NULL			0x8bb84b93962eacc9ULL
+#define SOFT_HASH_SHIFT			29
+#define SOFT_HASH_HIGH_SHIFT		32
+#define SOFT_HASH_LOW_MASK		0xffffffffULL
+/* The home bucket is got from the low 32 bits of the hash */
+#define SOFT_MAX_BUCKETS		(1ULL << 32)
+
+/* HyperLogLog of 2^7 registers, the standard error is about 9% */
+#define SOFT_HLL_BITS			7
+#define SOFT_HLL_REGS			(1U << SOFT_HLL_BITS)
+#define SOFT_HLL_ALPHA			0.7213
+#define SOFT_HLL_ALPHA_M		1.079
+#define SOFT_HLL_SMALL_RANGE		2.5
+
+#define SOFT_ROW_USED			0x1
+
+#define SOFT_ALIGN(x, a)		(((x) + (a) - 1) & ~((__u64)(a) - 1))
+#define SOFT_PTR_ALIGN(p, a)		((__u8 *)SOFT_ALIGN((uintptr_t)(p), (a)))
+
+enum soft_agg_op {
+	SOFT_AGG_SUM,
+	SOFT_AGG_COUNT,
+	SOFT_AGG_COUNT_ALL,
+	SOFT_AGG_MIN,
+	SOFT_AGG_MAX,
+	SOFT_AGG_DISTINCT,
+};
+
+/*
+ * Every row of the hash table starts with this head, then the key columns
+ * in the user order, then the aggregated values aligned to their size.
+ * @ext_next: index + 1 of the next row in the extend table, 0 is the end.
+ * Only the first row of a bucket and the extend rows use it.
+ * @key_nulls: bit i is set if key column i is empty.
+ * @valid: bit k is set if output column k got a non-empty value.
+ */
+struct soft_row_head {
+	__u32 hash;
+	__u32 ext_next;
+	__u16 flags;
+	__u16 key_nulls;
+	__u16 valid;
+	__u16 resv;
+};
+
+/*
+ * @size: bytes of the key in a row. For VARCHAR it is the max length,
+ * and the row keeps a 2 bytes length before the data.
+ */
+struct soft_key_col {
+	enum wd_dae_data_type type;
+	__u32 offset;
+	__u32 size;
+};
+
+/*
+ * An output agg column, count(*) is the last one if it exists. avg is
+ * a sum column and a count column of the same input.
+ * @in_idx: the input agg column of the normal input. For rehash input
+ * the input column has the same index as the output column.
+ * @in_size: the size of a CHAR input for count distinct.
+ */
+struct soft_agg_col {
+	enum soft_agg_op op;
+	enum wd_dae_data_type in_type;
+	enum wd_dae_data_type out_type;
+	__u32 in_idx;
+	__u32 in_size;
+	__u32 offset;
+};
+
+struct soft_table {
+	__u8 *std_table;
+	__u8 *ext_table;
+	__u64 std_row_num;
+	__u64 bucket_num;
+	__u64 ext_row_num;
+	__u64 ext_used;
+	/* The next row to output */
+	__u64 out_pos;
+};
+
+struct soft_hashagg_ctx {
+	struct soft_key_col key_cols[SOFT_DAE_MAX_KEY_COLS];
+	struct soft_agg_col agg_cols[SOFT_DAE_MAX_OUTPUT_COLS];
+	struct soft_table table;
+	struct soft_table rehash_table;
+	/*
+	 * The rows of the last rehash output. The next rehash input has the
+	 * same rows, and takes the count distinct registers from them.
+	 */
+	__u8 **rehash_rows;
+	__u32 rehash_rows_num;
+	__u32 key_num;
+	__u32 out_num;
+	__u32 row_size;
+	__u32 bucket_rows;
+	__u16 sum_overflow_cols;
+	bool has_distinct;
+};
+
+static inline __u64 soft_hash_mix(__u64 h, __u64 v)
+{
+	h = (h ^ v) * SOFT_HASH_MUL;
+
+	return h ^ (h >> SOFT_HASH_SHIFT);
+}
+
+static __u64 soft_hash_bytes(__u64 h, const __u8 *data, __u32 len)
+{
+	__u64 v;
+	__u32 i;
+
+	for (i = 0; i + sizeof(v) <= len; i += sizeof(v)) {
+		memcpy(&v, data + i, sizeof(v));
+		h = soft_hash_mix(h, v);
+	}
+
+	if (i < len) {
+		v = 0;
+		memcpy(&v, data + i, len - i);
+		h = soft_hash_mix(h, v);
+	}
+
+	return soft_hash_mix(h, len);
+}
+
+static inline struct soft_row_head *soft_row_head(__u8 *row)
+{
+	return (struct soft_row_head *)row;
+}
+
+static const __u8 *soft_vchar_data(struct wd_dae_col_addr *col, __u32 r, __u32 *len)
+{
+	*len = col->offset[r + 1] - col->offset[r];
+
+	return (const __u8 *)col->value + col->offset[r] - col->offset[0];
+}
+
+static const __u8 *soft_key_data(struct wd_dae_col_addr *col, struct soft_key_col *key,
+				 __u32 r, __u32 *len)
+{
+	if (key->type == WD_DAE_VARCHAR)
+		return soft_vchar_data(col, r, len);
+
+	*len = key->size;
+
+	return (const __u8 *)col->value + (__u64)r * key->size;
+}
+
+/*
+ * Hash a batch of rows column by column, the fixed size columns are done
+ * in loops without branches. Return the number of rows before a VARCHAR
+ * key which is longer than its size in the hash table.
+ */
+static __u32 soft_hash_keys(struct soft_hashagg_ctx *ctx, struct wd_dae_col_addr *cols,
+			    __u32 start, __u32 num, __u64 *hash)
+{
+	__u32 i, r, len, valid = num;
+	const __u8 *empty, *data;
+	const __u32 *v32;
+	const __u64 *v64;
+
+	for (r = 0; r < num; r++)
+		hash[r] = SOFT_HASH_SEED;
+
+	for (i = 0; i < ctx->key_num; i++) {
+		empty = cols[i].empty + start;
+		switch (ctx->key_cols[i].type) {
+		case WD_DAE_DATE:
+		case WD_DAE_INT:
+			v32 = (const __u32 *)cols[i].value + start;
+			for (r = 0; r < num; r++)
+				hash[r] = soft_hash_mix(hash[r], empty[r] ? SOFT_HASH_NULL : v32[r]);
+			break;
+		case WD_DAE_LONG:
+		case WD_DAE_SHORT_DECIMAL:
+			v64 = (const __u64 *)cols[i].value + start;
+			for (r = 0; r < num; r++)
+				hash[r] = soft_hash_mix(hash[r], empty[r] ? SOFT_HASH_NULL : v64[r]);
+			break;
+		case WD_DAE_VARCHAR:
+			for (r = 0; r < valid; r++) {
+				if (empty[r]) {
+					hash[r] = soft_hash_mix(hash[r], SOFT_HASH_NULL);
+					continue;
+				}
+				data = soft_vchar_data(cols + i, start + r, &len);
+				if (len > ctx->key_cols[i].size) {
+					WD_ERR("invalid: key %u vchar len %u is more than %u!\n",
+					       i, len, ctx->key_cols[i].size);
+					valid = r;
+					break;
+				}
+				hash[r] = soft_hash_bytes(hash[r], data, len);
+			}
+			break;
+		default:
+			for (r = 0; r < num; r++) {
+				if (empty[r]) {
+					hash[r] = soft_hash_mix(hash[r], SOFT_HASH_NULL);
+					continue;
+				}
+				data = soft_key_data(cols + i, ctx->key_cols + i, start + r, &len);
+				hash[r] = soft_hash_bytes(hash[r], data, len);
+			}
+			break;
+		}
+	}
+
+	return valid;
+}
+
+static __u16 soft_key_nulls(struct soft_hashagg_ctx *ctx, struct wd_dae_col_addr *cols,
+			    __u32 r)
+{
+	__u16 nulls = 0;
+	__u32 i;
+
+	for (i = 0; i < ctx->key_num; i++)
+		nulls |= (__u16)(!!cols[i].empty[r] << i);
+
+	return nulls;
+}
+
+static bool soft_key_match(struct soft_hashagg_ctx *ctx, __u8 *row,
+			   struct wd_dae_col_addr *cols, __u32 r, __u16 nulls)
+{
+	struct soft_key_col *key;
+	const __u8 *data;
+	__u16 row_len;
+	__u32 i, len;
+
+	if (soft_row_head(row)->key_nulls != nulls)
+		return false;
+
+	for (i = 0; i < ctx->key_num; i++) {
+		if (nulls & (1U << i))
+			continue;
+
+		key = ctx->key_cols + i;
+		data = soft_key_data(cols + i, key, r, &len);
+		if (key->type != WD_DAE_VARCHAR) {
+			if (memcmp(row + key->offset, data, len))
+				return false;
+			continue;
+		}
+
+		memcpy(&row_len, row + key->offset, sizeof(row_len));
+		if (row_len != len ||
+		    memcmp(row + key->offset + sizeof(row_len), data, len))
+			return false;
+	}
+
+	return true;
+}
+
+static void soft_key_store(struct soft_hashagg_ctx *ctx, __u8 *row, __u32 hash,
+			   struct wd_dae_col_addr *cols, __u32 r, __u16 nulls)
+{
+	struct soft_row_head *head = soft_row_head(row);
+	struct soft_key_col *key;
+	const __u8 *data;
+	__u16 row_len;
+	__u32 i, len;
+
+	head->hash = hash;
+	head->flags = SOFT_ROW_USED;
+	head->key_nulls = nulls;
+
+	for (i = 0; i < ctx->key_num; i++) {
+		if (nulls & (1U << i))
+			continue;
+
+		key = ctx->key_cols + i;
+		data = soft_key_data(cols + i, key, r, &len);
+		if (key->type != WD_DAE_VARCHAR) {
+			memcpy(row + key->offset, data, len);
+			continue;
+		}
+
+		row_len = len;
+		memcpy(row + key->offset, &row_len, sizeof(row_len));
+		memcpy(row + key->offset + sizeof(row_len), data, len);
+	}
+}
+
+/*
+ * Map the low half of the hash to [0, bucket_num) by a multiply and a shift,
+ * so that the table keeps all the buckets of the user memory, not only a
+ * power of 2 of them.
+ */
+static inline __u64 soft_home_bucket(__u64 hash, __u64 bucket_num)
+{
+	return ((hash & SOFT_HASH_LOW_MASK) * bucket_num) >> SOFT_HASH_HIGH_SHIFT;
+}
+
+/*
+ * The standard table is an open addressing table of cache line buckets,
+ * a key is looked up in SOFT_DAE_MAX_PROBE buckets from its home bucket.
+ * When they are all used, the key is chained to the home bucket in the
+ * extend table. Rows are never removed, so an empty row ends the lookup.
+ * Return NULL if the key is new and the extend table is full.
+ */
+static __u8 *soft_table_find(struct soft_hashagg_ctx *ctx, struct soft_table *table,
+			     __u64 hash, struct wd_dae_col_addr *cols, __u32 r)
+{
+	__u64 bucket_size = (__u64)ctx->bucket_rows * ctx->row_size;
+	__u64 home = soft_home_bucket(hash, table->bucket_num);
+	__u32 hash32 = hash >> SOFT_HASH_HIGH_SHIFT;
+	__u16 nulls = soft_key_nulls(ctx, cols, r);
+	__u8 *row, *bucket;
+	__u32 i, idx;
+	__u64 p, b;
+
+	for (p = 0; p < SOFT_DAE_MAX_PROBE && p < table->bucket_num; p++) {
+		b = home + p;
+		if (b >= table->bucket_num)
+			b -= table->bucket_num;
+		bucket = table->std_table + b * bucket_size;
+		for (i = 0, row = bucket; i < ctx->bucket_rows; i++, row += ctx->row_size) {
+			if (!(soft_row_head(row)->flags & SOFT_ROW_USED)) {
+				soft_key_store(ctx, row, hash32, cols, r, nulls);
+				return row;
+			}
+			if (soft_row_head(row)->hash == hash32 &&
+			    soft_key_match(ctx, row, cols, r, nulls))
+				return row;
+		}
+	}
+
+	bucket = table->std_table + home * bucket_size;
+	idx = soft_row_head(bucket)->ext_next;
+	while (idx) {
+		row = table->ext_table + (__u64)(idx - 1) * ctx->row_size;
+		if (soft_row_head(row)->hash == hash32 &&
+		    soft_key_match(ctx, row, cols, r, nulls))
+			return row;
+		idx = soft_row_head(row)->ext_next;
+	}
+
+	if (table->ext_used >= table->ext_row_num)
+		return NULL;
+
+	row = table->ext_table + table->ext_used * ctx->row_size;
+	table->ext_used++;
+	soft_key_store(ctx, row, hash32, cols, r, nulls);
+	soft_row_head(row)->ext_next = soft_row_head(bucket)->ext_next;
+	soft_row_head(bucket)->ext_next = table->ext_used;
+
+	return row;
+}
+
+static __u32 soft_find_rows(struct soft_hashagg_ctx *ctx, struct wd_dae_col_addr *cols,
+			    __u32 start, __u32 num, __u64 *hash, __u8 **rows)
+{
+	__u32 r;
+
+	for (r = 0; r < num; r++) {
+		rows[r] = soft_table_find(ctx, &ctx->table, hash[r], cols, start + r);
+		if (!rows[r])
+			break;
+	}
+
+	return r;
+}
+
+static void soft_sum_s64(__u8 **rows, __u32 num, __u32 k, __u32 offset,
+			 const __u8 *empty, const __s64 *in, __u16 *overflow)
+{
+	__s64 *sum;
+	__u32 r;
+
+	for (r = 0; r < num; r++) {
+		if (empty[r])
+			continue;
+		sum = (__s64 *)(rows[r] + offset);
+		if (__builtin_add_overflow(*sum, in[r], sum))
+			*overflow |= 1U << k;
+		soft_row_head(rows[r])->valid |= 1U << k;
+	}
+}
+
+static void soft_sum_s128(__u8 **rows, __u32 num, __u32 k, __u32 offset,
+			  const __u8 *empty, const __u8 *in, __u32 in_size,
+			  __u16 *overflow)
+{
+	__int128 sum, val;
+	__s64 val64;
+	__u32 r;
+
+	for (r = 0; r < num; r++) {
+		if (empty[r])
+			continue;
+		if (in_size == SOFT_DAE_DECIMAL128_SIZE) {
+			memcpy(&val, in + (__u64)r * in_size, sizeof(val));
+		} else {
+			memcpy(&val64, in + (__u64)r * in_size, sizeof(val64));
+			val = val64;
+		}
+		memcpy(&sum, rows[r] + offset, sizeof(sum));
+		if (__builtin_add_overflow(sum, val, &sum))
+			*overflow |= 1U << k;
+		memcpy(rows[r] + offset, &sum, sizeof(sum));
+		soft_row_head(rows[r])->valid |= 1U << k;
+	}
+}
+
+static void soft_count(__u8 **rows, __u32 num, __u32 offset, const __u8 *empty)
+{
+	__u32 r;
+
+	for (r = 0; r < num; r++)
+		*(__s64 *)(rows[r] + offset) += !empty[r];
+}
+
+static void soft_count_all(__u8 **rows, __u32 num, __u32 offset)
+{
+	__u32 r;
+
+	for (r = 0; r < num; r++)
+		*(__s64 *)(rows[r] + offset) += 1;
+}
+
+/* The counts of a rehash input are the outputs of the old table, add them */
+static void soft_count_merge(__u8 **rows, __u32 num, __u32 offset, const __s64 *in)
+{
+	__u32 r;
+
+	for (r = 0; r < num; r++)
+		*(__s64 *)(rows[r] + offset) += in[r];
+}
+
+static __u32 soft_type_size(enum wd_dae_data_type type)
+{
+	switch (type) {
+	case WD_DAE_DATE:
+	case WD_DAE_INT:
+		return SOFT_DAE_INT_SIZE;
+	case WD_DAE_LONG_DECIMAL:
+		return SOFT_DAE_DECIMAL128_SIZE;
+	default:
+		return SOFT_DAE_LONG_SIZE;
+	}
+}
+
+static __int128 soft_load_int(const __u8 *data, __u32 size)
+{
+	__int128 v128;
+	__s64 v64;
+	__s32 v32;
+
+	if (size == SOFT_DAE_INT_SIZE) {
+		memcpy(&v32, data, sizeof(v32));
+		return v32;
+	} else if (size == SOFT_DAE_LONG_SIZE) {
+		memcpy(&v64, data, sizeof(v64));
+		return v64;
+	}
+
+	memcpy(&v128, data, sizeof(v128));
+	return v128;
+}
+
+static void soft_store_int(__u8 *data, __u32 size, __int128 val)
+{
+	__s64 v64 = (__s64)val;
+	__s32 v32 = (__s32)val;
+
+	if (size == SOFT_DAE_INT_SIZE)
+		memcpy(data, &v32, sizeof(v32));
+	else if (size == SOFT_DAE_LONG_SIZE)
+		memcpy(data, &v64, sizeof(v64));
+	else
+		memcpy(data, &val, sizeof(val));
+}
+
+/* The input of min and max has the same type as the output */
+static void soft_minmax(__u8 **rows, __u32 num, __u32 k, struct soft_agg_col *agg,
+			const __u8 *empty, const __u8 *in)
+{
+	__u32 size = soft_type_size(agg->out_type);
+	bool is_max = agg->op == SOFT_AGG_MAX;
+	__int128 val, cur;
+	__u32 r;
+
+	for (r = 0; r < num; r++) {
+		if (empty[r])
+			continue;
+
+		val = soft_load_int(in + (__u64)r * size, size);
+		if (soft_row_head(rows[r])->valid & (1U << k)) {
+			cur = soft_load_int(rows[r] + agg->offset, size);
+			if (is_max ? val <= cur : val >= cur)
+				continue;
+		}
+		soft_store_int(rows[r] + agg->offset, size, val);
+		soft_row_head(rows[r])->valid |= 1U << k;
+	}
+}
+
+static inline __u64 soft_hash_final(__u64 h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+
+	return h ^ (h >> 33);
+}
+
+/*
+ * Each value sets the register of its low hash bits to the position of
+ * the lowest 1 bit in the rest of the hash, if that is larger.
+ */
+static void soft_distinct_add(__u8 **rows, __u32 num, struct soft_agg_col *agg,
+			      struct wd_dae_col_addr *col, __u32 start)
+{
+	const __u8 *empty = col->empty + start;
+	const __u8 *data;
+	__u32 r, len;
+	__u64 h, w;
+	__u8 rank;
+	__u8 *reg;
+
+	for (r = 0; r < num; r++) {
+		if (empty[r])
+			continue;
+
+		if (agg->in_type == WD_DAE_VARCHAR) {
+			data = soft_vchar_data(col, start + r, &len);
+		} else {
+			len = agg->in_size;
+			data = (const __u8 *)col->value + (__u64)(start + r) * len;
+		}
+
+		h = soft_hash_final(soft_hash_bytes(SOFT_HASH_SEED, data, len));
+		w = h >> SOFT_HLL_BITS;
+		rank = w ? __builtin_ctzll(w) + 1 : 64 - SOFT_HLL_BITS + 1;
+		reg = rows[r] + agg->offset + (h & (SOFT_HLL_REGS - 1));
+		if (*reg < rank)
+			*reg = rank;
+	}
+}
+
+static void soft_distinct_merge(__u8 **rows, __u32 num, struct soft_agg_col *agg,
+				__u8 **src_rows)
+{
+	__u8 *dst, *src;
+	__u32 r, i;
+
+	for (r = 0; r < num; r++) {
+		dst = rows[r] + agg->offset;
+		src = src_rows[r] + agg->offset;
+		for (i = 0; i < SOFT_HLL_REGS; i++)
+			dst[i] = dst[i] > src[i] ? dst[i] : src[i];
+	}
+}
+
+static __s64 soft_distinct_estimate(const __u8 *reg)
+{
+	double alpha = SOFT_HLL_ALPHA / (1 + SOFT_HLL_ALPHA_M / SOFT_HLL_REGS);
+	double sum = 0, est;
+	__u32 i, zeros = 0;
+
+	for (i = 0; i < SOFT_HLL_REGS; i++) {
+		sum += 1.0 / (1ULL << reg[i]);
+		zeros += !reg[i];
+	}
+
+	est = alpha * SOFT_HLL_REGS * SOFT_HLL_REGS / sum;
+	/* Linear counting is better for the small counts */
+	if (est <= SOFT_HLL_SMALL_RANGE * SOFT_HLL_REGS && zeros)
+		est = SOFT_HLL_REGS * log((double)SOFT_HLL_REGS / zeros);
+
+	return (__s64)(est + 0.5);
+}
+
+static void soft_update_aggs(struct soft_hashagg_ctx *ctx, struct wd_dae_col_addr *cols,
+			     __u32 start, __u32 num, __u8 **rows, bool is_rehash)
+{
+	enum wd_dae_data_type in_type;
+	struct wd_dae_col_addr *col;
+	struct soft_agg_col *agg;
+	__u32 k, size;
+
+	for (k = 0; k < ctx->out_num; k++) {
+		agg = ctx->agg_cols + k;
+		if (agg->op == SOFT_AGG_COUNT_ALL && !is_rehash) {
+			soft_count_all(rows, num, agg->offset);
+			continue;
+		}
+
+		if (agg->op == SOFT_AGG_DISTINCT) {
+			if (is_rehash)
+				soft_distinct_merge(rows, num, agg, ctx->rehash_rows + start);
+			else
+				soft_distinct_add(rows, num, agg, cols + agg->in_idx, start);
+			continue;
+		}
+
+		col = cols + (is_rehash ? k : agg->in_idx);
+		in_type = is_rehash ? agg->out_type : agg->in_type;
+		size = soft_type_size(in_type);
+		if (agg->op == SOFT_AGG_MIN || agg->op == SOFT_AGG_MAX) {
+			soft_minmax(rows, num, k, agg, col->empty + start,
+				    (const __u8 *)col->value + (__u64)start * size);
+			continue;
+		}
+
+		if (agg->op != SOFT_AGG_SUM) {
+			if (is_rehash)
+				soft_count_merge(rows, num, agg->offset,
+						 (const __s64 *)col->value + start);
+			else
+				soft_count(rows, num, agg->offset, col->empty + start);
+			continue;
+		}
+
+		if (agg->out_type == WD_DAE_LONG_DECIMAL)
+			soft_sum_s128(rows, num, k, agg->offset, col->empty + start,
+				      (const __u8 *)col->value + (__u64)start * size, size,
+				      &ctx->sum_overflow_cols);
+		else
+			soft_sum_s64(rows, num, k, agg->offset, col->empty + start,
+				     (const __s64 *)col->value + start,
+				     &ctx->sum_overflow_cols);
+	}
+}
+
+static void soft_fill_sum_overflow_cols(struct soft_hashagg_ctx *ctx, struct wd_agg_msg *msg)
+{
+	__u32 k;
+
+	if (!ctx->sum_overflow_cols)
+		return;
+
+	if (msg->result == WD_AGG_TASK_DONE)
+		msg->result = WD_AGG_SUM_OVERFLOW;
+
+	if (!msg->req.sum_overflow_cols)
+		return;
+
+	for (k = 0; k < ctx->out_num; k++)
+		msg->req.sum_overflow_cols[k] = !!(ctx->sum_overflow_cols & (1U << k));
+}
+
+static void soft_hashagg_input(struct soft_hashagg_ctx *ctx, struct wd_agg_msg *msg,
+			       bool is_rehash)
+{
+	struct wd_dae_col_addr *key_cols = msg->req.key_cols;
+	struct wd_dae_col_addr *agg_cols = msg->req.agg_cols;
+	__u8 *rows[SOFT_DAE_BATCH_ROWS];
+	__u64 hash[SOFT_DAE_BATCH_ROWS];
+	__u32 start, num, valid, done;
+
+	for (start = 0; start < msg->row_count; start += num) {
+		num = msg->row_count - start;
+		if (num > SOFT_DAE_BATCH_ROWS)
+			num = SOFT_DAE_BATCH_ROWS;
+
+		valid = soft_hash_keys(ctx, key_cols, start, num, hash);
+		done = soft_find_rows(ctx, key_cols, start, valid, hash, rows);
+		soft_update_aggs(ctx, agg_cols, start, done, rows, is_rehash);
+		if (done < valid) {
+			msg->result = WD_AGG_NEED_REHASH;
+			msg->in_row_count = start + done;
+			return;
+		} else if (valid < num) {
+			msg->result = WD_AGG_INVALID_VARCHAR;
+			msg->in_row_count = start + valid;
+			return;
+		}
+	}
+
+	msg->in_row_count = msg->row_count;
+}
+
+static __u8 *soft_table_row(struct soft_hashagg_ctx *ctx, struct soft_table *table, __u64 pos)
+{
+	if (pos < table->std_row_num)
+		return table->std_table + pos * ctx->row_size;
+
+	return table->ext_table + (pos - table->std_row_num) * ctx->row_size;
+}
+
+/* Check if the VARCHAR keys of a row can be put in the output columns */
+static bool soft_vchar_out_fit(struct soft_hashagg_ctx *ctx, struct wd_dae_col_addr *cols,
+			       __u8 *row, __u64 *vchar_len)
+{
+	struct soft_key_col *key;
+	__u16 row_len;
+	__u32 i;
+
+	for (i = 0; i < ctx->key_num; i++) {
+		key = ctx->key_cols + i;
+		if (key->type != WD_DAE_VARCHAR ||
+		    soft_row_head(row)->key_nulls & (1U << i))
+			continue;
+
+		memcpy(&row_len, row + key->offset, sizeof(row_len));
+		if (cols[i].value_size && vchar_len[i] + row_len > cols[i].value_size)
+			return false;
+		vchar_len[i] += row_len;
+	}
+
+	return true;
+}
+
+static void soft_out_key(struct soft_key_col *key, __u32 bit, struct wd_dae_col_addr *col,
+			 __u8 **rows, __u32 start, __u32 num)
+{
+	__u32 r, idx, off;
+	__u16 row_len;
+	__u8 *dst;
+
+	for (r = 0; r < num; r++) {
+		idx = start + r;
+		col->empty[idx] = !!(soft_row_head(rows[r])->key_nulls & bit);
+		if (key->type != WD_DAE_VARCHAR) {
+			dst = (__u8 *)col->value + (__u64)idx * key->size;
+			if (col->empty[idx])
+				memset(dst, 0, key->size);
+			else
+				memcpy(dst, rows[r] + key->offset, key->size);
+			continue;
+		}
+
+		if (!idx)
+			col->offset[0] = 0;
+		off = col->offset[idx];
+		row_len = 0;
+		if (!col->empty[idx]) {
+			memcpy(&row_len, rows[r] + key->offset, sizeof(row_len));
+			memcpy((__u8 *)col->value + off, rows[r] + key->offset + sizeof(row_len),
+			       row_len);
+		}
+		col->offset[idx + 1] = off + row_len;
+	}
+}
+
+static void soft_out_agg(struct soft_agg_col *agg, __u32 k, struct wd_dae_col_addr *col,
+			 __u8 **rows, __u32 start, __u32 num)
+{
+	__u32 size = soft_type_size(agg->out_type);
+	__u8 *dst = (__u8 *)col->value + (__u64)start * size;
+	__s64 *est = (__s64 *)dst;
+	__u32 r;
+
+	if (agg->op == SOFT_AGG_DISTINCT) {
+		for (r = 0; r < num; r++)
+			est[r] = soft_distinct_estimate(rows[r] + agg->offset);
+	} else {
+		for (r = 0; r < num; r++)
+			memcpy(dst + (__u64)r * size, rows[r] + agg->offset, size);
+	}
+
+	switch (agg->op) {
+	case SOFT_AGG_SUM:
+	case SOFT_AGG_MIN:
+	case SOFT_AGG_MAX:
+		/* The result of a group without any non-empty value is empty */
+		for (r = 0; r < num; r++)
+			col->empty[start + r] = !(soft_row_head(rows[r])->valid & (1U << k));
+		break;
+	default:
+		memset(col->empty + start, 0, num);
+		break;
+	}
+}
+
+static void soft_hashagg_output(struct soft_hashagg_ctx *ctx, struct wd_agg_msg *msg,
+				struct soft_table *table)
+{
+	__u64 total = table->std_row_num + table->ext_used;
+	__u64 vchar_len[SOFT_DAE_MAX_KEY_COLS] = {0};
+	struct wd_agg_req *req = &msg->req;
+	__u8 *rows[SOFT_DAE_BATCH_ROWS];
+	__u64 pos = table->out_pos;
+	__u32 count = 0, num, i;
+	bool full = false;
+	__u8 *row;
+
+	while (!full && pos < total && count < msg->row_count) {
+		/* Collect a batch of used rows, then write them column by column */
+		for (num = 0; pos < total && num < SOFT_DAE_BATCH_ROWS &&
+		     count + num < msg->row_count; pos++) {
+			row = soft_table_row(ctx, table, pos);
+			if (!(soft_row_head(row)->flags & SOFT_ROW_USED))
+				continue;
+			if (!soft_vchar_out_fit(ctx, req->out_key_cols, row, vchar_len)) {
+				full = true;
+				break;
+			}
+			rows[num++] = row;
+		}
+
+		if (table == &ctx->rehash_table && ctx->has_distinct)
+			memcpy(ctx->rehash_rows + count, rows, num * sizeof(rows[0]));
+
+		for (i = 0; i < ctx->key_num; i++)
+			soft_out_key(ctx->key_cols + i, 1U << i, req->out_key_cols + i,
+				     rows, count, num);
+
+		for (i = 0; i < ctx->out_num; i++)
+			soft_out_agg(ctx->agg_cols + i, i, req->out_agg_cols + i,
+				     rows, count, num);
+
+		count += num;
+	}
+
+	/* Skip the empty rows at the end, so the last output reports done */
+	while (pos < total && !(soft_row_head(soft_table_row(ctx, table, pos))->flags &
+				SOFT_ROW_USED))
+		pos++;
+
+	table->out_pos = pos;
+	msg->out_row_count = count;
+	msg->output_done = pos >= total;
+}
+
+static int soft_rehash_rows_alloc(struct soft_hashagg_ctx *ctx, __u32 row_num)
+{
+	__u8 **rows;
+
+	if (!ctx->has_distinct || row_num <= ctx->rehash_rows_num)
+		return WD_SUCCESS;
+
+	rows = realloc(ctx->rehash_rows, row_num * sizeof(rows[0]));
+	if (!rows) {
+		WD_ERR("failed to alloc soft hashagg rehash rows!\n");
+		return -WD_ENOMEM;
+	}
+
+	ctx->rehash_rows = rows;
+	ctx->rehash_rows_num = row_num;
+
+	return WD_SUCCESS;
+}
+
+static int soft_hashagg_send(struct wd_alg_driver *drv, handle_t ctx, void *hashagg_msg)
+{
+	struct wd_agg_msg *msg = hashagg_msg;
+	struct soft_hashagg_ctx *agg_ctx;
+	int ret;
+
+	if (unlikely(!msg || !msg->priv)) {
+		WD_ERR("invalid: soft hashagg msg or session priv is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	agg_ctx = msg->priv;
+	if (unlikely(!agg_ctx->table.std_table)) {
+		WD_ERR("invalid: soft hashagg hash table is not set!\n");
+		return -WD_EINVAL;
+	}
+
+	msg->result = WD_AGG_TASK_DONE;
+	switch (msg->pos) {
+	case WD_AGG_STREAM_INPUT:
+		soft_hashagg_input(agg_ctx, msg, false);
+		break;
+	case WD_AGG_REHASH_INPUT:
+		soft_hashagg_input(agg_ctx, msg, true);
+		break;
+	case WD_AGG_STREAM_OUTPUT:
+		soft_hashagg_output(agg_ctx, msg, &agg_ctx->table);
+		break;
+	case WD_AGG_REHASH_OUTPUT:
+		if (unlikely(!agg_ctx->rehash_table.std_table)) {
+			WD_ERR("invalid: soft hashagg rehash table is not set!\n");
+			return -WD_EINVAL;
+		}
+		ret = soft_rehash_rows_alloc(agg_ctx, msg->row_count);
+		if (ret)
+			return ret;
+		soft_hashagg_output(agg_ctx, msg, &agg_ctx->rehash_table);
+		break;
+	default:
+		WD_ERR("invalid: soft hashagg msg pos %d is wrong!\n", msg->pos);
+		return -WD_EINVAL;
+	}
+
+	soft_fill_sum_overflow_cols(agg_ctx, msg);
+
+	return WD_SUCCESS;
+}
+
+static int soft_hashagg_recv(struct wd_alg_driver *drv, handle_t ctx, void *hashagg_msg)
+{
+	/*
+	 * The request is done in send. Only the sync mode is supported, the
+	 * driver has no async ctx and wd_agg rejects the async requests.
+	 */
+	return WD_SUCCESS;
+}
+
+static int soft_key_col_init(struct soft_key_col *key, struct wd_key_col_info *info,
+			     __u32 idx)
+{
+	key->type = info->input_data_type;
+	switch (key->type) {
+	case WD_DAE_DATE:
+	case WD_DAE_INT:
+	case WD_DAE_LONG:
+	case WD_DAE_SHORT_DECIMAL:
+	case WD_DAE_LONG_DECIMAL:
+		key->size = soft_type_size(key->type);
+		break;
+	case WD_DAE_CHAR:
+		key->size = info->col_data_info;
+		break;
+	case WD_DAE_VARCHAR:
+		key->size = info->col_data_info ? info->col_data_info : SOFT_DAE_DEF_VCHAR_SIZE;
+		if (key->size > SOFT_DAE_MAX_VCHAR_SIZE) {
+			WD_ERR("invalid: key %u vchar size %u is more than support %d!\n",
+			       idx, key->size, SOFT_DAE_MAX_VCHAR_SIZE);
+			return -WD_EINVAL;
+		}
+		break;
+	default:
+		WD_ERR("invalid: unsupport key col %u data type %d!\n", idx, key->type);
+		return -WD_EINVAL;
+	}
+
+	return WD_SUCCESS;
+}
+
+/* The same input and output types as the DAE, so the results can be compared */
+static int soft_agg_col_check(struct soft_agg_col *agg)
+{
+	switch (agg->op) {
+	case SOFT_AGG_COUNT:
+	case SOFT_AGG_DISTINCT:
+		if (agg->in_type > WD_DAE_VARCHAR || agg->out_type != WD_DAE_LONG)
+			goto err;
+		return WD_SUCCESS;
+	case SOFT_AGG_MIN:
+	case SOFT_AGG_MAX:
+		if (agg->out_type != agg->in_type || agg->in_type == WD_DAE_CHAR ||
+		    agg->in_type == WD_DAE_VARCHAR)
+			goto err;
+		return WD_SUCCESS;
+	default:
+		break;
+	}
+
+	switch (agg->in_type) {
+	case WD_DAE_LONG:
+		if (agg->out_type != WD_DAE_LONG)
+			goto err;
+		break;
+	case WD_DAE_SHORT_DECIMAL:
+		if (agg->out_type != WD_DAE_SHORT_DECIMAL &&
+		    agg->out_type != WD_DAE_LONG_DECIMAL)
+			goto err;
+		break;
+	case WD_DAE_LONG_DECIMAL:
+		if (agg->out_type != WD_DAE_LONG_DECIMAL)
+			goto err;
+		break;
+	default:
+		goto err;
+	}
+
+	return WD_SUCCESS;
+
+err:
+	WD_ERR("invalid: soft hashagg not support alg %d from type %d to %d!\n",
+	       agg->op, agg->in_type, agg->out_type);
+	return -WD_EINVAL;
+}
+
+static int soft_agg_col_add(struct soft_hashagg_ctx *ctx, __u32 k, struct wd_agg_col_info *info,
+			    __u32 in_idx, __u32 op, __u32 out_type)
+{
+	struct soft_agg_col *agg;
+
+	if (k >= SOFT_DAE_MAX_OUTPUT_COLS) {
+		WD_ERR("invalid: agg output cols num is more than support %d!\n",
+		       SOFT_DAE_MAX_OUTPUT_COLS);
+		return -WD_EINVAL;
+	}
+
+	agg = ctx->agg_cols + k;
+	agg->op = op;
+	agg->in_type = info->input_data_type;
+	agg->in_size = info->input_data_type == WD_DAE_CHAR ?
+		       info->col_data_info : soft_type_size(info->input_data_type);
+	agg->out_type = out_type;
+	agg->in_idx = in_idx;
+	if (op == SOFT_AGG_DISTINCT)
+		ctx->has_distinct = true;
+
+	return soft_agg_col_check(agg);
+}
+
+static int soft_agg_cols_init(struct soft_hashagg_ctx *ctx, struct wd_agg_sess_setup *setup)
+{
+	static const __u32 ops[WD_AGG_ALG_TYPE_MAX] = {
+		[WD_AGG_SUM] = SOFT_AGG_SUM,
+		[WD_AGG_COUNT] = SOFT_AGG_COUNT,
+		[WD_AGG_MIN] = SOFT_AGG_MIN,
+		[WD_AGG_MAX] = SOFT_AGG_MAX,
+		[WD_AGG_AVG] = SOFT_AGG_SUM,
+		[WD_AGG_COUNT_DISTINCT] = SOFT_AGG_DISTINCT,
+	};
+	struct wd_agg_col_info *info;
+	struct soft_agg_col *agg;
+	__u32 i, j, k = 0;
+	int ret;
+
+	for (i = 0; i < setup->agg_cols_num; i++) {
+		info = setup->agg_cols_info + i;
+		for (j = 0; j < info->col_alg_num; j++, k++) {
+			ret = soft_agg_col_add(ctx, k, info, i, ops[info->output_col_algs[j]],
+					       info->output_data_types[j]);
+			if (ret)
+				return ret;
+
+			/* The avg is a sum and a count, the caller divides them */
+			if (info->output_col_algs[j] == WD_AGG_AVG) {
+				ret = soft_agg_col_add(ctx, ++k, info, i, SOFT_AGG_COUNT,
+						       WD_DAE_LONG);
+				if (ret)
+					return ret;
+			}
+		}
+	}
+
+	if (setup->is_count_all) {
+		if (setup->count_all_data_type != WD_DAE_LONG || k >= SOFT_DAE_MAX_OUTPUT_COLS) {
+			WD_ERR("invalid: count all type %d or output cols num is wrong!\n",
+			       setup->count_all_data_type);
+			return -WD_EINVAL;
+		}
+		agg = ctx->agg_cols + k++;
+		agg->op = SOFT_AGG_COUNT_ALL;
+		agg->in_type = WD_DAE_LONG;
+		agg->out_type = WD_DAE_LONG;
+	}
+
+	ctx->out_num = k;
+
+	return WD_SUCCESS;
+}
+
+static int soft_hashagg_layout(struct soft_hashagg_ctx *ctx)
+{
+	__u64 offset = sizeof(struct soft_row_head);
+	__u32 i, size, row_size;
+
+	for (i = 0; i < ctx->key_num; i++) {
+		ctx->key_cols[i].offset = offset;
+		offset += ctx->key_cols[i].size;
+		if (ctx->key_cols[i].type == WD_DAE_VARCHAR)
+			offset += sizeof(__u16);
+	}
+
+	for (i = 0; i < ctx->out_num; i++) {
+		if (ctx->agg_cols[i].op == SOFT_AGG_DISTINCT) {
+			/* The registers are bytes, keep them on a 8 bytes boundary */
+			size = SOFT_HLL_REGS;
+			offset = SOFT_ALIGN(offset, SOFT_DAE_LONG_SIZE);
+		} else {
+			size = soft_type_size(ctx->agg_cols[i].out_type);
+			offset = SOFT_ALIGN(offset, size);
+		}
+		ctx->agg_cols[i].offset = offset;
+		offset += size;
+	}
+
+	row_size = SOFT_DAE_MIN_ROW_SIZE;
+	while (row_size < offset)
+		row_size <<= 1;
+
+	if (row_size > SOFT_DAE_MAX_ROW_SIZE) {
+		WD_ERR("invalid: soft hashagg row size %u is more than support %d!\n",
+		       row_size, SOFT_DAE_MAX_ROW_SIZE);
+		return -WD_EINVAL;
+	}
+
+	/* The rows are powers of 2, so a row never crosses a cache line */
+	ctx->row_size = row_size;
+	ctx->bucket_rows = row_size < SOFT_DAE_CACHE_LINE ? SOFT_DAE_CACHE_LINE / row_size : 1;
+
+	return WD_SUCCESS;
+}
+
+static void soft_hashagg_sess_uninit(void *priv)
+{
+	struct soft_hashagg_ctx *ctx = priv;
+
+	if (!ctx)
+		return;
+
+	free(ctx->rehash_rows);
+	free(ctx);
+}
+
+static int soft_hashagg_sess_init(struct wd_agg_sess_setup *setup, void **priv)
+{
+	struct soft_hashagg_ctx *ctx;
+	__u32 i;
+	int ret;
+
+	if (!setup || !priv) {
+		WD_ERR("invalid: soft hashagg sess setup or priv is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (setup->key_cols_num > SOFT_DAE_MAX_KEY_COLS) {
+		WD_ERR("invalid: key cols num %u is more than support %d!\n",
+		       setup->key_cols_num, SOFT_DAE_MAX_KEY_COLS);
+		return -WD_EINVAL;
+	}
+
+	ctx = calloc(1, sizeof(struct soft_hashagg_ctx));
+	if (!ctx)
+		return -WD_ENOMEM;
+
+	for (i = 0; i < setup->key_cols_num; i++) {
+		ret = soft_key_col_init(ctx->key_cols + i, setup->key_cols_info + i, i);
+		if (ret)
+			goto free_ctx;
+	}
+	ctx->key_num = setup->key_cols_num;
+
+	ret = soft_agg_cols_init(ctx, setup);
+	if (ret)
+		goto free_ctx;
+
+	ret = soft_hashagg_layout(ctx);
+	if (ret)
+		goto free_ctx;
+
+	*priv = ctx;
+
+	return WD_SUCCESS;
+
+free_ctx:
+	free(ctx);
+	return ret;
+}
+
+static int soft_hashagg_get_row_size(void *priv)
+{
+	struct soft_hashagg_ctx *ctx = priv;
+
+	if (!ctx)
+		return -WD_EINVAL;
+
+	return ctx->row_size;
+}
+
+/*
+ * Use the cache line aligned part of a user table, so that a bucket is a
+ * cache line. Less than one cache line is lost for the alignment.
+ */
+static __u64 soft_table_rows(__u8 **table, __u8 *addr, __u32 row_num, __u32 row_size,
+			     __u32 table_row_size)
+{
+	__u64 size = (__u64)table_row_size * row_num;
+	__u64 pad;
+
+	*table = SOFT_PTR_ALIGN(addr, SOFT_DAE_CACHE_LINE);
+	pad = *table - addr;
+	if (!addr || pad >= size)
+		return 0;
+
+	return (size - pad) / row_size;
+}
+
+static int soft_hashagg_hash_table_init(struct wd_dae_hash_table *hash_table, void *priv)
+{
+	struct soft_hashagg_ctx *ctx = priv;
+	struct soft_table table = {0};
+	__u64 rows;
+
+	if (!ctx || !hash_table)
+		return -WD_EINVAL;
+
+	if (ctx->row_size > hash_table->table_row_size) {
+		WD_ERR("invalid: row size %u is error, soft hashagg need %u!\n",
+		       hash_table->table_row_size, ctx->row_size);
+		return -WD_EINVAL;
+	}
+
+	rows = soft_table_rows(&table.std_table, hash_table->std_table,
+			       hash_table->std_table_row_num, ctx->row_size,
+			       hash_table->table_row_size);
+	if (rows < ctx->bucket_rows) {
+		WD_ERR("invalid: standard table row num %llu is less than a bucket!\n", rows);
+		return -WD_EINVAL;
+	}
+	table.bucket_num = rows / ctx->bucket_rows;
+	if (table.bucket_num > SOFT_MAX_BUCKETS)
+		table.bucket_num = SOFT_MAX_BUCKETS;
+	table.std_row_num = table.bucket_num * ctx->bucket_rows;
+
+	table.ext_row_num = soft_table_rows(&table.ext_table, hash_table->ext_table,
+					    hash_table->ext_table_row_num, ctx->row_size,
+					    hash_table->table_row_size);
+
+	/* Keep the current table to output its rows in rehash */
+	if (ctx->table.std_table) {
+		memcpy(&ctx->rehash_table, &ctx->table, sizeof(struct soft_table));
+		ctx->rehash_table.out_pos = 0;
+	}
+
+	memset(table.std_table, 0, table.std_row_num * ctx->row_size);
+	if (table.ext_row_num)
+		memset(table.ext_table, 0, table.ext_row_num * ctx->row_size);
+	memcpy(&ctx->table, &table, sizeof(struct soft_table));
+
+	return WD_SUCCESS;
+}
+
+static int soft_hashagg_hash_table_stats(void *priv, struct wd_agg_table_stats *stats)
+{
+	struct soft_hashagg_ctx *ctx = priv;
+	struct soft_table *table;
+	__u64 i, used = 0, len;
+	__u32 idx;
+	__u8 *row;
+
+	if (!ctx || !stats)
+		return -WD_EINVAL;
+
+	table = &ctx->table;
+	for (i = 0, row = table->std_table; i < table->std_row_num; i++, row += ctx->row_size)
+		used += !!(soft_row_head(row)->flags & SOFT_ROW_USED);
+
+	/* Only the first row of a bucket has an extend chain */
+	stats->max_chain_len = 0;
+	for (i = 0; i < table->std_row_num; i += ctx->bucket_rows) {
+		row = table->std_table + i * ctx->row_size;
+		for (len = 0, idx = soft_row_head(row)->ext_next; idx; len++)
+			idx = soft_row_head(table->ext_table +
+					    (__u64)(idx - 1) * ctx->row_size)->ext_next;
+		if (len > stats->max_chain_len)
+			stats->max_chain_len = len;
+	}
+
+	stats->std_table_row_num = table->std_row_num;
+	stats->ext_table_row_num = table->ext_row_num;
+	stats->std_used_row_num = used;
+	stats->ext_used_row_num = table->ext_used;
+
+	return WD_SUCCESS;
+}
+
+static int soft_dae_init(struct wd_alg_driver *drv, void *conf)
+{
+	struct wd_ctx_config_internal *config = conf;
+
+	/* Fallback init is NULL */
+	if (!drv || !conf)
+		return 0;
+
+	config->epoll_en = 0;
+
+	return WD_SUCCESS;
+}
+
+static void soft_dae_exit(struct wd_alg_driver *drv)
+{
+}
+
+static int soft_dae_get_usage(void *param)
+{
+	return WD_SUCCESS;
+}
+
+static int soft_dae_get_extend_ops(void *ops)
+{
+	struct wd_agg_ops *agg_ops = (struct wd_agg_ops *)ops;
+
+	if (!agg_ops)
+		return -WD_EINVAL;
+
+	agg_ops->get_row_size = soft_hashagg_get_row_size;
+	agg_ops->hash_table_init = soft_hashagg_hash_table_init;
+	agg_ops->hash_table_stats = soft_hashagg_hash_table_stats;
+	agg_ops->sess_init = soft_hashagg_sess_init;
+	agg_ops->sess_uninit = soft_hashagg_sess_uninit;
+
+	return WD_SUCCESS;
+}
+
+static struct wd_alg_driver soft_hashagg_driver = {
+	.drv_name = "soft_dae",
+	.alg_name = "hashagg",
+	.calc_type = UADK_ALG_SOFT,
+	.priority = 0,
+	.queue_num = 1,
+	.op_type_num = 1,
+	.fallback = 0,
+	.init = soft_dae_init,
+	.exit = soft_dae_exit,
+	.send = soft_hashagg_send,
+	.recv = soft_hashagg_recv,
+	.get_usage = soft_dae_get_usage,
+	.get_extend_ops = soft_dae_get_extend_ops,
+};
+
+static void __attribute__((constructor)) soft_dae_probe(void)
+{
+	int ret;
+
+	WD_INFO("Info: register soft DAE alg drivers!\n");
+
+	ret = wd_alg_driver_register(&soft_hashagg_driver);
+	if (ret && ret != -WD_ENODEV)
+		WD_ERR("failed to register soft DAE hashagg driver!\n");
+}
+
+static void __attribute__((destructor)) soft_dae_remove(void)
+{
+	WD_INFO("Info: unregister soft DAE alg drivers!\n");
+
+	wd_alg_driver_unregister(&soft_hashagg_driver);
+}
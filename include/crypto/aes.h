@@ -12,10 +12,20 @@ extern "C" {
 
 #define UINT_B_CNT	8
 #define AES_MAXNR	14
+#define AES_BLOCK_SIZE	16
+
+enum aes_kernel {
+	/* Plain C, works on all CPUs */
+	AES_KERNEL_SOFT = 0,
+	/* AES instructions, ARMv8 CE or AES-NI */
+	AES_KERNEL_INSTR,
+	AES_KERNEL_MAX,
+};
 
 struct aes_key {
 	unsigned int rd_key[4 * (AES_MAXNR + 1)];
 	__u8 rounds;
+	__u8 kernel;
 };
 
 union uni {
@@ -24,6 +34,54 @@ union uni {
 	__u64 d;
 };
 
+/*
+ * aes_set_key - Expand the encryption key once, with the fastest kernel
+ * of the CPU. The key can encrypt any number of blocks after that.
+ * @key: the expanded key.
+ * @userkey: the key of 16, 24 or 32 bytes.
+ * @key_len: bytes of userkey.
+ */
+int aes_set_key(struct aes_key *key, const __u8 *userkey, __u32 key_len);
+
+/*
+ * aes_set_key_kernel - Same as aes_set_key, with the given kernel.
+ * Return -WD_EINVAL if the kernel is not supported by the CPU.
+ */
+int aes_set_key_kernel(struct aes_key *key, const __u8 *userkey, __u32 key_len,
+		       enum aes_kernel kernel);
+
+/*
+ * aes_set_decrypt_key - Expand the decryption key once, as aes_set_key.
+ * The key could only be used by aes_ecb_decrypt.
+ */
+int aes_set_decrypt_key(struct aes_key *key, const __u8 *userkey, __u32 key_len);
+
+/*
+ * aes_set_decrypt_key_kernel - Same as aes_set_decrypt_key, with the given
+ * kernel. Return -WD_EINVAL if the kernel is not supported by the CPU.
+ */
+int aes_set_decrypt_key_kernel(struct aes_key *key, const __u8 *userkey,
+			       __u32 key_len, enum aes_kernel kernel);
+
+void aes_encrypt_block(const struct aes_key *key, const __u8 *src, __u8 *dst);
+
+/* Encrypt or decrypt whole blocks in ECB mode, in could be the same as out */
+void aes_ecb_encrypt(const struct aes_key *key, const __u8 *in, __u8 *out,
+		     __u32 blocks);
+void aes_ecb_decrypt(const struct aes_key *key, const __u8 *in, __u8 *out,
+		     __u32 blocks);
+
+/*
+ * aes_ctr_encrypt - Encrypt or decrypt in CTR mode.
+ * @ctr: the 128 bits big-endian counter of the first block, it is updated
+ *	 to the counter of the next block. A last partial block uses one.
+ * @in: the input data, it could be the same as out.
+ * @len: bytes of data.
+ */
+void aes_ctr_encrypt(const struct aes_key *key, __u8 *ctr, const __u8 *in,
+		     __u8 *out, __u32 len);
+
+/* Expand the key and encrypt one block, for a key used only once */
 void aes_encrypt(__u8 *key, __u32 key_len, __u8 *src, __u8 *dst);
 #ifdef __cplusplus
 }
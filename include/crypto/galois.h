@@ -10,7 +10,55 @@
 extern "C" {
 #endif
 
-void galois_compute(__u8 *S, __u8 *H, __u8 *g, __u32 len);
+#define GALOIS_BLOCK_SIZE	16
+#define GALOIS_TABLE_NUM	16
+
+enum galois_kernel {
+	/* Shoup's 4-bit table, works on all CPUs */
+	GALOIS_KERNEL_TABLE = 0,
+	/* Carry-less multiply instructions, PMULL or PCLMULQDQ */
+	GALOIS_KERNEL_CLMUL,
+	GALOIS_KERNEL_MAX,
+};
+
+struct galois_key;
+typedef void (*galois_ghash_t)(const struct galois_key *key, __u64 *y,
+			       const __u8 *in, __u32 blocks);
+
+/*
+ * struct galois_key - the hash key H of GHASH and its precomputed data.
+ * @h: H as two big-endian words.
+ * @table: i * H of the 4-bit table kernel, i is 0 ~ 15.
+ * @ghash: the kernel to hash full blocks.
+ */
+struct galois_key {
+	__u64 h[2];
+	__u64 table[GALOIS_TABLE_NUM][2];
+	galois_ghash_t ghash;
+};
+
+/*
+ * galois_set_key - Precompute H of GCM, with the fastest kernel of the CPU.
+ * @key: the galois key to be set.
+ * @h: H, the AES encrypted zero block.
+ */
+void galois_set_key(struct galois_key *key, const __u8 *h);
+
+/*
+ * galois_set_key_kernel - Same as galois_set_key, with the given kernel.
+ * Return -WD_EINVAL if the kernel is not supported by the CPU.
+ */
+int galois_set_key_kernel(struct galois_key *key, const __u8 *h,
+			  enum galois_kernel kernel);
+
+/*
+ * galois_ghash - Hash a run of data: y = (y ^ block) * H for each block.
+ * @key: the galois key.
+ * @y: the 16 bytes hash value, updated in place.
+ * @in: the data, such as the whole AAD or ciphertext.
+ * @len: length of the data, the last partial block is padded with zero.
+ */
+void galois_ghash(const struct galois_key *key, __u8 *y, const __u8 *in, __u32 len);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved. */
+
+#ifndef __WD_SM4_H__
+#define __WD_SM4_H__
+
+#include <linux/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SM4_BLOCK_BYTES		16
+#define SM4_KEY_BYTES		16
+#define SM4_ROUNDS		32
+
+/*
+ * struct sm4_key - the round keys of SM4, in the order they are used.
+ * The decryption key is the encryption one reversed.
+ */
+struct sm4_key {
+	__u32 rk[SM4_ROUNDS];
+};
+
+/* sm4_set_key - Expand the 16 bytes user key for encryption */
+void sm4_set_key(struct sm4_key *key, const __u8 *userkey);
+
+/* sm4_set_dec_key - Expand the 16 bytes user key for decryption */
+void sm4_set_dec_key(struct sm4_key *key, const __u8 *userkey);
+
+/*
+ * sm4_ecb_crypt - Encrypt or decrypt whole blocks in ECB mode, the direction
+ * follows the key. in could be the same as out.
+ */
+void sm4_ecb_crypt(const struct sm4_key *key, const __u8 *in, __u8 *out,
+		   __u32 blocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,11 +6,28 @@
 
 #include "../wd_aead.h"
 #include "../wd_util.h"
+#include "../crypto/aes.h"
+#include "../crypto/galois.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * struct wd_aead_soft_key - The keys of the soft GCM computing, derived
+ * from the cipher key once and cached in the session.
+ * @ckey: the expanded cipher key.
+ * @hkey: the GHASH key, from the encrypted zero block.
+ * @valid: the keys are set, it is cleared when the cipher key changes.
+ * @lock: serializes the expanding and the cipher key update.
+ */
+struct wd_aead_soft_key {
+	struct aes_key ckey;
+	struct galois_key hkey;
+	bool valid;
+	pthread_spinlock_t lock;
+};
+
 struct wd_aead_msg {
 	struct wd_aead_req req;
 	/* Request identifier */
@@ -68,10 +85,46 @@ struct wd_aead_msg {
 	/* total of data for stream mode */
 	__u64 long_data_len;
 	enum wd_aead_msg_state msg_state;
+	/* keys of soft computing, owned by the session */
+	struct wd_aead_soft_key *soft_key;
 };
 
 struct wd_aead_msg *wd_aead_get_msg(__u32 idx, __u32 tag);
 
+/*
+ * wd_aead_soft_key_init() - Expand the AES GCM soft keys of the session.
+ * @key: the soft keys of the session.
+ * @ckey: the cipher key of the session.
+ * @ckey_bytes: the cipher key length.
+ *
+ * The requests of a session may run in several threads, the first one
+ * expands the keys under the lock and publishes them by @valid.
+ *
+ * Return 0 if the keys are ready or less than 0 otherwise.
+ */
+static inline int wd_aead_soft_key_init(struct wd_aead_soft_key *key,
+					const __u8 *ckey, __u16 ckey_bytes)
+{
+	__u8 h[AES_BLOCK_SIZE] = {0};
+	int ret = 0;
+
+	if (__atomic_load_n(&key->valid, __ATOMIC_ACQUIRE))
+		return 0;
+
+	pthread_spin_lock(&key->lock);
+	if (!key->valid) {
+		ret = aes_set_key(&key->ckey, ckey, ckey_bytes);
+		if (!ret) {
+			aes_encrypt_block(&key->ckey, h, h);
+			galois_set_key(&key->hkey, h);
+			__atomic_store_n(&key->valid, true, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_spin_unlock(&key->lock);
+
+	return ret;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,6 +46,8 @@ struct wd_agg_ops {
 	int (*sess_init)(struct wd_agg_sess_setup *setup, void **priv);
 	void (*sess_uninit)(void *priv);
 	int (*hash_table_init)(struct wd_dae_hash_table *hash_table, void *priv);
+	/* Optional, count the used rows and chains of the current table */
+	int (*hash_table_stats)(void *priv, struct wd_agg_table_stats *stats);
 };
 
 struct wd_agg_msg *wd_agg_get_msg(__u32 idx, __u32 tag);
@@ -55,6 +55,12 @@ struct wd_comp_msg {
 	__u32 tag;
 };
 
+/* Optional ops of the driver, got by its get_extend_ops */
+struct wd_comp_ops {
+	/* Release the stream state which the driver keeps in a ctx_buf */
+	void (*sess_reset)(void *ctx_buf);
+};
+
 struct wd_comp_msg *wd_comp_get_msg(__u32 idx, __u32 tag);
 
 #ifdef __cplusplus
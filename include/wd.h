@@ -359,9 +359,24 @@ int wd_get_avail_ctx(struct uacce_dev *dev);
  *
  * Return device list in which devices support given algorithm or NULL
  * otherwise.
+ *
+ * The devices are read from sysfs at the first call and cached for the
+ * process, the list is copied from the cache and should be freed by
+ * wd_free_list_accels(). The isolate flag of each device is read at each
+ * call, the isolated devices are left out.
  */
 struct uacce_dev_list *wd_get_accel_list(const char *alg_name);
 
+/**
+ * wd_refresh_accel_list() - Drop the cached devices.
+ *
+ * The devices are read from sysfs again at the next wd_get_accel_list(). It
+ * should be called after devices are added or removed, or their algorithms
+ * are changed. The cache is also dropped if the mtime of the uacce class dir
+ * is changed.
+ */
+void wd_refresh_accel_list(void);
+
 /**
  * wd_find_dev_by_numa() - get device with max available ctx number from an
  *			   device list according to numa id.
@@ -411,6 +426,26 @@ int wd_ctx_set_io_cmd(handle_t h_ctx, unsigned long cmd, void *arg);
  */
 unsigned long wd_ctx_get_region_size(handle_t h_ctx, enum uacce_qfrt qfrt);
 
+/**
+ * wd_ctx_is_emu() - Check if the context is an emulated queue.
+ * @h_ctx: The handle of context.
+ *
+ * A device is emulated in userspace if its directory under the uacce class
+ * dir has the "emulate" attribute, see docs/wd_environment_variable.
+ */
+bool wd_ctx_is_emu(handle_t h_ctx);
+
+/**
+ * wd_ctx_emu_db() - Ring the doorbell of an emulated queue.
+ * @h_ctx: The handle of context.
+ * @cmd: 0 means the sq tail is moved to @index, 1 means the cq head is.
+ * @index: The new sq tail or cq head.
+ *
+ * The emulated mmio region is plain memory, so drivers ring the doorbell of
+ * an emulated queue by this instead of writing to the mmio region.
+ */
+void wd_ctx_emu_db(handle_t h_ctx, __u8 cmd, __u16 index);
+
 enum wd_page_type {
 	WD_HUGE_PAGE = 0,
 	WD_NORMAL_PAGE,
@@ -457,6 +492,7 @@ struct wd_mempool_stats {
  *    +-------------+                  +-----+-----+-----+-----+
  *    |             |                  |     |     |     |     |
  *    +-------------+                  +-----+-----+-----+-----+
+ * free_block_num includes the blocks in the per-thread block caches.
  */
 struct wd_blockpool_stats {
 	unsigned long block_size;
@@ -466,6 +502,16 @@ struct wd_blockpool_stats {
 	unsigned long mem_waste_rate;
 };
 
+/*
+ * struct wd_blockpool_mag_stats - Statistics of the per-thread block caches
+ * @mag_hit_num: Number of allocs done by the per-thread block caches.
+ * @mag_miss_num: Number of allocs which get blocks from the shared pool.
+ */
+struct wd_blockpool_mag_stats {
+	unsigned long mag_hit_num;
+	unsigned long mag_miss_num;
+};
+
 /**
  * wd_block_alloc() - Allocate block memory from blkpool.
  * @blkpool: The handle of blkpool.
@@ -532,6 +578,13 @@ void wd_mempool_stats(handle_t mempool, struct wd_mempool_stats *stats);
  */
 void wd_blockpool_stats(handle_t blkpool, struct wd_blockpool_stats *stats);
 
+/**
+ * wd_blockpool_mag_stats() - Dump statistics of the per-thread block caches.
+ * @blkpool: The handle of blkpool.
+ * @stats: Pointer of struct wd_blockpool_mag_stats.
+ */
+void wd_blockpool_mag_stats(handle_t blkpool, struct wd_blockpool_mag_stats *stats);
+
 /**
  * wd_clone_dev() - clone a new uacce device.
  * @dev: The source device.
@@ -181,6 +181,27 @@ int wd_do_aead_sync(handle_t h_sess, struct wd_aead_req *req);
  */
 int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req);
 
+/**
+ * wd_do_aead_sync_batch() synchronous aead operation of a group of block
+ * messages, which are scheduled to one ctx and sent together.
+ * @sess: wd aead session
+ * @reqs: operational data, no more than WD_MAX_BATCH_NUM.
+ * @num: number of requests.
+ */
+int wd_do_aead_sync_batch(handle_t h_sess, struct wd_aead_req **reqs, __u32 num);
+
+/**
+ * wd_do_aead_async_batch() asynchronous aead operation of a group of
+ * block messages.
+ * @sess: wd aead session
+ * @reqs: operational data, no more than WD_MAX_BATCH_NUM.
+ * @num: number of requests.
+ * @count: return the number of requests sent, if only part of the
+ *	   requests are sent, -WD_EBUSY is returned.
+ */
+int wd_do_aead_async_batch(handle_t h_sess, struct wd_aead_req **reqs,
+			   __u32 num, __u32 *count);
+
 /**
  * wd_aead_set_authsize() Set authenticate data length to aead session.
  * @h_sess: wd aead session.
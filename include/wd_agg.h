@@ -16,13 +16,29 @@ extern "C" {
 
 /**
  * wd_agg_alg - Aggregation operation type.
+ * @WD_AGG_MIN/WD_AGG_MAX: The output data type is the same as the input,
+ * which is a DATE, INT, LONG or DECIMAL column.
+ * @WD_AGG_AVG: It uses two output columns, the sum of the data type in
+ * output_data_types, then the count as LONG. The caller divides them.
+ * @WD_AGG_COUNT_DISTINCT: Approximate count of the distinct non-empty values
+ * as LONG, estimated by HyperLogLog registers in the hash table row.
  */
 enum wd_agg_alg {
 	WD_AGG_SUM,
 	WD_AGG_COUNT,
+	WD_AGG_MIN,
+	WD_AGG_MAX,
+	WD_AGG_AVG,
+	WD_AGG_COUNT_DISTINCT,
 	WD_AGG_ALG_TYPE_MAX,
 };
 
+/*
+ * Size of the alg arrays of struct wd_agg_col_info. It is part of the ABI,
+ * so it does not follow WD_AGG_ALG_TYPE_MAX and only changes with the soname.
+ */
+#define WD_AGG_MAX_COL_ALGS	2
+
 /**
  * wd_agg_task_error_type - Aggregation task error type.
  */
@@ -60,14 +76,18 @@ struct wd_key_col_info {
  * @input_data_type: Agg column data type.
  * @output_data_types: Output agg column data type.
  * @output_col_algs: Output agg column operation type, the sequence must be
- * the same as that of output_data_types.
+ * the same as that of output_data_types. The output agg columns of the
+ * request are in the same sequence, WD_AGG_AVG takes two of them.
+ *
+ * A column has at most WD_AGG_MAX_COL_ALGS aggregations, more of them on the
+ * same data are set up as another agg column of the session.
  */
 struct wd_agg_col_info {
 	__u32 col_alg_num;
 	__u16 col_data_info;
 	enum wd_dae_data_type input_data_type;
-	enum wd_dae_data_type output_data_types[WD_AGG_ALG_TYPE_MAX];
-	enum wd_agg_alg output_col_algs[WD_AGG_ALG_TYPE_MAX];
+	enum wd_dae_data_type output_data_types[WD_AGG_MAX_COL_ALGS];
+	enum wd_agg_alg output_col_algs[WD_AGG_MAX_COL_ALGS];
 };
 
 /**
@@ -168,6 +188,10 @@ void wd_agg_uninit(void);
  * wd_agg_alloc_sess() - Allocate a wd agg session
  * @setup: Parameters to setup this session.
  *
+ * If the agg is inited with TASK_MIX and the hardware does not support
+ * the aggregations of the session, such as WD_AGG_MIN, the session is done
+ * by the soft driver in the caller's thread.
+ *
  * Return 0 if fail and others if succeed.
  */
 handle_t wd_agg_alloc_sess(struct wd_agg_sess_setup *setup);
@@ -187,6 +211,79 @@ void wd_agg_free_sess(handle_t h_sess);
  */
 int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info);
 
+/**
+ * wd_agg_table_setup - Hash table owned by the session.
+ * @cardinality: Expected number of groups, the first table is sized to hold
+ * them. 0 means the smallest table.
+ * @mempool: Mempool from wd_mempool_create(), the tables are got from its
+ * huge pages. 0 means the tables are mapped from normal pages.
+ * @max_size: Limit of the table memory in bytes, 0 means no limit.
+ * @growth: Multiple of the row number each time the table grows, it must
+ * be a power of 2. 0 means 2.
+ */
+struct wd_agg_table_setup {
+	__u64 cardinality;
+	handle_t mempool;
+	__u64 max_size;
+	__u32 growth;
+};
+
+/**
+ * wd_agg_set_managed_table() - Let the session own and grow its hash table.
+ * @h_sess: Wd agg session whose hash table has not been set.
+ * @setup: Parameters of the table.
+ *
+ * When the table is full, wd_agg_add_input_sync() gets a larger table,
+ * rehashes the groups into it and goes on with the rest rows. The request
+ * ends with WD_AGG_NEED_REHASH only if the table can not grow any more.
+ * The sync inputs of the session are done one by one, and
+ * wd_agg_add_input_async() returns -WD_EINVAL, since the table may be freed
+ * by a grow before an async request is done. wd_agg_set_hash_table() and
+ * wd_agg_rehash_sync() are not used with a managed table.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_agg_set_managed_table(handle_t h_sess, struct wd_agg_table_setup *setup);
+
+/**
+ * wd_agg_table_stats - Statistics of the hash table of a session.
+ * @std_table_row_num: Row number of the standard hash table in use.
+ * @ext_table_row_num: Row number of the extend hash table in use.
+ * @table_size: Bytes of the table owned by the session, 0 if the table is
+ * set by wd_agg_set_hash_table().
+ * @grow_num: Times the owned table has grown.
+ * @std_used_row_num: Rows of the standard table which hold a group.
+ * @ext_used_row_num: Rows of the extend table which hold a group.
+ * @max_chain_len: The most extend rows chained to one bucket.
+ * @fill_rate: Used rate of the standard table, e.g. 30 is 30%.
+ * @ext_usage_rate: Used rate of the extend table, e.g. 30 is 30%.
+ *
+ * The used rows and the chains are counted by the driver, they are 0 if the
+ * driver can not count them.
+ */
+struct wd_agg_table_stats {
+	__u64 std_table_row_num;
+	__u64 ext_table_row_num;
+	__u64 table_size;
+	__u64 grow_num;
+	__u64 std_used_row_num;
+	__u64 ext_used_row_num;
+	__u64 max_chain_len;
+	__u32 fill_rate;
+	__u32 ext_usage_rate;
+};
+
+/**
+ * wd_agg_get_table_stats() - Get the statistics of the session hash table.
+ * @h_sess: Wd agg session.
+ * @stats: Pointer of struct wd_agg_table_stats.
+ *
+ * The table is walked, so call it when no request of the session is running.
+ *
+ * Return 0 if succeed and others if fail.
+ */
+int wd_agg_get_table_stats(handle_t h_sess, struct wd_agg_table_stats *stats);
+
 /**
  * wd_agg_add_input_sync()/wd_agg_get_output_sync() - Input or output agg operation
  * @sess: Wd agg session
@@ -196,6 +293,19 @@ int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info);
  */
 int wd_agg_add_input_sync(handle_t h_sess, struct wd_agg_req *req);
 int wd_agg_get_output_sync(handle_t h_sess, struct wd_agg_req *req);
+
+/**
+ * wd_agg_add_input_async()/wd_agg_get_output_async() - Async input or output
+ * agg operation, the result is got by wd_agg_poll().
+ * @sess: Wd agg session
+ * @req: Operational data.
+ *
+ * Only the hardware driver supports the async mode. If the agg is inited
+ * with the soft driver, they return -WD_EINVAL. A fallback session of
+ * TASK_MIX is done at once and called back before return.
+ *
+ * Return 0 if succeed and others if fail.
+ */
 int wd_agg_add_input_async(handle_t h_sess, struct wd_agg_req *req);
 int wd_agg_get_output_async(handle_t h_sess, struct wd_agg_req *req);
 
@@ -10,6 +10,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <asm/types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -96,6 +97,11 @@ enum alg_dev_type {
  * @get_usage: callback interface used to obtain the
  *	    utilization rate of devices.
  * @get_extend_ops: callback interface to get private operation of drivers.
+ * @send_batch: optional callback interface used to send a group of task
+ *	    packets to the device in one submission, such as filling several
+ *	    sqes and ringing the doorbell once. @count returns the number of
+ *	    packets actually sent. If it is NULL, packets are sent one by one
+ *	    through @send.
  */
 struct wd_alg_driver {
 	const char	*drv_name;
@@ -113,6 +119,8 @@ struct wd_alg_driver {
 	int (*recv)(struct wd_alg_driver *drv, handle_t ctx, void *drv_msg);
 	int (*get_usage)(void *param);
 	int (*get_extend_ops)(void *ops);
+	int (*send_batch)(struct wd_alg_driver *drv, handle_t ctx,
+			  void **drv_msgs, __u32 num, __u32 *count);
 };
 
 inline int wd_alg_driver_init(struct wd_alg_driver *drv, void *conf)
@@ -196,6 +204,27 @@ void wd_disable_drv(struct wd_alg_driver *drv);
 
 struct wd_alg_list *wd_get_alg_head(void);
 
+struct uacce_dev_list;
+
+/*
+ * wd_scan_accel_list() - Read all the sva devices from @class_dir.
+ * @class_dir: the uacce class dir, see wd_uacce_class_dir().
+ *
+ * It is called by the device registry, which keeps the isolated devices and
+ * checks the flag each time a device is taken. The list should be freed by
+ * wd_free_list_accels().
+ */
+struct uacce_dev_list *wd_scan_accel_list(const char *class_dir);
+
+/*
+ * wd_check_accel_name() - Check the device registry of the process.
+ * @dev_name: the prefix of the device name.
+ *
+ * Return true if a device whose name starts with @dev_name is in the
+ * registry and is not isolated.
+ */
+bool wd_check_accel_name(const char *dev_name);
+
 #ifdef WD_STATIC_DRV
 /*
  * duplicate drivers will be skipped when it register to alg_list
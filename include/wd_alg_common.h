@@ -28,6 +28,10 @@ extern "C" {
 #define MAX_STR_LEN		256
 #define CTX_TYPE_INVALID	9999
 #define POLL_TIME		1000
+/* Max number of requests in one wd_do_<alg>_sync_batch/async_batch call */
+#define WD_MAX_BATCH_NUM	16
+/* Packet size classes of the sync wait time, see wd_handle_msg_sync() */
+#define WD_WAIT_LEN_NUM		8
 
 /* Key size of chiper */
 #define MAX_CIPHER_KEY_SIZE	64
@@ -55,6 +59,20 @@ enum wd_ctx_mode {
 	CTX_MODE_MAX,
 };
 
+/*
+ * How a sync request waits for its response.
+ * @WD_WAIT_POLL: keep trying to receive until the response is ready.
+ * @WD_WAIT_EPOLL: wait for the interrupt of the ctx before each receiving.
+ * @WD_WAIT_HYBRID: spin for the learned completion time of the packet,
+ *		    then wait for the interrupt.
+ */
+enum wd_wait_policy {
+	WD_WAIT_POLL = 0,
+	WD_WAIT_EPOLL,
+	WD_WAIT_HYBRID,
+	WD_WAIT_POLICY_MAX,
+};
+
 enum wd_init_type {
 	WD_TYPE_V1,
 	WD_TYPE_V2,
@@ -132,6 +150,8 @@ struct wd_ctx_params {
 	struct wd_cap_config *cap;
 };
 
+struct wd_stats_ctx;
+
 struct wd_soft_ctx {
 	void *priv;
 };
@@ -142,15 +162,28 @@ struct wd_ctx_internal {
 	__u8 ctx_mode;
 	__u16 sqn;
 	pthread_spinlock_t lock;
+	/* EWMA of the sync completion time in ns, one per packet size class */
+	__u32 wait_ns[WD_WAIT_LEN_NUM];
+	/*
+	 * sync requests on the ctx or waiting for its lock, the async ones
+	 * are in the msg pool
+	 */
+	__u32 inflight;
+	/* Counters in the statistics region, NULL if statistics are off */
+	struct wd_stats_ctx *stats;
 };
 
+struct wd_async_msg_pool;
+
 struct wd_ctx_config_internal {
 	__u32 ctx_num;
-	int shmid;
 	struct wd_ctx_internal *ctxs;
 	void *priv;
 	bool epoll_en;
-	unsigned long *msg_cnt;
+	__u32 fb_depth;
+	struct wd_ctx_config_internal *fb_config;
+	__u8 wait_policy;
+	struct wd_async_msg_pool *pool;
 };
 
 /*
@@ -164,6 +164,19 @@ int wd_cipher_set_key(handle_t h_sess, const __u8 *key, __u32 key_len);
  */
 int wd_do_cipher_sync(handle_t h_sess, struct wd_cipher_req *req);
 int wd_do_cipher_async(handle_t h_sess, struct wd_cipher_req *req);
+
+/**
+ * wd_do_cipher_sync_batch()/ async_batch() Syn/asynchronous cipher operation
+ * of a group of requests, which are scheduled to one ctx and sent together.
+ * @sess: wd cipher session
+ * @reqs: operational data, no more than WD_MAX_BATCH_NUM.
+ * @num: number of requests.
+ * @count: return the number of requests sent, if only part of the
+ *	   requests are sent, -WD_EBUSY is returned.
+ */
+int wd_do_cipher_sync_batch(handle_t h_sess, struct wd_cipher_req **reqs, __u32 num);
+int wd_do_cipher_async_batch(handle_t h_sess, struct wd_cipher_req **reqs,
+			     __u32 num, __u32 *count);
 /**
  * wd_cipher_poll_ctx() poll operation for asynchronous operation
  * @idx: index of ctx which will be polled.
@@ -170,6 +170,46 @@ void wd_comp_free_sess(handle_t h_sess);
  */
 int wd_comp_reset_sess(handle_t h_sess);
 
+/**
+ * wd_comp_instance_create() - Create a compression instance, which has its
+ * own ctxs, scheduler and driver. It works apart from wd_comp_init2_() and
+ * from the other instances, so the users of one process can use different
+ * drivers or ctx deployments.
+ * @alg: The algorithm users want to use.
+ * @sched_type: The scheduling type users want to use.
+ * @task_type: The task type, the same as wd_comp_init2_().
+ * @ctx_params: The ctxs resources users want to use, NULL means default.
+ *
+ * Return the instance handle if succeed and 0 if fail.
+ */
+handle_t wd_comp_instance_create(char *alg, __u32 sched_type, int task_type,
+				 struct wd_ctx_params *ctx_params);
+
+/**
+ * wd_comp_instance_destroy() - Release the resources of an instance. The
+ * sessions of the instance should be freed before.
+ * @h_inst: The instance to be destroyed.
+ */
+void wd_comp_instance_destroy(handle_t h_inst);
+
+/**
+ * wd_comp_instance_alloc_sess() - Allocate a session of an instance. The
+ * requests of the session are sent to the ctxs of the instance, and are
+ * done by the wd_do_comp_* interfaces as usual.
+ * @h_inst: The instance which the session belongs to.
+ * @setup: Parameters to setup this session.
+ */
+handle_t wd_comp_instance_alloc_sess(handle_t h_inst,
+				     struct wd_comp_sess_setup *setup);
+
+/**
+ * wd_comp_instance_poll() - Poll the async requests of an instance.
+ * @h_inst: The instance to be polled.
+ * @expt: Max number of requests to poll.
+ * @count: Return the number of polled requests finally.
+ */
+int wd_comp_instance_poll(handle_t h_inst, __u32 expt, __u32 *count);
+
 /**
  * wd_do_comp_sync() - Send a sync compression request.
  * @h_sess:	The session which request will be sent to.
@@ -187,6 +227,30 @@ int wd_do_comp_strm(handle_t h_sess, struct wd_comp_req *req);
  */
 int wd_do_comp_async(handle_t h_sess, struct wd_comp_req *req);
 
+/**
+ * wd_do_comp_sync_batch() - Send a group of sync stateless compression
+ * requests, which are scheduled to one ctx and submitted together.
+ * @h_sess:	The session which requests will be sent to.
+ * @reqs:	Requests, all of them should have the same op_type.
+ * @num:	Number of requests, no more than WD_MAX_BATCH_NUM.
+ *
+ * The result of each request is returned in its status.
+ */
+int wd_do_comp_sync_batch(handle_t h_sess, struct wd_comp_req **reqs, __u32 num);
+
+/**
+ * wd_do_comp_async_batch() - Send a group of async compression requests,
+ * which are scheduled to one ctx and submitted together.
+ * @h_sess:	The session which requests will be sent to.
+ * @reqs:	Requests, all of them should have the same op_type.
+ * @num:	Number of requests, no more than WD_MAX_BATCH_NUM.
+ * @count:	Return the number of requests sent, reqs[0] ~ reqs[count - 1].
+ *
+ * If only part of the requests are sent, -WD_EBUSY is returned.
+ */
+int wd_do_comp_async_batch(handle_t h_sess, struct wd_comp_req **reqs,
+			   __u32 num, __u32 *count);
+
 /**
  * wd_comp_poll_ctx() - Poll a ctx.
  * @idx:	The index of ctx which will be polled.
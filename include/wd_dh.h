@@ -57,6 +57,9 @@ handle_t wd_dh_alloc_sess(struct wd_dh_sess_setup *setup);
 void wd_dh_free_sess(handle_t sess);
 int wd_do_dh_async(handle_t sess, struct wd_dh_req *req);
 int wd_do_dh_sync(handle_t sess, struct wd_dh_req *req);
+int wd_do_dh_sync_batch(handle_t h_sess, struct wd_dh_req **reqs, __u32 num);
+int wd_do_dh_async_batch(handle_t sess, struct wd_dh_req **reqs,
+			 __u32 num, __u32 *count);
 int wd_dh_poll_ctx(__u32 idx, __u32 expt, __u32 *count);
 int wd_dh_poll(__u32 expt, __u32 *count);
 int wd_dh_init(struct wd_ctx_config *config, struct wd_sched *sched);
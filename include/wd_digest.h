@@ -215,6 +215,26 @@ int wd_do_digest_sync(handle_t h_sess, struct wd_digest_req *req);
  */
 int wd_do_digest_async(handle_t h_sess, struct wd_digest_req *req);
 
+/**
+ * wd_do_digest_sync_batch() - Do a group of sync digest tasks, which are
+ * scheduled to one ctx and sent together. Only block messages are supported.
+ * @h_sess: Session handler
+ * @reqs: Operation parameters, no more than WD_MAX_BATCH_NUM.
+ * @num: Number of requests.
+ */
+int wd_do_digest_sync_batch(handle_t h_sess, struct wd_digest_req **reqs, __u32 num);
+
+/**
+ * wd_do_digest_async_batch() - Do a group of asynchronous digest tasks.
+ * @h_sess: Session handler
+ * @reqs: Operation parameters, no more than WD_MAX_BATCH_NUM.
+ * @num: Number of requests.
+ * @count: Return the number of requests sent, if only part of the
+ *	   requests are sent, -WD_EBUSY is returned.
+ */
+int wd_do_digest_async_batch(handle_t h_sess, struct wd_digest_req **reqs,
+			     __u32 num, __u32 *count);
+
 /**
  * wd_digest_set_key() - Set auth key to digest session.
  * @h_sess: Session handler
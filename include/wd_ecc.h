@@ -495,6 +495,29 @@ int wd_do_ecc_sync(handle_t h_sess, struct wd_ecc_req *req);
  */
 int wd_do_ecc_async(handle_t sess, struct wd_ecc_req *req);
 
+/**
+ * wd_do_ecc_sync_batch() - Send a group of sync ecc requests, which are
+ * scheduled to one ctx and sent together.
+ * @h_sess:	The session which requests will be sent to.
+ * @reqs:	Requests, no more than WD_MAX_BATCH_NUM.
+ * @num:	Number of requests.
+ *
+ * The status of each request is set, the return value is the error
+ * of the first failed request.
+ */
+int wd_do_ecc_sync_batch(handle_t h_sess, struct wd_ecc_req **reqs, __u32 num);
+
+/**
+ * wd_do_ecc_async_batch() - Send a group of async ecc requests.
+ * @sess:	The session which requests will be sent to.
+ * @reqs:	Requests, no more than WD_MAX_BATCH_NUM.
+ * @num:	Number of requests.
+ * @count:	Return the number of requests sent, if only part of the
+ *		requests are sent, -WD_EBUSY is returned.
+ */
+int wd_do_ecc_async_batch(handle_t sess, struct wd_ecc_req **reqs,
+			  __u32 num, __u32 *count);
+
 
 /**
  * wd_ecc_poll_ctx() - Poll a ctx.
@@ -179,6 +179,29 @@ int wd_do_rsa_sync(handle_t h_sess, struct wd_rsa_req *req);
  */
 int wd_do_rsa_async(handle_t sess, struct wd_rsa_req *req);
 
+/**
+ * wd_do_rsa_sync_batch() - Send a group of sync rsa requests, which are
+ * scheduled to one ctx and sent together.
+ * @h_sess:	The session which requests will be sent to.
+ * @reqs:	Requests, no more than WD_MAX_BATCH_NUM.
+ * @num:	Number of requests.
+ *
+ * The status of each request is set, the return value is the error
+ * of the first failed request.
+ */
+int wd_do_rsa_sync_batch(handle_t h_sess, struct wd_rsa_req **reqs, __u32 num);
+
+/**
+ * wd_do_rsa_async_batch() - Send a group of async rsa requests.
+ * @sess:	The session which requests will be sent to.
+ * @reqs:	Requests, no more than WD_MAX_BATCH_NUM.
+ * @num:	Number of requests.
+ * @count:	Return the number of requests sent, if only part of the
+ *		requests are sent, -WD_EBUSY is returned.
+ */
+int wd_do_rsa_async_batch(handle_t sess, struct wd_rsa_req **reqs,
+			  __u32 num, __u32 *count);
+
 /**
  * wd_rsa_poll() - Poll finished request.
  *
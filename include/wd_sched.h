@@ -23,6 +23,8 @@ enum sched_policy_type {
 	SCHED_POLICY_NONE,
 	/* requests will need a fixed ctx */
 	SCHED_POLICY_SINGLE,
+	/* requests will be sent to the ctx with the fewest in-flight requests */
+	SCHED_POLICY_LOAD,
 	SCHED_POLICY_BUTT,
 };
 
@@ -35,6 +37,8 @@ struct sched_params {
 };
 
 typedef int (*user_poll_func)(__u32 pos, __u32 expect, __u32 *count);
+typedef __u32 (*wd_sched_load_func)(void *priv, __u32 pos);
+typedef int (*wd_sched_poll_func)(void *priv, __u32 pos, __u32 expect, __u32 *count);
 
 /*
  * wd_sched_rr_instance - Instante the schedule min region.
@@ -59,6 +63,28 @@ int wd_sched_rr_instance(const struct wd_sched *sched,
 struct wd_sched *wd_sched_rr_alloc(__u8 sched_type, __u8 type_num,
 				   __u16 numa_num, user_poll_func func);
 
+/**
+ * wd_sched_set_load - Set how the load scheduler gets the in-flight requests.
+ * @sched: The schedule instance, only SCHED_POLICY_LOAD uses the function.
+ * @func: Return the in-flight requests of the ctx pos.
+ * @priv: The first parameter of func.
+ *
+ * Without it, the load scheduler works as the RR scheduler.
+ */
+void wd_sched_set_load(struct wd_sched *sched, wd_sched_load_func func,
+		       void *priv);
+
+/**
+ * wd_sched_set_poll - Set a ctx poll function that takes private data.
+ * @sched: The schedule instance.
+ * @func: Poll the ctx pos, used instead of the func given at allocation.
+ * @priv: The first parameter of func.
+ *
+ * It lets several users of one alg poll their own ctxs with the same code.
+ */
+void wd_sched_set_poll(struct wd_sched *sched, wd_sched_poll_func func,
+		       void *priv);
+
 /**
  * wd_sched_rr_release - Release schedule memory.
  * @sched: The schedule which will be released.
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#ifndef __WD_STATS_H
+#define __WD_STATS_H
+
+#include <asm/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Layout of the statistics region of a process. Every library copy of
+ * wd_util in a process maps its own region under /dev/shm, named
+ * WD_STATS_PREFIX<pid>.<n>, which is readable by uadk_tool dfx.
+ */
+#define WD_STATS_PREFIX		"uadk_stats."
+#define WD_STATS_MAGIC		0x55535441
+#define WD_STATS_VERSION	1
+#define WD_STATS_CTX_MAX	256
+/* Threads are spread over the slots of a ctx, so they don't share cache lines */
+#define WD_STATS_SLOT_NUM	8
+#define WD_STATS_NAME_LEN	32
+
+enum wd_stats_cnt {
+	WD_STATS_SEND,
+	WD_STATS_RECV,
+	WD_STATS_BUSY,
+	WD_STATS_TIMEOUT,
+	WD_STATS_BYTES_IN,
+	WD_STATS_BYTES_OUT,
+	/* Sum of the latency of sync requests and their number */
+	WD_STATS_LAT_NS,
+	WD_STATS_LAT_CNT,
+	WD_STATS_CNT_NUM,
+};
+
+struct wd_stats_slot {
+	__u64 cnt[WD_STATS_CNT_NUM];
+} __attribute__((aligned(64)));
+
+/*
+ * struct wd_stats_ctx - Counters of one ctx.
+ * @gen: Incremented each time the entry is taken by a ctx, so a reader
+ *	 can tell a new ctx from an old one at the same index.
+ * @in_use: The entry is taken by a ctx.
+ * @numa: NUMA node of the device, -1 for a soft ctx.
+ * @mode: CTX_MODE_SYNC or CTX_MODE_ASYNC.
+ * @op_type: Operation type of the ctx.
+ * @alg: Algorithm class, such as cipher or zlib.
+ * @dev: Device name, or the driver name for a soft ctx.
+ */
+struct wd_stats_ctx {
+	__u32 gen;
+	__u32 in_use;
+	__s32 numa;
+	__u8 mode;
+	__u8 op_type;
+	char alg[WD_STATS_NAME_LEN];
+	char dev[WD_STATS_NAME_LEN];
+	struct wd_stats_slot slots[WD_STATS_SLOT_NUM];
+} __attribute__((aligned(64)));
+
+struct wd_stats_region {
+	__u32 magic;
+	__u32 version;
+	__s32 pid;
+	__u32 ctx_max;
+	struct wd_stats_ctx ctxs[WD_STATS_CTX_MAX];
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WD_STATS_H */
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+#ifndef __WD_UACCE_EMU_H
+#define __WD_UACCE_EMU_H
+
+#include <asm/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WD_EMU_ENGINE_NAME_LEN	16
+
+/*
+ * Configuration of an emulated device, it is read from the attributes
+ * "emulate", "emulate_sqe_size" and "emulate_delay_ns" in the device
+ * directory of the uacce class dir.
+ */
+struct wd_emu_cfg {
+	char engine[WD_EMU_ENGINE_NAME_LEN];
+	__u32 sqe_size;
+	__u64 delay_ns;
+};
+
+struct wd_emu_qp;
+
+/**
+ * wd_uacce_class_dir() - Get the directory where uacce devices are found.
+ *
+ * It is /sys/class/uacce, or WD_UACCE_SYSFS_DIR if the env is set.
+ */
+const char *wd_uacce_class_dir(void);
+
+struct wd_emu_qp *wd_emu_create(struct wd_emu_cfg *cfg);
+void wd_emu_destroy(struct wd_emu_qp *qp);
+void *wd_emu_mmap(struct wd_emu_qp *qp, int qfrt, size_t size);
+int wd_emu_ioctl(struct wd_emu_qp *qp, unsigned long cmd, void *arg);
+int wd_emu_wait(struct wd_emu_qp *qp, __u16 ms);
+void wd_emu_doorbell(struct wd_emu_qp *qp, __u8 cmd, __u16 index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WD_UACCE_EMU_H */
@@ -9,13 +9,12 @@
 
 #include <numa.h>
 #include <stdbool.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #include <asm/types.h>
 
 #include "wd.h"
 #include "wd_sched.h"
 #include "wd_alg.h"
+#include "wd_stats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +47,8 @@ enum wd_type {
 struct wd_async_msg_pool {
 	struct msg_pool *pools;
 	__u32 pool_num;
+	/* Messages of each async pool, drivers size their per-ctx state by it */
+	__u32 msg_num;
 };
 
 struct wd_ctx_range {
@@ -122,6 +123,9 @@ struct wd_msg_handle {
 	int (*recv)(struct wd_alg_driver *drv, handle_t ctx, void *drv_msg);
 };
 
+typedef int (*wd_alg_init_priv)(void *priv, struct wd_ctx_config *config,
+				struct wd_sched *sched);
+
 struct wd_init_attrs {
 	__u32 sched_type;
 	char *alg;
@@ -131,6 +135,9 @@ struct wd_init_attrs {
 	struct wd_ctx_config *ctx_config;
 	wd_alg_init alg_init;
 	wd_alg_poll_ctx alg_poll_ctx;
+	/* Used instead of alg_init if set, for the alg instances */
+	wd_alg_init_priv alg_init_priv;
+	void *priv;
 };
 
 /*
@@ -152,6 +159,18 @@ int wd_init_ctx_config(struct wd_ctx_config_internal *in,
  */
 int wd_init_sched(struct wd_sched *in, struct wd_sched *from);
 
+/*
+ * wd_init_sched_load() - Let the load scheduler see the in-flight requests
+ * of the ctxs.
+ * @sched: Scheduler configuration input by user, other policies ignore it.
+ * @config: ctx configuration in global setting.
+ * @pool: The async msg pool in global setting, its used msgs are the
+ *	  in-flight requests of an async ctx.
+ */
+void wd_init_sched_load(struct wd_sched *sched,
+			struct wd_ctx_config_internal *config,
+			struct wd_async_msg_pool *pool);
+
 /*
  * wd_clear_sched() - Clear internal scheduler configuration.
  * @in: Scheduler configuration in global setting.
@@ -225,6 +244,16 @@ int wd_get_msg_from_pool(struct wd_async_msg_pool *pool, int ctx_idx,
 void wd_put_msg_to_pool(struct wd_async_msg_pool *pool, int ctx_idx,
 			__u32 tag);
 
+/*
+ * wd_get_msg_pool_depth() - Get the number of messages in use.
+ * @pool: Pointer of global pools.
+ * @ctx_idx: Index of pool. Should be 0 ~ (pool_num - 1).
+ *
+ * Return the in-flight message number of the pool, it may be out of date
+ * when other threads are getting or putting messages.
+ */
+__u32 wd_get_msg_pool_depth(struct wd_async_msg_pool *pool, int ctx_idx);
+
 /*
  * wd_find_msg_in_pool() - Find a message in pool.
  * @pool: Pointer of global pools.
@@ -374,19 +403,179 @@ int wd_check_ctx(struct wd_ctx_config_internal *config, __u8 mode, __u32 idx);
  */
 int wd_set_epoll_en(const char *var_name, bool *epoll_en);
 
+/**
+ * wd_set_wait_policy() - set the sync wait policy from environment variable
+ * value.
+ * @var_name: Environment variable name string.
+ * @config: The ctx config, its epoll_en should be set before.
+ *
+ * The value is "poll", "epoll" or "hybrid". If it is unset, the policy
+ * follows epoll_en. epoll_en is set for epoll and hybrid, as the driver
+ * only arms the interrupt of the ctx when epoll is enabled.
+ *
+ * Return 0 if the value is valid, otherwise return -WD_EINVAL.
+ */
+int wd_set_wait_policy(const char *var_name,
+		       struct wd_ctx_config_internal *config);
+
+/**
+ * wd_set_fallback_depth() - set the overflow depth of the fallback driver
+ * from environment variable value.
+ * @var_name: Environment variable name string.
+ * @depth: In-flight async msgs of a ctx which start the overflow, 0 means
+ *	   the overflow is disabled.
+ *
+ * Return 0 if the value is 0 ~ WD_POOL_MAX_ENTRIES, otherwise return -WD_EINVAL.
+ */
+int wd_set_fallback_depth(const char *var_name, __u32 *depth);
+
+/**
+ * wd_alg_fallback_en() - check if requests can overflow to the fallback driver.
+ * @drv: The driver bound with TASK_MIX.
+ * @config: The ctx config which has the overflow depth.
+ *
+ * Return true if the driver has a fallback driver and the overflow is enabled.
+ */
+bool wd_alg_fallback_en(struct wd_alg_driver *drv,
+			struct wd_ctx_config_internal *config);
+
+/**
+ * wd_alg_fallback_check() - check if an async request should overflow to the
+ * fallback driver before it is sent to the ctx.
+ * @drv: The driver bound with TASK_MIX.
+ * @config: The ctx config which has the overflow depth.
+ * @pool: The async msg pool.
+ * @idx: The index of the ctx.
+ *
+ * Return true if the in-flight msgs of the ctx reach the overflow depth.
+ */
+bool wd_alg_fallback_check(struct wd_alg_driver *drv,
+			   struct wd_ctx_config_internal *config,
+			   struct wd_async_msg_pool *pool, __u32 idx);
+
+/**
+ * wd_alg_do_fallback() - do a msg by the fallback driver synchronously.
+ * @drv: The driver bound with TASK_MIX.
+ * @config: The ctx config which has the soft ctx of the fallback driver.
+ * @msg: The msg which is rejected or not sent to the hardware.
+ *
+ * Return 0 if the msg is done, otherwise return the error of the fallback
+ * driver.
+ */
+int wd_alg_do_fallback(struct wd_alg_driver *drv,
+		       struct wd_ctx_config_internal *config, void *msg);
+
 /**
  * wd_handle_msg_sync() - recv msg from hardware
  * @drv: the driver to handle msg.
  * @msg_handle: callback of msg handle ops.
- * @ctx: the handle of context.
+ * @config: the ctx config which has the wait policy.
+ * @ctx: the context, its wait time is learned with WD_WAIT_HYBRID.
  * @msg: the msg of task.
+ * @len: the packet size of the msg, which picks the class of the wait time.
  * @balance: estimated number of receiving msg.
- * @epoll_en: whether to enable epoll.
  *
  * Return 0 if successful or less than 0 otherwise.
  */
 int wd_handle_msg_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
-		       handle_t ctx, void *msg, __u64 *balance, bool epoll_en);
+		       struct wd_ctx_config_internal *config,
+		       struct wd_ctx_internal *ctx, void *msg, __u32 len,
+		       __u64 *balance);
+
+/**
+ * wd_send_msg_batch() - send a group of msgs to the driver
+ * @drv: the driver to handle msgs.
+ * @ctx: the handle of context.
+ * @msgs: the msgs of tasks.
+ * @num: the number of msgs.
+ * @count: return the number of msgs sent.
+ *
+ * Use the send_batch callback of the driver if it has one, otherwise
+ * send the msgs one by one, stopping at the first failure.
+ *
+ * Return 0 if all msgs are sent or less than 0 otherwise.
+ */
+int wd_send_msg_batch(struct wd_alg_driver *drv, handle_t ctx,
+		      void **msgs, __u32 num, __u32 *count);
+
+/**
+ * wd_handle_msg_sync_batch() - send a group of msgs and recv them from hardware
+ * @drv: the driver to handle msgs.
+ * @msg_handle: callback of msg handle ops.
+ * @config: the ctx config which has the wait policy.
+ * @ctx: the context.
+ * @msgs: the msgs of tasks.
+ * @num: the number of msgs.
+ * @len: the packet size of one msg.
+ * @balance: estimated number of receiving msg.
+ *
+ * The caller must hold the ctx exclusively as in wd_handle_msg_sync(), and
+ * give each msg a distinct tag. The msgs may complete out of order, the
+ * driver returns the response of the msg passed to recv by its tag.
+ *
+ * Return 0 if successful or less than 0 otherwise.
+ */
+int wd_handle_msg_sync_batch(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
+			     struct wd_ctx_config_internal *config,
+			     struct wd_ctx_internal *ctx, void **msgs, __u32 num,
+			     __u32 len, __u64 *balance);
+
+/**
+ * wd_send_msg_batch_sync() - send a group of sync msgs without receiving them
+ * @drv: the driver to handle msgs.
+ * @ctx: the context, which is held by the caller.
+ * @msgs: the msgs of tasks.
+ * @num: the number of msgs.
+ * @count: return the number of msgs sent.
+ *
+ * With wd_recv_msg_batch_sync(), the caller can send msgs to several ctxs
+ * before it waits for any of them.
+ *
+ * Return 0 if some msgs are sent or less than 0 otherwise.
+ */
+int wd_send_msg_batch_sync(struct wd_alg_driver *drv, struct wd_ctx_internal *ctx,
+			   void **msgs, __u32 num, __u32 *count);
+
+/**
+ * wd_recv_msg_batch_sync() - recv the msgs sent by wd_send_msg_batch_sync()
+ * @drv: the driver to handle msgs.
+ * @msg_handle: callback of msg handle ops.
+ * @config: the ctx config which has the wait policy.
+ * @ctx: the context, which is held by the caller since the msgs are sent.
+ * @msgs: the sent msgs, in the order they are sent.
+ * @num: the number of sent msgs.
+ * @len: the packet size of one msg.
+ *
+ * All the msgs are received even if one of them fails, unless the ctx
+ * times out or the hardware can't be accessed.
+ *
+ * Return 0 if successful or the first error of the msgs otherwise.
+ */
+int wd_recv_msg_batch_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
+			   struct wd_ctx_config_internal *config,
+			   struct wd_ctx_internal *ctx, void **msgs, __u32 num,
+			   __u32 len);
+
+/**
+ * wd_send_async_batch() - send a group of async msgs and add their tasks
+ * @drv: the driver to handle msgs.
+ * @config: ctx configuration in global setting.
+ * @pool: the async msg pool which the msgs are got from.
+ * @env_config: environment config of the alg.
+ * @idx: index of the ctx.
+ * @msgs: the msgs of tasks.
+ * @tags: the pool tag of each msg.
+ * @num: the number of msgs.
+ * @count: return the number of msgs sent and added to the polling tasks.
+ *
+ * The msgs which are not sent are put back to the pool. If adding a task
+ * fails, @count stops at the msgs added before it.
+ *
+ * Return 0 if all msgs are sent or less than 0 otherwise.
+ */
+int wd_send_async_batch(struct wd_alg_driver *drv, struct wd_ctx_config_internal *config,
+			struct wd_async_msg_pool *pool, struct wd_env_config *env_config,
+			__u32 idx, void **msgs, __u32 *tags, __u32 num, __u32 *count);
 
 /**
  * wd_init_check() - Check input parameters for wd_<alg>_init.
@@ -508,24 +697,90 @@ void wd_dlclose_drv(void *dlh_list);
  */
 int wd_get_lib_file_path(char *lib_file, char *lib_path, bool is_dir);
 
+/* Thread id which picks the slot of a ctx in the statistics region */
+extern __thread __u32 wd_stats_tid;
+__u32 wd_stats_new_tid(void);
+
 /**
- * wd_dfx_msg_cnt() - Message counter interface for ctx
+ * wd_stats_add() - Add to a counter of the ctx.
+ * @ctx: The ctx of the request.
+ * @cnt: The counter in enum wd_stats_cnt.
+ * @val: The value added.
+ *
+ * The threads of a process mostly have their own slots, the atomic add only
+ * matters when there are more threads than WD_STATS_SLOT_NUM.
+ */
+static inline void wd_stats_add(struct wd_ctx_internal *ctx, __u32 cnt, __u64 val)
+{
+	struct wd_stats_ctx *stats = ctx->stats;
+
+	if (likely(!stats))
+		return;
+
+	if (unlikely(!wd_stats_tid))
+		wd_stats_tid = wd_stats_new_tid();
+
+	__atomic_add_fetch(&stats->slots[wd_stats_tid % WD_STATS_SLOT_NUM].cnt[cnt],
+			   val, __ATOMIC_RELAXED);
+}
+
+static inline void wd_stats_add_err(struct wd_ctx_internal *ctx, int ret)
+{
+	if (ret == -WD_EBUSY)
+		wd_stats_add(ctx, WD_STATS_BUSY, 1);
+	else if (ret == -WD_ETIMEDOUT)
+		wd_stats_add(ctx, WD_STATS_TIMEOUT, 1);
+}
+
+/**
+ * wd_dfx_msg_cnt() - Count a request sent to the ctx.
  * @config: Ctx configuration in global setting.
- * @numSize: Number of elements.
- * @index: Indicates the CTX index.
+ * @idx: Indicates the CTX index.
  */
-static inline void wd_dfx_msg_cnt(struct wd_ctx_config_internal *config,
-				  __u32 numsize, __u32 idx)
+static inline void wd_dfx_msg_cnt(struct wd_ctx_config_internal *config, __u32 idx)
 {
-	__u16 sqn;
-	bool ret;
+	if (unlikely(idx >= config->ctx_num))
+		return;
 
-	ret = wd_need_info();
-	if (idx > numsize || !ret)
+	wd_stats_add(config->ctxs + idx, WD_STATS_SEND, 1);
+}
+
+/**
+ * wd_dfx_msg_done() - Count a request received from the ctx.
+ * @config: Ctx configuration in global setting.
+ * @idx: Indicates the CTX index.
+ * @in_bytes: Input bytes of the request.
+ * @out_bytes: Output bytes of the request.
+ */
+static inline void wd_dfx_msg_done(struct wd_ctx_config_internal *config, __u32 idx,
+				   __u64 in_bytes, __u64 out_bytes)
+{
+	struct wd_ctx_internal *ctx;
+
+	if (unlikely(idx >= config->ctx_num))
+		return;
+
+	ctx = config->ctxs + idx;
+	if (likely(!ctx->stats))
+		return;
+
+	wd_stats_add(ctx, WD_STATS_RECV, 1);
+	wd_stats_add(ctx, WD_STATS_BYTES_IN, in_bytes);
+	wd_stats_add(ctx, WD_STATS_BYTES_OUT, out_bytes);
+}
+
+/**
+ * wd_dfx_msg_err() - Count a request failed as the ctx is busy or timed out.
+ * @config: Ctx configuration in global setting.
+ * @idx: Indicates the CTX index.
+ * @ret: The error of the request, other errors are not counted.
+ */
+static inline void wd_dfx_msg_err(struct wd_ctx_config_internal *config, __u32 idx, int ret)
+{
+	if (unlikely(idx >= config->ctx_num))
 		return;
 
-	sqn = config->ctxs[idx].sqn;
-	config->msg_cnt[sqn]++;
+	wd_stats_add_err(config->ctxs + idx, ret);
 }
 
 /**
@@ -551,6 +806,24 @@ static inline void wd_ctx_spin_unlock(struct wd_ctx_internal *ctx, int type)
 	pthread_spin_unlock(&ctx->lock);
 }
 
+/**
+ * wd_ctx_inflight_add() - Count sync requests issued to the ctx.
+ * @ctx: queue context.
+ * @num: the number of requests.
+ *
+ * Called before the ctx lock is taken, so that the requests waiting for
+ * the lock are seen by the load balancing of the scheduler.
+ */
+static inline void wd_ctx_inflight_add(struct wd_ctx_internal *ctx, __u32 num)
+{
+	__atomic_add_fetch(&ctx->inflight, num, __ATOMIC_RELAXED);
+}
+
+static inline void wd_ctx_inflight_sub(struct wd_ctx_internal *ctx, __u32 num)
+{
+	__atomic_sub_fetch(&ctx->inflight, num, __ATOMIC_RELAXED);
+}
+
 #ifdef __cplusplus
 }
 #endif
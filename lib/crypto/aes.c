@@ -4,6 +4,21 @@
 #include <string.h>
 #include <stdint.h>
 #include "crypto/aes.h"
+#include "wd_alg_common.h"
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#define AES_INSTR
+#define AES_INSTR_TARGET	__attribute__((target("+crypto")))
+#elif defined(__x86_64__)
+#include <wmmintrin.h>
+#define AES_INSTR
+#define AES_INSTR_TARGET	__attribute__((target("aes")))
+#endif
+
+/* Blocks encrypted together, the AES instructions of them are pipelined */
+#define AES_BATCH	4
 
 #define WORD(n) (0x##n##n##n##n)
 #define LONG(n) (0x##n##n##n##n##n##n##n##n)
@@ -310,6 +325,94 @@ static void cipher(const unsigned char *in, unsigned char *out,
 	memcpy(out, state, STATE_BYTE);
 }
 
+/* The inverse affine transformation of the S-box, on the 8 bytes of w */
+static __u64 inv_affine_long(__u64 w)
+{
+	__u64 x;
+
+	x = ((w & LONG(7F)) << 0x1) | ((w & LONG(80)) >> 0x7);
+	x ^= ((w & LONG(1F)) << 0x3) | ((w & LONG(E0)) >> 0x5);
+	x ^= ((w & LONG(03)) << 0x6) | ((w & LONG(FC)) >> 0x2);
+
+	return x ^ LONG(05);
+}
+
+/*
+ * The inverse S-box is the GF(2^8) inverse of the inverse affine of a byte.
+ * sublong gives the affine of the inverse, so the affine is undone again.
+ * It is done without tables, as sublong does.
+ */
+static void inv_sublong(__u64 *w)
+{
+	__u64 x = inv_affine_long(*w);
+
+	sublong(&x);
+	*w = inv_affine_long(x);
+}
+
+static void inv_shift_rows(__u64 *state)
+{
+	unsigned char s[S_CNT];
+	unsigned char *s0;
+	__u8 r, i;
+
+	s0 = (unsigned char *)state;
+	for (r = 0; r < S_CNT; r++) {
+		for (i = 0; i < S_CNT; i++)
+			s[i] = s0[i * S_CNT + r];
+
+		for (i = 0; i < S_CNT; i++)
+			s0[i * S_CNT + r] = s[(i + S_CNT - r) % S_CNT];
+	}
+}
+
+/*
+ * InvMixColumns is MixColumns after multiplying the column by
+ * {04}x^2 + {05}, that is s[i] ^= {04} * (s[i] ^ s[i + 2]).
+ */
+static void inv_mix_columns(__u64 *state)
+{
+#define C		0x0000FFFF0000FFFFuLL
+	__u64 t;
+	__u8 c;
+
+	for (c = 0; c < STATE_CNT; c++) {
+		t = state[c] ^ (((state[c] & C) << 0x10) |
+				((state[c] >> 0x10) & C));
+		xtimelong(&t);
+		xtimelong(&t);
+		state[c] ^= t;
+	}
+
+	mix_columns(state);
+}
+
+static void inv_cipher(const unsigned char *in, unsigned char *out,
+		       const __u64 *w, __u8 nr)
+{
+	__u64 state[STATE_CNT];
+	__u8 i;
+
+	memcpy(state, in, STATE_BYTE);
+
+	add_round_key(state, w + nr * STATE_CNT);
+
+	for (i = nr - 1; i > 0; i--) {
+		inv_shift_rows(state);
+		inv_sublong(&state[0]);
+		inv_sublong(&state[1]);
+		add_round_key(state, w + i * STATE_CNT);
+		inv_mix_columns(state);
+	}
+
+	inv_shift_rows(state);
+	inv_sublong(&state[0]);
+	inv_sublong(&state[1]);
+	add_round_key(state, w);
+
+	memcpy(out, state, STATE_BYTE);
+}
+
 static void rotword(__u32 *x)
 {
 #define WORDBYTE	4
@@ -387,13 +490,321 @@ static int aes_set_encrypt_key(const unsigned char *userkey, const int bits,
 	return 0;
 }
 
-static void aes_encrypt_(const __u8 *in, __u8 *out, const struct aes_key *key)
+static void aes_soft_encrypt(const struct aes_key *key, const __u8 *in,
+			     __u8 *out, __u32 blocks)
 {
-	const __u64 *rk;
+	const __u64 *rk = (__u64 *)key->rd_key;
 
-	rk = (__u64 *)key->rd_key;
+	while (blocks--) {
+		cipher(in, out, rk, key->rounds);
+		in += AES_BLOCK_SIZE;
+		out += AES_BLOCK_SIZE;
+	}
+}
+
+static void aes_soft_decrypt(const struct aes_key *key, const __u8 *in,
+			     __u8 *out, __u32 blocks)
+{
+	const __u64 *rk = (__u64 *)key->rd_key;
+
+	while (blocks--) {
+		inv_cipher(in, out, rk, key->rounds);
+		in += AES_BLOCK_SIZE;
+		out += AES_BLOCK_SIZE;
+	}
+}
+
+/*
+ * The AES decryption instructions want the equivalent inverse cipher, whose
+ * round keys are in the reverse order and the middle ones go through
+ * InvMixColumns.
+ */
+static void aes_set_instr_decrypt_key(struct aes_key *key)
+{
+	__u64 *rk = (__u64 *)key->rd_key;
+	__u64 t[STATE_CNT];
+	__u8 i, nr = key->rounds;
+
+	for (i = 0; i < nr - i; i++) {
+		memcpy(t, rk + i * STATE_CNT, STATE_BYTE);
+		memcpy(rk + i * STATE_CNT, rk + (nr - i) * STATE_CNT, STATE_BYTE);
+		memcpy(rk + (nr - i) * STATE_CNT, t, STATE_BYTE);
+	}
+
+	for (i = 1; i < nr; i++)
+		inv_mix_columns(rk + i * STATE_CNT);
+}
 
-	cipher(in, out, rk, key->rounds);
+#ifdef AES_INSTR
+#if defined(__aarch64__)
+static bool aes_instr_support(void)
+{
+	return !!(getauxval(AT_HWCAP) & HWCAP_CE_AES);
+}
+
+static AES_INSTR_TARGET void aes_instr_encrypt(const struct aes_key *key, const __u8 *in,
+					       __u8 *out, __u32 blocks)
+{
+	const __u8 *rk = (const __u8 *)key->rd_key;
+	uint8x16_t s[AES_BATCH], k;
+	__u32 i, j, n;
+
+	while (blocks) {
+		n = blocks < AES_BATCH ? blocks : AES_BATCH;
+		for (j = 0; j < n; j++)
+			s[j] = vld1q_u8(in + j * AES_BLOCK_SIZE);
+
+		/* AESE does AddRoundKey first, so the last key is added alone */
+		for (i = 0; i < key->rounds - 1; i++) {
+			k = vld1q_u8(rk + i * AES_BLOCK_SIZE);
+			for (j = 0; j < n; j++)
+				s[j] = vaesmcq_u8(vaeseq_u8(s[j], k));
+		}
+
+		k = vld1q_u8(rk + i * AES_BLOCK_SIZE);
+		for (j = 0; j < n; j++)
+			s[j] = vaeseq_u8(s[j], k);
+
+		k = vld1q_u8(rk + key->rounds * AES_BLOCK_SIZE);
+		for (j = 0; j < n; j++)
+			vst1q_u8(out + j * AES_BLOCK_SIZE, veorq_u8(s[j], k));
+
+		in += n * AES_BLOCK_SIZE;
+		out += n * AES_BLOCK_SIZE;
+		blocks -= n;
+	}
+}
+
+static AES_INSTR_TARGET void aes_instr_decrypt(const struct aes_key *key, const __u8 *in,
+					       __u8 *out, __u32 blocks)
+{
+	const __u8 *rk = (const __u8 *)key->rd_key;
+	uint8x16_t s[AES_BATCH], k;
+	__u32 i, j, n;
+
+	while (blocks) {
+		n = blocks < AES_BATCH ? blocks : AES_BATCH;
+		for (j = 0; j < n; j++)
+			s[j] = vld1q_u8(in + j * AES_BLOCK_SIZE);
+
+		for (i = 0; i < key->rounds - 1; i++) {
+			k = vld1q_u8(rk + i * AES_BLOCK_SIZE);
+			for (j = 0; j < n; j++)
+				s[j] = vaesimcq_u8(vaesdq_u8(s[j], k));
+		}
+
+		k = vld1q_u8(rk + i * AES_BLOCK_SIZE);
+		for (j = 0; j < n; j++)
+			s[j] = vaesdq_u8(s[j], k);
+
+		k = vld1q_u8(rk + key->rounds * AES_BLOCK_SIZE);
+		for (j = 0; j < n; j++)
+			vst1q_u8(out + j * AES_BLOCK_SIZE, veorq_u8(s[j], k));
+
+		in += n * AES_BLOCK_SIZE;
+		out += n * AES_BLOCK_SIZE;
+		blocks -= n;
+	}
+}
+#else
+static bool aes_instr_support(void)
+{
+	return __builtin_cpu_supports("aes");
+}
+
+static AES_INSTR_TARGET void aes_instr_encrypt(const struct aes_key *key, const __u8 *in,
+					       __u8 *out, __u32 blocks)
+{
+	const __m128i *rk = (const __m128i *)key->rd_key;
+	__m128i s[AES_BATCH], k;
+	__u32 i, j, n;
+
+	while (blocks) {
+		n = blocks < AES_BATCH ? blocks : AES_BATCH;
+		k = _mm_loadu_si128(rk);
+		for (j = 0; j < n; j++)
+			s[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in + j), k);
+
+		for (i = 1; i < key->rounds; i++) {
+			k = _mm_loadu_si128(rk + i);
+			for (j = 0; j < n; j++)
+				s[j] = _mm_aesenc_si128(s[j], k);
+		}
+
+		k = _mm_loadu_si128(rk + key->rounds);
+		for (j = 0; j < n; j++)
+			_mm_storeu_si128((__m128i *)out + j, _mm_aesenclast_si128(s[j], k));
+
+		in += n * AES_BLOCK_SIZE;
+		out += n * AES_BLOCK_SIZE;
+		blocks -= n;
+	}
+}
+
+static AES_INSTR_TARGET void aes_instr_decrypt(const struct aes_key *key, const __u8 *in,
+					       __u8 *out, __u32 blocks)
+{
+	const __m128i *rk = (const __m128i *)key->rd_key;
+	__m128i s[AES_BATCH], k;
+	__u32 i, j, n;
+
+	while (blocks) {
+		n = blocks < AES_BATCH ? blocks : AES_BATCH;
+		k = _mm_loadu_si128(rk);
+		for (j = 0; j < n; j++)
+			s[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in + j), k);
+
+		for (i = 1; i < key->rounds; i++) {
+			k = _mm_loadu_si128(rk + i);
+			for (j = 0; j < n; j++)
+				s[j] = _mm_aesdec_si128(s[j], k);
+		}
+
+		k = _mm_loadu_si128(rk + key->rounds);
+		for (j = 0; j < n; j++)
+			_mm_storeu_si128((__m128i *)out + j, _mm_aesdeclast_si128(s[j], k));
+
+		in += n * AES_BLOCK_SIZE;
+		out += n * AES_BLOCK_SIZE;
+		blocks -= n;
+	}
+}
+#endif
+#endif
+
+static void aes_encrypt_blocks(const struct aes_key *key, const __u8 *in,
+			       __u8 *out, __u32 blocks)
+{
+#ifdef AES_INSTR
+	if (key->kernel == AES_KERNEL_INSTR) {
+		aes_instr_encrypt(key, in, out, blocks);
+		return;
+	}
+#endif
+	aes_soft_encrypt(key, in, out, blocks);
+}
+
+static int aes_check_kernel(enum aes_kernel kernel)
+{
+	switch (kernel) {
+	case AES_KERNEL_SOFT:
+		break;
+#ifdef AES_INSTR
+	case AES_KERNEL_INSTR:
+		if (!aes_instr_support())
+			return -WD_EINVAL;
+		break;
+#endif
+	default:
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+int aes_set_key_kernel(struct aes_key *key, const __u8 *userkey, __u32 key_len,
+		       enum aes_kernel kernel)
+{
+	if (aes_check_kernel(kernel))
+		return -WD_EINVAL;
+
+	/* The round keys are in the byte order of FIPS-197 for all kernels */
+	if (aes_set_encrypt_key(userkey, key_len << 0x3, key))
+		return -WD_EINVAL;
+
+	key->kernel = kernel;
+
+	return 0;
+}
+
+int aes_set_decrypt_key_kernel(struct aes_key *key, const __u8 *userkey,
+			       __u32 key_len, enum aes_kernel kernel)
+{
+	int ret;
+
+	ret = aes_set_key_kernel(key, userkey, key_len, kernel);
+	if (ret)
+		return ret;
+
+	if (kernel == AES_KERNEL_INSTR)
+		aes_set_instr_decrypt_key(key);
+
+	return 0;
+}
+
+int aes_set_key(struct aes_key *key, const __u8 *userkey, __u32 key_len)
+{
+	if (!aes_set_key_kernel(key, userkey, key_len, AES_KERNEL_INSTR))
+		return 0;
+
+	return aes_set_key_kernel(key, userkey, key_len, AES_KERNEL_SOFT);
+}
+
+int aes_set_decrypt_key(struct aes_key *key, const __u8 *userkey, __u32 key_len)
+{
+	if (!aes_set_decrypt_key_kernel(key, userkey, key_len, AES_KERNEL_INSTR))
+		return 0;
+
+	return aes_set_decrypt_key_kernel(key, userkey, key_len, AES_KERNEL_SOFT);
+}
+
+void aes_encrypt_block(const struct aes_key *key, const __u8 *src, __u8 *dst)
+{
+	aes_encrypt_blocks(key, src, dst, 1);
+}
+
+void aes_ecb_encrypt(const struct aes_key *key, const __u8 *in, __u8 *out,
+		     __u32 blocks)
+{
+	aes_encrypt_blocks(key, in, out, blocks);
+}
+
+void aes_ecb_decrypt(const struct aes_key *key, const __u8 *in, __u8 *out,
+		     __u32 blocks)
+{
+#ifdef AES_INSTR
+	if (key->kernel == AES_KERNEL_INSTR) {
+		aes_instr_decrypt(key, in, out, blocks);
+		return;
+	}
+#endif
+	aes_soft_decrypt(key, in, out, blocks);
+}
+
+static void aes_ctr_inc(__u8 *ctr)
+{
+	int i;
+
+	for (i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+		if (++ctr[i])
+			break;
+	}
+}
+
+void aes_ctr_encrypt(const struct aes_key *key, __u8 *ctr, const __u8 *in,
+		     __u8 *out, __u32 len)
+{
+	__u8 ks[AES_BATCH * AES_BLOCK_SIZE];
+	__u32 i, n, bytes;
+
+	while (len) {
+		n = (len + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+		n = n < AES_BATCH ? n : AES_BATCH;
+		for (i = 0; i < n; i++) {
+			memcpy(ks + i * AES_BLOCK_SIZE, ctr, AES_BLOCK_SIZE);
+			aes_ctr_inc(ctr);
+		}
+
+		aes_encrypt_blocks(key, ks, ks, n);
+
+		bytes = len < n * AES_BLOCK_SIZE ? len : n * AES_BLOCK_SIZE;
+		for (i = 0; i < bytes; i++)
+			out[i] = in[i] ^ ks[i];
+
+		in += bytes;
+		out += bytes;
+		len -= bytes;
+	}
 }
 
 void aes_encrypt(__u8 *key, __u32 key_len, __u8 *src, __u8 *dst)
@@ -401,9 +812,9 @@ void aes_encrypt(__u8 *key, __u32 key_len, __u8 *src, __u8 *dst)
 	struct aes_key local_key;
 	int ret;
 
-	ret = aes_set_encrypt_key(key, key_len << 0x3, &local_key);
+	ret = aes_set_key(&local_key, key, key_len);
 	if (ret)
 		return;
 
-	aes_encrypt_(src, dst, &local_key);
+	aes_encrypt_block(&local_key, src, dst);
 }
@@ -1,94 +1,240 @@
 // SPDX-License-Identifier: Apache-2.0
 /* Copyright 2023 Huawei Technologies Co.,Ltd. All rights reserved. */
 
+#include <endian.h>
 #include <string.h>
 #include "crypto/galois.h"
+#include "wd_alg_common.h"
 
-#define GF_LSB1_MASK	0x1
-#define GF_R		0xe1000000
-#define GALOIS_BITS	128
-#define UINT_BITS	(sizeof(unsigned int) * 8)
-
-#define GALOIS_UL_COUNT		4
-#define GALOIS_UL_COUNT_H	12
-
-#define GALOIS_PARA_TRANS_S(S, i)	(((unsigned int)(S)[(i) + 3] << 24) | \
-					 ((unsigned int)(S)[(i) + 2] << 16) | \
-					 ((unsigned int)(S)[(i) + 1] <<  8) | \
-					 ((unsigned int)(S)[(i)]))
-#define GALOIS_PARA_TRANS_H(H, i)	(((unsigned int)(H)[(i)] << 24)		| \
-					 ((unsigned int)(H)[(i) + 1] << 16)	| \
-					 ((unsigned int)(H)[(i) + 2] <<  8)	| \
-					 ((unsigned int)(H)[(i) + 3]))
-
-#define GALOIS_UINT_TRANS_CHAR(src_addr)					\
-	do {									\
-		unsigned int temp = *(src_addr);				\
-		*(src_addr) = ((temp & 0xff) << 24) | ((temp & 0xff00) << 8)	\
-		| ((temp & 0xff0000) >> 8) | ((temp & 0xff000000) >> 24);	\
-	} while (0)
-
-static void galois_xtime_128(unsigned int *src, unsigned int *dst)
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#define GALOIS_CLMUL
+#define GALOIS_CLMUL_TARGET	__attribute__((target("+crypto")))
+#elif defined(__x86_64__)
+#include <wmmintrin.h>
+#define GALOIS_CLMUL
+#define GALOIS_CLMUL_TARGET	__attribute__((target("pclmul")))
+#endif
+
+/* Based the NIST Special Publication 800-38D, R = 11100001 || 0^120 */
+#define GF_R		0xe100000000000000ULL
+#define GF_HALF_BYTES	8
+#define GF_NIBBLE_BITS	4
+#define GF_NIBBLE_MASK	0xf
+#define GF_REM_SHIFT	48
+
+/* The reduction of the 4 bits shifted out of Z, in the top 16 bits */
+static const __u64 gf_rem_4bit[GALOIS_TABLE_NUM] = {
+	0x0000ULL << GF_REM_SHIFT, 0x1c20ULL << GF_REM_SHIFT,
+	0x3840ULL << GF_REM_SHIFT, 0x2460ULL << GF_REM_SHIFT,
+	0x7080ULL << GF_REM_SHIFT, 0x6ca0ULL << GF_REM_SHIFT,
+	0x48c0ULL << GF_REM_SHIFT, 0x54e0ULL << GF_REM_SHIFT,
+	0xe100ULL << GF_REM_SHIFT, 0xfd20ULL << GF_REM_SHIFT,
+	0xd940ULL << GF_REM_SHIFT, 0xc560ULL << GF_REM_SHIFT,
+	0x9180ULL << GF_REM_SHIFT, 0x8da0ULL << GF_REM_SHIFT,
+	0xa9c0ULL << GF_REM_SHIFT, 0xb5e0ULL << GF_REM_SHIFT,
+};
+
+static __u64 galois_load_be64(const __u8 *p)
+{
+	__u64 v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return be64toh(v);
+}
+
+static void galois_store_be64(__u8 *p, __u64 v)
+{
+	v = htobe64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+/* v = v * x, the bits of GCM are reflected, so x moves them right */
+static void galois_mulx(__u64 *v)
 {
-	unsigned int tmp;
-	__u8 i;
-
-	/* Based the NIST Special Publication 800-38D */
-	for (i = 0; i < GALOIS_UL_COUNT; i++) {
-		tmp = src[i] >> 0x1;
-		dst[i] = tmp | (src[i + 1] << (UINT_BITS - 1));
-		if (i == GALOIS_UL_COUNT - 1) {
-			if (src[0] & GF_LSB1_MASK)
-				dst[i] = tmp ^ GF_R;
+	__u64 r = GF_R & (0 - (v[1] & 0x1));
+
+	v[1] = (v[0] << 63) | (v[1] >> 1);
+	v[0] = (v[0] >> 1) ^ r;
+}
+
+static void galois_init_table(struct galois_key *key)
+{
+	__u64 (*t)[2] = key->table;
+	__u32 i;
+
+	memset(t[0], 0, sizeof(t[0]));
+	t[8][0] = key->h[0];
+	t[8][1] = key->h[1];
+	for (i = 4; i; i >>= 1) {
+		t[i][0] = t[i << 1][0];
+		t[i][1] = t[i << 1][1];
+		galois_mulx(t[i]);
+	}
+
+	/* The other ones are the sums of the powers above */
+	for (i = 3; i < GALOIS_TABLE_NUM; i++) {
+		if (!(i & (i - 1)))
+			continue;
+		t[i][0] = t[i & (i - 1)][0] ^ t[i & -i][0];
+		t[i][1] = t[i & (i - 1)][1] ^ t[i & -i][1];
+	}
+}
+
+/* z = z * x^4 + table[n] */
+static void galois_table_step(const struct galois_key *key, __u64 *z, __u8 n)
+{
+	__u64 rem = z[1] & GF_NIBBLE_MASK;
+
+	z[1] = (z[0] << (64 - GF_NIBBLE_BITS)) | (z[1] >> GF_NIBBLE_BITS);
+	z[0] = (z[0] >> GF_NIBBLE_BITS) ^ gf_rem_4bit[rem];
+	z[0] ^= key->table[n][0];
+	z[1] ^= key->table[n][1];
+}
+
+/* Shoup's method, y * H is done with 32 table lookups of the nibbles */
+static void galois_ghash_table(const struct galois_key *key, __u64 *y,
+			       const __u8 *in, __u32 blocks)
+{
+	__u64 z[2];
+	__u8 b;
+	int i;
+
+	while (blocks--) {
+		y[0] ^= galois_load_be64(in);
+		y[1] ^= galois_load_be64(in + GF_HALF_BYTES);
+
+		z[0] = z[1] = 0;
+		for (i = GALOIS_BLOCK_SIZE - 1; i >= 0; i--) {
+			if (i >= GF_HALF_BYTES)
+				b = y[1] >> ((GALOIS_BLOCK_SIZE - 1 - i) * BYTE_BITS);
 			else
-				dst[i] = tmp;
+				b = y[0] >> ((GF_HALF_BYTES - 1 - i) * BYTE_BITS);
+
+			galois_table_step(key, z, b & GF_NIBBLE_MASK);
+			galois_table_step(key, z, b >> GF_NIBBLE_BITS);
 		}
+
+		y[0] = z[0];
+		y[1] = z[1];
+		in += GALOIS_BLOCK_SIZE;
 	}
 }
 
-static void galois_multi(unsigned int *input_a, unsigned int *input_b,
-			 unsigned int *mul, unsigned int array_size)
+#ifdef GALOIS_CLMUL
+#if defined(__aarch64__)
+static GALOIS_CLMUL_TARGET inline void galois_clmul64(__u64 a, __u64 b, __u64 *hi, __u64 *lo)
+{
+	uint64x2_t r = vreinterpretq_u64_p128(vmull_p64((poly64_t)a, (poly64_t)b));
+
+	*lo = vgetq_lane_u64(r, 0);
+	*hi = vgetq_lane_u64(r, 1);
+}
+
+static bool galois_clmul_support(void)
 {
-	/* 4 * (unsigned int), 4 * 32bit = 128bit */
-	unsigned int gf_V[GALOIS_BITS][GALOIS_UL_COUNT] = {0};
-	unsigned int *gf_Z = mul;
-	__u8 i, j, k;
+	return !!(getauxval(AT_HWCAP) & HWCAP_CE_PMULL);
+}
+#else
+static GALOIS_CLMUL_TARGET inline void galois_clmul64(__u64 a, __u64 b, __u64 *hi, __u64 *lo)
+{
+	__m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128(a), _mm_cvtsi64_si128(b), 0);
 
-	memcpy(gf_V[0], input_a, sizeof(unsigned int) * array_size);
+	*lo = _mm_cvtsi128_si64(r);
+	*hi = _mm_cvtsi128_si64(_mm_unpackhi_epi64(r, r));
+}
 
-	for (i = 1; i < GALOIS_BITS; i++)
-		galois_xtime_128(gf_V[i - 1], gf_V[i]);
+static bool galois_clmul_support(void)
+{
+	return __builtin_cpu_supports("pclmul");
+}
+#endif
 
-	for (i = 0; i < GALOIS_BITS; i++) {
-		k = GALOIS_BITS - i - 1;
-		if ((input_b[(k / UINT_BITS)] >> (k % UINT_BITS)) & 0x1) {
-			for (j = 0; j < array_size; j++)
-				gf_Z[j] ^= gf_V[i][j];
-		}
+/*
+ * The 256 bits product of the reflected y and H is got by Karatsuba, then it
+ * is shifted left by one bit and reduced, as Intel's carry-less multiplication
+ * white paper does.
+ */
+static GALOIS_CLMUL_TARGET void galois_ghash_clmul(const struct galois_key *key, __u64 *y,
+						   const __u8 *in, __u32 blocks)
+{
+	__u64 x0, x1, x2, x3, m0, m1, d;
+
+	while (blocks--) {
+		y[0] ^= galois_load_be64(in);
+		y[1] ^= galois_load_be64(in + GF_HALF_BYTES);
+
+		galois_clmul64(y[1], key->h[1], &x1, &x0);
+		galois_clmul64(y[0], key->h[0], &x3, &x2);
+		galois_clmul64(y[0] ^ y[1], key->h[0] ^ key->h[1], &m1, &m0);
+		m0 ^= x0 ^ x2;
+		m1 ^= x1 ^ x3;
+		x1 ^= m0;
+		x2 ^= m1;
+
+		x3 = (x3 << 1) | (x2 >> 63);
+		x2 = (x2 << 1) | (x1 >> 63);
+		x1 = (x1 << 1) | (x0 >> 63);
+		x0 <<= 1;
+
+		d = x1 ^ (x0 << 63) ^ (x0 << 62) ^ (x0 << 57);
+		y[0] = x3 ^ d ^ (d >> 1) ^ (d >> 2) ^ (d >> 7);
+		y[1] = x2 ^ x0 ^ ((x0 >> 1) | (d << 63)) ^
+		       ((x0 >> 2) | (d << 62)) ^ ((x0 >> 7) | (d << 57));
+		in += GALOIS_BLOCK_SIZE;
 	}
 }
+#endif
 
-void galois_compute(__u8 *S, __u8 *H, __u8 *g, __u32 len)
+int galois_set_key_kernel(struct galois_key *key, const __u8 *h,
+			  enum galois_kernel kernel)
 {
-	unsigned int SL[GALOIS_UL_COUNT] = {0};
-	unsigned int HL[GALOIS_UL_COUNT] = {0};
-	unsigned int G[GALOIS_UL_COUNT] = {0};
-	__u8 i, j;
-
-	/* Do galois multiplication operation on blocks: G = S x H */
-	for (i = 0; i < GALOIS_UL_COUNT; i++) {
-		j = i * GALOIS_UL_COUNT;
-		SL[i] = GALOIS_PARA_TRANS_S(S, j);
-		j = GALOIS_UL_COUNT_H - j;
-		HL[i] = GALOIS_PARA_TRANS_H(H, j);
+	key->h[0] = galois_load_be64(h);
+	key->h[1] = galois_load_be64(h + GF_HALF_BYTES);
+
+	switch (kernel) {
+	case GALOIS_KERNEL_TABLE:
+		galois_init_table(key);
+		key->ghash = galois_ghash_table;
+		return 0;
+#ifdef GALOIS_CLMUL
+	case GALOIS_KERNEL_CLMUL:
+		if (!galois_clmul_support())
+			return -WD_EINVAL;
+		key->ghash = galois_ghash_clmul;
+		return 0;
+#endif
+	default:
+		return -WD_EINVAL;
 	}
+}
 
-	galois_multi(SL, HL, G, GALOIS_UL_COUNT);
+void galois_set_key(struct galois_key *key, const __u8 *h)
+{
+	if (galois_set_key_kernel(key, h, GALOIS_KERNEL_CLMUL))
+		(void)galois_set_key_kernel(key, h, GALOIS_KERNEL_TABLE);
+}
+
+void galois_ghash(const struct galois_key *key, __u8 *y, const __u8 *in, __u32 len)
+{
+	__u8 last[GALOIS_BLOCK_SIZE] = {0};
+	__u32 blocks = len / GALOIS_BLOCK_SIZE;
+	__u32 tail = len % GALOIS_BLOCK_SIZE;
+	__u64 yl[2];
 
-	j = len - GALOIS_UL_COUNT;
-	for (i = 0; i < GALOIS_UL_COUNT; i++) {
-		GALOIS_UINT_TRANS_CHAR(&G[i]);
-		memcpy(&g[j], &G[i], sizeof(unsigned int));
-		j -= GALOIS_UL_COUNT;
+	yl[0] = galois_load_be64(y);
+	yl[1] = galois_load_be64(y + GF_HALF_BYTES);
+
+	if (blocks)
+		key->ghash(key, yl, in, blocks);
+
+	if (tail) {
+		memcpy(last, in + blocks * GALOIS_BLOCK_SIZE, tail);
+		key->ghash(key, yl, last, 1);
 	}
+
+	galois_store_be64(y, yl[0]);
+	galois_store_be64(y + GF_HALF_BYTES, yl[1]);
 }
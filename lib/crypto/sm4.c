@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: Apache-2.0
+/* Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved. */
+
+#include <endian.h>
+#include <string.h>
+#include "crypto/sm4.h"
+
+#define SM4_WORD_BYTES	4
+#define SM4_WORDS	4
+
+/* The S-box of GB/T 32907-2016 */
+static const __u8 sm4_sbox[256] = {
+	0xd6, 0x90, 0xe9, 0xfe, 0xcc, 0xe1, 0x3d, 0xb7, 0x16, 0xb6, 0x14, 0xc2, 0x28, 0xfb, 0x2c, 0x05,
+	0x2b, 0x67, 0x9a, 0x76, 0x2a, 0xbe, 0x04, 0xc3, 0xaa, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
+	0x9c, 0x42, 0x50, 0xf4, 0x91, 0xef, 0x98, 0x7a, 0x33, 0x54, 0x0b, 0x43, 0xed, 0xcf, 0xac, 0x62,
+	0xe4, 0xb3, 0x1c, 0xa9, 0xc9, 0x08, 0xe8, 0x95, 0x80, 0xdf, 0x94, 0xfa, 0x75, 0x8f, 0x3f, 0xa6,
+	0x47, 0x07, 0xa7, 0xfc, 0xf3, 0x73, 0x17, 0xba, 0x83, 0x59, 0x3c, 0x19, 0xe6, 0x85, 0x4f, 0xa8,
+	0x68, 0x6b, 0x81, 0xb2, 0x71, 0x64, 0xda, 0x8b, 0xf8, 0xeb, 0x0f, 0x4b, 0x70, 0x56, 0x9d, 0x35,
+	0x1e, 0x24, 0x0e, 0x5e, 0x63, 0x58, 0xd1, 0xa2, 0x25, 0x22, 0x7c, 0x3b, 0x01, 0x21, 0x78, 0x87,
+	0xd4, 0x00, 0x46, 0x57, 0x9f, 0xd3, 0x27, 0x52, 0x4c, 0x36, 0x02, 0xe7, 0xa0, 0xc4, 0xc8, 0x9e,
+	0xea, 0xbf, 0x8a, 0xd2, 0x40, 0xc7, 0x38, 0xb5, 0xa3, 0xf7, 0xf2, 0xce, 0xf9, 0x61, 0x15, 0xa1,
+	0xe0, 0xae, 0x5d, 0xa4, 0x9b, 0x34, 0x1a, 0x55, 0xad, 0x93, 0x32, 0x30, 0xf5, 0x8c, 0xb1, 0xe3,
+	0x1d, 0xf6, 0xe2, 0x2e, 0x82, 0x66, 0xca, 0x60, 0xc0, 0x29, 0x23, 0xab, 0x0d, 0x53, 0x4e, 0x6f,
+	0xd5, 0xdb, 0x37, 0x45, 0xde, 0xfd, 0x8e, 0x2f, 0x03, 0xff, 0x6a, 0x72, 0x6d, 0x6c, 0x5b, 0x51,
+	0x8d, 0x1b, 0xaf, 0x92, 0xbb, 0xdd, 0xbc, 0x7f, 0x11, 0xd9, 0x5c, 0x41, 0x1f, 0x10, 0x5a, 0xd8,
+	0x0a, 0xc1, 0x31, 0x88, 0xa5, 0xcd, 0x7b, 0xbd, 0x2d, 0x74, 0xd0, 0x12, 0xb8, 0xe5, 0xb4, 0xb0,
+	0x89, 0x69, 0x97, 0x4a, 0x0c, 0x96, 0x77, 0x7e, 0x65, 0xb9, 0xf1, 0x09, 0xc5, 0x6e, 0xc6, 0x84,
+	0x18, 0xf0, 0x7d, 0xec, 0x3a, 0xdc, 0x4d, 0x20, 0x79, 0xee, 0x5f, 0x3e, 0xd7, 0xcb, 0x39, 0x48,
+};
+
+static const __u32 sm4_fk[SM4_WORDS] = {
+	0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc,
+};
+
+static __u32 sm4_load_be32(const __u8 *p)
+{
+	__u32 v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return be32toh(v);
+}
+
+static void sm4_store_be32(__u8 *p, __u32 v)
+{
+	v = htobe32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static __u32 sm4_rotl(__u32 x, __u32 n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+/* The non-linear transformation tau, the S-box on each byte */
+static __u32 sm4_tau(__u32 x)
+{
+	return (__u32)sm4_sbox[x >> 24] << 24 |
+	       (__u32)sm4_sbox[(x >> 16) & 0xff] << 16 |
+	       (__u32)sm4_sbox[(x >> 8) & 0xff] << 8 |
+	       (__u32)sm4_sbox[x & 0xff];
+}
+
+/* The round function T = L(tau(x)) */
+static __u32 sm4_t(__u32 x)
+{
+	x = sm4_tau(x);
+
+	return x ^ sm4_rotl(x, 2) ^ sm4_rotl(x, 10) ^
+	       sm4_rotl(x, 18) ^ sm4_rotl(x, 24);
+}
+
+/* The T' of the key expansion, with the linear transformation L' */
+static __u32 sm4_key_t(__u32 x)
+{
+	x = sm4_tau(x);
+
+	return x ^ sm4_rotl(x, 13) ^ sm4_rotl(x, 23);
+}
+
+/* CK[i], byte j of it is (4i + j) * 7 mod 256 */
+static __u32 sm4_ck(__u32 i)
+{
+	__u32 ck = 0;
+	__u32 j;
+
+	for (j = 0; j < SM4_WORD_BYTES; j++)
+		ck = (ck << 8) | (((SM4_WORD_BYTES * i + j) * 7) & 0xff);
+
+	return ck;
+}
+
+void sm4_set_key(struct sm4_key *key, const __u8 *userkey)
+{
+	__u32 k[SM4_WORDS];
+	__u32 i;
+
+	for (i = 0; i < SM4_WORDS; i++)
+		k[i] = sm4_load_be32(userkey + i * SM4_WORD_BYTES) ^ sm4_fk[i];
+
+	for (i = 0; i < SM4_ROUNDS; i++) {
+		key->rk[i] = k[i % SM4_WORDS] ^ sm4_key_t(k[(i + 1) % SM4_WORDS] ^
+			     k[(i + 2) % SM4_WORDS] ^ k[(i + 3) % SM4_WORDS] ^ sm4_ck(i));
+		k[i % SM4_WORDS] = key->rk[i];
+	}
+}
+
+void sm4_set_dec_key(struct sm4_key *key, const __u8 *userkey)
+{
+	__u32 t, i;
+
+	sm4_set_key(key, userkey);
+	for (i = 0; i < SM4_ROUNDS / 2; i++) {
+		t = key->rk[i];
+		key->rk[i] = key->rk[SM4_ROUNDS - 1 - i];
+		key->rk[SM4_ROUNDS - 1 - i] = t;
+	}
+}
+
+void sm4_ecb_crypt(const struct sm4_key *key, const __u8 *in, __u8 *out,
+		   __u32 blocks)
+{
+	__u32 x[SM4_WORDS];
+	__u32 i;
+
+	while (blocks--) {
+		for (i = 0; i < SM4_WORDS; i++)
+			x[i] = sm4_load_be32(in + i * SM4_WORD_BYTES);
+
+		for (i = 0; i < SM4_ROUNDS; i++)
+			x[i % SM4_WORDS] ^= sm4_t(x[(i + 1) % SM4_WORDS] ^
+				x[(i + 2) % SM4_WORDS] ^ x[(i + 3) % SM4_WORDS] ^ key->rk[i]);
+
+		/* The output is the last 4 words in the reverse order */
+		for (i = 0; i < SM4_WORDS; i++)
+			sm4_store_be32(out + i * SM4_WORD_BYTES, x[SM4_WORDS - 1 - i]);
+
+		in += SM4_BLOCK_BYTES;
+		out += SM4_BLOCK_BYTES;
+	}
+}
@@ -0,0 +1,809 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test the hashagg of the soft dae driver against a reference: the rows are
+ * grouped by an INT and a VARCHAR key with NULLs, and aggregated by SUM,
+ * COUNT, MIN, MAX, AVG and COUNT_DISTINCT of a LONG column, SUM of a
+ * SHORT_DECIMAL column and count(*). The first table is small, so that it
+ * is grown by a rehash. The tables are of a row number which is not a power
+ * of 2 and start at an address which is not cache line aligned, the driver
+ * should use nearly all their rows. COUNT_DISTINCT is an estimate, so it is
+ * only checked in a range.
+ * A managed table is also tested: the rows are added by 8 threads to one
+ * session whose table grows, and by one thread to a session whose table can
+ * not grow over max_size, which ends the input with WD_AGG_NEED_REHASH.
+ * The test is skipped if the soft dae driver is not found.
+ */
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wd_agg.h"
+#include "wd_sched.h"
+
+#define TEST_ROW_NUM		20000
+#define TEST_GROUP_NUM		1500
+#define TEST_INPUT_ROWS		3000
+#define TEST_OUTPUT_ROWS	100
+#define TEST_KEY_LEN		12
+#define TEST_KEY_NUM		2
+#define TEST_AGG_NUM		4
+#define TEST_OUT_AGG_NUM	9
+/* The values of the LONG column are in [TEST_VAL_MIN, TEST_VAL_MIN + TEST_VAL_RANGE) */
+#define TEST_VAL_MIN		(-300)
+#define TEST_VAL_RANGE		1000
+#define TEST_DEC_INFO		0x0a12
+/* The sum of the COUNT_DISTINCT estimates is in 5% of the real sum */
+#define TEST_DISTINCT_ERR	20
+/* The first standard table is 3 * 2^7 rows, it is grown 3 times on a rehash */
+#define TEST_STD_ROWS		384
+#define TEST_EXT_RATIO		4
+#define TEST_GROW_RATIO		3
+/* The table is given at an address of 8 bytes after a cache line */
+#define TEST_TABLE_OFFSET	8
+#define TEST_THREAD_NUM		8
+#define TEST_THREAD_ROWS	500
+
+/* The output agg cols, in the order of the agg cols and their algs */
+enum test_out_col {
+	OUT_SUM,
+	OUT_COUNT,
+	OUT_MIN,
+	OUT_MAX,
+	OUT_AVG_SUM,
+	OUT_AVG_COUNT,
+	OUT_DISTINCT,
+	OUT_DEC_SUM,
+	OUT_COUNT_ALL,
+};
+
+struct test_input {
+	__s32 k1[TEST_ROW_NUM];
+	__u8 k1_empty[TEST_ROW_NUM];
+	char k2[TEST_ROW_NUM * TEST_KEY_LEN];
+	__u32 k2_offset[TEST_ROW_NUM + 1];
+	__u8 k2_empty[TEST_ROW_NUM];
+	__s64 a[TEST_ROW_NUM];
+	__u8 a_empty[TEST_ROW_NUM];
+	__s64 b[TEST_ROW_NUM];
+	__u8 b_empty[TEST_ROW_NUM];
+};
+
+struct ref_group {
+	__s32 k1;
+	__u8 k1_empty;
+	char k2[TEST_KEY_LEN + 1];
+	__u8 k2_empty;
+	__s64 sum;
+	__s64 count;
+	__s64 min;
+	__s64 max;
+	__u8 seen[TEST_VAL_RANGE / 8];
+	__s64 distinct;
+	__int128 dec_sum;
+	__s64 dec_count;
+	__s64 count_all;
+};
+
+struct test_output {
+	__s32 k1[TEST_OUTPUT_ROWS];
+	__u8 k1_empty[TEST_OUTPUT_ROWS];
+	char k2[TEST_OUTPUT_ROWS * TEST_KEY_LEN];
+	__u32 k2_offset[TEST_OUTPUT_ROWS + 1];
+	__u8 k2_empty[TEST_OUTPUT_ROWS];
+	__s64 val[TEST_OUT_AGG_NUM][TEST_OUTPUT_ROWS];
+	__int128 dec[TEST_OUTPUT_ROWS];
+	__u8 empty[TEST_OUT_AGG_NUM][TEST_OUTPUT_ROWS];
+	struct wd_dae_col_addr key_cols[TEST_KEY_NUM];
+	struct wd_dae_col_addr agg_cols[TEST_OUT_AGG_NUM];
+	__u8 overflow[TEST_OUT_AGG_NUM];
+};
+
+struct test_table {
+	struct wd_dae_hash_table table;
+	void *std_mem;
+	void *ext_mem;
+};
+
+static struct wd_key_col_info key_info[TEST_KEY_NUM] = {
+	{ 0, WD_DAE_INT },
+	{ TEST_KEY_LEN, WD_DAE_VARCHAR },
+};
+
+static struct wd_agg_col_info agg_info[TEST_AGG_NUM] = {
+	{ 2, 0, WD_DAE_LONG, { WD_DAE_LONG, WD_DAE_LONG }, { WD_AGG_SUM, WD_AGG_COUNT } },
+	{ 2, 0, WD_DAE_LONG, { WD_DAE_LONG, WD_DAE_LONG }, { WD_AGG_MIN, WD_AGG_MAX } },
+	{ 2, 0, WD_DAE_LONG, { WD_DAE_LONG, WD_DAE_LONG },
+	  { WD_AGG_AVG, WD_AGG_COUNT_DISTINCT } },
+	{ 1, TEST_DEC_INFO, WD_DAE_SHORT_DECIMAL, { WD_DAE_LONG_DECIMAL }, { WD_AGG_SUM } },
+};
+
+static struct test_input in;
+static struct ref_group groups[TEST_GROUP_NUM];
+static __u32 group_num;
+
+static struct ref_group *find_group(__u8 k1_empty, __s32 k1, __u8 k2_empty,
+				    const char *k2, __u32 k2_len)
+{
+	struct ref_group *g;
+	__u32 i;
+
+	for (i = 0; i < group_num; i++) {
+		g = &groups[i];
+		if (g->k1_empty != k1_empty || g->k2_empty != k2_empty)
+			continue;
+		if (!k1_empty && g->k1 != k1)
+			continue;
+		if (!k2_empty && (strlen(g->k2) != k2_len || memcmp(g->k2, k2, k2_len)))
+			continue;
+		return g;
+	}
+
+	return NULL;
+}
+
+static struct ref_group *add_group(__u8 k1_empty, __s32 k1, __u8 k2_empty,
+				   const char *k2, __u32 k2_len)
+{
+	struct ref_group *g;
+
+	g = find_group(k1_empty, k1, k2_empty, k2, k2_len);
+	if (g)
+		return g;
+
+	g = &groups[group_num++];
+	g->k1_empty = k1_empty;
+	g->k1 = k1_empty ? 0 : k1;
+	g->k2_empty = k2_empty;
+	if (!k2_empty)
+		memcpy(g->k2, k2, k2_len);
+
+	return g;
+}
+
+static void ref_add_row(__u32 r)
+{
+	__u32 off = in.k2_offset[r];
+	struct ref_group *g;
+	__u32 v;
+
+	g = add_group(in.k1_empty[r], in.k1[r], in.k2_empty[r], in.k2 + off,
+		      in.k2_offset[r + 1] - off);
+	if (!in.a_empty[r]) {
+		if (!g->count || in.a[r] < g->min)
+			g->min = in.a[r];
+		if (!g->count || in.a[r] > g->max)
+			g->max = in.a[r];
+		v = in.a[r] - TEST_VAL_MIN;
+		if (!(g->seen[v / 8] & (1 << (v % 8)))) {
+			g->seen[v / 8] |= 1 << (v % 8);
+			g->distinct++;
+		}
+		g->sum += in.a[r];
+		g->count++;
+	}
+	if (!in.b_empty[r]) {
+		g->dec_sum += in.b[r];
+		g->dec_count++;
+	}
+	g->count_all++;
+}
+
+/*
+ * A group is given by the two keys, an empty key of a group is also a key.
+ * The values of a tenth of the rows are empty.
+ */
+static void fill_input(void)
+{
+	__u32 off = 0;
+	__u32 i, g;
+
+	srand(1);
+	for (i = 0; i < TEST_ROW_NUM; i++) {
+		g = rand() % TEST_GROUP_NUM;
+		in.k1[i] = g % 97;
+		in.k1_empty[i] = !(g % 101);
+		in.k2_offset[i] = off;
+		in.k2_empty[i] = !(g % 53);
+		if (!in.k2_empty[i])
+			off += sprintf(in.k2 + off, "s%u", g / 7);
+		in.a[i] = rand() % TEST_VAL_RANGE + TEST_VAL_MIN;
+		in.a_empty[i] = !(rand() % 10);
+		in.b[i] = (__s64)rand() * 1000;
+		in.b_empty[i] = !(rand() % 7);
+	}
+	in.k2_offset[TEST_ROW_NUM] = off;
+}
+
+/* The reference of the first rows of the input */
+static void build_ref(__u32 rows)
+{
+	__u32 i;
+
+	memset(groups, 0, sizeof(groups));
+	group_num = 0;
+	for (i = 0; i < rows; i++)
+		ref_add_row(i);
+}
+
+static void free_table(struct test_table *t)
+{
+	free(t->std_mem);
+	free(t->ext_mem);
+	memset(t, 0, sizeof(*t));
+}
+
+static int alloc_table(struct test_table *t, __u32 row_size, __u32 std_rows)
+{
+	__u32 ext_rows = std_rows / TEST_EXT_RATIO;
+
+	t->std_mem = malloc((size_t)row_size * std_rows + TEST_TABLE_OFFSET);
+	t->ext_mem = malloc((size_t)row_size * ext_rows + TEST_TABLE_OFFSET);
+	if (!t->std_mem || !t->ext_mem) {
+		free_table(t);
+		return -WD_ENOMEM;
+	}
+
+	t->table.std_table = (__u8 *)t->std_mem + TEST_TABLE_OFFSET;
+	t->table.ext_table = (__u8 *)t->ext_mem + TEST_TABLE_OFFSET;
+	t->table.std_table_row_num = std_rows;
+	t->table.ext_table_row_num = ext_rows;
+	t->table.table_row_size = row_size;
+
+	return 0;
+}
+
+/* Less than a cache line of each table may be lost for the alignment */
+static int check_table_rows(handle_t h_sess, __u32 std_rows)
+{
+	struct wd_agg_table_stats stats = {0};
+	int ret;
+
+	ret = wd_agg_get_table_stats(h_sess, &stats);
+	if (ret) {
+		printf("fail to get table stats, ret %d\n", ret);
+		return ret;
+	}
+
+	if (stats.std_table_row_num > std_rows ||
+	    stats.std_table_row_num < std_rows - std_rows / 8) {
+		printf("the driver uses %llu rows of %u\n", stats.std_table_row_num,
+		       std_rows);
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+static handle_t alloc_sess(void)
+{
+	struct wd_agg_sess_setup setup = {0};
+
+	setup.key_cols_num = TEST_KEY_NUM;
+	setup.key_cols_info = key_info;
+	setup.agg_cols_num = TEST_AGG_NUM;
+	setup.agg_cols_info = agg_info;
+	setup.is_count_all = true;
+	setup.count_all_data_type = WD_DAE_LONG;
+
+	return wd_agg_alloc_sess(&setup);
+}
+
+static void set_col(struct wd_dae_col_addr *col, void *empty, void *value, __u32 *offset,
+		    __u32 rows, __u64 value_size)
+{
+	col->empty = empty;
+	col->value = value;
+	col->offset = offset;
+	col->empty_size = rows;
+	col->value_size = value_size;
+	col->offset_size = offset ? (rows + 1) * sizeof(__u32) : 0;
+}
+
+static void set_input(struct wd_agg_req *req, struct wd_dae_col_addr *key_cols,
+		      struct wd_dae_col_addr *agg_cols, __u32 pos, __u32 rows)
+{
+	__u32 off = in.k2_offset[pos];
+
+	set_col(&key_cols[0], in.k1_empty + pos, in.k1 + pos, NULL, rows,
+		rows * sizeof(__s32));
+	set_col(&key_cols[1], in.k2_empty + pos, in.k2 + off, in.k2_offset + pos, rows,
+		in.k2_offset[pos + rows] - off);
+	set_col(&agg_cols[0], in.a_empty + pos, in.a + pos, NULL, rows, rows * sizeof(__s64));
+	agg_cols[1] = agg_cols[0];
+	agg_cols[2] = agg_cols[0];
+	set_col(&agg_cols[3], in.b_empty + pos, in.b + pos, NULL, rows, rows * sizeof(__s64));
+
+	req->key_cols = key_cols;
+	req->key_cols_num = TEST_KEY_NUM;
+	req->agg_cols = agg_cols;
+	req->agg_cols_num = TEST_AGG_NUM;
+	req->in_row_count = rows;
+}
+
+static void set_output(struct wd_agg_req *req, struct test_output *out)
+{
+	__u32 rows = TEST_OUTPUT_ROWS;
+	int i;
+
+	set_col(&out->key_cols[0], out->k1_empty, out->k1, NULL, rows, sizeof(out->k1));
+	set_col(&out->key_cols[1], out->k2_empty, out->k2, out->k2_offset, rows,
+		sizeof(out->k2));
+	for (i = 0; i < TEST_OUT_AGG_NUM; i++)
+		set_col(&out->agg_cols[i], out->empty[i], out->val[i], NULL, rows,
+			sizeof(out->val[i]));
+	set_col(&out->agg_cols[OUT_DEC_SUM], out->empty[OUT_DEC_SUM], out->dec, NULL, rows,
+		sizeof(out->dec));
+
+	req->out_key_cols = out->key_cols;
+	req->out_key_cols_num = TEST_KEY_NUM;
+	req->out_agg_cols = out->agg_cols;
+	req->out_agg_cols_num = TEST_OUT_AGG_NUM;
+	req->sum_overflow_cols = out->overflow;
+	req->out_row_count = rows;
+}
+
+/*
+ * A group of a few values may still lose some of them to the collisions of
+ * the HyperLogLog registers, so a group is only checked in a factor of 2,
+ * and the sum of the estimates of all the groups in TEST_DISTINCT_ERR.
+ */
+static bool distinct_in_range(__s64 est, __s64 distinct)
+{
+	return est * 2 >= distinct && est <= distinct * 2;
+}
+
+static int check_row(struct test_output *out, __u32 i, __u8 *used, __s64 *est_sum)
+{
+	__u32 off = out->k2_offset[i];
+	struct ref_group *g;
+	__u8 valid;
+
+	g = find_group(out->k1_empty[i], out->k1[i], out->k2_empty[i], out->k2 + off,
+		       out->k2_empty[i] ? 0 : out->k2_offset[i + 1] - off);
+	if (!g || used[g - groups]) {
+		printf("group %d of row %u is unknown or output twice\n", out->k1[i], i);
+		return -WD_EINVAL;
+	}
+	used[g - groups] = 1;
+
+	valid = g->count != 0;
+	if (out->empty[OUT_SUM][i] == valid || out->empty[OUT_MIN][i] == valid ||
+	    out->empty[OUT_AVG_SUM][i] == valid ||
+	    out->empty[OUT_DEC_SUM][i] == (g->dec_count != 0))
+		goto err;
+
+	if (out->val[OUT_COUNT][i] != g->count || out->val[OUT_AVG_COUNT][i] != g->count ||
+	    out->val[OUT_COUNT_ALL][i] != g->count_all)
+		goto err;
+
+	if (valid && (out->val[OUT_SUM][i] != g->sum || out->val[OUT_MIN][i] != g->min ||
+		      out->val[OUT_MAX][i] != g->max || out->val[OUT_AVG_SUM][i] != g->sum ||
+		      !distinct_in_range(out->val[OUT_DISTINCT][i], g->distinct)))
+		goto err;
+
+	if (g->dec_count && out->dec[i] != g->dec_sum)
+		goto err;
+
+	*est_sum += out->val[OUT_DISTINCT][i];
+	return 0;
+
+err:
+	printf("wrong aggs of group %d %s\n", g->k1, g->k2);
+	return -WD_EINVAL;
+}
+
+/* Get all the groups out, each group of the reference must be there once */
+static int check_output(handle_t h_sess)
+{
+	struct wd_agg_req req = {0};
+	__s64 est_sum = 0, distinct_sum = 0;
+	struct test_output *out;
+	__u32 total = 0;
+	__u8 *used;
+	__u32 i;
+	int ret;
+
+	out = calloc(1, sizeof(*out));
+	used = calloc(group_num, 1);
+	if (!out || !used) {
+		ret = -WD_ENOMEM;
+		goto out_free;
+	}
+
+	do {
+		set_output(&req, out);
+		ret = wd_agg_get_output_sync(h_sess, &req);
+		if (ret) {
+			printf("fail to get output, ret %d\n", ret);
+			goto out_free;
+		}
+
+		for (i = 0; i < req.real_out_row_count; i++) {
+			ret = check_row(out, i, used, &est_sum);
+			if (ret)
+				goto out_free;
+		}
+		total += req.real_out_row_count;
+	} while (!req.output_done);
+
+	if (total != group_num) {
+		printf("%u groups are output of %u\n", total, group_num);
+		ret = -WD_EINVAL;
+		goto out_free;
+	}
+
+	for (i = 0; i < group_num; i++)
+		distinct_sum += groups[i].distinct;
+	if (est_sum < distinct_sum - distinct_sum / TEST_DISTINCT_ERR ||
+	    est_sum > distinct_sum + distinct_sum / TEST_DISTINCT_ERR) {
+		printf("distinct values are estimated %lld of %lld\n", est_sum, distinct_sum);
+		ret = -WD_EINVAL;
+	}
+
+out_free:
+	free(used);
+	free(out);
+	return ret;
+}
+
+/* Move the groups into a table of TEST_GROW_RATIO times the rows */
+static int grow_table(handle_t h_sess, struct test_table *t, struct wd_agg_req *req)
+{
+	struct test_table new_t = {0};
+	struct test_output *out;
+	__u32 std_rows;
+	int ret;
+
+	out = calloc(1, sizeof(*out));
+	if (!out)
+		return -WD_ENOMEM;
+
+	std_rows = t->table.std_table_row_num * TEST_GROW_RATIO;
+	ret = alloc_table(&new_t, t->table.table_row_size, std_rows);
+	if (ret)
+		goto out_free;
+
+	ret = wd_agg_set_hash_table(h_sess, &new_t.table);
+	if (ret) {
+		printf("fail to set the grown table, ret %d\n", ret);
+		free_table(&new_t);
+		goto out_free;
+	}
+
+	set_output(req, out);
+	ret = wd_agg_rehash_sync(h_sess, req);
+	if (ret) {
+		printf("fail to rehash to %u rows, ret %d\n", std_rows, ret);
+		free_table(&new_t);
+		goto out_free;
+	}
+
+	free_table(t);
+	*t = new_t;
+	ret = check_table_rows(h_sess, std_rows);
+
+out_free:
+	free(out);
+	return ret;
+}
+
+static int test_grow(void)
+{
+	struct wd_dae_col_addr key_cols[TEST_KEY_NUM];
+	struct wd_dae_col_addr agg_cols[TEST_AGG_NUM];
+	struct test_table t = {0};
+	struct wd_agg_req req = {0};
+	__u32 pos, rows, grow_num = 0;
+	handle_t h_sess;
+	int row_size;
+	int ret;
+
+	h_sess = alloc_sess();
+	if (!h_sess) {
+		printf("fail to alloc session!\n");
+		return -WD_ENOMEM;
+	}
+
+	row_size = wd_agg_get_table_rowsize(h_sess);
+	if (row_size <= 0) {
+		printf("fail to get table row size, ret %d\n", row_size);
+		ret = -WD_EINVAL;
+		goto out_free;
+	}
+
+	ret = alloc_table(&t, row_size, TEST_STD_ROWS);
+	if (ret)
+		goto out_free;
+
+	ret = wd_agg_set_hash_table(h_sess, &t.table);
+	if (ret) {
+		printf("fail to set hash table, ret %d\n", ret);
+		goto out_free;
+	}
+
+	ret = check_table_rows(h_sess, TEST_STD_ROWS);
+	if (ret)
+		goto out_free;
+
+	for (pos = 0; pos < TEST_ROW_NUM;) {
+		rows = TEST_ROW_NUM - pos;
+		if (rows > TEST_INPUT_ROWS)
+			rows = TEST_INPUT_ROWS;
+		set_input(&req, key_cols, agg_cols, pos, rows);
+		ret = wd_agg_add_input_sync(h_sess, &req);
+		if (ret) {
+			printf("fail to add input at row %u, ret %d\n", pos, ret);
+			goto out_free;
+		}
+		pos += req.real_in_row_count;
+
+		if (req.state == WD_AGG_NEED_REHASH) {
+			ret = grow_table(h_sess, &t, &req);
+			if (ret)
+				goto out_free;
+			grow_num++;
+		} else if (req.state != WD_AGG_TASK_DONE) {
+			printf("wrong state %d at row %u\n", req.state, pos);
+			ret = -WD_EINVAL;
+			goto out_free;
+		}
+	}
+
+	if (!grow_num) {
+		printf("the table is not grown!\n");
+		ret = -WD_EINVAL;
+		goto out_free;
+	}
+
+	ret = check_output(h_sess);
+	if (!ret)
+		printf("hashagg: %u groups, %u rehashes pass\n", group_num, grow_num);
+
+out_free:
+	wd_agg_free_sess(h_sess);
+	free_table(&t);
+	return ret;
+}
+
+static handle_t alloc_managed_sess(__u64 max_size)
+{
+	struct wd_agg_table_setup setup = {0};
+	handle_t h_sess;
+	int ret;
+
+	h_sess = alloc_sess();
+	if (!h_sess) {
+		printf("fail to alloc session!\n");
+		return 0;
+	}
+
+	/* Start with the smallest table, so that it has to grow */
+	setup.max_size = max_size;
+	ret = wd_agg_set_managed_table(h_sess, &setup);
+	if (ret) {
+		printf("fail to set managed table, ret %d\n", ret);
+		wd_agg_free_sess(h_sess);
+		return 0;
+	}
+
+	return h_sess;
+}
+
+struct thread_data {
+	handle_t h_sess;
+	__u32 start;
+	__u32 end;
+	int ret;
+};
+
+/* The inputs of the threads are done one by one on the managed table */
+static void *add_input_thread(void *arg)
+{
+	struct wd_dae_col_addr key_cols[TEST_KEY_NUM];
+	struct wd_dae_col_addr agg_cols[TEST_AGG_NUM];
+	struct thread_data *td = arg;
+	struct wd_agg_req req;
+	__u32 pos, rows;
+
+	for (pos = td->start; pos < td->end; pos += rows) {
+		rows = td->end - pos;
+		if (rows > TEST_THREAD_ROWS)
+			rows = TEST_THREAD_ROWS;
+		memset(&req, 0, sizeof(req));
+		set_input(&req, key_cols, agg_cols, pos, rows);
+		td->ret = wd_agg_add_input_sync(td->h_sess, &req);
+		if (td->ret || req.state != WD_AGG_TASK_DONE || req.real_in_row_count != rows) {
+			printf("fail to add input at row %u, ret %d, state %d, %u rows in\n",
+			       pos, td->ret, req.state, req.real_in_row_count);
+			td->ret = td->ret ? td->ret : -WD_EINVAL;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static int test_managed_mt(void)
+{
+	struct thread_data td[TEST_THREAD_NUM];
+	struct wd_agg_table_stats stats = {0};
+	pthread_t threads[TEST_THREAD_NUM];
+	__u32 rows = TEST_ROW_NUM / TEST_THREAD_NUM;
+	handle_t h_sess;
+	int i, num;
+	int ret = 0;
+
+	h_sess = alloc_managed_sess(0);
+	if (!h_sess)
+		return -WD_EINVAL;
+
+	for (num = 0; num < TEST_THREAD_NUM; num++) {
+		td[num].h_sess = h_sess;
+		td[num].start = num * rows;
+		td[num].end = num == TEST_THREAD_NUM - 1 ? TEST_ROW_NUM : (num + 1) * rows;
+		td[num].ret = 0;
+		ret = pthread_create(&threads[num], NULL, add_input_thread, &td[num]);
+		if (ret) {
+			printf("fail to create thread %d!\n", num);
+			ret = -WD_EINVAL;
+			break;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		pthread_join(threads[i], NULL);
+		if (!ret)
+			ret = td[i].ret;
+	}
+	if (ret)
+		goto out_free;
+
+	ret = wd_agg_get_table_stats(h_sess, &stats);
+	if (ret || !stats.grow_num) {
+		printf("the managed table is not grown, ret %d\n", ret);
+		ret = -WD_EINVAL;
+		goto out_free;
+	}
+
+	ret = check_output(h_sess);
+	if (!ret)
+		printf("managed hashagg: %d threads, %llu grows pass\n", TEST_THREAD_NUM,
+		       stats.grow_num);
+
+out_free:
+	wd_agg_free_sess(h_sess);
+	return ret;
+}
+
+/* The size of the smallest managed table, it can't hold all the groups */
+static int get_min_table_size(__u64 *size)
+{
+	struct wd_agg_table_stats stats = {0};
+	handle_t h_sess;
+	int ret;
+
+	h_sess = alloc_managed_sess(0);
+	if (!h_sess)
+		return -WD_EINVAL;
+
+	ret = wd_agg_get_table_stats(h_sess, &stats);
+	if (ret || stats.std_table_row_num + stats.ext_table_row_num >= group_num) {
+		printf("the smallest managed table is %llu rows, ret %d\n",
+		       stats.std_table_row_num + stats.ext_table_row_num, ret);
+		ret = -WD_EINVAL;
+	}
+	*size = stats.table_size;
+
+	wd_agg_free_sess(h_sess);
+	return ret;
+}
+
+/*
+ * The table of max_size can't grow, the input ends at the row which is not
+ * in the table with WD_AGG_NEED_REHASH, and the rows before it are output.
+ */
+static int test_managed_max_size(void)
+{
+	struct wd_dae_col_addr key_cols[TEST_KEY_NUM];
+	struct wd_dae_col_addr agg_cols[TEST_AGG_NUM];
+	struct wd_agg_table_stats stats = {0};
+	struct wd_agg_req req = {0};
+	__u64 max_size;
+	handle_t h_sess;
+	__u32 pos, rows;
+	int ret;
+
+	ret = get_min_table_size(&max_size);
+	if (ret)
+		return ret;
+
+	h_sess = alloc_managed_sess(max_size);
+	if (!h_sess)
+		return -WD_EINVAL;
+
+	for (pos = 0; pos < TEST_ROW_NUM; pos += req.real_in_row_count) {
+		rows = TEST_ROW_NUM - pos;
+		if (rows > TEST_INPUT_ROWS)
+			rows = TEST_INPUT_ROWS;
+		set_input(&req, key_cols, agg_cols, pos, rows);
+		ret = wd_agg_add_input_sync(h_sess, &req);
+		if (ret) {
+			printf("fail to add input at row %u, ret %d\n", pos, ret);
+			goto out_free;
+		}
+
+		if (req.state == WD_AGG_NEED_REHASH)
+			break;
+	}
+
+	if (req.state != WD_AGG_NEED_REHASH || req.real_in_row_count >= rows) {
+		printf("wrong state %d of a full table, %u rows of %u in\n", req.state,
+		       req.real_in_row_count, rows);
+		ret = -WD_EINVAL;
+		goto out_free;
+	}
+	pos += req.real_in_row_count;
+
+	ret = wd_agg_get_table_stats(h_sess, &stats);
+	if (ret || stats.grow_num || stats.table_size > max_size) {
+		printf("the table of %llu bytes is grown %llu times over %llu, ret %d\n",
+		       stats.table_size, stats.grow_num, max_size, ret);
+		ret = -WD_EINVAL;
+		goto out_free;
+	}
+
+	build_ref(pos);
+	ret = check_output(h_sess);
+	if (!ret)
+		printf("managed hashagg: table full at row %u pass\n", pos);
+
+out_free:
+	wd_agg_free_sess(h_sess);
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("wd_agg_soft_test: check the soft hashagg against a reference\n");
+	printf("    --help: show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, index = 0;
+	int ret;
+
+	static struct option long_options[] = {
+		{"help",	no_argument,		0, 0},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		print_help();
+		return 0;
+	}
+
+	ret = wd_agg_init("hashagg", SCHED_POLICY_RR, TASK_INSTR, NULL);
+	if (ret) {
+		printf("no soft dae driver, skip!\n");
+		return 0;
+	}
+
+	fill_input();
+	build_ref(TEST_ROW_NUM);
+	ret = test_grow();
+	if (!ret)
+		ret = test_managed_mt();
+	/* It rebuilds the reference of a part of the rows, so it is the last */
+	if (!ret)
+		ret = test_managed_max_size();
+
+	wd_agg_uninit();
+	return ret;
+}
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test a comp instance beside the default setting with the soft comp driver:
+ * a session of wd_comp_init2() and a session of an instance compress the
+ * same data, and both outputs are inflated by zlib. An instance has nothing
+ * to poll with a soft driver, so wd_comp_instance_poll() polls nothing. After
+ * the instance is destroyed, the default session and a new instance should
+ * still work. The test is skipped if the soft comp driver is not found.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "wd_comp.h"
+#include "wd_sched.h"
+
+#define TEST_ALG		"zlib"
+#define TEST_SRC_LEN		(64 * 1024)
+#define TEST_DST_LEN		(TEST_SRC_LEN * 2)
+#define TEST_POLL_NUM		1
+
+static __u8 src[TEST_SRC_LEN];
+
+static void fill_src(void)
+{
+	__u32 i;
+
+	for (i = 0; i < TEST_SRC_LEN; i++)
+		src[i] = (i % 251) < 120 ? 'a' + (i * 7 % 13) : rand();
+}
+
+static void setup_sess(struct wd_comp_sess_setup *setup)
+{
+	memset(setup, 0, sizeof(*setup));
+	setup->alg_type = WD_ZLIB;
+	setup->op_type = WD_DIR_COMPRESS;
+	setup->comp_lv = WD_COMP_L8;
+	setup->win_sz = WD_COMP_WS_32K;
+}
+
+static int check_inflate(const char *name, __u8 *out, __u32 out_len)
+{
+	uLongf len = TEST_SRC_LEN;
+	__u8 *back;
+	int ret;
+
+	back = malloc(TEST_SRC_LEN);
+	if (!back)
+		return -WD_ENOMEM;
+
+	ret = uncompress(back, &len, out, out_len);
+	if (ret != Z_OK || len != TEST_SRC_LEN || memcmp(src, back, len)) {
+		printf("%s: inflate failed, ret %d, %lu bytes out\n", name, ret, len);
+		ret = -WD_EINVAL;
+	} else {
+		ret = 0;
+	}
+
+	free(back);
+	return ret;
+}
+
+static int do_comp(const char *name, handle_t h_sess)
+{
+	struct wd_comp_req req = {0};
+	__u8 *dst;
+	int ret;
+
+	dst = malloc(TEST_DST_LEN);
+	if (!dst)
+		return -WD_ENOMEM;
+
+	req.op_type = WD_DIR_COMPRESS;
+	req.src = src;
+	req.src_len = TEST_SRC_LEN;
+	req.dst = dst;
+	req.dst_len = TEST_DST_LEN;
+	req.data_fmt = WD_FLAT_BUF;
+	ret = wd_do_comp_sync(h_sess, &req);
+	if (ret || req.status) {
+		printf("%s: comp failed, ret %d, status %u\n", name, ret, req.status);
+		ret = ret ? ret : -WD_EINVAL;
+		goto out_free;
+	}
+
+	ret = check_inflate(name, dst, req.dst_len);
+
+out_free:
+	free(dst);
+	return ret;
+}
+
+/* Create an instance, and compress by a session of it */
+static int test_inst(handle_t h_default)
+{
+	struct wd_comp_sess_setup setup;
+	__u32 count = TEST_POLL_NUM;
+	handle_t h_inst, h_sess;
+	int ret;
+
+	h_inst = wd_comp_instance_create(TEST_ALG, SCHED_POLICY_RR, TASK_INSTR, NULL);
+	if (!h_inst) {
+		printf("fail to create instance!\n");
+		return -WD_EINVAL;
+	}
+
+	setup_sess(&setup);
+	h_sess = wd_comp_instance_alloc_sess(h_inst, &setup);
+	if (!h_sess) {
+		printf("fail to alloc instance session!\n");
+		ret = -WD_ENOMEM;
+		goto out_destroy;
+	}
+
+	/* The requests of the two settings go one after the other */
+	ret = do_comp("instance", h_sess);
+	if (!ret)
+		ret = do_comp("default", h_default);
+	if (ret)
+		goto out_free;
+
+	ret = wd_comp_instance_poll(h_inst, TEST_POLL_NUM, &count);
+	if (ret || count) {
+		printf("instance poll ret %d, %u requests polled\n", ret, count);
+		ret = ret ? ret : -WD_EINVAL;
+	}
+
+out_free:
+	wd_comp_free_sess(h_sess);
+out_destroy:
+	wd_comp_instance_destroy(h_inst);
+	return ret;
+}
+
+static int test_default_and_inst(void)
+{
+	struct wd_comp_sess_setup setup;
+	handle_t h_sess;
+	int ret;
+
+	ret = wd_comp_init2(TEST_ALG, SCHED_POLICY_RR, TASK_INSTR);
+	if (ret) {
+		printf("no soft comp driver, skip!\n");
+		return 0;
+	}
+
+	setup_sess(&setup);
+	h_sess = wd_comp_alloc_sess(&setup);
+	if (!h_sess) {
+		printf("fail to alloc default session!\n");
+		ret = -WD_ENOMEM;
+		goto out_uninit;
+	}
+
+	ret = test_inst(h_sess);
+	if (ret)
+		goto out_free;
+
+	/* The destroyed instance must not take the resources of the default */
+	ret = do_comp("default after destroy", h_sess);
+	if (ret)
+		goto out_free;
+
+	ret = test_inst(h_sess);
+	if (!ret)
+		printf("comp instance beside the default setting pass\n");
+
+out_free:
+	wd_comp_free_sess(h_sess);
+out_uninit:
+	wd_comp_uninit2();
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("wd_comp_inst_test: run a comp instance beside the default setting\n");
+	printf("    --help: show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, index = 0;
+
+	static struct option long_options[] = {
+		{"help",	no_argument,		0, 0},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		print_help();
+		return 0;
+	}
+
+	fill_src();
+
+	return test_default_and_inst();
+}
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test the parallel path of wd_do_comp_sync2 with the soft comp driver:
+ * WD_COMP_PARALLEL_NUM splits a large request into chunks, which are joined
+ * into one stream, and the tail is rebuilt by wd_adler32_combine or
+ * wd_crc32_combine. The output is inflated by zlib, and the tail is checked
+ * against the checksum of the whole input. The test is skipped if the soft
+ * comp driver is not found.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "wd_comp.h"
+#include "wd_sched.h"
+
+#define TEST_PAR_NUM		"4"
+#define TEST_OUT_MARGIN		4096
+#define ZLIB_TAIL_SIZE		4
+#define GZIP_TAIL_SIZE		8
+
+struct par_alg {
+	char *name;
+	enum wd_comp_alg_type type;
+	/* The window bits of inflateInit2 */
+	int wbits;
+};
+
+static const struct par_alg algs[] = {
+	{ "zlib", WD_ZLIB, 15 },
+	{ "gzip", WD_GZIP, 31 },
+	{ "deflate", WD_DEFLATE, -15 },
+};
+
+static const __u32 sizes[] = {
+	128 * 1024 + 1,
+	1024 * 1024,
+	3 * 1024 * 1024,
+};
+
+/* Half of the data repeats, so that both the match and literal paths run */
+static void fill_src(__u8 *src, __u32 len)
+{
+	__u32 i;
+
+	for (i = 0; i < len; i++)
+		src[i] = (i % 251) < 120 ? 'a' + (i * 7 % 13) : rand();
+}
+
+static __u32 get_be32(const __u8 *buf)
+{
+	return ((__u32)buf[0] << 24) | ((__u32)buf[1] << 16) |
+	       ((__u32)buf[2] << 8) | buf[3];
+}
+
+static __u32 get_le32(const __u8 *buf)
+{
+	return ((__u32)buf[3] << 24) | ((__u32)buf[2] << 16) |
+	       ((__u32)buf[1] << 8) | buf[0];
+}
+
+static int check_tail(const struct par_alg *alg, const __u8 *src, __u32 len,
+		      const __u8 *out, __u32 out_len)
+{
+	__u32 expect;
+
+	if (alg->type == WD_ZLIB) {
+		expect = adler32(1, src, len);
+		if (get_be32(out + out_len - ZLIB_TAIL_SIZE) != expect) {
+			printf("%s: wrong adler32 of %u bytes\n", alg->name, len);
+			return -WD_EINVAL;
+		}
+	} else if (alg->type == WD_GZIP) {
+		expect = crc32(0, src, len);
+		if (get_le32(out + out_len - GZIP_TAIL_SIZE) != expect ||
+		    get_le32(out + out_len - GZIP_TAIL_SIZE / 2) != len) {
+			printf("%s: wrong crc32 or isize of %u bytes\n",
+			       alg->name, len);
+			return -WD_EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int check_inflate(const struct par_alg *alg, const __u8 *src, __u32 len,
+			 __u8 *out, __u32 out_len)
+{
+	z_stream zs = {0};
+	__u8 *back;
+	int ret;
+
+	back = malloc(len);
+	if (!back)
+		return -WD_ENOMEM;
+
+	ret = inflateInit2(&zs, alg->wbits);
+	if (ret != Z_OK) {
+		free(back);
+		return -WD_EINVAL;
+	}
+
+	zs.next_in = out;
+	zs.avail_in = out_len;
+	zs.next_out = back;
+	zs.avail_out = len;
+	ret = inflate(&zs, Z_FINISH);
+	if (ret != Z_STREAM_END || zs.avail_in || zs.total_out != len ||
+	    memcmp(src, back, len)) {
+		printf("%s: inflate of %u bytes failed, ret %d, %lu bytes out\n",
+		       alg->name, len, ret, zs.total_out);
+		ret = -WD_EINVAL;
+	} else {
+		ret = 0;
+	}
+
+	inflateEnd(&zs);
+	free(back);
+	return ret;
+}
+
+static int test_size(const struct par_alg *alg, handle_t h_sess, __u32 len)
+{
+	struct wd_comp_req req = {0};
+	__u32 out_len = len + len / 8 + TEST_OUT_MARGIN;
+	__u8 *src, *out;
+	int ret;
+
+	src = malloc(len);
+	out = malloc(out_len);
+	if (!src || !out) {
+		ret = -WD_ENOMEM;
+		goto out_free;
+	}
+
+	fill_src(src, len);
+	req.op_type = WD_DIR_COMPRESS;
+	req.src = src;
+	req.src_len = len;
+	req.dst = out;
+	req.dst_len = out_len;
+	req.data_fmt = WD_FLAT_BUF;
+	ret = wd_do_comp_sync2(h_sess, &req);
+	if (ret || req.status) {
+		printf("%s: comp of %u bytes failed, ret %d, status %u\n",
+		       alg->name, len, ret, req.status);
+		ret = ret ? ret : -WD_EINVAL;
+		goto out_free;
+	}
+
+	ret = check_tail(alg, src, len, out, req.dst_len);
+	if (ret)
+		goto out_free;
+
+	ret = check_inflate(alg, src, len, out, req.dst_len);
+
+out_free:
+	free(out);
+	free(src);
+	return ret;
+}
+
+static int test_alg(const struct par_alg *alg)
+{
+	struct wd_comp_sess_setup setup = {0};
+	handle_t h_sess;
+	int ret;
+	int i;
+
+	ret = wd_comp_init2(alg->name, SCHED_POLICY_RR, TASK_INSTR);
+	if (ret) {
+		printf("%s: no soft comp driver, skip!\n", alg->name);
+		return 0;
+	}
+
+	setup.alg_type = alg->type;
+	setup.op_type = WD_DIR_COMPRESS;
+	setup.comp_lv = WD_COMP_L8;
+	setup.win_sz = WD_COMP_WS_32K;
+	h_sess = wd_comp_alloc_sess(&setup);
+	if (!h_sess) {
+		printf("%s: fail to alloc session!\n", alg->name);
+		ret = -WD_ENOMEM;
+		goto out_uninit;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		ret = test_size(alg, h_sess, sizes[i]);
+		if (ret)
+			goto out_free;
+	}
+
+	printf("%s: parallel comp pass\n", alg->name);
+
+out_free:
+	wd_comp_free_sess(h_sess);
+out_uninit:
+	wd_comp_uninit2();
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("wd_comp_par_test: check the parallel comp and the joined checksums\n");
+	printf("    --alg <name>: only test zlib, gzip or deflate\n");
+	printf("    --help: show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name = NULL;
+	int opt, index = 0;
+	int ret = 0;
+	int i;
+
+	static struct option long_options[] = {
+		{"alg",		required_argument,	0, 0},
+		{"help",	no_argument,		0, 1},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		switch (opt) {
+		case 0:
+			name = optarg;
+			break;
+		default:
+			print_help();
+			return 0;
+		}
+	}
+
+	/* The parallel num is read by the init of wd_comp */
+	setenv("WD_COMP_PARALLEL_NUM", TEST_PAR_NUM, 1);
+
+	for (i = 0; i < ARRAY_SIZE(algs); i++) {
+		if (name && strcmp(name, algs[i].name))
+			continue;
+
+		ret = test_alg(&algs[i]);
+		if (ret)
+			break;
+	}
+
+	return ret;
+}
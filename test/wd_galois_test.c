@@ -0,0 +1,527 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test GHASH of lib/crypto/galois, AES of lib/crypto/aes and SM4 of
+ * lib/crypto/sm4:
+ * 1. kat: the GCM test cases of NIST SP 800-38D, the ciphertext, GHASH and
+ *    the tag are checked for each kernel supported by the CPU, and random
+ *    data is checked with the bit-serial multiplication of the spec. AES is
+ *    checked with the examples of FIPS-197 too, both ways. SM4 is checked
+ *    with the examples of GB/T 32907-2016.
+ * 2. bench: the hash speed of each GHASH kernel, compared with the
+ *    bit-serial multiplication, the AES-CTR speed of each AES kernel and
+ *    the SM4-ECB speed.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wd_alg_common.h"
+#include "crypto/aes.h"
+#include "crypto/galois.h"
+#include "crypto/sm4.h"
+
+#define TEST_BENCH_LEN		16384
+#define TEST_BENCH_TIMES	2000
+#define TEST_RAND_TIMES		1000
+#define TEST_MAX_DATA		64
+#define TEST_SM4_TIMES		1000000
+#define NSEC_PER_SEC		1000000000ULL
+
+struct gcm_case {
+	const char *key;
+	const char *iv;
+	const char *aad;
+	const char *pt;
+	const char *ct;
+	const char *ghash;
+	const char *tag;
+};
+
+/* The test cases 1 ~ 4 and 14 of the GCM spec, used by SP 800-38D */
+static const struct gcm_case gcm_cases[] = {
+	{
+		.key = "00000000000000000000000000000000",
+		.iv = "000000000000000000000000",
+		.aad = "",
+		.pt = "",
+		.ct = "",
+		.ghash = "00000000000000000000000000000000",
+		.tag = "58e2fccefa7e3061367f1d57a4e7455a",
+	}, {
+		.key = "00000000000000000000000000000000",
+		.iv = "000000000000000000000000",
+		.aad = "",
+		.pt = "00000000000000000000000000000000",
+		.ct = "0388dace60b6a392f328c2b971b2fe78",
+		.ghash = "f38cbb1ad69223dcc3457ae5b6b0f885",
+		.tag = "ab6e47d42cec13bdf53a67b21257bddf",
+	}, {
+		.key = "feffe9928665731c6d6a8f9467308308",
+		.iv = "cafebabefacedbaddecaf888",
+		.aad = "",
+		.pt = "d9313225f88406e5a55909c5aff5269a"
+		      "86a7a9531534f7da2e4c303d8a318a72"
+		      "1c3c0c95956809532fcf0e2449a6b525"
+		      "b16aedf5aa0de657ba637b391aafd255",
+		.ct = "42831ec2217774244b7221b784d0d49c"
+		      "e3aa212f2c02a4e035c17e2329aca12e"
+		      "21d514b25466931c7d8f6a5aac84aa05"
+		      "1ba30b396a0aac973d58e091473f5985",
+		.ghash = "7f1b32b81b820d02614f8895ac1d4eac",
+		.tag = "4d5c2af327cd64a62cf35abd2ba6fab4",
+	}, {
+		.key = "feffe9928665731c6d6a8f9467308308",
+		.iv = "cafebabefacedbaddecaf888",
+		.aad = "feedfacedeadbeeffeedfacedeadbeef"
+		       "abaddad2",
+		.pt = "d9313225f88406e5a55909c5aff5269a"
+		      "86a7a9531534f7da2e4c303d8a318a72"
+		      "1c3c0c95956809532fcf0e2449a6b525"
+		      "b16aedf5aa0de657ba637b39",
+		.ct = "42831ec2217774244b7221b784d0d49c"
+		      "e3aa212f2c02a4e035c17e2329aca12e"
+		      "21d514b25466931c7d8f6a5aac84aa05"
+		      "1ba30b396a0aac973d58e091",
+		.ghash = "698e57f70e6ecc7fd9463b7260a9ae5f",
+		.tag = "5bc94fbc3221a5db94fae95ae7121a47",
+	}, {
+		.key = "00000000000000000000000000000000"
+		       "00000000000000000000000000000000",
+		.iv = "000000000000000000000000",
+		.aad = "",
+		.pt = "00000000000000000000000000000000",
+		.ct = "cea7403d4d606b6e074ec5d3baf39d18",
+		.ghash = "83de425c5edc5d498f382c441041ca92",
+		.tag = "d0d1c8a799996bf0265b98b5d48ab919",
+	},
+};
+
+/* The examples of FIPS-197 appendix C, the plaintext is 00112233...ff */
+static const struct aes_case {
+	const char *key;
+	const char *ct;
+} aes_cases[] = {
+	{
+		.key = "000102030405060708090a0b0c0d0e0f",
+		.ct = "69c4e0d86a7b0430d8cdb78070b4c55a",
+	}, {
+		.key = "000102030405060708090a0b0c0d0e0f1011121314151617",
+		.ct = "dda97ca4864cdfe06eaf70a0ec0d7191",
+	}, {
+		.key = "000102030405060708090a0b0c0d0e0f"
+		       "101112131415161718191a1b1c1d1e1f",
+		.ct = "8ea2b7ca516745bfeafc49904b496089",
+	},
+};
+
+/* The examples of GB/T 32907-2016 appendix A, once and 1000000 times */
+static const struct sm4_case {
+	const char *key;
+	const char *ct;
+	__u32 times;
+} sm4_cases[] = {
+	{
+		.key = "0123456789abcdeffedcba9876543210",
+		.ct = "681edf34d206965e86b3e94f536e4246",
+		.times = 1,
+	}, {
+		.key = "0123456789abcdeffedcba9876543210",
+		.ct = "595298c7c6fd271f0402f804c33d3f66",
+		.times = TEST_SM4_TIMES,
+	},
+};
+
+static const char *galois_name[GALOIS_KERNEL_MAX] = {
+	"4-bit table", "carry-less",
+};
+
+static const char *aes_name[AES_KERNEL_MAX] = {
+	"soft", "instr",
+};
+
+static __u64 get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static __u32 hex_to_bin(const char *hex, __u8 *bin)
+{
+	__u32 len = strlen(hex) / 2;
+	unsigned int v;
+	__u32 i;
+
+	for (i = 0; i < len; i++) {
+		sscanf(hex + i * 2, "%2x", &v);
+		bin[i] = v;
+	}
+
+	return len;
+}
+
+/* Algorithm 1 of SP 800-38D, one bit of y each time */
+static void ref_mult(__u8 *y, const __u8 *h)
+{
+	__u8 z[GALOIS_BLOCK_SIZE] = {0};
+	__u8 v[GALOIS_BLOCK_SIZE];
+	__u8 lsb;
+	int i, j;
+
+	memcpy(v, h, GALOIS_BLOCK_SIZE);
+	for (i = 0; i < GALOIS_BLOCK_SIZE * 8; i++) {
+		if (y[i / 8] & (0x80 >> (i % 8))) {
+			for (j = 0; j < GALOIS_BLOCK_SIZE; j++)
+				z[j] ^= v[j];
+		}
+
+		lsb = v[GALOIS_BLOCK_SIZE - 1] & 0x1;
+		for (j = GALOIS_BLOCK_SIZE - 1; j > 0; j--)
+			v[j] = (v[j] >> 1) | (v[j - 1] << 7);
+		v[0] >>= 1;
+		if (lsb)
+			v[0] ^= 0xe1;
+	}
+
+	memcpy(y, z, GALOIS_BLOCK_SIZE);
+}
+
+static void ref_ghash(const __u8 *h, __u8 *y, const __u8 *in, __u32 len)
+{
+	__u32 i, block;
+
+	while (len) {
+		block = len < GALOIS_BLOCK_SIZE ? len : GALOIS_BLOCK_SIZE;
+		for (i = 0; i < block; i++)
+			y[i] ^= in[i];
+		ref_mult(y, h);
+		in += block;
+		len -= block;
+	}
+}
+
+static int test_kat_case(const struct gcm_case *c, enum galois_kernel gk,
+			 enum aes_kernel ak)
+{
+	__u8 key[AES_KEYSIZE_256], j0[GALOIS_BLOCK_SIZE] = {0};
+	__u8 aad[TEST_MAX_DATA], pt[TEST_MAX_DATA], ct[TEST_MAX_DATA];
+	__u8 h[GALOIS_BLOCK_SIZE] = {0}, ek[GALOIS_BLOCK_SIZE];
+	__u8 y[GALOIS_BLOCK_SIZE] = {0}, lens[GALOIS_BLOCK_SIZE] = {0};
+	__u8 ghash[GALOIS_BLOCK_SIZE], tag[GALOIS_BLOCK_SIZE];
+	__u8 ctr[AES_BLOCK_SIZE], out[TEST_MAX_DATA];
+	__u32 key_len, aad_len, ct_len, i;
+	struct galois_key gkey;
+	struct aes_key akey;
+
+	key_len = hex_to_bin(c->key, key);
+	aad_len = hex_to_bin(c->aad, aad);
+	hex_to_bin(c->pt, pt);
+	ct_len = hex_to_bin(c->ct, ct);
+	hex_to_bin(c->ghash, ghash);
+	hex_to_bin(c->tag, tag);
+
+	if (aes_set_key_kernel(&akey, key, key_len, ak))
+		return 0;
+	aes_encrypt_block(&akey, h, h);
+	if (galois_set_key_kernel(&gkey, h, gk))
+		return 0;
+
+	/* The data is encrypted from the counter 2, 1 is for the tag */
+	hex_to_bin(c->iv, j0);
+	j0[GALOIS_BLOCK_SIZE - 1] = 1;
+	memcpy(ctr, j0, AES_BLOCK_SIZE);
+	ctr[AES_BLOCK_SIZE - 1] = 2;
+	aes_ctr_encrypt(&akey, ctr, pt, out, ct_len);
+	if (memcmp(out, ct, ct_len)) {
+		printf("kat: %s AES-CTR of key %s is wrong!\n", aes_name[ak], c->key);
+		return 1;
+	}
+
+	/* The AAD and the ciphertext are padded to blocks separately */
+	galois_ghash(&gkey, y, aad, aad_len);
+	galois_ghash(&gkey, y, ct, ct_len);
+	for (i = 0; i < sizeof(__u64); i++) {
+		lens[7 - i] = ((__u64)aad_len * 8) >> (i * 8);
+		lens[15 - i] = ((__u64)ct_len * 8) >> (i * 8);
+	}
+	galois_ghash(&gkey, y, lens, GALOIS_BLOCK_SIZE);
+	if (memcmp(y, ghash, GALOIS_BLOCK_SIZE)) {
+		printf("kat: %s GHASH of key %s is wrong!\n", galois_name[gk], c->key);
+		return 1;
+	}
+
+	aes_encrypt_block(&akey, j0, ek);
+	for (i = 0; i < GALOIS_BLOCK_SIZE; i++)
+		y[i] ^= ek[i];
+	if (memcmp(y, tag, GALOIS_BLOCK_SIZE)) {
+		printf("kat: tag of key %s is wrong!\n", c->key);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_aes_case(const struct aes_case *c, enum aes_kernel ak)
+{
+	__u8 key[AES_KEYSIZE_256], pt[AES_BLOCK_SIZE], ct[AES_BLOCK_SIZE];
+	__u8 out[AES_BLOCK_SIZE];
+	struct aes_key akey;
+	__u32 key_len, i;
+
+	key_len = hex_to_bin(c->key, key);
+	hex_to_bin(c->ct, ct);
+	for (i = 0; i < AES_BLOCK_SIZE; i++)
+		pt[i] = i * 0x11;
+
+	if (aes_set_key_kernel(&akey, key, key_len, ak))
+		return 0;
+
+	aes_encrypt_block(&akey, pt, out);
+	if (memcmp(out, ct, AES_BLOCK_SIZE)) {
+		printf("kat: %s AES of key %s is wrong!\n", aes_name[ak], c->key);
+		return 1;
+	}
+
+	if (aes_set_decrypt_key_kernel(&akey, key, key_len, ak))
+		return 1;
+
+	aes_ecb_decrypt(&akey, ct, out, 1);
+	if (memcmp(out, pt, AES_BLOCK_SIZE)) {
+		printf("kat: %s AES decryption of key %s is wrong!\n", aes_name[ak], c->key);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_sm4_case(const struct sm4_case *c)
+{
+	__u8 key[SM4_KEY_BYTES], ct[SM4_BLOCK_BYTES], out[SM4_BLOCK_BYTES];
+	struct sm4_key skey;
+	__u32 i;
+
+	hex_to_bin(c->key, key);
+	hex_to_bin(c->ct, ct);
+
+	/* The plaintext is the key */
+	sm4_set_key(&skey, key);
+	memcpy(out, key, SM4_BLOCK_BYTES);
+	for (i = 0; i < c->times; i++)
+		sm4_ecb_crypt(&skey, out, out, 1);
+	if (memcmp(out, ct, SM4_BLOCK_BYTES)) {
+		printf("kat: SM4 of %u times is wrong!\n", c->times);
+		return 1;
+	}
+
+	sm4_set_dec_key(&skey, key);
+	for (i = 0; i < c->times; i++)
+		sm4_ecb_crypt(&skey, out, out, 1);
+	if (memcmp(out, key, SM4_BLOCK_BYTES)) {
+		printf("kat: SM4 decryption of %u times is wrong!\n", c->times);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_random(enum galois_kernel kernel)
+{
+	__u8 data[TEST_MAX_DATA], h[GALOIS_BLOCK_SIZE];
+	__u8 y[GALOIS_BLOCK_SIZE], ref[GALOIS_BLOCK_SIZE];
+	struct galois_key gkey;
+	unsigned int seed = 1;
+	__u32 i, n, len;
+
+	for (n = 0; n < TEST_RAND_TIMES; n++) {
+		for (i = 0; i < GALOIS_BLOCK_SIZE; i++) {
+			h[i] = rand_r(&seed);
+			y[i] = ref[i] = rand_r(&seed);
+		}
+		for (i = 0; i < TEST_MAX_DATA; i++)
+			data[i] = rand_r(&seed);
+
+		if (galois_set_key_kernel(&gkey, h, kernel))
+			return 0;
+
+		len = rand_r(&seed) % (TEST_MAX_DATA + 1);
+		galois_ghash(&gkey, y, data, len);
+		ref_ghash(h, ref, data, len);
+		if (memcmp(y, ref, GALOIS_BLOCK_SIZE)) {
+			printf("kat: %s GHASH of %u random bytes is wrong!\n",
+			       galois_name[kernel], len);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Each GHASH kernel is paired with the AES kernel of the same index */
+static int test_kat(void)
+{
+	__u8 h[AES_KEYSIZE_256] = {0};
+	struct galois_key gkey;
+	struct aes_key akey;
+	int ret = 0;
+	__u32 i, k;
+
+	for (k = 0; k < GALOIS_KERNEL_MAX; k++) {
+		if (galois_set_key_kernel(&gkey, h, k) ||
+		    aes_set_key_kernel(&akey, h, AES_KEYSIZE_128, k)) {
+			printf("kat: %s GHASH or %s AES is not supported, skipped\n",
+			       galois_name[k], aes_name[k]);
+			continue;
+		}
+
+		for (i = 0; i < sizeof(aes_cases) / sizeof(aes_cases[0]); i++)
+			ret |= test_aes_case(&aes_cases[i], k);
+		for (i = 0; i < sizeof(gcm_cases) / sizeof(gcm_cases[0]); i++)
+			ret |= test_kat_case(&gcm_cases[i], k, k);
+		ret |= test_random(k);
+
+		printf("kat: %s GHASH, %s AES, %s\n", galois_name[k], aes_name[k],
+		       ret ? "failed" : "passed");
+	}
+
+	for (i = 0; i < sizeof(sm4_cases) / sizeof(sm4_cases[0]); i++)
+		ret |= test_sm4_case(&sm4_cases[i]);
+	printf("kat: SM4, %s\n", ret ? "failed" : "passed");
+
+	return ret;
+}
+
+static void test_bench(__u32 len, __u32 times)
+{
+	__u8 h[GALOIS_BLOCK_SIZE], y[GALOIS_BLOCK_SIZE] = {0};
+	__u8 ctr[AES_BLOCK_SIZE] = {0};
+	struct galois_key gkey;
+	struct aes_key akey;
+	struct sm4_key skey;
+	__u64 start, cost;
+	__u8 *data;
+	__u32 i, k;
+
+	data = calloc(1, len);
+	if (!data) {
+		printf("failed to alloc bench data!\n");
+		return;
+	}
+
+	for (i = 0; i < GALOIS_BLOCK_SIZE; i++)
+		h[i] = i * 0x11;
+
+	for (k = 0; k < GALOIS_KERNEL_MAX; k++) {
+		if (galois_set_key_kernel(&gkey, h, k))
+			continue;
+
+		start = get_ns();
+		for (i = 0; i < times; i++)
+			galois_ghash(&gkey, y, data, len);
+		cost = get_ns() - start;
+		printf("bench: GHASH %-12s %8.1f MB/s\n", galois_name[k],
+		       (double)len * times * 1000 / (cost ? cost : 1));
+	}
+
+	/* The bit-serial one is much slower, a few rounds are enough */
+	start = get_ns();
+	for (i = 0; i < (times + 99) / 100; i++)
+		ref_ghash(h, y, data, len);
+	cost = get_ns() - start;
+	printf("bench: GHASH %-12s %8.1f MB/s\n", "bit-serial",
+	       (double)len * i * 1000 / (cost ? cost : 1));
+
+	for (k = 0; k < AES_KERNEL_MAX; k++) {
+		if (aes_set_key_kernel(&akey, h, AES_KEYSIZE_128, k))
+			continue;
+
+		start = get_ns();
+		for (i = 0; i < times; i++)
+			aes_ctr_encrypt(&akey, ctr, data, data, len);
+		cost = get_ns() - start;
+		printf("bench: AES-128-CTR %-6s %8.1f MB/s\n", aes_name[k],
+		       (double)len * times * 1000 / (cost ? cost : 1));
+	}
+
+	sm4_set_key(&skey, h);
+	start = get_ns();
+	for (i = 0; i < times; i++)
+		sm4_ecb_crypt(&skey, data, data, len / SM4_BLOCK_BYTES);
+	cost = get_ns() - start;
+	printf("bench: SM4-ECB %-10s %8.1f MB/s\n", "soft",
+	       (double)(len / SM4_BLOCK_BYTES * SM4_BLOCK_BYTES) * times * 1000 /
+	       (cost ? cost : 1));
+
+	free(data);
+}
+
+static void print_help(void)
+{
+	printf("wd_galois_test [--kat] [--bench] [options]\n");
+	printf("	--kat		check the known answers and random data\n");
+	printf("	--bench		compare the speed of the GHASH, AES and SM4 kernels\n");
+	printf("	--len		bytes of each bench hash, default 16384\n");
+	printf("	--times		hash times of bench, default 2000\n");
+	printf("	--help		show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	__u32 times = TEST_BENCH_TIMES;
+	__u32 len = TEST_BENCH_LEN;
+	bool kat = false, bench = false;
+	int opt, index = 0;
+	int ret = 0;
+
+	static struct option long_options[] = {
+		{"kat",		no_argument,		0, 0},
+		{"bench",	no_argument,		0, 1},
+		{"len",		required_argument,	0, 2},
+		{"times",	required_argument,	0, 3},
+		{"help",	no_argument,		0, 4},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		switch (opt) {
+		case 0:
+			kat = true;
+			break;
+		case 1:
+			bench = true;
+			break;
+		case 2:
+			len = strtoul(optarg, NULL, 0);
+			break;
+		case 3:
+			times = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help();
+			return 0;
+		}
+	}
+
+	if (!len || !times) {
+		printf("invalid: len and times > 0!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!kat && !bench)
+		kat = bench = true;
+
+	if (kat)
+		ret = test_kat();
+
+	if (bench && !ret)
+		test_bench(len, times);
+
+	return ret;
+}
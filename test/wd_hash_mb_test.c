@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test the SHA-1/SHA-2 algs of the hash_mb driver through wd_digest:
+ * the examples of FIPS 180-2 are hashed in sync mode, then a batch of
+ * them is sent in async mode and the digests are checked in the callbacks
+ * while polling. The SHA algs don't need SVE, the test is only skipped
+ * if the hash_mb driver is not found.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wd_digest.h"
+#include "wd_sched.h"
+
+#define TEST_ASYNC_NUM		64
+#define TEST_POLL_TIMES		1000000
+#define TEST_MAX_DIGEST		64
+
+struct hash_case {
+	const char *msg;
+	const char *digest;
+};
+
+struct hash_alg {
+	char *name;
+	enum wd_digest_type type;
+	__u32 digest_bytes;
+	const struct hash_case cases[2];
+};
+
+struct async_tag {
+	const struct hash_alg *alg;
+	const struct hash_case *hcase;
+	__u8 out[TEST_MAX_DIGEST];
+	__u32 *done;
+	__u32 *fails;
+};
+
+#define MSG_ABC		"abc"
+#define MSG_448		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+#define MSG_896		"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn" \
+			"hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"
+
+static const struct hash_alg algs[] = {
+	{ "sha1", WD_DIGEST_SHA1, 20, {
+		{ MSG_ABC, "a9993e364706816aba3e25717850c26c9cd0d89d" },
+		{ MSG_448, "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+	} },
+	{ "sha224", WD_DIGEST_SHA224, 28, {
+		{ MSG_ABC, "23097d223405d8228642a477bda255b3"
+			   "2aadbce4bda0b3f7e36c9da7" },
+		{ MSG_448, "75388b16512776cc5dba5da1fd890150"
+			   "b0c6455cb4f58b1952522525" },
+	} },
+	{ "sha256", WD_DIGEST_SHA256, 32, {
+		{ MSG_ABC, "ba7816bf8f01cfea414140de5dae2223"
+			   "b00361a396177a9cb410ff61f20015ad" },
+		{ MSG_448, "248d6a61d20638b8e5c026930c3e6039"
+			   "a33ce45964ff2167f6ecedd419db06c1" },
+	} },
+	{ "sha384", WD_DIGEST_SHA384, 48, {
+		{ MSG_ABC, "cb00753f45a35e8bb5a03d699ac65007"
+			   "272c32ab0eded1631a8b605a43ff5bed"
+			   "8086072ba1e7cc2358baeca134c825a7" },
+		{ MSG_896, "09330c33f71147e83d192fc782cd1b47"
+			   "53111b173b3b05d22fa08086e3b0f712"
+			   "fcc7c71a557e2db966c3e9fa91746039" },
+	} },
+	{ "sha512", WD_DIGEST_SHA512, 64, {
+		{ MSG_ABC, "ddaf35a193617abacc417349ae204131"
+			   "12e6fa4e89a97ea20a9eeee64b55d39a"
+			   "2192992a274fc1a836ba3c23a3feebbd"
+			   "454d4423643ce80e2a9ac94fa54ca49f" },
+		{ MSG_896, "8e959b75dae313da8cf4f72814fc143f"
+			   "8f7779c6eb9f7fa17299aeadb6889018"
+			   "501d289e4900f7e4331b99dec4b5433a"
+			   "c7d329eeb6dd26545e96e55b874be909" },
+	} },
+};
+
+static void hex_to_bin(const char *hex, __u8 *bin, __u32 len)
+{
+	unsigned int byte;
+	__u32 i;
+
+	for (i = 0; i < len; i++) {
+		sscanf(hex + i * 2, "%2x", &byte);
+		bin[i] = byte;
+	}
+}
+
+static int check_digest(const struct hash_alg *alg,
+			const struct hash_case *hcase, const __u8 *out)
+{
+	__u8 expect[TEST_MAX_DIGEST];
+
+	hex_to_bin(hcase->digest, expect, alg->digest_bytes);
+	if (memcmp(out, expect, alg->digest_bytes)) {
+		printf("%s: wrong digest of \"%s\"\n", alg->name, hcase->msg);
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+static void fill_req(struct wd_digest_req *req, const struct hash_alg *alg,
+		     const struct hash_case *hcase, __u8 *out)
+{
+	memset(req, 0, sizeof(*req));
+	req->in = (void *)hcase->msg;
+	req->in_bytes = strlen(hcase->msg);
+	req->out = out;
+	req->out_bytes = alg->digest_bytes;
+	req->out_buf_bytes = TEST_MAX_DIGEST;
+	req->data_fmt = WD_FLAT_BUF;
+}
+
+static int test_sync(handle_t h_sess, const struct hash_alg *alg)
+{
+	__u8 out[TEST_MAX_DIGEST];
+	struct wd_digest_req req;
+	int ret;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(alg->cases); i++) {
+		fill_req(&req, alg, &alg->cases[i], out);
+		ret = wd_do_digest_sync(h_sess, &req);
+		if (ret || req.state) {
+			printf("%s: sync digest failed, ret %d, state %u\n",
+			       alg->name, ret, req.state);
+			return -WD_EINVAL;
+		}
+
+		ret = check_digest(alg, &alg->cases[i], out);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void *async_cb(void *param)
+{
+	struct wd_digest_req *req = param;
+	struct async_tag *tag = req->cb_param;
+
+	if (req->state || check_digest(tag->alg, tag->hcase, tag->out))
+		(*tag->fails)++;
+	(*tag->done)++;
+
+	return NULL;
+}
+
+static int test_async(handle_t h_sess, const struct hash_alg *alg)
+{
+	static struct wd_digest_req reqs[TEST_ASYNC_NUM];
+	static struct async_tag tags[TEST_ASYNC_NUM];
+	__u32 done = 0, fails = 0;
+	__u32 count, i;
+	int ret;
+
+	for (i = 0; i < TEST_ASYNC_NUM; i++) {
+		tags[i].alg = alg;
+		tags[i].hcase = &alg->cases[i % ARRAY_SIZE(alg->cases)];
+		tags[i].done = &done;
+		tags[i].fails = &fails;
+		memset(tags[i].out, 0, sizeof(tags[i].out));
+		fill_req(&reqs[i], alg, tags[i].hcase, tags[i].out);
+		reqs[i].cb = async_cb;
+		reqs[i].cb_param = &tags[i];
+		ret = wd_do_digest_async(h_sess, &reqs[i]);
+		if (ret) {
+			printf("%s: async send %u failed, ret %d\n",
+			       alg->name, i, ret);
+			return ret;
+		}
+	}
+
+	for (i = 0; i < TEST_POLL_TIMES && done < TEST_ASYNC_NUM; i++) {
+		count = 0;
+		ret = wd_digest_poll(TEST_ASYNC_NUM - done, &count);
+		if (ret && ret != -WD_EAGAIN) {
+			printf("%s: async poll failed, ret %d\n", alg->name, ret);
+			return ret;
+		}
+	}
+
+	if (done != TEST_ASYNC_NUM || fails) {
+		printf("%s: async got %u of %d, %u wrong\n",
+		       alg->name, done, TEST_ASYNC_NUM, fails);
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_alg(const struct hash_alg *alg)
+{
+	struct wd_digest_sess_setup setup = {0};
+	handle_t h_sess;
+	int ret;
+
+	ret = wd_digest_init2(alg->name, SCHED_POLICY_NONE, TASK_INSTR);
+	if (ret) {
+		printf("%s: no hash_mb driver, skip!\n", alg->name);
+		return 0;
+	}
+
+	setup.alg = alg->type;
+	setup.mode = WD_DIGEST_NORMAL;
+	h_sess = wd_digest_alloc_sess(&setup);
+	if (!h_sess) {
+		printf("%s: fail to alloc session!\n", alg->name);
+		ret = -WD_ENOMEM;
+		goto out_uninit;
+	}
+
+	ret = test_sync(h_sess, alg);
+	if (ret)
+		goto out_free;
+
+	ret = test_async(h_sess, alg);
+	if (ret)
+		goto out_free;
+
+	printf("%s: sync and async pass\n", alg->name);
+
+out_free:
+	wd_digest_free_sess(h_sess);
+out_uninit:
+	wd_digest_uninit2();
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("wd_hash_mb_test: check the SHA algs of hash_mb in sync and async mode\n");
+	printf("    --alg <name>: only test sha1, sha224, sha256, sha384 or sha512\n");
+	printf("    --help: show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name = NULL;
+	int opt, index = 0;
+	int ret = 0;
+	int i;
+
+	static struct option long_options[] = {
+		{"alg",		required_argument,	0, 0},
+		{"help",	no_argument,		0, 1},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		switch (opt) {
+		case 0:
+			name = optarg;
+			break;
+		default:
+			print_help();
+			return 0;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(algs); i++) {
+		if (name && strcmp(name, algs[i].name))
+			continue;
+
+		ret = test_alg(&algs[i]);
+		if (ret)
+			break;
+	}
+
+	return ret;
+}
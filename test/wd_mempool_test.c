@@ -120,8 +120,10 @@ static void show_help(void)
 			"			 allocating and freeing memory, these values\n"
 			"			 are for this purpose\n"
 			" --perf <mode>	 0 for mempool, 1 for block pool, 2 for sec's alg perf\n"
+			"			 3 for block pool contention of multi threads\n"
 			" --multi <num>  pthread num\n"
 			" --times <num>  if perf is 2, this is times for sec's alg in every pthread\n"
+			"			 if perf is 3, this is alloc times in every pthread\n"
 			" --ctxnum <num> ctx num\n"
 			"			 in blkpool\n"
 			" --path	     file's path\n"
@@ -417,6 +419,117 @@ static int test_mempool(struct test_option *opt)
 	return 0;
 }
 
+#define BLK_CONTEND_HOLD_NUM	8
+
+/* Each thread holds a few blocks as requests in flight, then frees them */
+static void *blk_contend_thread(void *data)
+{
+	struct test_opt_per_thread *opt = data;
+	char *blks[BLK_CONTEND_HOLD_NUM];
+	long long int i;
+	int j, num;
+
+	for (i = 0; i < g_times; i += num) {
+		num = i % BLK_CONTEND_HOLD_NUM + 1;
+		for (j = 0; j < num; j++) {
+			blks[j] = wd_block_alloc(opt->bp);
+			if (!blks[j]) {
+				opt->flag = 1;
+				break;
+			}
+			*blks[j] = (char)j;
+		}
+
+		num = j ? j : 1;
+		while (j--)
+			wd_block_free(opt->bp, blks[j]);
+	}
+
+	return NULL;
+}
+
+static int test_blkpool_contend(struct test_option *opt)
+{
+	struct wd_blockpool_mag_stats mag_stats = {0};
+	struct wd_blockpool_stats bp_stats = {0};
+	struct wd_mempool_stats mp_stats = {0};
+	struct timeval start_tval, end_tval;
+	unsigned long fail_thread = 0;
+	float time_used, speed;
+	handle_t mp, bp;
+	int i, ret = 0;
+
+	if (g_thread_num > THREADS_NUM) {
+		printf("thread num %u should not be more than %d!\n",
+		       g_thread_num, THREADS_NUM);
+		return -EINVAL;
+	}
+
+	if (!opt->blk_size[0] || !opt->blk_num[0]) {
+		printf("blk_size_array and blk_num_array should be set!\n");
+		return -EINVAL;
+	}
+
+	mp = wd_mempool_create(opt->mp_size, opt->node);
+	if (WD_IS_ERR(mp)) {
+		printf("Fail to create mempool, err(%lld)!\n", WD_HANDLE_ERR(mp));
+		return -1;
+	}
+
+	bp = wd_blockpool_create(mp, opt->blk_size[0], opt->blk_num[0]);
+	if (WD_IS_ERR(bp)) {
+		printf("Fail to create blkpool, err(%lld)!\n", WD_HANDLE_ERR(bp));
+		wd_mempool_destroy(mp);
+		return -1;
+	}
+
+	printf("blkpool contention(thread_num=%u, times=%lld) is testing...\n",
+	       g_thread_num, g_times);
+
+	gettimeofday(&start_tval, NULL);
+	for (i = 0; i < g_thread_num; i++) {
+		thr_data[i].bp = bp;
+		thr_data[i].flag = 0;
+		ret = pthread_create(&system_test_thrds[i], NULL,
+				     blk_contend_thread, &thr_data[i]);
+		if (ret) {
+			printf("Fail to create thread %d!\n", i);
+			break;
+		}
+	}
+
+	while (i--) {
+		pthread_join(system_test_thrds[i], NULL);
+		fail_thread += thr_data[i].flag;
+	}
+	gettimeofday(&end_tval, NULL);
+
+	time_used = (float)((end_tval.tv_sec - start_tval.tv_sec) * 1000000 +
+			    end_tval.tv_usec - start_tval.tv_usec);
+	speed = g_times * g_thread_num / time_used;
+	printf("blkpool contention: %.3f M alloc+free/s, %lu threads got no block\n",
+	       speed, fail_thread);
+
+	wd_mempool_stats(mp, &mp_stats);
+	wd_blockpool_stats(bp, &bp_stats);
+	dump_mp_bp(&mp_stats, &bp_stats);
+	wd_blockpool_mag_stats(bp, &mag_stats);
+	printf("bp mag_hit_num      : %lu\n", mag_stats.mag_hit_num);
+	printf("bp mag_miss_num     : %lu\n", mag_stats.mag_miss_num);
+
+	/* All the blocks are back, in the shared stack or the thread caches */
+	if (bp_stats.free_block_num != bp_stats.block_num) {
+		printf("blkpool lost blocks, %lu of %lu are free!\n",
+		       bp_stats.free_block_num, bp_stats.block_num);
+		ret = -1;
+	}
+
+	wd_blockpool_destroy(bp);
+	wd_mempool_destroy(mp);
+
+	return ret;
+}
+
 static handle_t sva_sched_init(handle_t h_sched_ctx, void *sched_param)
 {
 	return (handle_t)0;
@@ -982,6 +1095,8 @@ int main(int argc, char *argv[])
 		return test_mempool(&opt);
 	else if (opt.perf == 1)
 		return test_blkpool(&opt);
+	else if (opt.perf == 3)
+		return test_blkpool_contend(&opt);
 	else
 		return test_sec_perf(&opt);
 }
@@ -0,0 +1,368 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test the async msg pool of wd_util:
+ * 1. stress: many threads get and put msgs of one pool at the same time,
+ *    every got msg must be owned by only one thread, and a get must not
+ *    be busy while some msgs are free.
+ * 2. bench: the cost of a get/put pair when the pool is partly used,
+ *    compared with the linear scan of the used array.
+ */
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wd_util.h"
+
+#define TEST_MSG_NUM		1024
+#define TEST_MAX_THREAD		64
+#define TEST_MAX_HOLD		16
+#define TEST_STRESS_TIMES	1000000
+#define TEST_BENCH_TIMES	1000000
+#define NSEC_PER_SEC		1000000000ULL
+
+struct test_msg {
+	__u32 owner;
+	__u32 tag;
+};
+
+struct test_thread {
+	pthread_t tid;
+	__u32 id;
+	__u64 times;
+	__u64 busy;
+	__u64 false_busy;
+	int err;
+};
+
+/* The msg pool before the free ring, kept here as the baseline */
+struct scan_pool {
+	void *msgs;
+	int *used;
+	__u32 msg_num;
+	__u32 msg_size;
+	int tail;
+};
+
+static struct wd_async_msg_pool g_pool;
+static __u32 g_msg_num = TEST_MSG_NUM;
+/* Msgs being got or held, a msg is counted until its put is done */
+static __u32 g_held;
+static pthread_barrier_t g_barrier;
+
+static __u64 get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int test_pool_init(__u32 msg_num)
+{
+	struct wd_ctx config = {0};
+	struct wd_ctx_config cfg = {0};
+
+	config.ctx_mode = CTX_MODE_ASYNC;
+	cfg.ctx_num = 1;
+	cfg.ctxs = &config;
+
+	return wd_init_async_request_pool(&g_pool, &cfg, msg_num,
+					  sizeof(struct test_msg));
+}
+
+static void *stress_thread(void *data)
+{
+	struct test_thread *thread = data;
+	struct test_msg *hold[TEST_MAX_HOLD];
+	struct test_msg *msg;
+	__u32 num, held, i;
+	__u64 cnt = 0;
+	int tag;
+
+	pthread_barrier_wait(&g_barrier);
+
+	while (cnt < thread->times) {
+		num = cnt % TEST_MAX_HOLD + 1;
+		for (i = 0; i < num; i++) {
+			held = __atomic_add_fetch(&g_held, 1, __ATOMIC_SEQ_CST);
+			tag = wd_get_msg_from_pool(&g_pool, 0, (void **)&msg);
+			if (tag == -WD_EBUSY) {
+				/* The others hold less than all, so one is free */
+				if (held <= g_msg_num)
+					thread->false_busy++;
+				thread->busy++;
+				__atomic_sub_fetch(&g_held, 1, __ATOMIC_SEQ_CST);
+				break;
+			} else if (tag < 0 || (__u32)tag > g_msg_num) {
+				printf("thread %u got invalid tag %d!\n", thread->id, tag);
+				thread->err = 1;
+				return NULL;
+			}
+
+			/* Nobody else may own the msg until it is put back */
+			if (__atomic_exchange_n(&msg->owner, thread->id, __ATOMIC_RELAXED)) {
+				printf("msg %d is got by two threads!\n", tag);
+				thread->err = 1;
+				return NULL;
+			}
+			msg->tag = tag;
+			hold[i] = msg;
+		}
+
+		num = i;
+		for (i = 0; i < num; i++) {
+			msg = hold[i];
+			if (__atomic_load_n(&msg->owner, __ATOMIC_RELAXED) != thread->id) {
+				printf("msg %u is changed by another thread!\n", msg->tag);
+				thread->err = 1;
+				return NULL;
+			}
+			__atomic_store_n(&msg->owner, 0, __ATOMIC_RELAXED);
+			wd_put_msg_to_pool(&g_pool, 0, msg->tag);
+			__atomic_sub_fetch(&g_held, 1, __ATOMIC_SEQ_CST);
+		}
+		cnt += num ? num : 1;
+	}
+
+	return NULL;
+}
+
+static int test_stress(__u32 thread_num, __u64 times)
+{
+	struct test_thread threads[TEST_MAX_THREAD] = {0};
+	__u64 start, busy = 0, false_busy = 0;
+	struct test_msg *msg;
+	int ret = 0;
+	__u32 i;
+
+	ret = test_pool_init(g_msg_num);
+	if (ret) {
+		printf("failed to init msg pool, ret = %d!\n", ret);
+		return ret;
+	}
+
+	pthread_barrier_init(&g_barrier, NULL, thread_num);
+	start = get_ns();
+	for (i = 0; i < thread_num; i++) {
+		threads[i].id = i + 1;
+		threads[i].times = times;
+		ret = pthread_create(&threads[i].tid, NULL, stress_thread, &threads[i]);
+		if (ret) {
+			printf("failed to create thread %u!\n", i);
+			/* The barrier would never open without all threads */
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < thread_num; i++) {
+		pthread_join(threads[i].tid, NULL);
+		busy += threads[i].busy;
+		false_busy += threads[i].false_busy;
+		ret |= threads[i].err;
+	}
+
+	if (false_busy) {
+		printf("msg pool is busy %llu times with free msgs!\n", false_busy);
+		ret = 1;
+	}
+	pthread_barrier_destroy(&g_barrier);
+
+	/* All the msgs are free again */
+	for (i = 0; !ret && i < g_msg_num; i++) {
+		if (wd_get_msg_from_pool(&g_pool, 0, (void **)&msg) < 0) {
+			printf("msg pool lost msgs, only %u are free!\n", i);
+			ret = 1;
+		}
+	}
+	if (!ret && wd_get_msg_from_pool(&g_pool, 0, (void **)&msg) != -WD_EBUSY) {
+		printf("msg pool has more msgs than %u!\n", g_msg_num);
+		ret = 1;
+	}
+
+	printf("stress: %u threads x %llu msgs, busy %llu, %llu ms, %s\n",
+	       thread_num, times, busy, (get_ns() - start) / 1000000,
+	       ret ? "failed" : "passed");
+
+	wd_uninit_async_request_pool(&g_pool);
+
+	return ret;
+}
+
+static int scan_pool_init(struct scan_pool *p, __u32 msg_num)
+{
+	p->msgs = calloc(msg_num, sizeof(struct test_msg));
+	p->used = calloc(msg_num, sizeof(int));
+	if (!p->msgs || !p->used) {
+		free(p->msgs);
+		free(p->used);
+		return -WD_ENOMEM;
+	}
+
+	p->msg_num = msg_num;
+	p->msg_size = sizeof(struct test_msg);
+	p->tail = 0;
+
+	return 0;
+}
+
+static int scan_pool_get(struct scan_pool *p, void **msg)
+{
+	__u32 idx = p->tail;
+	__u32 cnt = 0;
+
+	while (__atomic_test_and_set(&p->used[idx], __ATOMIC_ACQUIRE)) {
+		idx = (idx + 1) % p->msg_num;
+		cnt++;
+		if (cnt == p->msg_num)
+			return -WD_EBUSY;
+	}
+
+	p->tail = (idx + 1) % p->msg_num;
+	*msg = (void *)((uintptr_t)p->msgs + p->msg_size * idx);
+
+	return idx + 1;
+}
+
+static void scan_pool_put(struct scan_pool *p, __u32 tag)
+{
+	__atomic_clear(&p->used[tag - 1], __ATOMIC_RELEASE);
+}
+
+/*
+ * Keep 'used' msgs in the pool, then put a random one and get one for many
+ * times. Responses of the async path come back out of order, so the free
+ * msgs are spread over the pool.
+ */
+static int test_bench(__u32 used, __u64 times)
+{
+	__u32 hold[TEST_MSG_NUM];
+	__u64 start, ring_ns, scan_ns;
+	struct scan_pool sp;
+	__u32 i, seed;
+	void *msg;
+	__u64 n;
+
+	if (test_pool_init(g_msg_num) || scan_pool_init(&sp, g_msg_num)) {
+		printf("failed to init msg pools!\n");
+		return -WD_ENOMEM;
+	}
+
+	/* The put msg is got again at once, so at least one is held */
+	if (!used)
+		used = 1;
+
+	for (i = 0; i < used; i++)
+		hold[i] = wd_get_msg_from_pool(&g_pool, 0, &msg);
+
+	seed = 1;
+	start = get_ns();
+	for (n = 0; n < times; n++) {
+		i = rand_r(&seed) % used;
+		wd_put_msg_to_pool(&g_pool, 0, hold[i]);
+		hold[i] = wd_get_msg_from_pool(&g_pool, 0, &msg);
+	}
+	ring_ns = get_ns() - start;
+
+	for (i = 0; i < used; i++)
+		hold[i] = scan_pool_get(&sp, &msg);
+
+	seed = 1;
+	start = get_ns();
+	for (n = 0; n < times; n++) {
+		i = rand_r(&seed) % used;
+		scan_pool_put(&sp, hold[i]);
+		hold[i] = scan_pool_get(&sp, &msg);
+	}
+	scan_ns = get_ns() - start;
+
+	printf("bench: %4u/%u used, free ring %6.1f ns/op, used scan %6.1f ns/op\n",
+	       used, g_msg_num, (double)ring_ns / times, (double)scan_ns / times);
+
+	wd_uninit_async_request_pool(&g_pool);
+	free(sp.msgs);
+	free(sp.used);
+
+	return 0;
+}
+
+static void print_help(void)
+{
+	printf("wd_msg_pool_test [--stress] [--bench] [options]\n");
+	printf("	--stress	get and put msgs from many threads\n");
+	printf("	--bench		compare the free ring with the used scan\n");
+	printf("	--threads	thread number of stress, default 8\n");
+	printf("	--times		msgs of each stress thread or bench loop\n");
+	printf("	--msgs		msg number of the pool, default 1024\n");
+	printf("	--help		show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	static const __u32 used_pct[] = {0, 50, 90, 100};
+	__u64 stress_times = TEST_STRESS_TIMES;
+	__u64 bench_times = TEST_BENCH_TIMES;
+	bool stress = false, bench = false;
+	__u32 thread_num = 8;
+	int opt, index = 0;
+	int ret = 0;
+	__u32 i;
+
+	static struct option long_options[] = {
+		{"stress",	no_argument,		0, 0},
+		{"bench",	no_argument,		0, 1},
+		{"threads",	required_argument,	0, 2},
+		{"times",	required_argument,	0, 3},
+		{"msgs",	required_argument,	0, 4},
+		{"help",	no_argument,		0, 5},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		switch (opt) {
+		case 0:
+			stress = true;
+			break;
+		case 1:
+			bench = true;
+			break;
+		case 2:
+			thread_num = strtoul(optarg, NULL, 0);
+			break;
+		case 3:
+			stress_times = bench_times = strtoull(optarg, NULL, 0);
+			break;
+		case 4:
+			g_msg_num = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help();
+			return 0;
+		}
+	}
+
+	if (!thread_num || thread_num > TEST_MAX_THREAD ||
+	    !g_msg_num || g_msg_num > TEST_MSG_NUM || !stress_times) {
+		printf("invalid: threads 1 ~ %d, msgs 1 ~ %d, times > 0!\n",
+		       TEST_MAX_THREAD, TEST_MSG_NUM);
+		return -WD_EINVAL;
+	}
+
+	if (!stress && !bench)
+		stress = bench = true;
+
+	if (stress)
+		ret = test_stress(thread_num, stress_times);
+
+	for (i = 0; bench && !ret && i < sizeof(used_pct) / sizeof(used_pct[0]); i++)
+		ret = test_bench(g_msg_num * used_pct[i] / 100, bench_times);
+
+	return ret;
+}
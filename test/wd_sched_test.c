@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test the RR scheduler of wd_sched: many threads init and free session
+ * keys at the same time, like the sessions of short TLS connections.
+ * The rate of session alloc/free is shown for 1 ~ max threads, and the
+ * ctxs picked by the sessions must be balanced.
+ */
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wd_sched.h"
+
+#define TEST_MAX_THREAD		128
+#define TEST_MAX_CTX		64
+#define TEST_TIMES		100000
+#define NSEC_PER_SEC		1000000000ULL
+
+struct test_thread {
+	pthread_t tid;
+	__u64 times;
+	__u64 picked[TEST_MAX_CTX];
+	int err;
+};
+
+static struct wd_sched *g_sched;
+static __u32 g_ctx_num = 16;
+static pthread_barrier_t g_barrier;
+
+static __u64 get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int test_poll(__u32 pos, __u32 expect, __u32 *count)
+{
+	return 0;
+}
+
+static int test_sched_init(void)
+{
+	struct sched_params param = {0};
+	int ret;
+
+	g_sched = wd_sched_rr_alloc(SCHED_POLICY_RR, 1, 1, test_poll);
+	if (!g_sched) {
+		printf("failed to alloc RR scheduler!\n");
+		return -WD_ENOMEM;
+	}
+
+	param.mode = CTX_MODE_SYNC;
+	param.begin = 0;
+	param.end = g_ctx_num - 1;
+	ret = wd_sched_rr_instance(g_sched, &param);
+	if (ret)
+		goto out;
+
+	param.mode = CTX_MODE_ASYNC;
+	param.begin = g_ctx_num;
+	param.end = g_ctx_num * 2 - 1;
+	ret = wd_sched_rr_instance(g_sched, &param);
+	if (ret)
+		goto out;
+
+	return 0;
+
+out:
+	printf("failed to instance RR scheduler, ret = %d!\n", ret);
+	wd_sched_rr_release(g_sched);
+	return ret;
+}
+
+static void *sess_thread(void *data)
+{
+	struct test_thread *thread = data;
+	struct sched_params param = {0};
+	handle_t h_sched_ctx = g_sched->h_sched_ctx;
+	handle_t key;
+	__u32 pos;
+	__u64 i;
+
+	pthread_barrier_wait(&g_barrier);
+
+	for (i = 0; i < thread->times; i++) {
+		/* As wd_<alg>_alloc_sess and wd_<alg>_free_sess do */
+		key = g_sched->sched_init(h_sched_ctx, &param);
+		if (WD_IS_ERR(key)) {
+			thread->err = 1;
+			return NULL;
+		}
+
+		pos = g_sched->pick_next_ctx(h_sched_ctx, (void *)key, CTX_MODE_SYNC);
+		if (pos >= g_ctx_num) {
+			printf("got invalid sync ctx %u!\n", pos);
+			thread->err = 1;
+			free((void *)key);
+			return NULL;
+		}
+		thread->picked[pos]++;
+		free((void *)key);
+	}
+
+	return NULL;
+}
+
+static int test_sess_rate(struct test_thread *threads, __u32 thread_num, __u64 times)
+{
+	__u64 picked[TEST_MAX_CTX] = {0};
+	__u64 start, cost, min, max;
+	int ret = 0;
+	__u32 i, j;
+
+	pthread_barrier_init(&g_barrier, NULL, thread_num + 1);
+	for (i = 0; i < thread_num; i++) {
+		memset(&threads[i], 0, sizeof(threads[i]));
+		threads[i].times = times;
+		ret = pthread_create(&threads[i].tid, NULL, sess_thread, &threads[i]);
+		if (ret) {
+			printf("failed to create thread %u!\n", i);
+			/* The barrier would never open without all threads */
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&g_barrier);
+	start = get_ns();
+	for (i = 0; i < thread_num; i++) {
+		pthread_join(threads[i].tid, NULL);
+		ret |= threads[i].err;
+		for (j = 0; j < g_ctx_num; j++)
+			picked[j] += threads[i].picked[j];
+	}
+	cost = get_ns() - start;
+	pthread_barrier_destroy(&g_barrier);
+
+	min = max = picked[0];
+	for (j = 1; j < g_ctx_num; j++) {
+		min = picked[j] < min ? picked[j] : min;
+		max = picked[j] > max ? picked[j] : max;
+	}
+
+	/* The shared cursor hands out the ctxs in turn, whoever asks */
+	if (max - min > 1)
+		ret = 1;
+
+	printf("%3u threads: %8.3f M sess/s, ctx %llu ~ %llu, %s\n", thread_num,
+	       (double)thread_num * times * 1000 / (cost ? cost : 1),
+	       min, max, ret ? "failed" : "passed");
+
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("wd_sched_test [options]\n");
+	printf("	--threads	max thread number, default 128\n");
+	printf("	--times		sessions of each thread, default 100000\n");
+	printf("	--ctxs		sync ctx number of the region, default 16\n");
+	printf("	--help		show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	static struct test_thread threads[TEST_MAX_THREAD];
+	__u32 max_thread = TEST_MAX_THREAD;
+	__u64 times = TEST_TIMES;
+	int opt, index = 0;
+	__u32 thread_num;
+	int ret = 0;
+
+	static struct option long_options[] = {
+		{"threads",	required_argument,	0, 0},
+		{"times",	required_argument,	0, 1},
+		{"ctxs",	required_argument,	0, 2},
+		{"help",	no_argument,		0, 3},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		switch (opt) {
+		case 0:
+			max_thread = strtoul(optarg, NULL, 0);
+			break;
+		case 1:
+			times = strtoull(optarg, NULL, 0);
+			break;
+		case 2:
+			g_ctx_num = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help();
+			return 0;
+		}
+	}
+
+	if (!max_thread || max_thread > TEST_MAX_THREAD ||
+	    !g_ctx_num || g_ctx_num > TEST_MAX_CTX || !times) {
+		printf("invalid: threads 1 ~ %d, ctxs 1 ~ %d, times > 0!\n",
+		       TEST_MAX_THREAD, TEST_MAX_CTX);
+		return -WD_EINVAL;
+	}
+
+	for (thread_num = 1; !ret && thread_num <= max_thread; thread_num <<= 1) {
+		ret = test_sched_init();
+		if (ret)
+			return ret;
+
+		ret = test_sess_rate(threads, thread_num, times);
+		wd_sched_rr_release(g_sched);
+	}
+
+	return ret;
+}
@@ -0,0 +1,332 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Test the emulated devices of WD_UACCE_SYSFS_DIR: a class dir with a
+ * hisi_zip and a hisi_sec2 device is built in a temporary directory, the
+ * zip engine compresses a request of several chunks with wd_do_comp_sync2
+ * and decompresses it back, and the sec engine completes a cbc(aes)
+ * request. The zip engine copies the data, and deflate has no header, so
+ * the round trip gives the data back.
+ * The test is skipped if the hisi drivers are not found.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "wd_cipher.h"
+#include "wd_comp.h"
+#include "wd_sched.h"
+
+#define TEST_DIR_LEN		64
+#define TEST_PATH_LEN		256
+#define TEST_COMP_LEN		(300 * 1024)
+#define TEST_CIPHER_LEN		4096
+#define TEST_AES_KEY_LEN	16
+#define TEST_AES_IV_LEN		16
+
+struct emu_attr {
+	const char *name;
+	const char *value;
+};
+
+struct emu_dev {
+	const char *name;
+	const char *algs;
+	const char *engine;
+};
+
+static const struct emu_dev emu_devs[] = {
+	{ "hisi_zip-0", "zlib\ngzip\ndeflate\n", "zip" },
+	{ "hisi_sec2-0", "cipher\ndigest\naead\n", "sec" },
+};
+
+static char class_dir[TEST_DIR_LEN];
+
+static int write_attr(const char *dev, const char *attr, const char *value)
+{
+	char path[TEST_PATH_LEN];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s/%s", class_dir, dev, attr);
+	fp = fopen(path, "w");
+	if (!fp) {
+		printf("fail to create %s!\n", path);
+		return -WD_EINVAL;
+	}
+
+	fputs(value, fp);
+	fclose(fp);
+
+	return 0;
+}
+
+static int build_dev(const struct emu_dev *dev)
+{
+	/* The dus holds 1024 sqes, 1024 cqes and the queue status */
+	const struct emu_attr attrs[] = {
+		{ "flags", "1" },
+		{ "api", "hisi_qm_v2" },
+		{ "algorithms", dev->algs },
+		{ "region_mmio_size", "4096" },
+		{ "region_dus_size", "200704" },
+		{ "available_instances", "16" },
+		{ "isolate", "0" },
+		{ "device/numa_node", "0" },
+		{ "emulate", dev->engine },
+	};
+	char path[TEST_PATH_LEN];
+	int ret;
+	int i;
+
+	snprintf(path, sizeof(path), "%s/%s", class_dir, dev->name);
+	if (mkdir(path, 0755))
+		return -WD_EINVAL;
+
+	snprintf(path, sizeof(path), "%s/%s/device", class_dir, dev->name);
+	if (mkdir(path, 0755))
+		return -WD_EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(attrs); i++) {
+		ret = write_attr(dev->name, attrs[i].name, attrs[i].value);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void remove_class_dir(void)
+{
+	char cmd[TEST_DIR_LEN + 16];
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", class_dir);
+	if (system(cmd))
+		printf("fail to remove %s!\n", class_dir);
+}
+
+static int build_class_dir(void)
+{
+	int ret;
+	int i;
+
+	snprintf(class_dir, sizeof(class_dir), "/tmp/wd_uacce_emu_XXXXXX");
+	if (!mkdtemp(class_dir)) {
+		printf("fail to create the class dir!\n");
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(emu_devs); i++) {
+		ret = build_dev(&emu_devs[i]);
+		if (ret) {
+			printf("fail to build %s!\n", emu_devs[i].name);
+			remove_class_dir();
+			return ret;
+		}
+	}
+
+	return setenv("WD_UACCE_SYSFS_DIR", class_dir, 1);
+}
+
+static handle_t alloc_comp_sess(enum wd_comp_op_type op_type)
+{
+	struct wd_comp_sess_setup setup = {0};
+
+	setup.alg_type = WD_DEFLATE;
+	setup.op_type = op_type;
+	setup.comp_lv = WD_COMP_L8;
+	setup.win_sz = WD_COMP_WS_32K;
+
+	return wd_comp_alloc_sess(&setup);
+}
+
+static int do_comp(enum wd_comp_op_type op_type, void *src, __u32 src_len,
+		   void *dst, __u32 *dst_len)
+{
+	struct wd_comp_req req = {0};
+	handle_t h_sess;
+	int ret;
+
+	h_sess = alloc_comp_sess(op_type);
+	if (!h_sess) {
+		printf("zip: fail to alloc session!\n");
+		return -WD_ENOMEM;
+	}
+
+	req.op_type = op_type;
+	req.src = src;
+	req.src_len = src_len;
+	req.dst = dst;
+	req.dst_len = *dst_len;
+	req.data_fmt = WD_FLAT_BUF;
+	/* Compress in chunks, and decompress the whole stream at once */
+	if (op_type == WD_DIR_COMPRESS)
+		ret = wd_do_comp_sync2(h_sess, &req);
+	else
+		ret = wd_do_comp_sync(h_sess, &req);
+	if (ret || req.status) {
+		printf("zip: op %d failed, ret %d, status %u\n",
+		       op_type, ret, req.status);
+		ret = ret ? ret : -WD_EINVAL;
+	}
+	*dst_len = req.dst_len;
+
+	wd_comp_free_sess(h_sess);
+	return ret;
+}
+
+static int test_zip(void)
+{
+	__u32 comp_len = TEST_COMP_LEN;
+	__u32 decomp_len = TEST_COMP_LEN;
+	__u8 *src, *comp, *decomp;
+	int ret;
+	int i;
+
+	ret = wd_comp_init2("deflate", SCHED_POLICY_RR, TASK_HW);
+	if (ret) {
+		printf("zip: no hisi_zip driver, skip!\n");
+		return 0;
+	}
+
+	ret = -WD_ENOMEM;
+	src = malloc(TEST_COMP_LEN);
+	comp = malloc(comp_len);
+	decomp = malloc(decomp_len);
+	if (!src || !comp || !decomp)
+		goto out;
+
+	for (i = 0; i < TEST_COMP_LEN; i++)
+		src[i] = rand();
+
+	ret = do_comp(WD_DIR_COMPRESS, src, TEST_COMP_LEN, comp, &comp_len);
+	if (ret)
+		goto out;
+
+	if (comp_len != TEST_COMP_LEN) {
+		printf("zip: compressed %u bytes of %d\n", comp_len, TEST_COMP_LEN);
+		ret = -WD_EINVAL;
+		goto out;
+	}
+
+	ret = do_comp(WD_DIR_DECOMPRESS, comp, comp_len, decomp, &decomp_len);
+	if (ret)
+		goto out;
+
+	if (decomp_len != TEST_COMP_LEN || memcmp(src, decomp, decomp_len)) {
+		printf("zip: wrong data after %u bytes are decompressed\n",
+		       decomp_len);
+		ret = -WD_EINVAL;
+		goto out;
+	}
+
+	printf("zip: emulated request pass\n");
+
+out:
+	free(decomp);
+	free(comp);
+	free(src);
+	wd_comp_uninit2();
+	return ret;
+}
+
+static int test_sec(void)
+{
+	__u8 key[TEST_AES_KEY_LEN] = {0};
+	__u8 iv[TEST_AES_IV_LEN] = {0};
+	struct wd_cipher_sess_setup setup = {0};
+	struct wd_cipher_req req = {0};
+	__u8 *in, *out;
+	handle_t h_sess;
+	int ret;
+
+	ret = wd_cipher_init2("cbc(aes)", SCHED_POLICY_RR, TASK_HW);
+	if (ret) {
+		printf("sec: no hisi_sec2 driver, skip!\n");
+		return 0;
+	}
+
+	ret = -WD_ENOMEM;
+	in = calloc(1, TEST_CIPHER_LEN);
+	out = calloc(1, TEST_CIPHER_LEN);
+	if (!in || !out)
+		goto out;
+
+	setup.alg = WD_CIPHER_AES;
+	setup.mode = WD_CIPHER_CBC;
+	h_sess = wd_cipher_alloc_sess(&setup);
+	if (!h_sess) {
+		printf("sec: fail to alloc session!\n");
+		goto out;
+	}
+
+	ret = wd_cipher_set_key(h_sess, key, sizeof(key));
+	if (ret) {
+		printf("sec: fail to set key!\n");
+		goto out_free;
+	}
+
+	req.op_type = WD_CIPHER_ENCRYPTION;
+	req.src = in;
+	req.in_bytes = TEST_CIPHER_LEN;
+	req.dst = out;
+	req.out_bytes = TEST_CIPHER_LEN;
+	req.out_buf_bytes = TEST_CIPHER_LEN;
+	req.iv = iv;
+	req.iv_bytes = sizeof(iv);
+	req.data_fmt = WD_FLAT_BUF;
+	ret = wd_do_cipher_sync(h_sess, &req);
+	if (ret || req.state) {
+		printf("sec: request failed, ret %d, state %d\n", ret, req.state);
+		ret = ret ? ret : -WD_EINVAL;
+		goto out_free;
+	}
+
+	printf("sec: emulated request pass\n");
+
+out_free:
+	wd_cipher_free_sess(h_sess);
+out:
+	free(out);
+	free(in);
+	wd_cipher_uninit2();
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("wd_uacce_emu_test: run zip and sec requests on emulated devices\n");
+	printf("    --help: show this help\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, index = 0;
+	int ret;
+
+	static struct option long_options[] = {
+		{"help",	no_argument,		0, 0},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "", long_options, &index)) != -1) {
+		print_help();
+		return 0;
+	}
+
+	ret = build_class_dir();
+	if (ret)
+		return ret;
+
+	ret = test_zip();
+	if (!ret)
+		ret = test_sec();
+
+	remove_class_dir();
+	return ret;
+}
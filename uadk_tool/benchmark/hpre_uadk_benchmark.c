@@ -1400,12 +1400,14 @@ static void *rsa_uadk_sync_run(void *arg)
 	}
 
 	do {
+		acc_req_start();
 		ret = wd_do_rsa_sync(h_sess, &req);
 		if (ret || req.status) {
 			HPRE_TST_PRT("failed to do rsa task, status: %d\n", req.status);
 			goto dst_release;
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -1537,6 +1539,7 @@ static void *rsa_uadk_async_run(void *arg)
 		tag[i].sess = h_sess;
 		req.cb_param = &tag[i];
 
+		acc_req_start();
 		ret = wd_do_rsa_async(h_sess, &req);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1809,6 +1812,7 @@ static void *dh_uadk_async_run(void *arg)
 		tag[i].sess = h_sess;
 		req.cb_param = &tag[i];
 
+		acc_req_start();
 		ret = wd_do_dh_async(h_sess, &req);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1887,12 +1891,14 @@ static void *dh_uadk_sync_run(void *arg)
 	}
 
 	do {
+		acc_req_start();
 		ret = wd_do_dh_sync(h_sess, &req);
 		if (ret || req.status) {
 			HPRE_TST_PRT("failed to do dh task, status: %d\n", req.status);
 			goto param_release;
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -2363,12 +2369,14 @@ static void *ecc_uadk_sync_run(void *arg)
 	}
 
 	do {
+		acc_req_start();
 		ret = wd_do_ecc_sync(h_sess, &req);
 		if (ret || req.status) {
 			HPRE_TST_PRT("failed to do ecc task, status: %d\n", req.status);
 			goto src_release;
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -2537,6 +2545,7 @@ static void *ecc_uadk_async_run(void *arg)
 		tag[i].sess = h_sess;
 		req.cb_param = &tag[i];
 
+		acc_req_start();
 		ret = wd_do_ecc_async(h_sess, &req);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -893,12 +893,14 @@ static void *rsa_wd_sync_run(void *arg)
 	}
 
 	do {
+		acc_req_start();
 		ret = wcrypto_do_rsa(ctx, &opdata, tag);
 		if (ret || opdata.status) {
 			HPRE_TST_PRT("failed to do rsa task, status: %d\n", opdata.status);
 			goto out_release;
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -1043,6 +1045,7 @@ static void *rsa_wd_async_run(void *arg)
 		tag[i].cnt = i;
 		tag[i].optype = opdata.op_type;
 
+		acc_req_start();
 		ret = wcrypto_do_rsa(ctx, &opdata, &tag[i]);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1306,12 +1309,14 @@ static void *dh_wd_sync_run(void *arg)
 	}
 
 	do {
+		acc_req_start();
 		ret = wcrypto_do_dh(ctx, &opdata, tag);
 		if (ret || opdata.status) {
 			HPRE_TST_PRT("failed to do dh task, status: %d\n", opdata.status);
 			goto param_release;
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -1398,6 +1403,7 @@ static void *dh_wd_async_run(void *arg)
 		tag[i].cnt = i;
 		tag[i].optype = opdata.op_type;
 
+		acc_req_start();
 		ret = wcrypto_do_dh(ctx, &opdata, &tag[i]);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -2207,12 +2213,14 @@ static void *ecc_wd_sync_run(void *arg)
 	}
 
 	do {
+		acc_req_start();
 		ret = wcrypto_do_ecc(ctx, &opdata, tag);
 		if (ret || opdata.status) {
 			HPRE_TST_PRT("failed to do ecc task, status: %d\n", opdata.status);
 			goto src_release;
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -2381,6 +2389,7 @@ static void *ecc_wd_async_run(void *arg)
 		tag[i].cnt = i;
 		tag[i].optype = opdata.op_type;
 
+		acc_req_start();
 		ret = wcrypto_do_ecc(ctx, &opdata, &tag[i]);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
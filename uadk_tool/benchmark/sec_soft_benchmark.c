@@ -858,6 +858,7 @@ static void *sec_soft_cipher_sync(void *arg)
 		src = soft_pool->bds[i].src;
 		dst = soft_pool->bds[i].dst;
 
+		acc_req_start();
 		if (optype) {
 			ret = EVP_DecryptInit_ex(ctx, evp_cipher, pdata->engine, priv_key, priv_iv);
 			if (ret != 1)
@@ -882,6 +883,7 @@ static void *sec_soft_cipher_sync(void *arg)
 			EVP_EncryptFinal_ex(ctx, dst, &outl);
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -939,6 +941,7 @@ static void *sec_soft_aead_sync(void *arg)
 			src = soft_pool->bds[i].src;
 			dst = soft_pool->bds[i].dst;
 
+			acc_req_start();
 			(void)EVP_CipherInit_ex(ctx, evp_cipher, pdata->engine, priv_key, priv_iv, optype);
 
 			if (optype) {
@@ -960,6 +963,7 @@ static void *sec_soft_aead_sync(void *arg)
 			else
 				EVP_EncryptFinal_ex(ctx, dst, &outl);
 
+			acc_req_done();
 			count++;
 			if (get_run_state() == 0)
 				break;
@@ -970,6 +974,7 @@ static void *sec_soft_aead_sync(void *arg)
 			src = soft_pool->bds[i].src;
 			dst = soft_pool->bds[i].dst;
 
+			acc_req_start();
 			(void)EVP_CipherInit_ex(ctx, evp_cipher, pdata->engine, priv_key, priv_iv, optype);
 
 			if (optype) {
@@ -988,6 +993,7 @@ static void *sec_soft_aead_sync(void *arg)
 			if (ret != 1)
 				EVP_CipherInit_ex(ctx, evp_cipher, pdata->engine, priv_key, priv_iv, optype);
 
+			acc_req_done();
 			count++;
 			if (get_run_state() == 0)
 				break;
@@ -1037,10 +1043,12 @@ static void *sec_soft_digest_sync(void *arg)
 			i = count % MAX_POOL_LENTH;
 			src = soft_pool->bds[i].src;
 
+			acc_req_start();
 			EVP_DigestInit_ex(md_ctx, evp_md, pdata->engine);
 			EVP_DigestUpdate(md_ctx, src, g_pktlen);
 			EVP_DigestFinal_ex(md_ctx, mac, &ssl_size);
 
+			acc_req_done();
 			count++;
 			if (get_run_state() == 0)
 				break;
@@ -1055,10 +1063,12 @@ static void *sec_soft_digest_sync(void *arg)
 			i = count % MAX_POOL_LENTH;
 			src = soft_pool->bds[i].src;
 
+			acc_req_start();
 			HMAC_Init_ex(hm_ctx, priv_key, pdata->keysize, evp_md, pdata->engine);
 			HMAC_Update(hm_ctx, src, g_pktlen);
 			HMAC_Final(hm_ctx, mac, &ssl_size);
 
+			acc_req_done();
 			count++;
 			if (get_run_state() == 0)
 				break;
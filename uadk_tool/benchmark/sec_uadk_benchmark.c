@@ -1259,6 +1259,7 @@ static void *sec_uadk_cipher_async(void *arg)
 		creq.src = uadk_pool->bds[i].src;
 		creq.dst = uadk_pool->bds[i].dst;
 
+		acc_req_start();
 		ret = wd_do_cipher_async(h_sess, &creq);
 		if (ret < 0) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1360,6 +1361,7 @@ static void *sec_uadk_aead_async(void *arg)
 		areq.dst = uadk_pool->bds[i].dst;
 		areq.mac = uadk_pool->bds[i].mac;
 
+		acc_req_start();
 		ret = wd_do_aead_async(h_sess, &areq);
 		if (ret < 0) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1430,6 +1432,7 @@ static void *sec_uadk_digest_async(void *arg)
 		dreq.in = uadk_pool->bds[i].src;
 		dreq.out = uadk_pool->bds[i].dst;
 
+		acc_req_start();
 		ret = wd_do_digest_async(h_sess, &dreq);
 		if (ret < 0) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1495,9 +1498,11 @@ static void *sec_uadk_cipher_sync(void *arg)
 		i = count % MAX_POOL_LENTH;
 		creq.src = uadk_pool->bds[i].src;
 		creq.dst = uadk_pool->bds[i].dst;
+		acc_req_start();
 		ret = wd_do_cipher_sync(h_sess, &creq);
 		if ((ret < 0 && ret != -WD_EBUSY) || creq.state)
 			break;
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -1586,7 +1591,9 @@ static void *sec_uadk_aead_sync(void *arg)
 		areq.dst = uadk_pool->bds[i].dst;
 		count++;
 
+		acc_req_start();
 		ret = wd_do_aead_sync(h_sess, &areq);
+		acc_req_done();
 		if (ret || areq.state)
 			break;
 		if (get_run_state() == 0)
@@ -1645,9 +1652,11 @@ static void *sec_uadk_digest_sync(void *arg)
 		i = count % MAX_POOL_LENTH;
 		dreq.in = uadk_pool->bds[i].src;
 		dreq.out = uadk_pool->bds[i].dst;
+		acc_req_start();
 		ret = wd_do_digest_sync(h_sess, &dreq);
 		if (ret || dreq.state)
 			break;
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -907,6 +907,7 @@ static void *sec_wd_cipher_async(void *arg)
 		if (get_run_state() == 0)
 			break;
 
+		acc_req_start();
 		ret = wcrypto_do_cipher(ctx, &copdata, (void *)tag);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1046,6 +1047,7 @@ static void *sec_wd_aead_async(void *arg)
 		if (get_run_state() == 0)
 			break;
 
+		acc_req_start();
 		ret = wcrypto_do_aead(ctx, &aopdata, (void *)tag);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1151,6 +1153,7 @@ static void *sec_wd_digest_async(void *arg)
 		if (get_run_state() == 0)
 			break;
 
+		acc_req_start();
 		ret = wcrypto_do_digest(ctx, &dopdata, (void *)tag);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1251,6 +1254,7 @@ static void *sec_wd_cipher_sync(void *arg)
 		if (get_run_state() == 0)
 			break;
 
+		acc_req_start();
 		ret = wcrypto_do_cipher(ctx, &copdata, tag);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1262,6 +1266,7 @@ static void *sec_wd_cipher_sync(void *arg)
 			continue;
 		}
 
+		acc_req_done();
 		count++;
 		try_cnt = 0;
 		i = count % MAX_POOL_LENTH;
@@ -1376,6 +1381,7 @@ static void *sec_wd_aead_sync(void *arg)
 		if (get_run_state() == 0)
 			break;
 
+		acc_req_start();
 		ret = wcrypto_do_aead(ctx, &aopdata, tag);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1387,6 +1393,7 @@ static void *sec_wd_aead_sync(void *arg)
 			continue;
 		}
 
+		acc_req_done();
 		count++;
 		try_cnt = 0;
 		i = count % MAX_POOL_LENTH;
@@ -1467,6 +1474,7 @@ static void *sec_wd_digest_sync(void *arg)
 		if (get_run_state() == 0)
 			break;
 
+		acc_req_start();
 		ret = wcrypto_do_digest(ctx, &dopdata, (void *)tag);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1478,6 +1486,7 @@ static void *sec_wd_digest_sync(void *arg)
 			continue;
 		}
 
+		acc_req_done();
 		count++;
 		try_cnt = 0;
 		i = count % MAX_POOL_LENTH;
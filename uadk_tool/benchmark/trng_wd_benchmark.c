@@ -124,12 +124,14 @@ static void *trng_wd_sync_run(void *arg)
 	opdata.op_type = WCRYPTO_TRNG_GEN;
 
 	do {
+		acc_req_start();
 		ret = wcrypto_do_rng(ctx, &opdata, NULL);
 		if (ret) {
 			printf("failed to do rng task, ret: %d\n", ret);
 			goto ctx_release;
 		}
 
+		acc_req_done();
 		count++;
 		if (get_run_state() == 0)
 			break;
@@ -137,6 +139,7 @@ static void *trng_wd_sync_run(void *arg)
 
 ctx_release:
 	wcrypto_del_rng_ctx(ctx);
+	cal_avg_latency(count);
 	add_recv_data(count, opdata.in_bytes);
 
 	return NULL;
@@ -233,6 +236,7 @@ static void *wd_trng_async_run(void *arg)
 	tag->ctx = ctx;
 
 	do {
+		acc_req_start();
 		ret = wcrypto_do_rng(ctx, &opdata, tag);
 		if (ret && ret != -WD_EBUSY) {
 			printf("failed to send trng task, ret = %d!\n", ret);
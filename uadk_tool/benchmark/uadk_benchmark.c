@@ -1,11 +1,14 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include "include/wd_alg_common.h"
 #include "include/wd_sched.h"
 
 #include "uadk_benchmark.h"
+#include "uadk_benchmark_report.h"
 #include "sec_uadk_benchmark.h"
 #include "sec_wd_benchmark.h"
 #include "sec_soft_benchmark.h"
@@ -20,6 +23,20 @@
 
 #define TABLE_SPACE_SIZE	8
 
+/*
+ * Log-linear latency histogram in ns: values below LAT_SUB_COUNT have their
+ * own bucket, every power of two above is split into LAT_SUB_COUNT buckets,
+ * so a bucket is within 1/LAT_SUB_COUNT of its values.
+ */
+#define LAT_SUB_BITS		5
+#define LAT_SUB_COUNT		(1 << LAT_SUB_BITS)
+#define LAT_MAX_BITS		40
+#define LAT_MAX_VALUE		((1ULL << LAT_MAX_BITS) - 1)
+#define LAT_BUCKET_NUM		((LAT_MAX_BITS - LAT_SUB_BITS + 1) * LAT_SUB_COUNT)
+#define LAT_PERMILLE		1000
+/* Sleep until this much before the send time and spin the rest, timer wake-up is late */
+#define RATE_SPIN_NS		100000
+
 /*----------------------------------------head struct--------------------------------------------------------*/
 static unsigned int g_run_state = 1;
 static struct acc_option *g_run_options;
@@ -32,6 +49,38 @@ static struct _recv_data {
 	u32 recv_times;
 } g_recv_data;
 
+struct lat_hist {
+	u64 buckets[LAT_BUCKET_NUM];
+	u64 count;
+	u64 sum;
+	u64 max;
+};
+
+static const u32 lat_permille[] = {500, 900, 990, 999};
+
+struct acc_perf {
+	double kib_s;
+	double kops;
+	double cpu_rate;
+};
+
+/* Results of all processes, shared with the child processes */
+struct acc_report {
+	struct acc_perf perf[PROCESS_NUM];
+	struct lat_hist lat;
+};
+
+static struct acc_report *g_report;
+/* Index of the process in g_report->perf */
+static u32 g_proc_idx;
+/* Merged histogram of all threads, in g_report if --latency is set */
+static struct lat_hist *g_lat_hist;
+/* Interval of requests of one thread in ns for --rate, 0 is closed-loop */
+static u64 g_req_interval;
+static __thread struct lat_hist t_lat_hist;
+static __thread u64 t_req_start;
+static __thread u64 t_next_req;
+
 /* SVA mode and NOSVA mode change need re_insmod driver ko */
 enum test_type {
 	SVA_MODE = 0x1,
@@ -320,15 +369,278 @@ void get_rand_data(u8 *addr, u32 size)
 	}
 }
 
+static u64 get_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u64)ts.tv_sec * SEC_2_NSEC + ts.tv_nsec;
+}
+
+static u32 lat_bucket_index(u64 value)
+{
+	u32 exp;
+
+	if (value < LAT_SUB_COUNT)
+		return value;
+
+	if (value > LAT_MAX_VALUE)
+		value = LAT_MAX_VALUE;
+
+	exp = 63 - __builtin_clzll(value);
+
+	return (exp - LAT_SUB_BITS + 1) * LAT_SUB_COUNT +
+	       ((value >> (exp - LAT_SUB_BITS)) & (LAT_SUB_COUNT - 1));
+}
+
+/* The middle value of a bucket */
+static u64 lat_bucket_value(u32 idx)
+{
+	u32 shift;
+
+	if (idx < LAT_SUB_COUNT)
+		return idx;
+
+	shift = idx / LAT_SUB_COUNT - 1;
+
+	return ((u64)(LAT_SUB_COUNT + idx % LAT_SUB_COUNT) << shift) + ((1ULL << shift) >> 1);
+}
+
+static u64 lat_hist_percentile(struct lat_hist *hist, u32 permille)
+{
+	u64 target = (hist->count * permille + LAT_PERMILLE - 1) / LAT_PERMILLE;
+	u64 sum = 0;
+	u32 i;
+
+	for (i = 0; i < LAT_BUCKET_NUM; i++) {
+		sum += hist->buckets[i];
+		if (sum >= target)
+			break;
+	}
+
+	if (i == LAT_BUCKET_NUM || lat_bucket_value(i) > hist->max)
+		return hist->max;
+
+	return lat_bucket_value(i);
+}
+
+static void lat_hist_print(const char *name, struct lat_hist *hist)
+{
+	char buf[256];
+	int len;
+	u32 i;
+
+	len = snprintf(buf, sizeof(buf), "%s latency: count %llu, avg %.1fus",
+		       name, hist->count, (double)hist->sum / hist->count / USEC_2_NSEC);
+	for (i = 0; i < ARRAY_SIZE(lat_permille); i++)
+		len += snprintf(buf + len, sizeof(buf) - len, ", p%g %.1fus",
+				lat_permille[i] / 10.0,
+				(double)lat_hist_percentile(hist, lat_permille[i]) / USEC_2_NSEC);
+	ACC_TST_PRT("%s, max %.1fus\n", buf, (double)hist->max / USEC_2_NSEC);
+}
+
+/* Atomic, as the threads of all processes merge into g_lat_hist at once */
+static void lat_hist_merge(struct lat_hist *dst, struct lat_hist *src)
+{
+	u64 max;
+	u32 i;
+
+	for (i = 0; i < LAT_BUCKET_NUM; i++) {
+		if (src->buckets[i])
+			__atomic_add_fetch(&dst->buckets[i], src->buckets[i], __ATOMIC_RELAXED);
+	}
+
+	__atomic_add_fetch(&dst->count, src->count, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&dst->sum, src->sum, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&dst->max, __ATOMIC_RELAXED);
+	while (src->max > max &&
+	       !__atomic_compare_exchange_n(&dst->max, &max, src->max, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/*
+ * Call before sending a request. With --rate the thread sends on a fixed
+ * schedule, and the latency counts from the scheduled time, so a request
+ * which is late because of a slow one before it is also counted slow.
+ */
+void acc_req_start(void)
+{
+	struct timespec ts;
+	u64 now;
+
+	if (!g_req_interval && !g_lat_hist)
+		return;
+
+	now = get_time_ns();
+	if (!g_req_interval) {
+		t_req_start = now;
+		return;
+	}
+
+	if (!t_next_req)
+		t_next_req = now;
+
+	if (t_next_req > now + RATE_SPIN_NS) {
+		ts.tv_sec = (t_next_req - RATE_SPIN_NS) / SEC_2_NSEC;
+		ts.tv_nsec = (t_next_req - RATE_SPIN_NS) % SEC_2_NSEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+
+	while (get_time_ns() < t_next_req)
+		;
+
+	t_req_start = t_next_req;
+	t_next_req += g_req_interval;
+}
+
+/* Call when a sync request is done */
+void acc_req_done(void)
+{
+	u64 lat;
+
+	if (!g_lat_hist)
+		return;
+
+	lat = get_time_ns() - t_req_start;
+	t_lat_hist.buckets[lat_bucket_index(lat)]++;
+	t_lat_hist.count++;
+	t_lat_hist.sum += lat;
+	if (lat > t_lat_hist.max)
+		t_lat_hist.max = lat;
+}
+
 void cal_avg_latency(u32 count)
 {
 	double latency;
+	char name[64];
 
 	if (!g_run_options || !g_run_options->latency)
 		return;
 
-	latency = (double)g_run_options->times * SEC_2_USEC / count;
-	ACC_TST_PRT("thread<%lu> avg latency: %.1fus\n", gettid(), latency);
+	if (!t_lat_hist.count) {
+		latency = (double)g_run_options->times * SEC_2_USEC / count;
+		ACC_TST_PRT("thread<%lu> avg latency: %.1fus\n", gettid(), latency);
+		return;
+	}
+
+	snprintf(name, sizeof(name), "thread<%lu>", gettid());
+	lat_hist_print(name, &t_lat_hist);
+	lat_hist_merge(g_lat_hist, &t_lat_hist);
+	memset(&t_lat_hist, 0, sizeof(t_lat_hist));
+}
+
+static int report_init(struct acc_option *option)
+{
+	u64 threads = (u64)option->threads * option->multis;
+
+	g_req_interval = option->rate ? threads * SEC_2_NSEC / option->rate : 0;
+	g_proc_idx = 0;
+
+	g_report = mmap(NULL, sizeof(struct acc_report), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (g_report == MAP_FAILED) {
+		ACC_TST_PRT("failed to alloc benchmark report!\n");
+		g_report = NULL;
+		return -ENOMEM;
+	}
+
+	if (option->latency)
+		g_lat_hist = &g_report->lat;
+
+	return 0;
+}
+
+static void report_record_option(struct acc_record *rec, struct acc_option *option)
+{
+	record_add_str(rec, "algname", option->algname);
+	record_add_str(rec, "algclass", option->algclass);
+	record_add_str(rec, "engine", option->engine);
+	record_add_str(rec, "device", option->device);
+	record_add_u64(rec, "algtype", option->algtype);
+	record_add_u64(rec, "modetype", option->modetype);
+	record_add_u64(rec, "optype", option->optype);
+	record_add_u64(rec, "syncmode", option->syncmode);
+	record_add_u64(rec, "pktlen", option->pktlen);
+	record_add_u64(rec, "times", option->times);
+	record_add_u64(rec, "threads", option->threads);
+	record_add_u64(rec, "multis", option->multis);
+	record_add_u64(rec, "ctxnums", option->ctxnums);
+	record_add_u64(rec, "acctype", option->acctype);
+	record_add_u64(rec, "subtype", option->subtype);
+	record_add_u64(rec, "engine_flag", option->engine_flag);
+	record_add_u64(rec, "prefetch", option->prefetch);
+	record_add_u64(rec, "winsize", option->winsize);
+	record_add_u64(rec, "complevel", option->complevel);
+	record_add_u64(rec, "inittype", option->inittype);
+	record_add_u64(rec, "latency", option->latency);
+	record_add_u64(rec, "rate", option->rate);
+	record_add_u64(rec, "sched_type", option->sched_type);
+	record_add_u64(rec, "task_type", option->task_type);
+}
+
+static int report_write(struct acc_option *option, u32 nr_proc)
+{
+	struct lat_hist *hist = &g_report->lat;
+	struct acc_perf total = {0};
+	struct acc_record *rec;
+	u32 i;
+	int ret;
+
+	rec = calloc(1, sizeof(*rec));
+	if (!rec)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_proc; i++) {
+		total.kib_s += g_report->perf[i].kib_s;
+		total.kops += g_report->perf[i].kops;
+		total.cpu_rate += g_report->perf[i].cpu_rate;
+	}
+
+	report_record_option(rec, option);
+	record_add_double(rec, "throughput_mb_s", total.kib_s / 1024);
+	record_add_double(rec, "ops_s", total.kops * 1000);
+	record_add_double(rec, "cpu_rate", total.cpu_rate);
+	record_add_u64(rec, "lat_count", hist->count);
+	record_add_double(rec, "lat_avg_us", hist->count ?
+			  (double)hist->sum / hist->count / USEC_2_NSEC : 0);
+	for (i = 0; i < ARRAY_SIZE(lat_permille); i++) {
+		char key[REC_KEY_LEN];
+
+		/* p50, p90, p99, p999 */
+		snprintf(key, sizeof(key), "lat_p%u_us", lat_permille[i] % 10 ?
+			 lat_permille[i] : lat_permille[i] / 10);
+		record_add_double(rec, key, hist->count ?
+				  (double)lat_hist_percentile(hist, lat_permille[i]) / USEC_2_NSEC : 0);
+	}
+	record_add_double(rec, "lat_max_us", (double)hist->max / USEC_2_NSEC);
+
+	ret = record_write(rec, option->format, option->output);
+	free(rec);
+
+	return ret;
+}
+
+static int report_uninit(struct acc_option *option, u32 nr_proc)
+{
+	int ret = 0;
+
+	if (!g_report)
+		return 0;
+
+	if (g_report->lat.count)
+		lat_hist_print("all threads", &g_report->lat);
+
+	/* No record if the run failed */
+	if (nr_proc && option->format != OUT_FORMAT_TEXT)
+		ret = report_write(option, nr_proc);
+
+	munmap(g_report, sizeof(struct acc_report));
+	g_report = NULL;
+	g_lat_hist = NULL;
+
+	return ret;
 }
 
 void segmentfault_handler(int sig)
@@ -482,6 +794,12 @@ void cal_perfermance_data(struct acc_option *option, u32 sttime)
 	ACC_TST_PRT("algname:\tlength:\t\tperf:\t\tiops:\t\tCPU_rate:\n"
 		    "%s\t%-2uBytes \t%.2f%s\t%.1fKops \t%.2f%%\n",
 		    palgname, option->pktlen, perfermance, unit, ops, cpu_rate);
+
+	if (g_report) {
+		g_report->perf[g_proc_idx].kib_s = perfermance;
+		g_report->perf[g_proc_idx].kops = ops;
+		g_report->perf[g_proc_idx].cpu_rate = cpu_rate;
+	}
 }
 
 static int benchmark_run(struct acc_option *option)
@@ -546,6 +864,9 @@ static void dump_param(struct acc_option *option)
 	ACC_TST_PRT("    [--prefetch]:%u\n", option->prefetch);
 	ACC_TST_PRT("    [--engine]:  %s\n", option->engine);
 	ACC_TST_PRT("    [--latency]: %u\n", option->latency);
+	ACC_TST_PRT("    [--rate]:    %u\n", option->rate);
+	ACC_TST_PRT("    [--format]:  %u\n", option->format);
+	ACC_TST_PRT("    [--output]:  %s\n", option->output);
 	ACC_TST_PRT("    [--init2]:   %u\n", option->inittype);
 	ACC_TST_PRT("    [--device]:  %s\n", option->device);
 }
@@ -564,14 +885,21 @@ int acc_benchmark_run(struct acc_option *option)
 	g_run_options = option;
 
 	pthread_mutex_init(&acc_mutex, NULL);
+	ret = report_init(option);
+	if (ret)
+		return ret;
+
 	if (option->multis <= 1) {
 		ret = benchmark_run(option);
-		return ret;
+		status = report_uninit(option, ret ? 0 : 1);
+		return ret ? ret : status;
 	}
 
 	pids = calloc(option->multis, sizeof(pid_t));
-	if (!pids)
+	if (!pids) {
+		report_uninit(option, 0);
 		return -ENOMEM;
+	}
 
 	for (i = 0; i < option->multis; i++) {
 		pid = fork();
@@ -585,6 +913,7 @@ int acc_benchmark_run(struct acc_option *option)
 		}
 
 		/* Child */
+		g_proc_idx = i;
 		exit(benchmark_run(option));
 	}
 
@@ -611,8 +940,9 @@ int acc_benchmark_run(struct acc_option *option)
 		}
 	}
 	free(pids);
+	status = report_uninit(option, ret ? 0 : nr_children);
 
-	return ret;
+	return ret ? ret : status;
 }
 
 int acc_default_case(struct acc_option *option)
@@ -671,7 +1001,15 @@ static void print_help(void)
 	ACC_TST_PRT("    [--alglist]:\n");
 	ACC_TST_PRT("        list the all support alg\n");
 	ACC_TST_PRT("    [--latency]:\n");
-	ACC_TST_PRT("        test the running time of packets\n");
+	ACC_TST_PRT("        test the running time of packets, report the percentiles of sync mode\n");
+	ACC_TST_PRT("    [--rate]:\n");
+	ACC_TST_PRT("        send the requests of all threads and processes at a fixed rate per second\n");
+	ACC_TST_PRT("    [--format]:\n");
+	ACC_TST_PRT("        text, json or csv, json and csv print one record of the options and results\n");
+	ACC_TST_PRT("    [--output]:\n");
+	ACC_TST_PRT("        append the json or csv record to the file instead of stdout\n");
+	ACC_TST_PRT("    compare <base file> <new file> [--threshold N]:\n");
+	ACC_TST_PRT("        compare two json or csv result files, exit with 1 on a regression\n");
 	ACC_TST_PRT("    [--init2]:\n");
 	ACC_TST_PRT("        select init2 mode in the init interface of UADK SVA\n");
 	ACC_TST_PRT("    [--device]:\n");
@@ -718,6 +1056,9 @@ int acc_cmd_parse(int argc, char *argv[], struct acc_option *option)
 		{"complevel",	required_argument,	0, 16},
 		{"init2",	no_argument,		0, 17},
 		{"device",	required_argument,	0, 18},
+		{"rate",	required_argument,	0, 19},
+		{"format",	required_argument,	0, 20},
+		{"output",	required_argument,	0, 21},
 		{0, 0, 0, 0}
 	};
 
@@ -789,6 +1130,24 @@ int acc_cmd_parse(int argc, char *argv[], struct acc_option *option)
 			}
 			strcpy(option->device, optarg);
 			break;
+		case 19:
+			option->rate = strtol(optarg, NULL, 0);
+			break;
+		case 20:
+			c = get_format_type(optarg);
+			if (c < 0) {
+				ACC_TST_PRT("invalid: format is %s\n", optarg);
+				goto to_exit;
+			}
+			option->format = c;
+			break;
+		case 21:
+			if (strlen(optarg) >= MAX_OUTPUT_PATH) {
+				ACC_TST_PRT("invalid: output file is %s\n", optarg);
+				goto to_exit;
+			}
+			strcpy(option->output, optarg);
+			break;
 		default:
 			ACC_TST_PRT("invalid: bad input parameter!\n");
 			print_help();
@@ -30,12 +30,15 @@
 #define MAX_ALG_NAME		64
 #define ACC_QUEUE_SIZE		1024
 #define MAX_DEVICE_NAME		64
+#define MAX_OUTPUT_PATH		256
 
 #define MAX_BLOCK_NM		16384 /* BLOCK_NUM must 4 times of POOL_LENTH */
 #define MAX_POOL_LENTH		4096
 #define MAX_TRY_CNT		5000
 #define SEND_USLEEP		100
 #define SEC_2_USEC		1000000
+#define SEC_2_NSEC		1000000000ULL
+#define USEC_2_NSEC		1000
 #define HASH_ZISE		16
 
 #define SCHED_SINGLE		"sched_single"
@@ -56,6 +59,10 @@ typedef unsigned char u8;
  * @optype: enc/dec, comp/decomp
  * @prefetch: write allocated memory to prevent page faults
  * @latency: test packet running time
+ * @rate: offered load of all threads and processes in requests per second,
+ *	  0 means sending as fast as possible
+ * @format: text, or a json/csv record of the options and results
+ * @output: file the record is appended to, stdout if empty
  */
 struct acc_option {
 	char algname[MAX_ALG_NAME];
@@ -79,8 +86,11 @@ struct acc_option {
 	u32 complevel;
 	u32 inittype;
 	bool latency;
+	u32 rate;
 	u32 sched_type;
 	int task_type;
+	u32 format;
+	char output[MAX_OUTPUT_PATH];
 };
 
 enum acc_type {
@@ -111,6 +121,13 @@ enum alg_type {
 	CIPHER_INSTR_TYPE,
 };
 
+enum acc_out_format {
+	OUT_FORMAT_TEXT,
+	OUT_FORMAT_JSON,
+	OUT_FORMAT_CSV,
+	OUT_FORMAT_MAX,
+};
+
 enum sync_type {
 	SYNC_MODE,
 	ASYNC_MODE,
@@ -218,6 +235,8 @@ extern void add_recv_data(u32 cnt, u32 pkglen);
 extern void add_send_complete(void);
 extern u32 get_recv_time(void);
 extern void cal_avg_latency(u32 count);
+extern void acc_req_start(void);
+extern void acc_req_done(void);
 extern int get_alg_name(int alg, char *alg_name);
 extern void segmentfault_handler(int sig);
 
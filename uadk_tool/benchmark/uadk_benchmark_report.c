@@ -0,0 +1,524 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <float.h>
+#include "uadk_benchmark_report.h"
+
+#define REC_LINE_LEN		4096
+#define REC_ID_LEN		1024
+#define DEFAULT_THRESHOLD	5.0
+#define PERCENT			100.0
+
+enum metric_dir {
+	/* Reported, not compared */
+	METRIC_INFO,
+	METRIC_HIGHER_BETTER,
+	METRIC_LOWER_BETTER,
+};
+
+struct rec_metric {
+	const char *key;
+	u32 dir;
+};
+
+/* The fields of a record after the option fields */
+static const struct rec_metric rec_metrics[] = {
+	{"throughput_mb_s",	METRIC_HIGHER_BETTER},
+	{"ops_s",		METRIC_HIGHER_BETTER},
+	{"cpu_rate",		METRIC_LOWER_BETTER},
+	{"lat_count",		METRIC_INFO},
+	{"lat_avg_us",		METRIC_LOWER_BETTER},
+	{"lat_p50_us",		METRIC_LOWER_BETTER},
+	{"lat_p90_us",		METRIC_LOWER_BETTER},
+	{"lat_p99_us",		METRIC_LOWER_BETTER},
+	{"lat_p999_us",		METRIC_LOWER_BETTER},
+	{"lat_max_us",		METRIC_LOWER_BETTER},
+};
+
+/* Option fields that don't tell which workload a record is */
+static const char *rec_ignored_ids[] = {"times"};
+
+static const char *format_names[] = {
+	[OUT_FORMAT_TEXT] = "text",
+	[OUT_FORMAT_JSON] = "json",
+	[OUT_FORMAT_CSV] = "csv",
+};
+
+int get_format_type(const char *name)
+{
+	int i;
+
+	for (i = 0; i < OUT_FORMAT_MAX; i++) {
+		if (!strcmp(name, format_names[i]))
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+static void record_add(struct acc_record *rec, const char *key, bool is_str)
+{
+	snprintf(rec->key[rec->num], REC_KEY_LEN, "%s", key);
+	rec->is_str[rec->num] = is_str;
+}
+
+void record_add_str(struct acc_record *rec, const char *key, const char *val)
+{
+	if (rec->num >= REC_MAX_FIELDS)
+		return;
+
+	record_add(rec, key, true);
+	snprintf(rec->val[rec->num++], REC_VAL_LEN, "%s", val);
+}
+
+void record_add_u64(struct acc_record *rec, const char *key, u64 val)
+{
+	if (rec->num >= REC_MAX_FIELDS)
+		return;
+
+	record_add(rec, key, false);
+	snprintf(rec->val[rec->num++], REC_VAL_LEN, "%llu", val);
+}
+
+void record_add_double(struct acc_record *rec, const char *key, double val)
+{
+	if (rec->num >= REC_MAX_FIELDS)
+		return;
+
+	record_add(rec, key, false);
+	snprintf(rec->val[rec->num++], REC_VAL_LEN, "%.2f", val);
+}
+
+static void record_write_json(struct acc_record *rec, FILE *fp)
+{
+	const char *p;
+	u32 i;
+
+	fputc('{', fp);
+	for (i = 0; i < rec->num; i++) {
+		fprintf(fp, "%s\"%s\": ", i ? ", " : "", rec->key[i]);
+		if (!rec->is_str[i]) {
+			fputs(rec->val[i], fp);
+			continue;
+		}
+
+		fputc('"', fp);
+		for (p = rec->val[i]; *p; p++) {
+			if (*p == '"' || *p == '\\')
+				fputc('\\', fp);
+			fputc(*p, fp);
+		}
+		fputc('"', fp);
+	}
+	fputs("}\n", fp);
+}
+
+/* No value has a comma, so the fields are not quoted */
+static void record_write_csv(struct acc_record *rec, FILE *fp, bool header)
+{
+	u32 i;
+
+	if (header) {
+		for (i = 0; i < rec->num; i++)
+			fprintf(fp, "%s%s", i ? "," : "", rec->key[i]);
+		fputc('\n', fp);
+	}
+
+	for (i = 0; i < rec->num; i++)
+		fprintf(fp, "%s%s", i ? "," : "", rec->val[i]);
+	fputc('\n', fp);
+}
+
+int record_write(struct acc_record *rec, u32 format, const char *path)
+{
+	bool header = true;
+	FILE *fp = stdout;
+
+	if (path && strlen(path)) {
+		fp = fopen(path, "a");
+		if (!fp) {
+			ACC_TST_PRT("failed to open result file %s!\n", path);
+			return -errno;
+		}
+		/* Append the rows of CSV under the header of the file */
+		header = !ftell(fp);
+	}
+
+	if (format == OUT_FORMAT_JSON)
+		record_write_json(rec, fp);
+	else if (format == OUT_FORMAT_CSV)
+		record_write_csv(rec, fp, header);
+
+	if (fp != stdout)
+		fclose(fp);
+
+	return 0;
+}
+
+static char *skip_space(char *p)
+{
+	while (isspace((unsigned char)*p))
+		p++;
+
+	return p;
+}
+
+/* Parse a JSON string in place, return the char after the closing quote */
+static char *parse_json_str(char *p, char *out, u32 len)
+{
+	u32 i = 0;
+
+	if (*p++ != '"')
+		return NULL;
+
+	while (*p && *p != '"') {
+		if (*p == '\\' && p[1])
+			p++;
+		if (i + 1 < len)
+			out[i++] = *p;
+		p++;
+	}
+	out[i] = '\0';
+
+	return *p == '"' ? p + 1 : NULL;
+}
+
+/* Only the flat objects of record_write_json are supported */
+static int record_parse_json(char *line, struct acc_record *rec)
+{
+	char *p = skip_space(line);
+	char *end;
+	bool is_str;
+
+	rec->num = 0;
+	if (*p++ != '{')
+		return -EINVAL;
+
+	while (rec->num < REC_MAX_FIELDS) {
+		p = skip_space(p);
+		if (*p == '}')
+			return 0;
+
+		p = parse_json_str(p, rec->key[rec->num], REC_KEY_LEN);
+		if (!p)
+			return -EINVAL;
+
+		p = skip_space(p);
+		if (*p++ != ':')
+			return -EINVAL;
+
+		p = skip_space(p);
+		is_str = *p == '"';
+		if (is_str) {
+			p = parse_json_str(p, rec->val[rec->num], REC_VAL_LEN);
+			if (!p)
+				return -EINVAL;
+		} else {
+			end = p + strcspn(p, ",}");
+			snprintf(rec->val[rec->num], REC_VAL_LEN, "%.*s", (int)(end - p), p);
+			while (end > p && isspace((unsigned char)rec->val[rec->num][end - p - 1]))
+				end--;
+			rec->val[rec->num][end - p] = '\0';
+			p = end;
+		}
+		rec->is_str[rec->num++] = is_str;
+
+		p = skip_space(p);
+		if (*p == ',')
+			p++;
+	}
+
+	return -EINVAL;
+}
+
+static int split_csv(char *line, char fields[][REC_VAL_LEN])
+{
+	char *save = NULL;
+	char *tok;
+	int num = 0;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	for (tok = strtok_r(line, ",", &save); tok && num < REC_MAX_FIELDS;
+	     tok = strtok_r(NULL, ",", &save))
+		snprintf(fields[num++], REC_VAL_LEN, "%s", tok);
+
+	return num;
+}
+
+static int record_add_parsed(struct acc_record **recs, u32 *num, u32 *size,
+			     struct acc_record *rec)
+{
+	struct acc_record *tmp;
+
+	if (*num == *size) {
+		*size = *size ? *size * 2 : 16;
+		tmp = realloc(*recs, *size * sizeof(struct acc_record));
+		if (!tmp)
+			return -ENOMEM;
+		*recs = tmp;
+	}
+
+	memcpy(&(*recs)[(*num)++], rec, sizeof(*rec));
+
+	return 0;
+}
+
+/*
+ * Read the records of a result file. A line starting with '{' is a JSON
+ * record, a line starting with "algname," is a CSV header and the lines
+ * with as many fields after it are CSV records, other lines are skipped,
+ * so the text output of the benchmark may be in the file too.
+ */
+static int record_load(const char *path, struct acc_record **recs, u32 *num)
+{
+	char (*header)[REC_VAL_LEN] = NULL;
+	struct acc_record rec;
+	char *line = NULL;
+	int header_num = 0;
+	u32 size = 0;
+	int ret = 0;
+	FILE *fp;
+	int i, n;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		ACC_TST_PRT("failed to open result file %s!\n", path);
+		return -errno;
+	}
+
+	line = malloc(REC_LINE_LEN);
+	header = calloc(REC_MAX_FIELDS, REC_VAL_LEN);
+	if (!line || !header) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	*recs = NULL;
+	*num = 0;
+	while (fgets(line, REC_LINE_LEN, fp)) {
+		if (*skip_space(line) == '{') {
+			if (record_parse_json(line, &rec))
+				continue;
+		} else if (!strncmp(line, "algname,", strlen("algname,"))) {
+			header_num = split_csv(line, header);
+			continue;
+		} else {
+			if (!header_num)
+				continue;
+
+			n = split_csv(line, rec.val);
+			if (n != header_num)
+				continue;
+
+			rec.num = n;
+			for (i = 0; i < n; i++) {
+				snprintf(rec.key[i], REC_KEY_LEN, "%s", header[i]);
+				rec.is_str[i] = false;
+			}
+		}
+
+		ret = record_add_parsed(recs, num, &size, &rec);
+		if (ret)
+			goto out;
+	}
+
+out:
+	free(header);
+	free(line);
+	fclose(fp);
+	if (ret) {
+		free(*recs);
+		*recs = NULL;
+		*num = 0;
+	}
+
+	return ret;
+}
+
+static const struct rec_metric *get_metric(const char *key)
+{
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(rec_metrics); i++) {
+		if (!strcmp(key, rec_metrics[i].key))
+			return &rec_metrics[i];
+	}
+
+	return NULL;
+}
+
+static const char *record_get(struct acc_record *rec, const char *key)
+{
+	u32 i;
+
+	for (i = 0; i < rec->num; i++) {
+		if (!strcmp(rec->key[i], key))
+			return rec->val[i];
+	}
+
+	return NULL;
+}
+
+/* The option fields of a record, two records of the same workload match */
+static void record_id(struct acc_record *rec, char *id, u32 len)
+{
+	u32 i, j, pos = 0;
+
+	id[0] = '\0';
+	for (i = 0; i < rec->num && pos < len; i++) {
+		if (get_metric(rec->key[i]))
+			continue;
+
+		for (j = 0; j < ARRAY_SIZE(rec_ignored_ids); j++) {
+			if (!strcmp(rec->key[i], rec_ignored_ids[j]))
+				break;
+		}
+		if (j < ARRAY_SIZE(rec_ignored_ids))
+			continue;
+
+		pos += snprintf(id + pos, len - pos, "%s=%s;", rec->key[i], rec->val[i]);
+	}
+}
+
+static void record_name(struct acc_record *rec, char *name, u32 len)
+{
+	const char *keys[] = {"algname", "optype", "syncmode", "pktlen", "threads", "multis"};
+	const char *val;
+	u32 i, pos = 0;
+
+	name[0] = '\0';
+	for (i = 0; i < ARRAY_SIZE(keys) && pos < len; i++) {
+		val = record_get(rec, keys[i]);
+		if (val)
+			pos += snprintf(name + pos, len - pos, "%s%s", i ? "/" : "", val);
+	}
+}
+
+/* Return 1 if the metric regresses more than threshold percent */
+static int compare_metric(const char *name, const struct rec_metric *metric,
+			  const char *base_val, const char *new_val, double threshold)
+{
+	double base = strtod(base_val, NULL);
+	double cur = strtod(new_val, NULL);
+	bool regress;
+	double diff;
+
+	/* A zero is a metric not measured in the run, such as the latency */
+	if (metric->dir == METRIC_INFO || base < DBL_EPSILON || cur < DBL_EPSILON)
+		return 0;
+
+	diff = (cur - base) / base * PERCENT;
+	if (metric->dir == METRIC_HIGHER_BETTER)
+		regress = diff < -threshold;
+	else
+		regress = diff > threshold;
+
+	ACC_TST_PRT("%-48s %-16s %14.2f %14.2f %+8.2f%%%s\n", name, metric->key,
+		    base, cur, diff, regress ? "  REGRESSION" : "");
+
+	return regress ? 1 : 0;
+}
+
+static int compare_records(struct acc_record *base, u32 base_num,
+			   struct acc_record *cur, u32 cur_num, double threshold)
+{
+	char cur_id[REC_ID_LEN], base_id[REC_ID_LEN];
+	const struct rec_metric *metric;
+	int regress = 0, unmatched = 0;
+	char name[REC_VAL_LEN * 2];
+	const char *base_val;
+	u32 i, j, k;
+
+	ACC_TST_PRT("%-48s %-16s %14s %14s %9s\n", "case", "metric", "base", "new", "change");
+	for (i = 0; i < cur_num; i++) {
+		record_id(&cur[i], cur_id, sizeof(cur_id));
+		record_name(&cur[i], name, sizeof(name));
+
+		/* The last record of the base wins if it has several runs */
+		for (j = base_num; j > 0; j--) {
+			record_id(&base[j - 1], base_id, sizeof(base_id));
+			if (!strcmp(cur_id, base_id))
+				break;
+		}
+
+		if (!j) {
+			ACC_TST_PRT("%-48s no base record\n", name);
+			unmatched++;
+			continue;
+		}
+
+		for (k = 0; k < cur[i].num; k++) {
+			metric = get_metric(cur[i].key[k]);
+			if (!metric)
+				continue;
+
+			base_val = record_get(&base[j - 1], cur[i].key[k]);
+			if (base_val)
+				regress += compare_metric(name, metric, base_val,
+							  cur[i].val[k], threshold);
+		}
+	}
+
+	ACC_TST_PRT("%u records compared, %d regressions beyond %.2f%%, %d without base\n",
+		    cur_num, regress, threshold, unmatched);
+
+	return regress;
+}
+
+static void print_compare_help(void)
+{
+	ACC_TST_PRT("USAGE\n");
+	ACC_TST_PRT("    uadk_tool benchmark compare <base file> <new file> [--threshold N]\n");
+	ACC_TST_PRT("DESCRIPTION\n");
+	ACC_TST_PRT("    compare the records of --format json or csv result files, the\n");
+	ACC_TST_PRT("    records of the same options except --seconds are matched\n");
+	ACC_TST_PRT("    [--threshold N]: percent of change regarded as a regression, default 5\n");
+	ACC_TST_PRT("    exit with 1 if any metric regresses\n");
+}
+
+int acc_compare_run(int argc, char *argv[])
+{
+	struct acc_record *base = NULL, *cur = NULL;
+	double threshold = DEFAULT_THRESHOLD;
+	u32 base_num, cur_num;
+	const char *files[2];
+	int i, nfile = 0;
+	int ret;
+
+	for (i = 0; i < argc; i++) {
+		if (!strcmp(argv[i], "--threshold") && i + 1 < argc) {
+			threshold = strtod(argv[++i], NULL);
+		} else if (!strcmp(argv[i], "--help") || nfile == ARRAY_SIZE(files)) {
+			print_compare_help();
+			return -EINVAL;
+		} else {
+			files[nfile++] = argv[i];
+		}
+	}
+
+	if (nfile != ARRAY_SIZE(files) || threshold < 0) {
+		print_compare_help();
+		return -EINVAL;
+	}
+
+	ret = record_load(files[0], &base, &base_num);
+	if (ret)
+		return ret;
+
+	ret = record_load(files[1], &cur, &cur_num);
+	if (ret)
+		goto free_base;
+
+	if (!base_num || !cur_num) {
+		ACC_TST_PRT("no benchmark record in %s!\n", base_num ? files[1] : files[0]);
+		ret = -EINVAL;
+		goto free_cur;
+	}
+
+	ret = compare_records(base, base_num, cur, cur_num, threshold) ? 1 : 0;
+
+free_cur:
+	free(cur);
+free_base:
+	free(base);
+	return ret;
+}
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+#ifndef UADK_BENCHMARK_REPORT_H
+#define UADK_BENCHMARK_REPORT_H
+
+#include "uadk_benchmark.h"
+
+#define REC_MAX_FIELDS		48
+#define REC_KEY_LEN		32
+#define REC_VAL_LEN		80
+
+/*
+ * struct acc_record - One result of a benchmark run, the option fields
+ * come first and the metrics follow. It is written as one JSON object per
+ * line or as a CSV row, and read back by the compare command.
+ */
+struct acc_record {
+	u32 num;
+	bool is_str[REC_MAX_FIELDS];
+	char key[REC_MAX_FIELDS][REC_KEY_LEN];
+	char val[REC_MAX_FIELDS][REC_VAL_LEN];
+};
+
+extern void record_add_str(struct acc_record *rec, const char *key, const char *val);
+extern void record_add_u64(struct acc_record *rec, const char *key, u64 val);
+extern void record_add_double(struct acc_record *rec, const char *key, double val);
+/* Append to path, or print to stdout if path is empty */
+extern int record_write(struct acc_record *rec, u32 format, const char *path);
+extern int get_format_type(const char *name);
+extern int acc_compare_run(int argc, char *argv[]);
+
+#endif /* UADK_BENCHMARK_REPORT_H */
@@ -790,10 +790,12 @@ static void *zip_uadk_blk_lz77_sync_run(void *arg)
 		creq.dst_len = out_len;
 		creq.priv = &ftuple[i];
 
+		acc_req_start();
 		ret = wd_do_comp_sync(h_sess, &creq);
 		if (ret || creq.status)
 			break;
 
+		acc_req_done();
 		count++;
 		zstd_input.src = creq.src;
 		zstd_input.size = creq.src_len;
@@ -873,6 +875,7 @@ static void *zip_uadk_stm_lz77_sync_run(void *arg)
 		in_len = uadk_pool->bds[0].src_len;
 		out_len = uadk_pool->bds[0].dst_len;
 
+		acc_req_start();
 		while (in_len > 0) {
 			creq.src_len = in_len > CHUNK_SIZE ? CHUNK_SIZE : in_len;
 			creq.dst_len = out_len > 2 * CHUNK_SIZE ? 2 * CHUNK_SIZE : out_len;
@@ -893,6 +896,7 @@ static void *zip_uadk_stm_lz77_sync_run(void *arg)
 			out_len -= 2 * CHUNK_SIZE;
 		}
 
+		acc_req_done();
 		count++;
 
 		if (get_run_state() == 0)
@@ -963,6 +967,7 @@ static void *zip_uadk_blk_lz77_async_run(void *arg)
 		pdata->tag[i].cctx = cctx;
 		creq.cb_param = &pdata->tag[i];
 
+		acc_req_start();
 		ret = wd_do_comp_async(h_sess, &creq);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -1028,10 +1033,12 @@ static void *zip_uadk_blk_sync_run(void *arg)
 		creq.src_len = uadk_pool->bds[i].src_len;
 		creq.dst_len = out_len;
 
+		acc_req_start();
 		ret = wd_do_comp_sync(h_sess, &creq);
 		if (ret || creq.status)
 			break;
 
+		acc_req_done();
 		count++;
 		uadk_pool->bds[i].dst_len = creq.dst_len;
 		if (get_run_state() == 0)
@@ -1088,6 +1095,7 @@ static void *zip_uadk_stm_sync_run(void *arg)
 		creq.src_len = uadk_pool->bds[i].src_len;
 		creq.dst_len = out_len;
 
+		acc_req_start();
 		ret = wd_do_comp_sync2(h_sess, &creq);
 		if (ret < 0 || creq.status == WD_IN_EPARA) {
 			ZIP_TST_PRT("wd comp, invalid or incomplete data! "
@@ -1095,6 +1103,7 @@ static void *zip_uadk_stm_sync_run(void *arg)
 			break;
 		}
 
+		acc_req_done();
 		count++;
 		uadk_pool->bds[i].dst_len = creq.dst_len;
 
@@ -1160,6 +1169,7 @@ static void *zip_uadk_blk_async_run(void *arg)
 		pdata->tag[i].bd_idx = i;
 		creq.cb_param = &pdata->tag[i];
 
+		acc_req_start();
 		ret = wd_do_comp_async(h_sess, &creq);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
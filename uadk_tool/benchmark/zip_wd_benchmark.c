@@ -550,11 +550,13 @@ static void *zip_wd_blk_lz77_sync_run(void *arg)
 		opdata.avail_out = out_len;
 		opdata.priv = &ftuple[i];
 
+		acc_req_start();
 		ret = wcrypto_do_comp(ctx, &opdata, NULL);
 		if (ret || opdata.status == WCRYPTO_DECOMP_END_NOSPACE ||
 		     opdata.status == WD_IN_EPARA || opdata.status == WD_VERIFY_ERR)
 			break;
 
+		acc_req_done();
 		count++;
 
 		if (get_run_state() == 0)
@@ -631,6 +633,7 @@ static void *zip_wd_stm_lz77_sync_run(void *arg)
 		in_len = bd_pool[i].src_len;
 		out_len = bd_pool[i].dst_len;
 
+		acc_req_start();
 		while (in_len > 0) {
 			opdata.in_len = in_len > CHUNK_SIZE ? CHUNK_SIZE : in_len;
 			opdata.avail_out = out_len > 2 * CHUNK_SIZE ? 2 * CHUNK_SIZE : out_len;
@@ -650,6 +653,7 @@ static void *zip_wd_stm_lz77_sync_run(void *arg)
 			dst += 2 * CHUNK_SIZE;
 			out_len -= 2 * CHUNK_SIZE;
 		}
+		acc_req_done();
 		count++;
 
 		if (get_run_state() == 0)
@@ -740,6 +744,7 @@ static void *zip_wd_blk_lz77_async_run(void *arg)
 		tag[i].cm_len = out_len;
 		tag[i].priv = opdata.priv;
 
+		acc_req_start();
 		ret = wcrypto_do_comp(ctx, &opdata, &tag[i]);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
@@ -826,11 +831,13 @@ static void *zip_wd_blk_sync_run(void *arg)
 		opdata.in_len = bd_pool[i].src_len;
 		opdata.avail_out = out_len;
 
+		acc_req_start();
 		ret = wcrypto_do_comp(ctx, &opdata, NULL);
 		if (ret || opdata.status == WCRYPTO_DECOMP_END_NOSPACE ||
 		     opdata.status == WD_IN_EPARA || opdata.status == WD_VERIFY_ERR)
 			break;
 
+		acc_req_done();
 		count++;
 		bd_pool[i].dst_len = opdata.produced;
 		if (get_run_state() == 0)
@@ -894,6 +901,7 @@ static void *zip_wd_stm_sync_run(void *arg)
 		total_out = 0;
 		opdata.stream_pos = WCRYPTO_COMP_STREAM_NEW;
 
+		acc_req_start();
 		do {
 			opdata.in_len = in_len > CHUNK_SIZE ? CHUNK_SIZE : in_len;
 			opdata.avail_out = out_len > 2 * CHUNK_SIZE ? 2 * CHUNK_SIZE : out_len;
@@ -918,6 +926,7 @@ static void *zip_wd_stm_sync_run(void *arg)
 			total_out += opdata.produced;
 		} while (in_len > 0);
 
+		acc_req_done();
 		count++;
 		bd_pool[i].dst_len = total_out;
 
@@ -1003,6 +1012,7 @@ static void *zip_wd_blk_async_run(void *arg)
 		tag[i].td_id = pdata->td_id;
 		tag[i].bd_idx = i;
 
+		acc_req_start();
 		ret = wcrypto_do_comp(ctx, &opdata, &tag[i]);
 		if (ret == -WD_EBUSY) {
 			usleep(SEND_USLEEP * try_cnt);
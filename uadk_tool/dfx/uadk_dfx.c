@@ -1,5 +1,9 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,15 +12,22 @@
 #include <getopt.h>
 #include <unistd.h>
 #include <limits.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "include/wd.h"
+#include "include/wd_alg_common.h"
+#include "include/wd_stats.h"
 #include "uadk_dfx.h"
 
 #define uadk_build_date()	printf("built on: %s %s\n", __DATE__, __TIME__)
 #define ARRAY_SIZE(x)		(sizeof(x) / sizeof((x)[0]))
-#define PRIVILEGE_FLAG		0666
+#define SHM_DIR			"/dev/shm"
+#define STATS_SNAP_INIT		64
+#define TOP_INTERVAL_SEC	1
+#define NSEC_PER_SEC		1000000000ULL
+#define NSEC_PER_USEC		1000
+#define BYTES_PER_MB		(1024.0 * 1024.0)
 
 struct uadk_env_var {
 	const char *module;
@@ -40,6 +51,7 @@ enum dfx_op_type {
 	DISPLAY_ENV,
 	DISPLAY_COUNT,
 	DISPLAY_HELP,
+	DISPLAY_TOP,
 };
 
 const char *uadk_modules[] = {"sec", "hpre", "zip"};
@@ -61,69 +73,336 @@ const struct uadk_env_var env_vars[] = {
 	 .epoll_en_var = "WD_COMP_EPOLL_EN"},
 };
 
-static void dump_ctx_count(unsigned long *count)
+struct stats_ctx_snap {
+	char region[NAME_MAX];
+	__u32 idx;
+	__u32 gen;
+	pid_t pid;
+	__s32 numa;
+	__u8 mode;
+	char alg[WD_STATS_NAME_LEN];
+	char dev[WD_STATS_NAME_LEN];
+	__u64 cnt[WD_STATS_CNT_NUM];
+};
+
+struct stats_snap {
+	struct stats_ctx_snap *ctxs;
+	__u32 num;
+	__u32 size;
+	__u64 time_ns;
+};
+
+/* The rates of a ctx, or the sum of the ctxs of a NUMA node or an alg */
+struct stats_rate {
+	char name[WD_STATS_NAME_LEN * 2];
+	__u32 ctx_num;
+	double cnt[WD_STATS_CNT_NUM];
+};
+
+static volatile sig_atomic_t top_stop;
+
+static __u64 stats_get_ns(void)
 {
-	__u32 idx = 0;
-	int i;
+	struct timespec ts;
 
-	if (!count)
-		return;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	printf("displays the ctx counter value...\n");
-	for (i = 0; i < WD_CTX_CNT_NUM; i++) {
-		if (count[i]) {
-			printf("ctx-[%d]:%lu \t", i, count[i]);
-			idx++;
-		} else {
+	return (__u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int stats_snap_add(struct stats_snap *snap, struct wd_stats_region *region,
+			  const char *name, __u32 idx)
+{
+	struct wd_stats_ctx *ctx = &region->ctxs[idx];
+	struct stats_ctx_snap *tmp, *out;
+	__u32 i, j;
+
+	if (snap->num == snap->size) {
+		snap->size = snap->size ? snap->size * 2 : STATS_SNAP_INIT;
+		tmp = realloc(snap->ctxs, snap->size * sizeof(*tmp));
+		if (!tmp)
+			return -ENOMEM;
+		snap->ctxs = tmp;
+	}
+
+	out = &snap->ctxs[snap->num++];
+	memset(out, 0, sizeof(*out));
+	snprintf(out->region, sizeof(out->region), "%s", name);
+	out->idx = idx;
+	out->gen = ctx->gen;
+	out->pid = region->pid;
+	out->numa = ctx->numa;
+	out->mode = ctx->mode;
+	memcpy(out->alg, ctx->alg, sizeof(out->alg) - 1);
+	memcpy(out->dev, ctx->dev, sizeof(out->dev) - 1);
+	for (i = 0; i < WD_STATS_SLOT_NUM; i++)
+		for (j = 0; j < WD_STATS_CNT_NUM; j++)
+			out->cnt[j] += __atomic_load_n(&ctx->slots[i].cnt[j], __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+static int stats_region_read(struct stats_snap *snap, const char *name)
+{
+	struct wd_stats_region *region;
+	char path[NAME_MAX + 1];
+	struct stat st;
+	int ret = 0;
+	__u32 i;
+	int fd;
+
+	snprintf(path, sizeof(path), "/%s", name);
+	fd = shm_open(path, O_RDONLY, 0);
+	if (fd < 0)
+		return 0;
+
+	if (fstat(fd, &st) || st.st_size < sizeof(*region)) {
+		close(fd);
+		return 0;
+	}
+
+	region = mmap(NULL, sizeof(*region), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (region == MAP_FAILED)
+		return 0;
+
+	/* The region of a process which has exited without uninit is stale */
+	if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != WD_STATS_MAGIC ||
+	    region->version != WD_STATS_VERSION ||
+	    (kill(region->pid, 0) && errno == ESRCH))
+		goto out;
+
+	for (i = 0; i < region->ctx_max && i < WD_STATS_CTX_MAX; i++) {
+		if (!__atomic_load_n(&region->ctxs[i].in_use, __ATOMIC_ACQUIRE))
 			continue;
-		}
 
-		if ((idx & 0x3) == 0)
-			printf("\n");
+		ret = stats_snap_add(snap, region, name, i);
+		if (ret)
+			break;
 	}
-	printf("\n");
+
+out:
+	munmap(region, sizeof(*region));
+	return ret;
 }
 
-static int get_shared_id(void)
+/* Read the counters of all the processes using uadk */
+static int stats_snap_take(struct stats_snap *snap)
 {
-	int shm;
+	struct dirent *entry;
+	int ret = 0;
+	DIR *dir;
 
-	shm = shmget(WD_IPC_KEY, sizeof(unsigned long) * WD_CTX_CNT_NUM,
-		     IPC_CREAT | PRIVILEGE_FLAG);
-	if (shm < 0) {
-		printf("failed to get the shared memory id.\n");
-		return -EINVAL;
+	snap->num = 0;
+	snap->time_ns = stats_get_ns();
+
+	dir = opendir(SHM_DIR);
+	if (!dir) {
+		printf("failed to open %s.\n", SHM_DIR);
+		return -errno;
 	}
 
-	return shm;
+	while ((entry = readdir(dir))) {
+		if (strncmp(entry->d_name, WD_STATS_PREFIX, strlen(WD_STATS_PREFIX)))
+			continue;
+
+		ret = stats_region_read(snap, entry->d_name);
+		if (ret)
+			break;
+	}
+	closedir(dir);
+
+	return ret;
+}
+
+static void stats_snap_free(struct stats_snap *snap)
+{
+	free(snap->ctxs);
+	memset(snap, 0, sizeof(*snap));
 }
 
 static int uadk_shared_read(void)
 {
-	unsigned long *shared;
-	void *ptr;
-	int shm;
+	struct stats_snap snap = {0};
+	struct stats_ctx_snap *ctx;
+	__u32 i;
+	int ret;
+
+	ret = stats_snap_take(&snap);
+	if (ret)
+		goto out;
+
+	if (!snap.num) {
+		printf("no ctx is counted, set WD_STATS_EN=1 for the uadk process.\n");
+		goto out;
+	}
 
-	shm = get_shared_id();
-	if (shm < 0)
-		return -EINVAL;
+	printf("displays the ctx counter value...\n");
+	printf("%-8s %-10s %-20s %5s %-5s %14s %14s %10s %10s\n", "PID", "ALG", "DEV",
+	       "NUMA", "MODE", "SEND", "RECV", "BUSY", "TIMEOUT");
+	for (i = 0; i < snap.num; i++) {
+		ctx = &snap.ctxs[i];
+		printf("%-8d %-10s %-20s %5d %-5s %14llu %14llu %10llu %10llu\n",
+		       ctx->pid, ctx->alg, ctx->dev, ctx->numa,
+		       ctx->mode == CTX_MODE_SYNC ? "sync" : "async",
+		       ctx->cnt[WD_STATS_SEND], ctx->cnt[WD_STATS_RECV],
+		       ctx->cnt[WD_STATS_BUSY], ctx->cnt[WD_STATS_TIMEOUT]);
+	}
 
-	ptr = (int *)shmat(shm, NULL, 0);
-	if (ptr < 0) {
-		printf("failed to get the shared memory addr.\n");
-		return -EINVAL;
+out:
+	stats_snap_free(&snap);
+	return ret;
+}
+
+static struct stats_ctx_snap *stats_snap_find(struct stats_snap *snap,
+					      struct stats_ctx_snap *ctx)
+{
+	__u32 i;
+
+	for (i = 0; i < snap->num; i++) {
+		if (snap->ctxs[i].idx == ctx->idx && snap->ctxs[i].gen == ctx->gen &&
+		    !strcmp(snap->ctxs[i].region, ctx->region))
+			return &snap->ctxs[i];
 	}
 
-	shared = (unsigned long *)ptr;
+	return NULL;
+}
+
+static void stats_rate_add(struct stats_rate *rates, __u32 *num, const char *name,
+			   struct stats_rate *rate)
+{
+	__u32 i, j;
 
-	printf("get the shared memory addr successful.\n");
-	dump_ctx_count(shared);
+	for (i = 0; i < *num; i++) {
+		if (!strcmp(rates[i].name, name))
+			break;
+	}
 
-	shmdt(ptr);
+	if (i == *num) {
+		memset(&rates[i], 0, sizeof(rates[i]));
+		snprintf(rates[i].name, sizeof(rates[i].name), "%s", name);
+		(*num)++;
+	}
+
+	rates[i].ctx_num++;
+	for (j = 0; j < WD_STATS_CNT_NUM; j++)
+		rates[i].cnt[j] += rate->cnt[j];
+}
+
+static void stats_rate_print(struct stats_rate *rate)
+{
+	double lat = 0;
+
+	if (rate->cnt[WD_STATS_LAT_CNT])
+		lat = rate->cnt[WD_STATS_LAT_NS] / rate->cnt[WD_STATS_LAT_CNT] / NSEC_PER_USEC;
+
+	printf("%-44s %5u %12.0f %12.0f %10.2f %10.2f %8.0f %8.0f %10.1f\n",
+	       rate->name, rate->ctx_num, rate->cnt[WD_STATS_SEND], rate->cnt[WD_STATS_RECV],
+	       rate->cnt[WD_STATS_BYTES_IN] / BYTES_PER_MB,
+	       rate->cnt[WD_STATS_BYTES_OUT] / BYTES_PER_MB,
+	       rate->cnt[WD_STATS_BUSY], rate->cnt[WD_STATS_TIMEOUT], lat);
+}
+
+static void stats_rate_print_head(const char *name)
+{
+	printf("\n%-44s %5s %12s %12s %10s %10s %8s %8s %10s\n", name, "CTXS",
+	       "SEND/s", "RECV/s", "IN MB/s", "OUT MB/s", "BUSY/s", "TMOUT/s", "LAT(us)");
+}
+
+static int stats_top_print(struct stats_snap *prev, struct stats_snap *cur)
+{
+	double sec = (double)(cur->time_ns - prev->time_ns) / NSEC_PER_SEC;
+	struct stats_rate *numas, *algs, rate;
+	__u32 numa_num = 0, alg_num = 0;
+	struct stats_ctx_snap *ctx, *old;
+	__u32 i, j, idle = 0;
+	char name[WD_STATS_NAME_LEN * 2];
+
+	numas = calloc(cur->num + 1, sizeof(*numas));
+	algs = calloc(cur->num + 1, sizeof(*algs));
+	if (!numas || !algs) {
+		free(numas);
+		free(algs);
+		return -ENOMEM;
+	}
+
+	/* Clear the screen */
+	printf("\033[H\033[2J");
+	printf("uadk top - %u ctxs, refreshed every %.1fs, Ctrl-C to quit\n", cur->num, sec);
+	stats_rate_print_head("PID/ALG/DEV/NUMA/MODE");
+	for (i = 0; i < cur->num; i++) {
+		ctx = &cur->ctxs[i];
+		old = stats_snap_find(prev, ctx);
+		memset(&rate, 0, sizeof(rate));
+		rate.ctx_num = 1;
+		/* The LAT counters are kept as the delta so the average is of the interval */
+		for (j = 0; j < WD_STATS_CNT_NUM; j++) {
+			rate.cnt[j] = ctx->cnt[j] - (old ? old->cnt[j] : 0);
+			if (j != WD_STATS_LAT_NS && j != WD_STATS_LAT_CNT)
+				rate.cnt[j] /= sec;
+		}
+
+		snprintf(name, sizeof(name), "%d", ctx->numa);
+		stats_rate_add(numas, &numa_num, name, &rate);
+		stats_rate_add(algs, &alg_num, ctx->alg, &rate);
+
+		if (!rate.cnt[WD_STATS_SEND] && !rate.cnt[WD_STATS_RECV]) {
+			idle++;
+			continue;
+		}
+
+		snprintf(rate.name, sizeof(rate.name), "%d/%s/%s/%d/%s", ctx->pid, ctx->alg,
+			 ctx->dev, ctx->numa, ctx->mode == CTX_MODE_SYNC ? "sync" : "async");
+		stats_rate_print(&rate);
+	}
+	printf("%u idle ctxs are not shown\n", idle);
+
+	stats_rate_print_head("NUMA");
+	for (i = 0; i < numa_num; i++)
+		stats_rate_print(&numas[i]);
+
+	stats_rate_print_head("ALG");
+	for (i = 0; i < alg_num; i++)
+		stats_rate_print(&algs[i]);
+
+	fflush(stdout);
+	free(numas);
+	free(algs);
 
 	return 0;
 }
 
+static void stats_top_stop(int sig)
+{
+	top_stop = 1;
+}
+
+/* Refresh the rates every second, count times or until Ctrl-C if count is 0 */
+static int uadk_stats_top(__u32 count)
+{
+	struct stats_snap snap[2] = {0};
+	__u32 cur = 0, iter = 0;
+	int ret;
+
+	top_stop = 0;
+	signal(SIGINT, stats_top_stop);
+
+	ret = stats_snap_take(&snap[cur]);
+	while (!ret && !top_stop && (!count || iter++ < count)) {
+		sleep(TOP_INTERVAL_SEC);
+		cur ^= 1;
+		ret = stats_snap_take(&snap[cur]);
+		if (!ret)
+			ret = stats_top_print(&snap[cur ^ 1], &snap[cur]);
+	}
+
+	signal(SIGINT, SIG_DFL);
+	stats_snap_free(&snap[0]);
+	stats_snap_free(&snap[1]);
+
+	return ret;
+}
+
 bool uadk_check_module(const char *module)
 {
 	int i;
@@ -189,11 +468,14 @@ void print_dfx_help(void)
 	printf("    uadk_tool dfx [--dir]     = Show library dir\n");
 	printf("    uadk_tool dfx [--env]     = Show environment variables\n");
 	printf("    uadk_tool dfx [--count]   = Show the ctx message count\n");
+	printf("    uadk_tool dfx [--top[=N]] = Show the rates of ctxs every second, N times\n");
 	printf("    uadk_tool dfx [--help]    = usage\n");
 	printf("Example\n");
 	printf("    uadk_tool dfx --version\n");
 	printf("    uadk_tool dfx --env sec\n");
 	printf("    uadk_tool dfx --count\n");
+	printf("    uadk_tool dfx --top\n");
+	printf("    the uadk process counts its ctxs when WD_STATS_EN=1\n");
 }
 
 void dfx_cmd_parse(int argc, char *argv[])
@@ -210,6 +492,7 @@ void dfx_cmd_parse(int argc, char *argv[])
 		{"env",     required_argument, 0,  5},
 		{"count",   no_argument, 0,  6},
 		{"help",    no_argument, 0,  7},
+		{"top",     optional_argument, 0,  8},
 		{0, 0, 0, 0}
 	};
 
@@ -244,6 +527,9 @@ void dfx_cmd_parse(int argc, char *argv[])
 		case DISPLAY_HELP:
 			print_dfx_help();
 			break;
+		case DISPLAY_TOP:
+			uadk_stats_top(optarg ? strtoul(optarg, NULL, 0) : 0);
+			break;
 		default:
 			printf("bad input parameter, exit!\n");
 			print_dfx_help();
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "benchmark/uadk_benchmark.h"
+#include "benchmark/uadk_benchmark_report.h"
 #include "dfx/uadk_dfx.h"
 #include "test/uadk_test.h"
 
@@ -24,6 +25,9 @@ int main(int argc, char **argv)
 		if (!strcmp("dfx", argv[index])) {
 			dfx_cmd_parse(argc, argv);
 		} else if (!strcmp("benchmark", argv[index])) {
+			if (argv[index + 1] && !strcmp("compare", argv[index + 1]))
+				return acc_compare_run(argc - index - 2, argv + index + 2);
+
 			printf("start UADK benchmark test.\n");
 			if (!argv[++index])
 				acc_default_case(&option);
@@ -16,12 +16,14 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <numa.h>
+#include <pthread.h>
 #include <sched.h>
 
 #include "wd.h"
 #include "wd_alg.h"
-#define SYS_CLASS_DIR			"/sys/class/uacce"
+#include "wd_uacce_emu.h"
 #define FILE_MAX_SIZE			(8 << 20)
+#define EMU_SQE_SIZE			128
 
 enum UADK_LOG_LEVEL {
 	WD_LOG_NONE = 0,
@@ -41,6 +43,8 @@ struct wd_ctx_h {
 	unsigned long qfrs_offs[UACCE_QFRT_MAX];
 	void *qfrs_base[UACCE_QFRT_MAX];
 	struct uacce_dev *dev;
+	/* Not NULL if the queue is emulated in userspace */
+	struct wd_emu_qp *emu;
 	void *priv;
 };
 
@@ -220,18 +224,10 @@ static int get_dev_info(struct uacce_dev *dev)
 	int value = 0;
 	int ret;
 
-	/* hardware err isolate flag */
-	ret = access_attr(dev->dev_root, "isolate", F_OK);
-	if (!ret) {
-		ret = get_int_attr(dev, "isolate", &value);
-		if (ret < 0)
-			return ret;
-		else if (value == 1) {
-			WD_ERR("skip isolated uacce device!\n");
-			return -WD_ENODEV;
-		}
-	}
-
+	/*
+	 * The hardware err isolate flag is not checked here, it may change
+	 * while the device is in the registry, see wd_get_accel_list().
+	 */
 	ret = get_int_attr(dev, "flags", &dev->flags);
 	if (ret < 0)
 		return ret;
@@ -269,7 +265,8 @@ static int get_dev_info(struct uacce_dev *dev)
 	return get_str_attr(dev, "algorithms", dev->algs, MAX_ATTR_STR_SIZE);
 }
 
-static struct uacce_dev *read_uacce_sysfs(const char *dev_name)
+static struct uacce_dev *read_uacce_sysfs(const char *class_dir,
+					  const char *dev_name)
 {
 	struct uacce_dev *dev = NULL;
 	int ret;
@@ -282,7 +279,7 @@ static struct uacce_dev *read_uacce_sysfs(const char *dev_name)
 		return NULL;
 
 	ret = snprintf(dev->dev_root, MAX_DEV_NAME_LEN, "%s/%s",
-			   SYS_CLASS_DIR, dev_name);
+			   class_dir, dev_name);
 	if (ret < 0)
 		goto out;
 
@@ -386,16 +383,65 @@ void wd_add_dev_to_list(struct uacce_dev_list *head, struct uacce_dev_list *node
 	tmp->next = node;
 }
 
+static int get_emu_attr(struct uacce_dev *dev, const char *attr, int def)
+{
+	int value = def;
+	int ret;
+
+	if (access_attr(dev->dev_root, attr, F_OK))
+		return def;
+
+	ret = get_int_attr(dev, attr, &value);
+	if (ret < 0)
+		return ret;
+
+	return value < 0 ? -WD_EINVAL : value;
+}
+
+static struct wd_emu_qp *wd_request_emu(struct uacce_dev *dev)
+{
+	struct wd_emu_cfg cfg = {0};
+	int ret;
+
+	ret = get_str_attr(dev, "emulate", cfg.engine, sizeof(cfg.engine));
+	if (ret < 0)
+		return NULL;
+
+	ret = get_emu_attr(dev, "emulate_sqe_size", EMU_SQE_SIZE);
+	if (ret < 0)
+		return NULL;
+	cfg.sqe_size = ret;
+
+	ret = get_emu_attr(dev, "emulate_delay_ns", 0);
+	if (ret < 0)
+		return NULL;
+	cfg.delay_ns = ret;
+
+	return wd_emu_create(&cfg);
+}
+
 handle_t wd_request_ctx(struct uacce_dev *dev)
 {
+	struct wd_emu_qp *emu = NULL;
 	struct wd_ctx_h	*ctx;
 	char char_dev_path[PATH_MAX];
 	char *ptrRet = NULL;
-	int fd;
+	int fd = -1;
 
 	if (!dev || !strlen(dev->dev_root))
 		return 0;
 
+	/* The device is emulated, no char device is behind it. */
+	if (!access_attr(dev->dev_root, "emulate", F_OK)) {
+		emu = wd_request_emu(dev);
+		if (!emu) {
+			WD_ERR("failed to request emulated queue of %s!\n",
+			       dev->dev_root);
+			return 0;
+		}
+		goto alloc_ctx;
+	}
+
 	ptrRet = realpath(dev->char_dev_path, char_dev_path);
 	if (ptrRet == NULL)
 		return 0;
@@ -406,6 +452,7 @@ handle_t wd_request_ctx(struct uacce_dev *dev)
 		return 0;
 	}
 
+alloc_ctx:
 	ctx = calloc(1, sizeof(struct wd_ctx_h));
 	if (!ctx)
 		goto close_fd;
@@ -423,6 +470,7 @@ handle_t wd_request_ctx(struct uacce_dev *dev)
 		goto free_drv_name;
 
 	ctx->fd = fd;
+	ctx->emu = emu;
 
 	wd_ctx_init_qfrs_offs(ctx);
 
@@ -438,7 +486,10 @@ free_dev_name:
 free_ctx:
 	free(ctx);
 close_fd:
-	close(fd);
+	if (emu)
+		wd_emu_destroy(emu);
+	else
+		close(fd);
 	return 0;
 }
 
@@ -449,7 +500,10 @@ void wd_release_ctx(handle_t h_ctx)
 	if (!ctx)
 		return;
 
-	close(ctx->fd);
+	if (ctx->emu)
+		wd_emu_destroy(ctx->emu);
+	else
+		close(ctx->fd);
 	free(ctx->dev);
 	free(ctx->drv_name);
 	free(ctx->dev_name);
@@ -502,8 +556,12 @@ void *wd_ctx_mmap_qfr(handle_t h_ctx, enum uacce_qfrt qfrt)
 
 	size = ctx->qfrs_offs[qfrt];
 
-	addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->fd, off);
-	if (addr == MAP_FAILED) {
+	if (ctx->emu)
+		addr = wd_emu_mmap(ctx->emu, qfrt, size);
+	else
+		addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			    ctx->fd, off);
+	if (!addr || addr == MAP_FAILED) {
 		WD_ERR("failed to mmap, qfrt = %d, err = %d!\n", qfrt, -errno);
 		return NULL;
 	}
@@ -554,6 +612,21 @@ int wd_ctx_set_priv(handle_t h_ctx, void *priv)
 	return 0;
 }
 
+bool wd_ctx_is_emu(handle_t h_ctx)
+{
+	struct wd_ctx_h	*ctx = (struct wd_ctx_h *)h_ctx;
+
+	return ctx && ctx->emu;
+}
+
+void wd_ctx_emu_db(handle_t h_ctx, __u8 cmd, __u16 index)
+{
+	struct wd_ctx_h	*ctx = (struct wd_ctx_h *)h_ctx;
+
+	if (ctx && ctx->emu)
+		wd_emu_doorbell(ctx->emu, cmd, index);
+}
+
 char *wd_ctx_get_api(handle_t h_ctx)
 {
 	struct wd_ctx_h	*ctx = (struct wd_ctx_h *)h_ctx;
@@ -573,6 +646,9 @@ int wd_ctx_wait(handle_t h_ctx, __u16 ms)
 	if (!ctx)
 		return -WD_EINVAL;
 
+	if (ctx->emu)
+		return wd_emu_wait(ctx->emu, ms);
+
 	fds[0].fd = ctx->fd;
 	fds[0].events = POLLIN;
 	ret = poll(fds, 1, ms);
@@ -619,77 +695,14 @@ int wd_get_avail_ctx(struct uacce_dev *dev)
 	return avail_ctx;
 }
 
-static int get_dev_alg_name(const char *d_name, char *dev_alg_name, size_t sz)
-{
-	char dev_path[MAX_DEV_NAME_LEN] = {0};
-	__u32 size;
-	int ret;
-
-	ret = snprintf(dev_path, MAX_DEV_NAME_LEN, "%s/%s",
-		       SYS_CLASS_DIR, d_name);
-	if (ret < 0)
-		return ret;
-	else if (ret > MAX_DEV_NAME_LEN)
-		return -WD_EINVAL;
-
-	ret = get_raw_attr(dev_path, "algorithms", dev_alg_name, sz);
-	if (ret < 0) {
-		dev_alg_name[0] = '\0';
-		return ret;
-	}
-
-	size = ret;
-	if (size == sz)
-		dev_alg_name[sz - 1] = '\0';
-
-	return 0;
-}
-
-static bool dev_has_alg(const char *dev_alg_name, const char *alg_name)
-{
-	char *str;
-
-	str = strstr(dev_alg_name, alg_name);
-	if (!str)
-		return false;
-
-	if (*(str + strlen(alg_name)) == '\n' &&
-	    ((str > dev_alg_name && *(str - 1) == '\n') || str == dev_alg_name))
-		return true;
-
-	return false;
-}
-
-static int check_alg_name(const char *alg_name)
-{
-	int i = 0;
-
-	if (!alg_name)
-		return -WD_EINVAL;
-
-	while (alg_name[i] != '\0') {
-		i++;
-		if (i >= MAX_ATTR_STR_SIZE) {
-			WD_ERR("failed to get list, alg name is too long!\n");
-			return -WD_EINVAL;
-		}
-	}
-
-	return 0;
-}
-
-struct uacce_dev_list *wd_get_accel_list(const char *alg_name)
+struct uacce_dev_list *wd_scan_accel_list(const char *class_dir)
 {
-	struct uacce_dev_list *node, *head = NULL;
-	char dev_alg_name[MAX_ATTR_STR_SIZE];
+	struct uacce_dev_list *node, *head = NULL, *tail = NULL;
 	struct dirent *dev_dir;
 	DIR *wd_class;
 	int ret;
 
-	if (check_alg_name(alg_name))
-		return NULL;
-
-	wd_class = opendir(SYS_CLASS_DIR);
+	wd_class = opendir(class_dir);
 	if (!wd_class) {
 		WD_ERR("UADK framework isn't enabled in system!\n");
 		return NULL;
@@ -700,38 +713,28 @@ struct uacce_dev_list *wd_get_accel_list(const char *alg_name)
 		    !strncmp(dev_dir->d_name, "..", LINUX_PRTDIR_SIZE))
 			continue;
 
-		ret = access_attr(SYS_CLASS_DIR, dev_dir->d_name, F_OK);
+		ret = access_attr(class_dir, dev_dir->d_name, F_OK);
 		if (ret < 0) {
 			WD_ERR("failed to access dev: %s, ret: %d\n",
 				    dev_dir->d_name, ret);
 			continue;
 		}
 
-		ret = get_dev_alg_name(dev_dir->d_name, dev_alg_name,
-				       sizeof(dev_alg_name));
-		if (ret < 0) {
-			WD_ERR("failed to get dev: %s alg name!\n", dev_dir->d_name);
-			continue;
-		}
-
-		if (!dev_has_alg(dev_alg_name, alg_name))
-			continue;
-
 		node = calloc(1, sizeof(*node));
 		if (!node)
 			goto free_list;
 
-		node->dev = read_uacce_sysfs(dev_dir->d_name);
+		node->dev = read_uacce_sysfs(class_dir, dev_dir->d_name);
 		if (!node->dev) {
 			free(node);
-			node = NULL;
 			continue;
 		}
 
 		if (!head)
 			head = node;
 		else
-			wd_add_dev_to_list(head, node);
+			tail->next = node;
+		tail = node;
 	}
 
 	closedir(wd_class);
@@ -836,6 +839,9 @@ int wd_ctx_set_io_cmd(handle_t h_ctx, unsigned long cmd, void *arg)
 	if (!ctx)
 		return -WD_EINVAL;
 
+	if (ctx->emu)
+		return wd_emu_ioctl(ctx->emu, cmd, arg);
+
 	if (!arg)
 		return ioctl(ctx->fd, cmd);
 
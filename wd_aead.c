@@ -57,6 +57,8 @@ struct wd_aead_sess {
 	__u8			iv[MAX_IV_SIZE];
 	/* Total of data for stream mode */
 	__u64			long_data_len;
+	/* Expanded keys of the soft GCM computing of drivers */
+	struct wd_aead_soft_key	soft_key;
 };
 
 struct wd_env_config wd_aead_env_config;
@@ -198,8 +200,12 @@ int wd_aead_set_ckey(handle_t h_sess, const __u8 *key, __u16 key_len)
 		return -WD_EINVAL;
 	}
 
+	/* The soft keys may be expanded from the old key at the same time */
+	pthread_spin_lock(&sess->soft_key.lock);
 	sess->ckey_bytes = key_len;
 	memcpy(sess->ckey, key, key_len);
+	__atomic_store_n(&sess->soft_key.valid, false, __ATOMIC_RELEASE);
+	pthread_spin_unlock(&sess->soft_key.lock);
 
 	return 0;
 }
@@ -346,6 +352,8 @@ handle_t wd_aead_alloc_sess(struct wd_aead_sess_setup *setup)
 		goto err_sess;
 	}
 
+	(void)pthread_spin_init(&sess->soft_key.lock, PTHREAD_PROCESS_PRIVATE);
+
 	return (handle_t)sess;
 err_sess:
 	if (sess->sched_key)
@@ -365,6 +373,8 @@ void wd_aead_free_sess(handle_t h_sess)
 
 	wd_memset_zero(sess->ckey, sess->ckey_bytes);
 	wd_memset_zero(sess->akey, sess->akey_bytes);
+	pthread_spin_destroy(&sess->soft_key.lock);
+	wd_memset_zero(&sess->soft_key, sizeof(sess->soft_key));
 
 	if (sess->sched_key)
 		free(sess->sched_key);
@@ -449,6 +459,15 @@ static int wd_aead_init_nolock(struct wd_ctx_config *config, struct wd_sched *sc
 	if (ret < 0)
 		return ret;
 
+	ret = wd_set_wait_policy("WD_AEAD_WAIT_POLICY", &wd_aead_setting.config);
+	if (ret < 0)
+		return ret;
+
+	ret = wd_set_fallback_depth("WD_AEAD_FALLBACK_DEPTH",
+				    &wd_aead_setting.config.fb_depth);
+	if (ret < 0)
+		return ret;
+
 	ret = wd_init_ctx_config(&wd_aead_setting.config, config);
 	if (ret)
 		return ret;
@@ -457,6 +476,8 @@ static int wd_aead_init_nolock(struct wd_ctx_config *config, struct wd_sched *sc
 	if (ret < 0)
 		goto out_clear_ctx_config;
 
+	wd_init_sched_load(sched, &wd_aead_setting.config, &wd_aead_setting.pool);
+
 	/* init async request pool */
 	ret = wd_init_async_request_pool(&wd_aead_setting.pool,
 					config, WD_POOL_MAX_ENTRIES,
@@ -712,6 +733,7 @@ static void fill_request_msg(struct wd_aead_msg *msg, struct wd_aead_req *req,
 	msg->out_bytes = req->out_bytes;
 	msg->ckey = sess->ckey;
 	msg->ckey_bytes = sess->ckey_bytes;
+	msg->soft_key = &sess->soft_key;
 	msg->akey = sess->akey;
 	msg->akey_bytes = sess->akey_bytes;
 	msg->iv = req->iv;
@@ -734,14 +756,28 @@ static int send_recv_sync(struct wd_ctx_internal *ctx,
 	msg_handle.send = wd_aead_setting.driver->send;
 	msg_handle.recv = wd_aead_setting.driver->recv;
 
+	wd_ctx_inflight_add(ctx, 1);
 	pthread_spin_lock(&ctx->lock);
-	ret = wd_handle_msg_sync(wd_aead_setting.driver, &msg_handle, ctx->ctx,
-				 msg, NULL, wd_aead_setting.config.epoll_en);
+	ret = wd_handle_msg_sync(wd_aead_setting.driver, &msg_handle,
+				 &wd_aead_setting.config, ctx, msg,
+				 msg->in_bytes, NULL);
 	pthread_spin_unlock(&ctx->lock);
+	wd_ctx_inflight_sub(ctx, 1);
 
 	return ret;
 }
 
+/*
+ * The state of a stream message is kept in the format of the hardware,
+ * so only the block message can be done by the fallback driver.
+ */
+static bool wd_aead_fallback_en(struct wd_aead_req *req)
+{
+	return req->msg_state == AEAD_MSG_BLOCK &&
+	       wd_alg_fallback_en(wd_aead_setting.driver,
+				  &wd_aead_setting.config);
+}
+
 int wd_do_aead_sync(handle_t h_sess, struct wd_aead_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_aead_setting.config;
@@ -766,14 +802,40 @@ int wd_do_aead_sync(handle_t h_sess, struct wd_aead_req *req)
 	if (unlikely(ret))
 		return ret;
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ctx = config->ctxs + idx;
 	ret = send_recv_sync(ctx, &msg);
+	if (likely(!ret))
+		wd_dfx_msg_done(config, idx, msg.in_bytes, msg.out_bytes);
+	else if (ret == -WD_EBUSY && wd_aead_fallback_en(req))
+		ret = wd_alg_do_fallback(wd_aead_setting.driver,
+					 &wd_aead_setting.config, &msg);
 	req->state = msg.result;
 
 	return ret;
 }
 
+/* The overflow request is done by the fallback driver and called back at once */
+static int wd_aead_async_fallback(struct wd_aead_sess *sess,
+				  struct wd_aead_req *req)
+{
+	struct wd_aead_msg msg;
+	int ret;
+
+	memset(&msg, 0, sizeof(struct wd_aead_msg));
+	fill_request_msg(&msg, req, sess);
+
+	ret = wd_alg_do_fallback(wd_aead_setting.driver,
+				 &wd_aead_setting.config, &msg);
+	if (unlikely(ret))
+		return ret;
+
+	msg.req.state = msg.result;
+	msg.req.cb(&msg.req, msg.req.cb_param);
+
+	return 0;
+}
+
 int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_aead_setting.config;
@@ -792,6 +854,13 @@ int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req)
 		return -WD_EINVAL;
 	}
 
+	/* A soft driver does the request in send, it has nothing to poll */
+	if (unlikely(wd_aead_setting.driver->calc_type == UADK_ALG_SOFT)) {
+		WD_ERR("invalid: %s driver doesn't support async aead!\n",
+		       wd_aead_setting.driver->drv_name);
+		return -WD_EINVAL;
+	}
+
 	idx = wd_aead_setting.sched.pick_next_ctx(
 		wd_aead_setting.sched.h_sched_ctx,
 		sess->sched_key, CTX_MODE_ASYNC);
@@ -801,9 +870,17 @@ int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req)
 
 	ctx = config->ctxs + idx;
 
+	if (wd_aead_fallback_en(req) &&
+	    wd_alg_fallback_check(wd_aead_setting.driver, config,
+				  &wd_aead_setting.pool, idx))
+		return wd_aead_async_fallback(sess, req);
+
 	msg_id = wd_get_msg_from_pool(&wd_aead_setting.pool,
 				     idx, (void **)&msg);
 	if (unlikely(msg_id < 0)) {
+		if (msg_id == -WD_EBUSY && wd_aead_fallback_en(req))
+			return wd_aead_async_fallback(sess, req);
+
 		WD_ERR("failed to get msg from pool!\n");
 		return msg_id;
 	}
@@ -813,13 +890,19 @@ int wd_do_aead_async(handle_t h_sess, struct wd_aead_req *req)
 
 	ret = wd_alg_driver_send(wd_aead_setting.driver, ctx->ctx, msg);
 	if (unlikely(ret < 0)) {
+		wd_dfx_msg_err(config, idx, ret);
+		if (ret == -WD_EBUSY && wd_aead_fallback_en(req)) {
+			wd_put_msg_to_pool(&wd_aead_setting.pool, idx, msg->tag);
+			return wd_aead_async_fallback(sess, req);
+		}
+
 		if (ret != -WD_EBUSY)
 			WD_ERR("failed to send BD, hw is err!\n");
 
 		goto fail_with_msg;
 	}
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ret = wd_add_task_to_async_queue(&wd_aead_env_config, idx);
 	if (ret)
 		goto fail_with_msg;
@@ -831,6 +914,151 @@ fail_with_msg:
 	return ret;
 }
 
+static int wd_aead_check_batch(struct wd_aead_sess *sess,
+			       struct wd_aead_req **reqs,
+			       __u32 num, __u8 mode)
+{
+	__u32 i;
+	int ret;
+
+	if (unlikely(!reqs || !num || num > WD_MAX_BATCH_NUM)) {
+		WD_ERR("invalid: aead batch reqs is NULL or num %u is error!\n", num);
+		return -WD_EINVAL;
+	}
+
+	/* A soft driver does the request in send, it has nothing to poll */
+	if (unlikely(mode == CTX_MODE_ASYNC &&
+		     wd_aead_setting.driver->calc_type == UADK_ALG_SOFT)) {
+		WD_ERR("invalid: %s driver doesn't support async aead!\n",
+		       wd_aead_setting.driver->drv_name);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < num; i++) {
+		ret = wd_aead_param_check(sess, reqs[i]);
+		if (unlikely(ret))
+			return -WD_EINVAL;
+
+		if (unlikely(mode == CTX_MODE_ASYNC && !reqs[i]->cb)) {
+			WD_ERR("invalid: aead input req cb is NULL!\n");
+			return -WD_EINVAL;
+		}
+
+		/* Stream messages depend on each other, they can't be in one batch */
+		if (unlikely(reqs[i]->msg_state != AEAD_MSG_BLOCK)) {
+			WD_ERR("invalid: aead batch only supports block message!\n");
+			return -WD_EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int wd_do_aead_sync_batch(handle_t h_sess, struct wd_aead_req **reqs, __u32 num)
+{
+	struct wd_ctx_config_internal *config = &wd_aead_setting.config;
+	struct wd_aead_sess *sess = (struct wd_aead_sess *)h_sess;
+	struct wd_aead_msg msgs[WD_MAX_BATCH_NUM];
+	void *msg_list[WD_MAX_BATCH_NUM];
+	struct wd_msg_handle msg_handle;
+	struct wd_ctx_internal *ctx;
+	__u32 idx, i;
+	int ret;
+
+	ret = wd_aead_check_batch(sess, reqs, num, CTX_MODE_SYNC);
+	if (unlikely(ret))
+		return ret;
+
+	memset(msgs, 0, sizeof(struct wd_aead_msg) * num);
+	for (i = 0; i < num; i++) {
+		fill_request_msg(&msgs[i], reqs[i], sess);
+		reqs[i]->state = 0;
+		msgs[i].tag = i;
+		msg_list[i] = &msgs[i];
+	}
+
+	idx = wd_aead_setting.sched.pick_next_ctx(
+		wd_aead_setting.sched.h_sched_ctx,
+		sess->sched_key, CTX_MODE_SYNC);
+	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
+	if (unlikely(ret))
+		return ret;
+
+	ctx = config->ctxs + idx;
+
+	msg_handle.send = wd_aead_setting.driver->send;
+	msg_handle.recv = wd_aead_setting.driver->recv;
+
+	wd_ctx_inflight_add(ctx, num);
+	pthread_spin_lock(&ctx->lock);
+	ret = wd_handle_msg_sync_batch(wd_aead_setting.driver, &msg_handle, config,
+				       ctx, msg_list, num, msgs[0].in_bytes, NULL);
+	pthread_spin_unlock(&ctx->lock);
+	wd_ctx_inflight_sub(ctx, num);
+
+	for (i = 0; i < num; i++) {
+		reqs[i]->state = msgs[i].result;
+		if (likely(!ret))
+			wd_dfx_msg_done(config, idx, msgs[i].in_bytes, msgs[i].out_bytes);
+	}
+
+	return ret;
+}
+
+int wd_do_aead_async_batch(handle_t h_sess, struct wd_aead_req **reqs,
+			   __u32 num, __u32 *count)
+{
+	struct wd_ctx_config_internal *config = &wd_aead_setting.config;
+	struct wd_aead_sess *sess = (struct wd_aead_sess *)h_sess;
+	void *msg_list[WD_MAX_BATCH_NUM];
+	__u32 tags[WD_MAX_BATCH_NUM];
+	struct wd_aead_msg *msg;
+	int msg_id, ret;
+	__u32 idx, i;
+
+	if (unlikely(!count)) {
+		WD_ERR("invalid: aead batch count is NULL!\n");
+		return -WD_EINVAL;
+	}
+	*count = 0;
+
+	ret = wd_aead_check_batch(sess, reqs, num, CTX_MODE_ASYNC);
+	if (unlikely(ret))
+		return ret;
+
+	idx = wd_aead_setting.sched.pick_next_ctx(
+		wd_aead_setting.sched.h_sched_ctx,
+		sess->sched_key, CTX_MODE_ASYNC);
+	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		msg_id = wd_get_msg_from_pool(&wd_aead_setting.pool,
+					      idx, (void **)&msg);
+		if (unlikely(msg_id < 0)) {
+			if (!i) {
+				WD_ERR("failed to get msg from pool!\n");
+				return msg_id;
+			}
+			break;
+		}
+
+		fill_request_msg(msg, reqs[i], sess);
+		msg->tag = msg_id;
+		msg_list[i] = msg;
+		tags[i] = msg_id;
+	}
+
+	ret = wd_send_async_batch(wd_aead_setting.driver, config,
+				  &wd_aead_setting.pool, &wd_aead_env_config,
+				  idx, msg_list, tags, i, count);
+	if (unlikely(ret))
+		return ret;
+
+	return *count < num ? -WD_EBUSY : 0;
+}
+
 struct wd_aead_msg *wd_aead_get_msg(__u32 idx, __u32 tag)
 {
 	return wd_find_msg_in_pool(&wd_aead_setting.pool, idx, tag);
@@ -876,6 +1104,7 @@ int wd_aead_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 			return -WD_EINVAL;
 		}
 
+		wd_dfx_msg_done(config, idx, msg->in_bytes, msg->out_bytes);
 		msg->tag = resp_msg.tag;
 		msg->req.state = resp_msg.result;
 		req = &msg->req;
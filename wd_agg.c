@@ -7,6 +7,7 @@
 #include <pthread.h>
 #include <sched.h>
 #include <limits.h>
+#include <sys/mman.h>
 #include "include/drv/wd_agg_drv.h"
 #include "wd_agg.h"
 
@@ -18,6 +19,19 @@
 /* Sum of the max row number of standard and external hash table */
 #define MAX_HASH_TABLE_ROW_NUM		0x1FFFFFFFE
 
+/* Hash table owned by the session */
+#define MANAGED_MIN_STD_ROWS		1024
+#define MANAGED_MAX_STD_ROWS		(1ULL << 31)
+#define MANAGED_LOAD_RATE		75
+#define MANAGED_EXT_ROW_RATIO		4
+#define MANAGED_TABLE_ALIGN		4096
+#define MANAGED_DEF_GROWTH		2
+#define MANAGED_REHASH_ROWS		1024
+#define MANAGED_COL_ALIGN		16
+#define DAE_DEF_VCHAR_SIZE		30
+#define DAE_PERCENT			100
+#define WD_AGG_ALIGN(x, a)		(((x) + (a) - 1) & ~((__u64)(a) - 1))
+
 enum wd_agg_sess_state {
 	WD_AGG_SESS_UNINIT, /* Uninit session */
 	WD_AGG_SESS_INIT, /* Hash table has been set */
@@ -54,6 +68,29 @@ struct wd_agg_sess_agg_conf {
 	enum wd_dae_data_type count_all_data_type;
 };
 
+struct wd_agg_table_mem {
+	void *addr;
+	__u64 size;
+	handle_t blkpool;
+};
+
+/*
+ * The hash table owned by a session, see wd_agg_set_managed_table.
+ * @lock: The sync inputs of the session are serialized by it, so the table
+ * grows under it and no input sees the session state of the rehash.
+ * @cols: The output cols of the rehash, the key cols then the agg cols,
+ * followed by the same number of cols as their initial values.
+ */
+struct wd_agg_table_mgr {
+	struct wd_agg_table_setup setup;
+	struct wd_agg_table_mem mem;
+	pthread_mutex_t lock;
+	__u64 grow_num;
+	struct wd_dae_col_addr *cols;
+	__u8 *sum_overflow_cols;
+	void *buf;
+};
+
 struct wd_agg_sess {
 	char *alg_name;
 	wd_dev_mask_t *dev_mask;
@@ -67,6 +104,9 @@ struct wd_agg_sess {
 	struct wd_dae_charset charset_info;
 	struct wd_dae_hash_table hash_table;
 	struct wd_dae_hash_table rehash_table;
+	/* The session is done by the fallback driver of TASK_MIX */
+	bool fallback;
+	struct wd_agg_table_mgr *table_mgr;
 };
 
 static char *wd_agg_alg_name = "hashagg";
@@ -225,7 +265,7 @@ static int check_agg_cols_info(struct wd_agg_sess_setup *setup, __u32 *out_agg_c
 			return ret;
 		}
 
-		if (!info[i].col_alg_num || info[i].col_alg_num > WD_AGG_ALG_TYPE_MAX) {
+		if (!info[i].col_alg_num || info[i].col_alg_num > WD_AGG_MAX_COL_ALGS) {
 			WD_ERR("failed to check agg col_alg_num: %u! col idx: %u\n",
 			       info[i].col_alg_num, i);
 			return -WD_EINVAL;
@@ -245,6 +285,9 @@ static int check_agg_cols_info(struct wd_agg_sess_setup *setup, __u32 *out_agg_c
 				return -WD_EINVAL;
 			}
 			alg_cnt[alg] += 1;
+			/* The count of avg is in the next output col */
+			if (alg == WD_AGG_AVG)
+				k++;
 		}
 	}
 
@@ -332,11 +375,16 @@ static int fill_agg_session(struct wd_agg_sess *sess, struct wd_agg_sess_setup *
 					     sess->agg_conf.data_size, i);
 
 	sess->agg_conf.out_data_size = sess->agg_conf.data_size + setup->agg_cols_num;
-	for (i = 0, k = 0; i < setup->agg_cols_num; i++)
-		for (j = 0; j < agg[i].col_alg_num; j++, k++)
+	for (i = 0, k = 0; i < setup->agg_cols_num; i++) {
+		for (j = 0; j < agg[i].col_alg_num; j++, k++) {
 			(void)get_col_data_type_size(agg[i].output_data_types[j],
 						     agg[i].col_data_info,
 						     sess->agg_conf.out_data_size, k);
+			if (agg[i].output_col_algs[j] == WD_AGG_AVG)
+				(void)get_col_data_type_size(WD_DAE_LONG, 0,
+							     sess->agg_conf.out_data_size, ++k);
+		}
+	}
 
 	sess->key_conf.cols_num = setup->key_cols_num;
 	sess->agg_conf.cols_num = setup->agg_cols_num;
@@ -382,6 +430,30 @@ static int wd_agg_init_sess_priv(struct wd_agg_sess *sess, struct wd_agg_sess_se
 	return WD_SUCCESS;
 }
 
+/* The hash table of the session is in the format of the fallback driver */
+static int wd_agg_init_fallback_sess(struct wd_agg_sess *sess, struct wd_agg_sess_setup *setup)
+{
+	struct wd_alg_driver *fb_drv = (struct wd_alg_driver *)wd_agg_setting.driver->fallback;
+	int ret;
+
+	memset(&sess->ops, 0, sizeof(struct wd_agg_ops));
+	sess->priv = NULL;
+	sess->hash_table.table_row_size = 0;
+	if (!fb_drv->get_extend_ops || fb_drv->get_extend_ops(&sess->ops)) {
+		WD_ERR("failed to get agg fallback extend ops!\n");
+		return -WD_EINVAL;
+	}
+
+	ret = wd_agg_init_sess_priv(sess, setup);
+	if (ret)
+		return ret;
+
+	WD_INFO("agg session is done by the soft driver %s!\n", fb_drv->drv_name);
+	sess->fallback = true;
+
+	return WD_SUCCESS;
+}
+
 handle_t wd_agg_alloc_sess(struct wd_agg_sess_setup *setup)
 {
 	__u32 out_agg_cols_num = 0;
@@ -422,6 +494,8 @@ handle_t wd_agg_alloc_sess(struct wd_agg_sess_setup *setup)
 	}
 
 	ret = wd_agg_init_sess_priv(sess, setup);
+	if (ret && wd_agg_setting.driver->fallback)
+		ret = wd_agg_init_fallback_sess(sess, setup);
 	if (ret)
 		goto err_sess;
 
@@ -443,6 +517,36 @@ err_sess:
 	return (handle_t)0;
 }
 
+static void wd_agg_table_mem_free(struct wd_agg_table_mem *mem)
+{
+	if (!mem->addr)
+		return;
+
+	if (mem->blkpool) {
+		wd_block_free(mem->blkpool, mem->addr);
+		wd_blockpool_destroy(mem->blkpool);
+	} else {
+		munmap(mem->addr, mem->size);
+	}
+
+	memset(mem, 0, sizeof(struct wd_agg_table_mem));
+}
+
+static void wd_agg_table_mgr_free(struct wd_agg_sess *sess)
+{
+	struct wd_agg_table_mgr *mgr = sess->table_mgr;
+
+	if (!mgr)
+		return;
+
+	wd_agg_table_mem_free(&mgr->mem);
+	pthread_mutex_destroy(&mgr->lock);
+	free(mgr->buf);
+	free(mgr->cols);
+	free(mgr);
+	sess->table_mgr = NULL;
+}
+
 void wd_agg_free_sess(handle_t h_sess)
 {
 	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
@@ -452,6 +556,7 @@ void wd_agg_free_sess(handle_t h_sess)
 		return;
 	}
 
+	wd_agg_table_mgr_free(sess);
 	free(sess->key_conf.cols_info);
 	free(sess->agg_conf.cols_info);
 	free(sess->key_conf.data_size);
@@ -504,18 +609,12 @@ static int wd_agg_check_sess_state(struct wd_agg_sess *sess, enum wd_agg_sess_st
 	return WD_SUCCESS;
 }
 
-int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info)
+static int wd_agg_set_hash_table_inner(struct wd_agg_sess *sess, struct wd_dae_hash_table *info)
 {
-	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
 	struct wd_dae_hash_table *hash_table, *rehash_table;
 	enum wd_agg_sess_state expected;
 	int ret;
 
-	if (!sess || !info) {
-		WD_ERR("invalid: agg sess or hash table is NULL!\n");
-		return -WD_EINVAL;
-	}
-
 	ret = wd_agg_check_sess_state(sess, &expected);
 	if (ret)
 		return ret;
@@ -565,6 +664,307 @@ out:
 	return ret;
 }
 
+int wd_agg_set_hash_table(handle_t h_sess, struct wd_dae_hash_table *info)
+{
+	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
+
+	if (!sess || !info) {
+		WD_ERR("invalid: agg sess or hash table is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (sess->table_mgr) {
+		WD_ERR("invalid: agg sess hash table is managed by the session!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_agg_set_hash_table_inner(sess, info);
+}
+
+/* The extend table follows the standard table in the same memory */
+static __u64 wd_agg_table_size(__u32 row_size, __u64 std_rows)
+{
+	return WD_AGG_ALIGN(std_rows * row_size, MANAGED_TABLE_ALIGN) +
+	       std_rows / MANAGED_EXT_ROW_RATIO * row_size;
+}
+
+static int wd_agg_table_mem_alloc(struct wd_agg_sess *sess, __u64 std_rows,
+				  struct wd_agg_table_mem *mem, struct wd_dae_hash_table *info)
+{
+	struct wd_agg_table_mgr *mgr = sess->table_mgr;
+	__u32 row_size = sess->hash_table.table_row_size;
+	__u64 size = wd_agg_table_size(row_size, std_rows);
+	handle_t blkpool;
+
+	if (std_rows > MANAGED_MAX_STD_ROWS ||
+	    (mgr->setup.max_size && size > mgr->setup.max_size)) {
+		WD_ERR("agg managed table of %llu rows is over the limit!\n", std_rows);
+		return -WD_ENOMEM;
+	}
+
+	if (mgr->setup.mempool) {
+		blkpool = wd_blockpool_create(mgr->setup.mempool, size, 1);
+		if (WD_IS_ERR(blkpool)) {
+			WD_ERR("failed to create agg table blockpool, size: %llu!\n", size);
+			return -WD_ENOMEM;
+		}
+
+		mem->addr = wd_block_alloc(blkpool);
+		if (!mem->addr) {
+			WD_ERR("failed to alloc agg table block, size: %llu!\n", size);
+			wd_blockpool_destroy(blkpool);
+			return -WD_ENOMEM;
+		}
+		mem->blkpool = blkpool;
+	} else {
+		mem->addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem->addr == MAP_FAILED) {
+			WD_ERR("failed to map agg table, size: %llu!\n", size);
+			mem->addr = NULL;
+			return -WD_ENOMEM;
+		}
+		mem->blkpool = 0;
+	}
+	mem->size = size;
+
+	info->table_row_size = row_size;
+	info->std_table = mem->addr;
+	info->std_table_row_num = std_rows;
+	info->ext_table = (__u8 *)mem->addr + WD_AGG_ALIGN(std_rows * row_size, MANAGED_TABLE_ALIGN);
+	info->ext_table_row_num = std_rows / MANAGED_EXT_ROW_RATIO;
+
+	return WD_SUCCESS;
+}
+
+/* Size of a row of the rehash output col, key cols then agg cols */
+static __u64 wd_agg_rehash_col_size(struct wd_agg_sess *sess, __u32 idx, bool *is_vchar)
+{
+	struct wd_key_col_info *key;
+	__u32 k;
+
+	*is_vchar = false;
+	if (idx < sess->key_conf.cols_num) {
+		key = sess->key_conf.cols_info + idx;
+		if (key->input_data_type != WD_DAE_VARCHAR)
+			return sess->key_conf.data_size[idx];
+
+		*is_vchar = true;
+		return key->col_data_info ? key->col_data_info : DAE_DEF_VCHAR_SIZE;
+	}
+
+	k = idx - sess->key_conf.cols_num;
+	if (sess->agg_conf.is_count_all && k == sess->agg_conf.out_cols_num - 1)
+		return DAE_LONG_SIZE;
+
+	return sess->agg_conf.out_data_size[k];
+}
+
+static int wd_agg_rehash_cols_init(struct wd_agg_sess *sess, struct wd_agg_table_mgr *mgr)
+{
+	__u32 cols_num = sess->key_conf.cols_num + sess->agg_conf.out_cols_num;
+	__u64 rows = MANAGED_REHASH_ROWS;
+	struct wd_dae_col_addr *col;
+	__u64 size, pos;
+	bool is_vchar;
+	__u8 *buf;
+	__u32 i;
+
+	pos = WD_AGG_ALIGN(sess->agg_conf.out_cols_num, MANAGED_COL_ALIGN);
+	for (i = 0; i < cols_num; i++) {
+		size = wd_agg_rehash_col_size(sess, i, &is_vchar);
+		pos += WD_AGG_ALIGN(rows, MANAGED_COL_ALIGN) +
+		       WD_AGG_ALIGN(rows * size, MANAGED_COL_ALIGN);
+		if (is_vchar)
+			pos += WD_AGG_ALIGN((rows + 1) * sizeof(__u32), MANAGED_COL_ALIGN);
+	}
+
+	mgr->cols = calloc(cols_num * 2, sizeof(struct wd_dae_col_addr));
+	mgr->buf = calloc(1, pos);
+	if (!mgr->cols || !mgr->buf) {
+		WD_ERR("failed to alloc agg managed table rehash cols!\n");
+		return -WD_ENOMEM;
+	}
+
+	buf = mgr->buf;
+	mgr->sum_overflow_cols = buf;
+	pos = WD_AGG_ALIGN(sess->agg_conf.out_cols_num, MANAGED_COL_ALIGN);
+	for (i = 0; i < cols_num; i++) {
+		col = mgr->cols + cols_num + i;
+		size = wd_agg_rehash_col_size(sess, i, &is_vchar);
+		col->empty = buf + pos;
+		col->empty_size = rows;
+		pos += WD_AGG_ALIGN(rows, MANAGED_COL_ALIGN);
+		col->value = buf + pos;
+		col->value_size = rows * size;
+		pos += WD_AGG_ALIGN(rows * size, MANAGED_COL_ALIGN);
+		if (is_vchar) {
+			col->offset = (__u32 *)(buf + pos);
+			col->offset_size = (rows + 1) * sizeof(__u32);
+			pos += WD_AGG_ALIGN(col->offset_size, MANAGED_COL_ALIGN);
+		}
+	}
+
+	return WD_SUCCESS;
+}
+
+int wd_agg_set_managed_table(handle_t h_sess, struct wd_agg_table_setup *setup)
+{
+	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
+	struct wd_dae_hash_table info = {0};
+	__u64 rows = MANAGED_MIN_STD_ROWS;
+	struct wd_agg_table_mgr *mgr;
+	int ret;
+
+	if (!sess || !setup) {
+		WD_ERR("invalid: agg sess or managed table setup is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (setup->growth && (setup->growth < MANAGED_DEF_GROWTH ||
+			      setup->growth & (setup->growth - 1))) {
+		WD_ERR("invalid: agg managed table growth %u is not a power of 2!\n",
+		       setup->growth);
+		return -WD_EINVAL;
+	}
+
+	if (sess->table_mgr || sess->hash_table.std_table) {
+		WD_ERR("invalid: agg sess hash table has been set!\n");
+		return -WD_EINVAL;
+	}
+
+	mgr = calloc(1, sizeof(struct wd_agg_table_mgr));
+	if (!mgr) {
+		WD_ERR("failed to alloc agg managed table!\n");
+		return -WD_ENOMEM;
+	}
+
+	memcpy(&mgr->setup, setup, sizeof(struct wd_agg_table_setup));
+	if (!mgr->setup.growth)
+		mgr->setup.growth = MANAGED_DEF_GROWTH;
+
+	ret = pthread_mutex_init(&mgr->lock, NULL);
+	if (ret) {
+		free(mgr);
+		return -WD_EINVAL;
+	}
+	sess->table_mgr = mgr;
+
+	ret = wd_agg_rehash_cols_init(sess, mgr);
+	if (ret)
+		goto out_free;
+
+	while (rows < MANAGED_MAX_STD_ROWS &&
+	       rows * MANAGED_LOAD_RATE / DAE_PERCENT < setup->cardinality)
+		rows <<= 1;
+
+	/* A large hint is cut down to the limit, the table grows later if needed */
+	while (rows > MANAGED_MIN_STD_ROWS && setup->max_size &&
+	       wd_agg_table_size(sess->hash_table.table_row_size, rows) > setup->max_size)
+		rows >>= 1;
+
+	ret = wd_agg_table_mem_alloc(sess, rows, &mgr->mem, &info);
+	if (ret)
+		goto out_free;
+
+	ret = wd_agg_set_hash_table_inner(sess, &info);
+	if (ret)
+		goto out_free;
+
+	return WD_SUCCESS;
+
+out_free:
+	wd_agg_table_mgr_free(sess);
+	return ret;
+}
+
+/*
+ * Move the groups to a larger table, it is called with the lock of the
+ * table held. It returns -WD_ENOMEM if the table can not grow and is kept,
+ * or -WD_EIO if the groups are lost in rehash.
+ */
+static int wd_agg_table_grow(struct wd_agg_sess *sess)
+{
+	struct wd_agg_table_mgr *mgr = sess->table_mgr;
+	__u32 cols_num = sess->key_conf.cols_num + sess->agg_conf.out_cols_num;
+	struct wd_agg_table_mem mem = {0};
+	struct wd_dae_hash_table info = {0};
+	struct wd_agg_req req = {0};
+	int ret;
+
+	ret = wd_agg_table_mem_alloc(sess, (__u64)sess->hash_table.std_table_row_num *
+				     mgr->setup.growth, &mem, &info);
+	if (ret)
+		return ret;
+
+	ret = wd_agg_set_hash_table_inner(sess, &info);
+	if (ret) {
+		wd_agg_table_mem_free(&mem);
+		return -WD_ENOMEM;
+	}
+
+	/* The rehash changes the sizes of the cols */
+	memcpy(mgr->cols, mgr->cols + cols_num, cols_num * sizeof(struct wd_dae_col_addr));
+	req.out_key_cols = mgr->cols;
+	req.out_key_cols_num = sess->key_conf.cols_num;
+	req.out_agg_cols = mgr->cols + sess->key_conf.cols_num;
+	req.out_agg_cols_num = sess->agg_conf.out_cols_num;
+	req.out_row_count = MANAGED_REHASH_ROWS;
+	req.sum_overflow_cols = mgr->sum_overflow_cols;
+	ret = wd_agg_rehash_sync((handle_t)sess, &req);
+
+	wd_agg_table_mem_free(&mgr->mem);
+	memcpy(&mgr->mem, &mem, sizeof(struct wd_agg_table_mem));
+	if (ret) {
+		WD_ERR("failed to rehash agg managed table!\n");
+		return -WD_EIO;
+	}
+	mgr->grow_num++;
+
+	return WD_SUCCESS;
+}
+
+int wd_agg_get_table_stats(handle_t h_sess, struct wd_agg_table_stats *stats)
+{
+	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
+	int ret;
+
+	if (!sess || !stats) {
+		WD_ERR("invalid: agg sess or table stats is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	if (!sess->hash_table.std_table) {
+		WD_ERR("invalid: agg sess hash table is not set!\n");
+		return -WD_EINVAL;
+	}
+
+	memset(stats, 0, sizeof(struct wd_agg_table_stats));
+	stats->std_table_row_num = sess->hash_table.std_table_row_num;
+	stats->ext_table_row_num = sess->hash_table.ext_table_row_num;
+	if (sess->table_mgr) {
+		stats->table_size = sess->table_mgr->mem.size;
+		stats->grow_num = sess->table_mgr->grow_num;
+	}
+
+	if (sess->ops.hash_table_stats) {
+		ret = sess->ops.hash_table_stats(sess->priv, stats);
+		if (ret) {
+			WD_ERR("failed to get agg hash table stats!\n");
+			return ret;
+		}
+	}
+
+	if (stats->std_table_row_num)
+		stats->fill_rate = stats->std_used_row_num * DAE_PERCENT /
+				   stats->std_table_row_num;
+	if (stats->ext_table_row_num)
+		stats->ext_usage_rate = stats->ext_used_row_num * DAE_PERCENT /
+					stats->ext_table_row_num;
+
+	return WD_SUCCESS;
+}
+
 static void wd_agg_clear_status(void)
 {
 	wd_alg_clear_init(&wd_agg_setting.status);
@@ -578,6 +978,10 @@ static int wd_agg_alg_init(struct wd_ctx_config *config, struct wd_sched *sched)
 	if (ret < 0)
 		return ret;
 
+	ret = wd_set_wait_policy("WD_AGG_WAIT_POLICY", &wd_agg_setting.config);
+	if (ret < 0)
+		return ret;
+
 	ret = wd_init_ctx_config(&wd_agg_setting.config, config);
 	if (ret < 0)
 		return ret;
@@ -586,6 +990,8 @@ static int wd_agg_alg_init(struct wd_ctx_config *config, struct wd_sched *sched)
 	if (ret < 0)
 		goto out_clear_ctx_config;
 
+	wd_init_sched_load(sched, &wd_agg_setting.config, &wd_agg_setting.pool);
+
 	/* Allocate async pool for every ctx */
 	ret = wd_init_async_request_pool(&wd_agg_setting.pool, config, WD_POOL_MAX_ENTRIES,
 					 sizeof(struct wd_agg_msg));
@@ -609,9 +1015,10 @@ out_clear_ctx_config:
 
 static int wd_agg_alg_uninit(void)
 {
-	void *priv = wd_agg_setting.priv;
+	enum wd_status status;
 
-	if (!priv)
+	wd_alg_get_init(&wd_agg_setting.status, &status);
+	if (status == WD_UNINIT)
 		return -WD_EINVAL;
 
 	/* Uninit async request pool */
@@ -660,6 +1067,13 @@ int wd_agg_init(char *alg, __u32 sched_type, int task_type, struct wd_ctx_params
 
 		/* Get alg driver and dev name */
 		wd_agg_setting.driver = wd_alg_drv_bind(task_type, alg);
+		/*
+		 * The hash table is in the format of its driver, so the requests
+		 * of a session can not overflow to the soft driver one by one.
+		 * TASK_MIX uses the soft driver for all sessions without DAE.
+		 */
+		if (!wd_agg_setting.driver && task_type == TASK_MIX)
+			wd_agg_setting.driver = wd_alg_drv_bind(TASK_INSTR, alg);
 		if (!wd_agg_setting.driver) {
 			WD_ERR("failed to bind %s driver.\n", alg);
 			goto out_dlopen;
@@ -940,6 +1354,11 @@ static int check_out_agg_col_addr(struct wd_dae_col_addr *cols, __u32 cols_num,
 			ret = check_out_col_addr(cols + k, row_count,
 						 sess->agg_conf.cols_info[i].output_data_types[j],
 						 sess->agg_conf.out_data_size[k]);
+			if (!ret && sess->agg_conf.cols_info[i].output_col_algs[j] == WD_AGG_AVG) {
+				k++;
+				ret = check_out_col_addr(cols + k, row_count, WD_DAE_LONG,
+							 sess->agg_conf.out_data_size[k]);
+			}
 			if (unlikely(ret)) {
 				WD_ERR("failed to check agg req output agg col! col idx: %u\n", i);
 				return ret;
@@ -1085,22 +1504,31 @@ static int wd_agg_sync_job(struct wd_agg_sess *sess, struct wd_agg_req *req,
 	__u32 idx;
 	int ret;
 
+	if (sess->fallback)
+		return wd_alg_do_fallback(wd_agg_setting.driver,
+					  &wd_agg_setting.config, msg);
+
 	idx = wd_agg_setting.sched.pick_next_ctx(wd_agg_setting.sched.h_sched_ctx,
 						 sess->sched_key, CTX_MODE_SYNC);
 	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
 	if (unlikely(ret))
 		return ret;
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ctx = config->ctxs + idx;
 
 	msg_handle.send = wd_agg_setting.driver->send;
 	msg_handle.recv = wd_agg_setting.driver->recv;
 
+	wd_ctx_inflight_add(ctx, 1);
 	pthread_spin_lock(&ctx->lock);
-	ret = wd_handle_msg_sync(wd_agg_setting.driver, &msg_handle, ctx->ctx,
-				 msg, NULL, config->epoll_en);
+	ret = wd_handle_msg_sync(wd_agg_setting.driver, &msg_handle, config,
+				 ctx, msg, 0, NULL);
 	pthread_spin_unlock(&ctx->lock);
+	wd_ctx_inflight_sub(ctx, 1);
+	/* The rows of agg have no fixed size, so no bytes are counted */
+	if (likely(!ret))
+		wd_dfx_msg_done(config, idx, 0, 0);
 
 	return ret;
 }
@@ -1140,6 +1568,111 @@ static int wd_agg_check_msg_result(__u32 result)
 	}
 }
 
+static void wd_agg_skip_col_rows(struct wd_dae_col_addr *col, enum wd_dae_data_type type,
+				 __u64 data_size, __u32 rows, __u32 left)
+{
+	col->empty += rows;
+	col->empty_size = left * sizeof(col->empty[0]);
+	if (type == WD_DAE_VARCHAR) {
+		col->value = (__u8 *)col->value + col->offset[rows] - col->offset[0];
+		col->offset += rows;
+		col->offset_size = (left + 1) * sizeof(col->offset[0]);
+		col->value_size = col->offset[left] - col->offset[0];
+	} else {
+		col->value = (__u8 *)col->value + rows * data_size;
+		col->value_size = left * data_size;
+	}
+}
+
+/* Point the input cols of @req to the rows after the first @rows */
+static void wd_agg_skip_rows(struct wd_agg_sess *sess, struct wd_agg_req *req, __u32 rows)
+{
+	__u32 left = req->in_row_count - rows;
+	__u32 i;
+
+	for (i = 0; i < req->key_cols_num; i++)
+		wd_agg_skip_col_rows(req->key_cols + i, sess->key_conf.cols_info[i].input_data_type,
+				     sess->key_conf.data_size[i], rows, left);
+
+	for (i = 0; req->agg_cols && i < req->agg_cols_num; i++)
+		wd_agg_skip_col_rows(req->agg_cols + i, sess->agg_conf.cols_info[i].input_data_type,
+				     sess->agg_conf.data_size[i], rows, left);
+
+	req->in_row_count = left;
+}
+
+static struct wd_dae_col_addr *wd_agg_copy_in_cols(struct wd_agg_req *req)
+{
+	struct wd_dae_col_addr *cols;
+	__u32 agg_num = req->agg_cols ? req->agg_cols_num : 0;
+
+	cols = malloc((req->key_cols_num + agg_num) * sizeof(struct wd_dae_col_addr));
+	if (!cols) {
+		WD_ERR("failed to alloc agg input cols for rehash!\n");
+		return NULL;
+	}
+
+	memcpy(cols, req->key_cols, req->key_cols_num * sizeof(struct wd_dae_col_addr));
+	req->key_cols = cols;
+	if (agg_num) {
+		memcpy(cols + req->key_cols_num, req->agg_cols,
+		       agg_num * sizeof(struct wd_dae_col_addr));
+		req->agg_cols = cols + req->key_cols_num;
+	}
+
+	return cols;
+}
+
+/*
+ * When the managed table is full, it grows and the input goes on with
+ * the rest rows, until all rows are added or the table can not grow.
+ * It is called with the lock of the table held.
+ */
+static int wd_agg_managed_input(struct wd_agg_sess *sess, struct wd_agg_req *req)
+{
+	struct wd_dae_col_addr *cols = NULL;
+	struct wd_agg_req sub_req;
+	struct wd_agg_msg msg;
+	__u32 done = 0;
+	int ret;
+
+	memcpy(&sub_req, req, sizeof(struct wd_agg_req));
+	while (true) {
+		memset(&msg, 0, sizeof(struct wd_agg_msg));
+		fill_request_msg_input(&msg, &sub_req, sess, false);
+		ret = wd_agg_sync_job(sess, &sub_req, &msg);
+		if (unlikely(ret))
+			goto out;
+
+		done += msg.in_row_count;
+		if (msg.result != WD_AGG_NEED_REHASH || done >= req->in_row_count)
+			break;
+
+		if (!cols) {
+			cols = wd_agg_copy_in_cols(&sub_req);
+			if (!cols)
+				break;
+		}
+
+		ret = wd_agg_table_grow(sess);
+		if (ret == -WD_ENOMEM) {
+			ret = WD_SUCCESS;
+			break;
+		} else if (ret) {
+			goto out;
+		}
+
+		wd_agg_skip_rows(sess, &sub_req, msg.in_row_count);
+	}
+
+	req->state = msg.result;
+	req->real_in_row_count = done;
+
+out:
+	free(cols);
+	return ret;
+}
+
 int wd_agg_add_input_sync(handle_t h_sess, struct wd_agg_req *req)
 {
 	struct wd_agg_sess *sess = (struct wd_agg_sess *)h_sess;
@@ -1153,24 +1686,61 @@ int wd_agg_add_input_sync(handle_t h_sess, struct wd_agg_req *req)
 		return ret;
 	}
 
+	/* The state is checked under the lock, a growing table is in rehash */
+	if (sess->table_mgr)
+		pthread_mutex_lock(&sess->table_mgr->lock);
+
 	ret = wd_agg_input_try_init(sess, &expected);
 	if (unlikely(ret))
-		return ret;
+		goto out;
 
-	memset(&msg, 0, sizeof(struct wd_agg_msg));
-	fill_request_msg_input(&msg, req, sess, false);
 	req->state = 0;
+	if (sess->table_mgr) {
+		ret = wd_agg_managed_input(sess, req);
+	} else {
+		memset(&msg, 0, sizeof(struct wd_agg_msg));
+		fill_request_msg_input(&msg, req, sess, false);
+		ret = wd_agg_sync_job(sess, req, &msg);
+		if (likely(!ret)) {
+			req->state = msg.result;
+			req->real_in_row_count = msg.in_row_count;
+		}
+	}
 
-	ret = wd_agg_sync_job(sess, req, &msg);
 	if (unlikely(ret)) {
 		if (expected == WD_AGG_SESS_INIT)
 			__atomic_store_n(&sess->state, expected, __ATOMIC_RELEASE);
 		WD_ERR("failed to do agg add input sync job!\n");
-		return ret;
 	}
 
+out:
+	if (sess->table_mgr)
+		pthread_mutex_unlock(&sess->table_mgr->lock);
+	return ret;
+}
+
+/* The request of a fallback session is done at once and called back */
+static int wd_agg_async_fallback(struct wd_agg_sess *sess, struct wd_agg_req *req,
+				 bool is_input)
+{
+	struct wd_agg_msg msg = {0};
+	int ret;
+
+	if (is_input)
+		fill_request_msg_input(&msg, req, sess, false);
+	else
+		fill_request_msg_output(&msg, req, sess, false);
+
+	ret = wd_alg_do_fallback(wd_agg_setting.driver,
+				 &wd_agg_setting.config, &msg);
+	if (unlikely(ret))
+		return ret;
+
 	req->state = msg.result;
 	req->real_in_row_count = msg.in_row_count;
+	req->real_out_row_count = msg.out_row_count;
+	req->output_done = msg.output_done;
+	req->cb(req, req->cb_param);
 
 	return WD_SUCCESS;
 }
@@ -1183,6 +1753,16 @@ static int wd_agg_async_job(struct wd_agg_sess *sess, struct wd_agg_req *req, bo
 	int msg_id, ret;
 	struct wd_agg_msg *msg;
 
+	if (sess->fallback)
+		return wd_agg_async_fallback(sess, req, is_input);
+
+	/* A soft driver does the request in send and only has a sync ctx */
+	if (unlikely(wd_agg_setting.driver->calc_type != UADK_ALG_HW)) {
+		WD_ERR("invalid: %s driver doesn't support async agg!\n",
+		       wd_agg_setting.driver->drv_name);
+		return -WD_EINVAL;
+	}
+
 	idx = wd_agg_setting.sched.pick_next_ctx(wd_agg_setting.sched.h_sched_ctx,
 						 sess->sched_key, CTX_MODE_ASYNC);
 	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
@@ -1203,13 +1783,14 @@ static int wd_agg_async_job(struct wd_agg_sess *sess, struct wd_agg_req *req, bo
 	msg->tag = msg_id;
 	ret = wd_alg_driver_send(wd_agg_setting.driver, ctx->ctx, msg);
 	if (unlikely(ret < 0)) {
+		wd_dfx_msg_err(config, idx, ret);
 		if (ret != -WD_EBUSY)
 			WD_ERR("wd agg async send err!\n");
 
 		goto fail_with_msg;
 	}
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 
 	return WD_SUCCESS;
 
@@ -1230,6 +1811,12 @@ int wd_agg_add_input_async(handle_t h_sess, struct wd_agg_req *req)
 		return ret;
 	}
 
+	/* The table may be freed by a grow before the request is done */
+	if (unlikely(sess->table_mgr)) {
+		WD_ERR("invalid: agg managed table doesn't support async input!\n");
+		return -WD_EINVAL;
+	}
+
 	ret = wd_agg_input_try_init(sess, &expected);
 	if (unlikely(ret))
 		return ret;
@@ -1371,6 +1958,12 @@ static int wd_agg_set_aggcol_size(struct wd_agg_sess *sess, struct wd_dae_col_ad
 						 sess->agg_conf.cols_info[i].output_data_types[j]);
 			if (unlikely(ret))
 				return ret;
+			if (sess->agg_conf.cols_info[i].output_col_algs[j] == WD_AGG_AVG) {
+				k++;
+				(void)set_col_size_inner(agg + k, expt, row_count,
+							 sess->agg_conf.out_data_size[k],
+							 WD_DAE_LONG);
+			}
 		}
 	}
 
@@ -1542,6 +2135,7 @@ static int wd_agg_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 			return -WD_EINVAL;
 		}
 
+		wd_dfx_msg_done(config, idx, 0, 0);
 		msg->tag = resp_msg.tag;
 		msg->req.state = resp_msg.result;
 		msg->req.real_in_row_count = resp_msg.in_row_count;
@@ -4,91 +4,182 @@
  */
 
 #define _GNU_SOURCE
-#include <dirent.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <pthread.h>
 #include <sys/auxv.h>
+#include <sys/stat.h>
 
 #include "wd.h"
 #include "wd_alg.h"
-
-#define SYS_CLASS_DIR			"/sys/class/uacce"
-#define SVA_FILE_NAME			"flags"
-#define DEV_SVA_SIZE		32
-#define STR_DECIMAL		0xA
+#include "wd_uacce_emu.h"
 
 static struct wd_alg_list alg_list_head;
 static struct wd_alg_list *alg_list_tail = &alg_list_head;
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static bool wd_check_dev_sva(const char *dev_name)
+/*
+ * The uacce devices are scanned once and shared by all the device discovery
+ * of the process. They are scanned again if the class dir or its mtime is
+ * changed, or after wd_refresh_accel_list(). The registry lives here since
+ * this file is only built into libwd, the alg libs find devices through it.
+ */
+static struct wd_dev_registry {
+	pthread_mutex_t lock;
+	struct uacce_dev_list *list;
+	char class_dir[MAX_DEV_NAME_LEN];
+	struct timespec mtime;
+	bool valid;
+} dev_registry = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static bool dev_has_alg(const char *dev_alg_name, const char *alg_name)
 {
-	char dev_path[PATH_MAX] = {'\0'};
-	char buf[DEV_SVA_SIZE] = {'\0'};
-	unsigned int val;
-	ssize_t ret;
-	int fd;
-
-	ret = snprintf(dev_path, PATH_STR_SIZE, "%s/%s/%s", SYS_CLASS_DIR,
-			  dev_name, SVA_FILE_NAME);
-	if (ret < 0) {
-		WD_ERR("failed to snprintf, device name: %s!\n", dev_name);
-		return false;
+	const char *str = dev_alg_name;
+	size_t len = strlen(alg_name);
+	char end;
+
+	/* The algorithms are separated by '\n', the trailing one is stripped. */
+	while ((str = strstr(str, alg_name)) != NULL) {
+		end = *(str + len);
+		if ((end == '\n' || end == '\0') &&
+		    (str == dev_alg_name || *(str - 1) == '\n'))
+			return true;
+		str++;
 	}
 
-	/**
-	 * The opened file is the specified device driver file.
-	 * no need for realpath processing.
-	 */
-	fd = open(dev_path, O_RDONLY, 0);
-	if (fd < 0) {
-		WD_ERR("failed to open %s(%d)!\n", dev_path, -errno);
-		return false;
+	return false;
+}
+
+static int check_alg_name(const char *alg_name)
+{
+	int i = 0;
+
+	if (!alg_name)
+		return -WD_EINVAL;
+
+	while (alg_name[i] != '\0') {
+		i++;
+		if (i >= MAX_ATTR_STR_SIZE) {
+			WD_ERR("failed to get list, alg name is too long!\n");
+			return -WD_EINVAL;
+		}
 	}
 
-	ret = read(fd, buf, DEV_SVA_SIZE - 1);
-	if (ret <= 0) {
-		WD_ERR("failed to read anything at %s!\n", dev_path);
-		close(fd);
-		return false;
+	return 0;
+}
+
+/* Called with the registry lock held */
+static struct uacce_dev_list *wd_get_dev_registry(void)
+{
+	const char *class_dir = wd_uacce_class_dir();
+	struct stat st;
+
+	if (stat(class_dir, &st)) {
+		WD_ERR("UADK framework isn't enabled in system!\n");
+		return NULL;
 	}
-	close(fd);
 
-	val = strtol(buf, NULL, STR_DECIMAL);
-	if (val & UACCE_DEV_SVA)
-		return true;
+	if (dev_registry.valid && !strcmp(dev_registry.class_dir, class_dir) &&
+	    dev_registry.mtime.tv_sec == st.st_mtim.tv_sec &&
+	    dev_registry.mtime.tv_nsec == st.st_mtim.tv_nsec)
+		return dev_registry.list;
 
-	return false;
+	wd_free_list_accels(dev_registry.list);
+	dev_registry.list = wd_scan_accel_list(class_dir);
+	/* Nothing is cached if no device is found, try again next time. */
+	dev_registry.valid = !!dev_registry.list;
+	dev_registry.mtime = st.st_mtim;
+	strncpy(dev_registry.class_dir, class_dir, MAX_DEV_NAME_LEN - 1);
+
+	return dev_registry.list;
 }
 
-static bool wd_check_accel_dev(const char *dev_name)
+void wd_refresh_accel_list(void)
 {
-	struct dirent *dev_dir;
-	DIR *wd_class;
+	pthread_mutex_lock(&dev_registry.lock);
+	wd_free_list_accels(dev_registry.list);
+	dev_registry.list = NULL;
+	dev_registry.valid = false;
+	pthread_mutex_unlock(&dev_registry.lock);
+}
 
-	wd_class = opendir(SYS_CLASS_DIR);
-	if (!wd_class) {
-		WD_ERR("UADK framework isn't enabled in system!\n");
-		return false;
+/*
+ * A device may be isolated after a hardware error at any time, the flag is
+ * read again each time a device is taken from the registry.
+ */
+static bool wd_dev_is_usable(struct uacce_dev *dev)
+{
+	return wd_is_isolate(dev) != 1;
+}
+
+bool wd_check_accel_name(const char *dev_name)
+{
+	struct uacce_dev_list *p;
+	bool found = false;
+	char *name;
+
+	pthread_mutex_lock(&dev_registry.lock);
+	for (p = wd_get_dev_registry(); p; p = p->next) {
+		name = rindex(p->dev->char_dev_path, '/');
+		name = name ? name + 1 : p->dev->char_dev_path;
+		if (!strncmp(name, dev_name, strlen(dev_name)) &&
+		    wd_dev_is_usable(p->dev)) {
+			found = true;
+			break;
+		}
 	}
+	pthread_mutex_unlock(&dev_registry.lock);
+
+	return found;
+}
 
-	while ((dev_dir = readdir(wd_class)) != NULL) {
-		if (!strncmp(dev_dir->d_name, ".", LINUX_CRTDIR_SIZE) ||
-		     !strncmp(dev_dir->d_name, "..", LINUX_PRTDIR_SIZE))
+struct uacce_dev_list *wd_get_accel_list(const char *alg_name)
+{
+	struct uacce_dev_list *node, *p, *head = NULL, *tail = NULL;
+
+	if (check_alg_name(alg_name))
+		return NULL;
+
+	pthread_mutex_lock(&dev_registry.lock);
+	for (p = wd_get_dev_registry(); p; p = p->next) {
+		if (!dev_has_alg(p->dev->algs, alg_name))
 			continue;
 
-		if (!strncmp(dev_dir->d_name, dev_name, strlen(dev_name)) &&
-		     wd_check_dev_sva(dev_dir->d_name)) {
-			closedir(wd_class);
-			return true;
+		if (!wd_dev_is_usable(p->dev)) {
+			WD_ERR("skip isolated uacce device!\n");
+			continue;
 		}
+
+		node = calloc(1, sizeof(*node));
+		if (!node)
+			goto free_list;
+
+		node->dev = wd_clone_dev(p->dev);
+		if (!node->dev) {
+			free(node);
+			goto free_list;
+		}
+
+		if (!head)
+			head = node;
+		else
+			tail->next = node;
+		tail = node;
 	}
-	closedir(wd_class);
+	pthread_mutex_unlock(&dev_registry.lock);
 
-	return false;
+	return head;
+
+free_list:
+	pthread_mutex_unlock(&dev_registry.lock);
+	wd_free_list_accels(head);
+	return NULL;
 }
 
 static bool wd_check_ce_support(const char *dev_name)
@@ -127,7 +218,9 @@ static bool wd_alg_check_available(int calc_type, const char *dev_name)
 	bool ret = false;
 
 	switch (calc_type) {
+	/* Soft calculation only needs the general CPU */
 	case UADK_ALG_SOFT:
+		ret = true;
 		break;
 	/* Should find the CPU if not support CE */
 	case UADK_ALG_CE_INSTR:
@@ -139,7 +232,7 @@ static bool wd_alg_check_available(int calc_type, const char *dev_name)
 		break;
 	/* Check if the current driver has device support */
 	case UADK_ALG_HW:
-		ret = wd_check_accel_dev(dev_name);
+		ret = wd_check_accel_name(dev_name);
 		break;
 	}
 
@@ -330,6 +330,15 @@ static int wd_cipher_common_init(struct wd_ctx_config *config,
 	if (ret < 0)
 		return ret;
 
+	ret = wd_set_wait_policy("WD_CIPHER_WAIT_POLICY", &wd_cipher_setting.config);
+	if (ret < 0)
+		return ret;
+
+	ret = wd_set_fallback_depth("WD_CIPHER_FALLBACK_DEPTH",
+				    &wd_cipher_setting.config.fb_depth);
+	if (ret < 0)
+		return ret;
+
 	ret = wd_init_ctx_config(&wd_cipher_setting.config, config);
 	if (ret < 0)
 		return ret;
@@ -338,6 +347,8 @@ static int wd_cipher_common_init(struct wd_ctx_config *config,
 	if (ret < 0)
 		goto out_clear_ctx_config;
 
+	wd_init_sched_load(sched, &wd_cipher_setting.config, &wd_cipher_setting.pool);
+
 	/* allocate async pool for every ctx */
 	ret = wd_init_async_request_pool(&wd_cipher_setting.pool,
 					 config, WD_POOL_MAX_ENTRIES,
@@ -640,6 +651,14 @@ static int wd_cipher_check_params(handle_t h_sess,
 		return -WD_EINVAL;
 	}
 
+	/* A soft driver does the request in send, it has nothing to poll */
+	if (unlikely(mode == CTX_MODE_ASYNC &&
+		     wd_cipher_setting.driver->calc_type == UADK_ALG_SOFT)) {
+		WD_ERR("invalid: %s driver doesn't support async cipher!\n",
+		       wd_cipher_setting.driver->drv_name);
+		return -WD_EINVAL;
+	}
+
 	if (unlikely(req->out_buf_bytes < req->in_bytes)) {
 		WD_ERR("cipher set out_buf_bytes is error, size = %u\n",
 			req->out_buf_bytes);
@@ -685,10 +704,13 @@ static int send_recv_sync(struct wd_ctx_internal *ctx,
 	msg_handle.send = wd_cipher_setting.driver->send;
 	msg_handle.recv = wd_cipher_setting.driver->recv;
 
+	wd_ctx_inflight_add(ctx, 1);
 	wd_ctx_spin_lock(ctx, wd_cipher_setting.driver->calc_type);
-	ret = wd_handle_msg_sync(wd_cipher_setting.driver, &msg_handle, ctx->ctx,
-				 msg, NULL, wd_cipher_setting.config.epoll_en);
+	ret = wd_handle_msg_sync(wd_cipher_setting.driver, &msg_handle,
+				 &wd_cipher_setting.config, ctx, msg,
+				 msg->in_bytes, NULL);
 	wd_ctx_spin_unlock(ctx, wd_cipher_setting.driver->calc_type);
+	wd_ctx_inflight_sub(ctx, 1);
 
 	return ret;
 }
@@ -719,15 +741,42 @@ int wd_do_cipher_sync(handle_t h_sess, struct wd_cipher_req *req)
 	if (unlikely(ret))
 		return ret;
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ctx = config->ctxs + idx;
 
 	ret = send_recv_sync(ctx, &msg);
+	if (likely(!ret))
+		wd_dfx_msg_done(config, idx, msg.in_bytes, msg.out_bytes);
+	else if (ret == -WD_EBUSY &&
+	    wd_alg_fallback_en(wd_cipher_setting.driver, config))
+		ret = wd_alg_do_fallback(wd_cipher_setting.driver,
+					 &wd_cipher_setting.config, &msg);
 	req->state = msg.result;
 
 	return ret;
 }
 
+/* The overflow request is done by the fallback driver and called back at once */
+static int wd_cipher_async_fallback(struct wd_cipher_req *req,
+				    struct wd_cipher_sess *sess)
+{
+	struct wd_cipher_msg msg;
+	int ret;
+
+	memset(&msg, 0, sizeof(struct wd_cipher_msg));
+	fill_request_msg(&msg, req, sess);
+
+	ret = wd_alg_do_fallback(wd_cipher_setting.driver,
+				 &wd_cipher_setting.config, &msg);
+	if (unlikely(ret))
+		return ret;
+
+	msg.req.state = msg.result;
+	msg.req.cb(&msg.req, msg.req.cb_param);
+
+	return 0;
+}
+
 int wd_do_cipher_async(handle_t h_sess, struct wd_cipher_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_cipher_setting.config;
@@ -752,9 +801,17 @@ int wd_do_cipher_async(handle_t h_sess, struct wd_cipher_req *req)
 
 	ctx = config->ctxs + idx;
 
+	if (wd_alg_fallback_check(wd_cipher_setting.driver, config,
+				  &wd_cipher_setting.pool, idx))
+		return wd_cipher_async_fallback(req, sess);
+
 	msg_id = wd_get_msg_from_pool(&wd_cipher_setting.pool, idx,
 				   (void **)&msg);
 	if (unlikely(msg_id < 0)) {
+		if (msg_id == -WD_EBUSY &&
+		    wd_alg_fallback_en(wd_cipher_setting.driver, config))
+			return wd_cipher_async_fallback(req, sess);
+
 		WD_ERR("failed to get msg from pool!\n");
 		return msg_id;
 	}
@@ -764,13 +821,20 @@ int wd_do_cipher_async(handle_t h_sess, struct wd_cipher_req *req)
 
 	ret = wd_alg_driver_send(wd_cipher_setting.driver, ctx->ctx, msg);
 	if (unlikely(ret < 0)) {
+		wd_dfx_msg_err(config, idx, ret);
+		if (ret == -WD_EBUSY &&
+		    wd_alg_fallback_en(wd_cipher_setting.driver, config)) {
+			wd_put_msg_to_pool(&wd_cipher_setting.pool, idx, msg->tag);
+			return wd_cipher_async_fallback(req, sess);
+		}
+
 		if (ret != -WD_EBUSY)
 			WD_ERR("wd cipher async send err!\n");
 
 		goto fail_with_msg;
 	}
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ret = wd_add_task_to_async_queue(&wd_cipher_env_config, idx);
 	if (ret)
 		goto fail_with_msg;
@@ -782,6 +846,133 @@ fail_with_msg:
 	return ret;
 }
 
+static int wd_cipher_check_batch(handle_t h_sess, struct wd_cipher_req **reqs,
+				 __u32 num, __u8 mode)
+{
+	__u32 i;
+	int ret;
+
+	if (unlikely(!reqs || !num || num > WD_MAX_BATCH_NUM)) {
+		WD_ERR("invalid: cipher batch reqs is NULL or num %u is error!\n", num);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < num; i++) {
+		ret = wd_cipher_check_params(h_sess, reqs[i], mode);
+		if (unlikely(ret)) {
+			WD_ERR("failed to check cipher params!\n");
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int wd_do_cipher_sync_batch(handle_t h_sess, struct wd_cipher_req **reqs, __u32 num)
+{
+	struct wd_ctx_config_internal *config = &wd_cipher_setting.config;
+	struct wd_cipher_sess *sess = (struct wd_cipher_sess *)h_sess;
+	struct wd_cipher_msg msgs[WD_MAX_BATCH_NUM];
+	void *msg_list[WD_MAX_BATCH_NUM];
+	struct wd_msg_handle msg_handle;
+	struct wd_ctx_internal *ctx;
+	__u32 idx, i;
+	int ret;
+
+	ret = wd_cipher_check_batch(h_sess, reqs, num, CTX_MODE_SYNC);
+	if (unlikely(ret))
+		return ret;
+
+	memset(msgs, 0, sizeof(struct wd_cipher_msg) * num);
+	for (i = 0; i < num; i++) {
+		fill_request_msg(&msgs[i], reqs[i], sess);
+		reqs[i]->state = 0;
+		msgs[i].tag = i;
+		msg_list[i] = &msgs[i];
+	}
+
+	idx = wd_cipher_setting.sched.pick_next_ctx(
+		     wd_cipher_setting.sched.h_sched_ctx,
+		     sess->sched_key, CTX_MODE_SYNC);
+	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
+	if (unlikely(ret))
+		return ret;
+
+	ctx = config->ctxs + idx;
+
+	msg_handle.send = wd_cipher_setting.driver->send;
+	msg_handle.recv = wd_cipher_setting.driver->recv;
+
+	wd_ctx_inflight_add(ctx, num);
+	wd_ctx_spin_lock(ctx, wd_cipher_setting.driver->calc_type);
+	ret = wd_handle_msg_sync_batch(wd_cipher_setting.driver, &msg_handle, config,
+				       ctx, msg_list, num, msgs[0].in_bytes, NULL);
+	wd_ctx_spin_unlock(ctx, wd_cipher_setting.driver->calc_type);
+	wd_ctx_inflight_sub(ctx, num);
+
+	for (i = 0; i < num; i++) {
+		reqs[i]->state = msgs[i].result;
+		if (likely(!ret))
+			wd_dfx_msg_done(config, idx, msgs[i].in_bytes, msgs[i].out_bytes);
+	}
+
+	return ret;
+}
+
+int wd_do_cipher_async_batch(handle_t h_sess, struct wd_cipher_req **reqs,
+			     __u32 num, __u32 *count)
+{
+	struct wd_ctx_config_internal *config = &wd_cipher_setting.config;
+	struct wd_cipher_sess *sess = (struct wd_cipher_sess *)h_sess;
+	void *msg_list[WD_MAX_BATCH_NUM];
+	__u32 tags[WD_MAX_BATCH_NUM];
+	struct wd_cipher_msg *msg;
+	int msg_id, ret;
+	__u32 idx, i;
+
+	if (unlikely(!count)) {
+		WD_ERR("invalid: cipher batch count is NULL!\n");
+		return -WD_EINVAL;
+	}
+	*count = 0;
+
+	ret = wd_cipher_check_batch(h_sess, reqs, num, CTX_MODE_ASYNC);
+	if (unlikely(ret))
+		return ret;
+
+	idx = wd_cipher_setting.sched.pick_next_ctx(
+		     wd_cipher_setting.sched.h_sched_ctx,
+		     sess->sched_key, CTX_MODE_ASYNC);
+	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		msg_id = wd_get_msg_from_pool(&wd_cipher_setting.pool, idx,
+					      (void **)&msg);
+		if (unlikely(msg_id < 0)) {
+			if (!i) {
+				WD_ERR("failed to get msg from pool!\n");
+				return msg_id;
+			}
+			break;
+		}
+
+		fill_request_msg(msg, reqs[i], sess);
+		msg->tag = msg_id;
+		msg_list[i] = msg;
+		tags[i] = msg_id;
+	}
+
+	ret = wd_send_async_batch(wd_cipher_setting.driver, config,
+				  &wd_cipher_setting.pool, &wd_cipher_env_config,
+				  idx, msg_list, tags, i, count);
+	if (unlikely(ret))
+		return ret;
+
+	return *count < num ? -WD_EBUSY : 0;
+}
+
 struct wd_cipher_msg *wd_cipher_get_msg(__u32 idx, __u32 tag)
 {
 	return wd_find_msg_in_pool(&wd_cipher_setting.pool, idx, tag);
@@ -826,6 +1017,7 @@ int wd_cipher_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 			return -WD_EINVAL;
 		}
 
+		wd_dfx_msg_done(config, idx, msg->in_bytes, msg->out_bytes);
 		msg->tag = resp_msg.tag;
 		msg->req.state = resp_msg.result;
 		req = &msg->req;
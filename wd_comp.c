@@ -4,6 +4,7 @@
  * Copyright 2020-2021 Linaro ltd.
  */
 
+#define _GNU_SOURCE
 #include <dirent.h>
 #include <dlfcn.h>
 #include <errno.h>
@@ -17,6 +18,16 @@
 
 #define HW_CTX_SIZE			(64 * 1024)
 #define STREAM_CHUNK			(128 * 1024)
+/* The output room of a parallel chunk, more than its worst expansion */
+#define PAR_CHUNK_OUT			(STREAM_CHUNK + STREAM_CHUNK / 2)
+#define PAR_MAX_NUM			64
+#define PAR_MAX_LANES			8
+#define ZLIB_HEAD_SIZE			2
+#define ZLIB_TAIL_SIZE			4
+#define GZIP_HEAD_SIZE			10
+#define GZIP_TAIL_SIZE			8
+#define ADLER_BASE			65521U
+#define CRC32_POLY			0xedb88320U
 
 #define swap_byte(x) \
 	((((x) & 0x000000ff) << 24) | \
@@ -39,6 +50,8 @@ struct wd_comp_sess {
 	__u32 checksum;
 	__u8 *ctx_buf;
 	void *sched_key;
+	struct wd_comp_setting *setting;
+	struct wd_comp_ops ops;
 };
 
 struct wd_comp_setting {
@@ -47,33 +60,55 @@ struct wd_comp_setting {
 	struct wd_sched sched;
 	struct wd_async_msg_pool pool;
 	struct wd_alg_driver *driver;
+	struct wd_env_config *env_config;
+	__u32 par_num;
 	void *dlhandle;
 	void *dlh_list;
-} wd_comp_setting;
+};
+
+/*
+ * wd_comp_inst - an alg instance, which has its own ctxs, scheduler and
+ * driver. The driver is copied, so the private data of the driver is not
+ * shared with the default setting or with the other instances.
+ */
+struct wd_comp_inst {
+	struct wd_comp_setting setting;
+	struct wd_init_attrs attrs;
+	struct wd_env_config env_config;
+	struct wd_alg_driver drv;
+};
 
 struct wd_env_config wd_comp_env_config;
 static struct wd_init_attrs wd_comp_init_attrs;
 
-static void wd_comp_close_driver(int init_type)
+/* The default setting, used by the process-global interfaces */
+struct wd_comp_setting wd_comp_setting = {
+	.env_config = &wd_comp_env_config,
+};
+
+/* The setting polled by this thread, the driver gets the async msg from it */
+static __thread struct wd_comp_setting *wd_comp_poll_setting;
+
+static void wd_comp_close_driver(struct wd_comp_setting *setting, int init_type)
 {
 #ifndef WD_STATIC_DRV
 	if (init_type == WD_TYPE_V2) {
-		wd_dlclose_drv(wd_comp_setting.dlh_list);
+		wd_dlclose_drv(setting->dlh_list);
 		return;
 	}
 
-	if (wd_comp_setting.dlhandle) {
-		wd_release_drv(wd_comp_setting.driver);
-		dlclose(wd_comp_setting.dlhandle);
-		wd_comp_setting.dlhandle = NULL;
+	if (setting->dlhandle) {
+		wd_release_drv(setting->driver);
+		dlclose(setting->dlhandle);
+		setting->dlhandle = NULL;
 	}
 #else
-	wd_release_drv(wd_comp_setting.driver);
+	wd_release_drv(setting->driver);
 	hisi_zip_remove();
 #endif
 }
 
-static int wd_comp_open_driver(int init_type)
+static int wd_comp_open_driver(struct wd_comp_setting *setting, int init_type)
 {
 	struct wd_alg_driver *driver = NULL;
 	const char *alg_name = "zlib";
@@ -87,8 +122,8 @@ static int wd_comp_open_driver(int init_type)
 		 * then open them by wd_dlopen_drv()
 		 * use NULL means dynamic query path
 		 */
-		wd_comp_setting.dlh_list = wd_dlopen_drv(NULL);
-		if (!wd_comp_setting.dlh_list) {
+		setting->dlh_list = wd_dlopen_drv(NULL);
+		if (!setting->dlh_list) {
 			WD_ERR("fail to open driver lib files.\n");
 			return -WD_EINVAL;
 		}
@@ -100,8 +135,8 @@ static int wd_comp_open_driver(int init_type)
 	if (ret)
 		return ret;
 
-	wd_comp_setting.dlhandle = dlopen(lib_path, RTLD_NOW);
-	if (!wd_comp_setting.dlhandle) {
+	setting->dlhandle = dlopen(lib_path, RTLD_NOW);
+	if (!setting->dlhandle) {
 		WD_ERR("failed to open libhisi_zip.so, %s\n", dlerror());
 		return -WD_EINVAL;
 	}
@@ -112,12 +147,12 @@ static int wd_comp_open_driver(int init_type)
 #endif
 	driver = wd_request_drv(alg_name, false);
 	if (!driver) {
-		wd_comp_close_driver(WD_TYPE_V1);
+		wd_comp_close_driver(setting, WD_TYPE_V1);
 		WD_ERR("failed to get %s driver support\n", alg_name);
 		return -WD_EINVAL;
 	}
 
-	wd_comp_setting.driver = driver;
+	setting->driver = driver;
 
 	return WD_SUCCESS;
 }
@@ -142,61 +177,103 @@ static bool wd_comp_alg_check(const char *alg_name)
 	return false;
 }
 
-static int wd_comp_init_nolock(struct wd_ctx_config *config, struct wd_sched *sched)
+static int wd_comp_set_par_num(struct wd_comp_setting *setting)
+{
+	const char *var_name = "WD_COMP_PARALLEL_NUM";
+	const char *s;
+	int val;
+
+	setting->par_num = 0;
+	s = secure_getenv(var_name);
+	if (!s || !strlen(s))
+		return 0;
+
+	val = strtol(s, NULL, 10);
+	if (val < 0 || val > PAR_MAX_NUM) {
+		WD_ERR("invalid: %s is %s, must be 0 ~ %d!\n", var_name, s,
+		       PAR_MAX_NUM);
+		return -WD_EINVAL;
+	}
+
+	setting->par_num = val;
+
+	return 0;
+}
+
+static int wd_comp_setting_init(struct wd_comp_setting *setting,
+				struct wd_ctx_config *config,
+				struct wd_sched *sched)
 {
 	int ret;
 
-	ret = wd_set_epoll_en("WD_COMP_EPOLL_EN",
-			      &wd_comp_setting.config.epoll_en);
+	ret = wd_comp_set_par_num(setting);
+	if (ret < 0)
+		return ret;
+
+	ret = wd_set_epoll_en("WD_COMP_EPOLL_EN", &setting->config.epoll_en);
+	if (ret < 0)
+		return ret;
+
+	ret = wd_set_wait_policy("WD_COMP_WAIT_POLICY", &setting->config);
+	if (ret < 0)
+		return ret;
+
+	ret = wd_set_fallback_depth("WD_COMP_FALLBACK_DEPTH",
+				    &setting->config.fb_depth);
 	if (ret < 0)
 		return ret;
 
-	ret = wd_init_ctx_config(&wd_comp_setting.config, config);
+	ret = wd_init_ctx_config(&setting->config, config);
 	if (ret < 0)
 		return ret;
 
-	ret = wd_init_sched(&wd_comp_setting.sched, sched);
+	ret = wd_init_sched(&setting->sched, sched);
 	if (ret < 0)
 		goto out_clear_ctx_config;
 
-	ret = wd_init_async_request_pool(&wd_comp_setting.pool,
+	wd_init_sched_load(sched, &setting->config, &setting->pool);
+
+	ret = wd_init_async_request_pool(&setting->pool,
 					 config, WD_POOL_MAX_ENTRIES,
 					 sizeof(struct wd_comp_msg));
 	if (ret < 0)
 		goto out_clear_sched;
 
-	ret = wd_alg_init_driver(&wd_comp_setting.config,
-					wd_comp_setting.driver);
+	ret = wd_alg_init_driver(&setting->config, setting->driver);
 	if (ret)
 		goto out_clear_pool;
 
 	return 0;
 
 out_clear_pool:
-	wd_uninit_async_request_pool(&wd_comp_setting.pool);
+	wd_uninit_async_request_pool(&setting->pool);
 out_clear_sched:
-	wd_clear_sched(&wd_comp_setting.sched);
+	wd_clear_sched(&setting->sched);
 out_clear_ctx_config:
-	wd_clear_ctx_config(&wd_comp_setting.config);
+	wd_clear_ctx_config(&setting->config);
 	return ret;
 }
 
-static int wd_comp_uninit_nolock(void)
+static int wd_comp_init_nolock(struct wd_ctx_config *config, struct wd_sched *sched)
+{
+	return wd_comp_setting_init(&wd_comp_setting, config, sched);
+}
+
+static int wd_comp_setting_uninit(struct wd_comp_setting *setting)
 {
 	enum wd_status status;
 
-	wd_alg_get_init(&wd_comp_setting.status, &status);
+	wd_alg_get_init(&setting->status, &status);
 	if (status == WD_UNINIT)
 		return -WD_EINVAL;
 
 	/* Uninit async request pool */
-	wd_uninit_async_request_pool(&wd_comp_setting.pool);
+	wd_uninit_async_request_pool(&setting->pool);
 
 	/* Unset config, sched, driver */
-	wd_clear_sched(&wd_comp_setting.sched);
+	wd_clear_sched(&setting->sched);
 
-	wd_alg_uninit_driver(&wd_comp_setting.config,
-			     wd_comp_setting.driver);
+	wd_alg_uninit_driver(&setting->config, setting->driver);
 
 	return 0;
 }
@@ -215,7 +292,7 @@ int wd_comp_init(struct wd_ctx_config *config, struct wd_sched *sched)
 	if (ret)
 		goto out_clear_init;
 
-	ret = wd_comp_open_driver(WD_TYPE_V1);
+	ret = wd_comp_open_driver(&wd_comp_setting, WD_TYPE_V1);
 	if (ret)
 		goto out_clear_init;
 
@@ -228,7 +305,7 @@ int wd_comp_init(struct wd_ctx_config *config, struct wd_sched *sched)
 	return 0;
 
 out_clear_driver:
-	wd_comp_close_driver(WD_TYPE_V1);
+	wd_comp_close_driver(&wd_comp_setting, WD_TYPE_V1);
 out_clear_init:
 	wd_alg_clear_init(&wd_comp_setting.status);
 	return ret;
@@ -238,76 +315,85 @@ void wd_comp_uninit(void)
 {
 	int ret;
 
-	ret = wd_comp_uninit_nolock();
+	ret = wd_comp_setting_uninit(&wd_comp_setting);
 	if (ret)
 		return;
 
-	wd_comp_close_driver(WD_TYPE_V1);
+	wd_comp_close_driver(&wd_comp_setting, WD_TYPE_V1);
 	wd_alg_clear_init(&wd_comp_setting.status);
 }
 
-int wd_comp_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_params *ctx_params)
+static int wd_comp_check_init2(char *alg, __u32 sched_type, int task_type)
 {
-	struct wd_ctx_nums comp_ctx_num[WD_DIR_MAX] = {0};
-	struct wd_ctx_params comp_ctx_params = {0};
-	int state, ret = -WD_EINVAL;
-	bool flag;
-
-	pthread_atfork(NULL, NULL, wd_comp_clear_status);
-
-	state = wd_alg_try_init(&wd_comp_setting.status);
-	if (state)
-		return state;
-
 	if (!alg || sched_type >= SCHED_POLICY_BUTT ||
 	    task_type < 0 || task_type >= TASK_MAX_TYPE) {
 		WD_ERR("invalid: input param is wrong!\n");
-		goto out_uninit;
+		return -WD_EINVAL;
 	}
 
-	flag = wd_comp_alg_check(alg);
-	if (!flag) {
+	if (!wd_comp_alg_check(alg)) {
 		WD_ERR("invalid: comp:%s unsupported!\n", alg);
-		goto out_uninit;
+		return -WD_EINVAL;
 	}
 
-	state = wd_comp_open_driver(WD_TYPE_V2);
-	if (state)
-		goto out_uninit;
+	return 0;
+}
+
+/*
+ * Bind a driver of the alg and request its ctxs, try the next driver if the
+ * devices of the current one are not usable. The instance binds a copy of
+ * the driver in own, the default setting binds the driver itself.
+ */
+static int wd_comp_attrs_init(struct wd_comp_setting *setting,
+			      struct wd_init_attrs *attrs,
+			      struct wd_alg_driver *own, char *alg,
+			      __u32 sched_type, int task_type,
+			      struct wd_ctx_params *ctx_params)
+{
+	struct wd_ctx_nums comp_ctx_num[WD_DIR_MAX] = {0};
+	struct wd_ctx_params comp_ctx_params = {0};
+	struct wd_alg_driver *drv;
+	int ret = -WD_EINVAL;
 
 	while (ret != 0) {
-		memset(&wd_comp_setting.config, 0, sizeof(struct wd_ctx_config_internal));
+		memset(&setting->config, 0, sizeof(struct wd_ctx_config_internal));
 
 		/* Get alg driver and dev name */
-		wd_comp_setting.driver = wd_alg_drv_bind(task_type, alg);
-		if (!wd_comp_setting.driver) {
+		drv = wd_alg_drv_bind(task_type, alg);
+		if (!drv) {
 			WD_ERR("failed to bind %s driver.\n", alg);
-			goto out_dlclose;
+			return ret;
+		}
+
+		if (own) {
+			memcpy(own, drv, sizeof(struct wd_alg_driver));
+			setting->driver = own;
+		} else {
+			setting->driver = drv;
 		}
 
 		comp_ctx_params.ctx_set_num = comp_ctx_num;
 		ret = wd_ctx_param_init(&comp_ctx_params, ctx_params,
-					wd_comp_setting.driver, WD_COMP_TYPE, WD_DIR_MAX);
+					drv, WD_COMP_TYPE, WD_DIR_MAX);
 		if (ret) {
 			if (ret == -WD_EAGAIN) {
-				wd_disable_drv(wd_comp_setting.driver);
-				wd_alg_drv_unbind(wd_comp_setting.driver);
+				wd_disable_drv(drv);
+				wd_alg_drv_unbind(drv);
 				continue;
 			}
 			goto out_unbind_drv;
 		}
 
-		wd_comp_init_attrs.alg = alg;
-		wd_comp_init_attrs.sched_type = sched_type;
-		wd_comp_init_attrs.driver = wd_comp_setting.driver;
-		wd_comp_init_attrs.ctx_params = &comp_ctx_params;
-		wd_comp_init_attrs.alg_init = wd_comp_init_nolock;
-		wd_comp_init_attrs.alg_poll_ctx = wd_comp_poll_ctx;
-		ret = wd_alg_attrs_init(&wd_comp_init_attrs);
+		attrs->alg = alg;
+		attrs->sched_type = sched_type;
+		attrs->driver = setting->driver;
+		attrs->ctx_params = &comp_ctx_params;
+		attrs->alg_poll_ctx = wd_comp_poll_ctx;
+		ret = wd_alg_attrs_init(attrs);
 		if (ret) {
 			if (ret == -WD_ENODEV) {
-				wd_disable_drv(wd_comp_setting.driver);
-				wd_alg_drv_unbind(wd_comp_setting.driver);
+				wd_disable_drv(drv);
+				wd_alg_drv_unbind(drv);
 				wd_ctx_param_uninit(&comp_ctx_params);
 				continue;
 			}
@@ -316,7 +402,6 @@ int wd_comp_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_par
 		}
 	}
 
-	wd_alg_set_init(&wd_comp_setting.status);
 	wd_ctx_param_uninit(&comp_ctx_params);
 
 	return 0;
@@ -324,9 +409,40 @@ int wd_comp_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_par
 out_params_uninit:
 	wd_ctx_param_uninit(&comp_ctx_params);
 out_unbind_drv:
-	wd_alg_drv_unbind(wd_comp_setting.driver);
+	wd_alg_drv_unbind(drv);
+	return ret;
+}
+
+int wd_comp_init2_(char *alg, __u32 sched_type, int task_type, struct wd_ctx_params *ctx_params)
+{
+	int ret;
+
+	pthread_atfork(NULL, NULL, wd_comp_clear_status);
+
+	ret = wd_alg_try_init(&wd_comp_setting.status);
+	if (ret)
+		return ret;
+
+	ret = wd_comp_check_init2(alg, sched_type, task_type);
+	if (ret)
+		goto out_uninit;
+
+	ret = wd_comp_open_driver(&wd_comp_setting, WD_TYPE_V2);
+	if (ret)
+		goto out_uninit;
+
+	wd_comp_init_attrs.alg_init = wd_comp_init_nolock;
+	ret = wd_comp_attrs_init(&wd_comp_setting, &wd_comp_init_attrs, NULL,
+				 alg, sched_type, task_type, ctx_params);
+	if (ret)
+		goto out_dlclose;
+
+	wd_alg_set_init(&wd_comp_setting.status);
+
+	return 0;
+
 out_dlclose:
-	wd_comp_close_driver(WD_TYPE_V2);
+	wd_comp_close_driver(&wd_comp_setting, WD_TYPE_V2);
 out_uninit:
 	wd_alg_clear_init(&wd_comp_setting.status);
 	return ret;
@@ -336,25 +452,115 @@ void wd_comp_uninit2(void)
 {
 	int ret;
 
-	ret = wd_comp_uninit_nolock();
+	ret = wd_comp_setting_uninit(&wd_comp_setting);
 	if (ret)
 		return;
 
 	wd_alg_attrs_uninit(&wd_comp_init_attrs);
 	wd_alg_drv_unbind(wd_comp_setting.driver);
-	wd_comp_close_driver(WD_TYPE_V2);
+	wd_comp_close_driver(&wd_comp_setting, WD_TYPE_V2);
 	wd_comp_setting.dlh_list = NULL;
 	wd_alg_clear_init(&wd_comp_setting.status);
 }
 
+static int wd_comp_setting_poll_ctx(struct wd_comp_setting *setting,
+				    __u32 idx, __u32 expt, __u32 *count);
+
+static int wd_comp_inst_poll_ctx(void *priv, __u32 idx, __u32 expt, __u32 *count)
+{
+	return wd_comp_setting_poll_ctx(priv, idx, expt, count);
+}
+
+static int wd_comp_inst_init(void *priv, struct wd_ctx_config *config,
+			     struct wd_sched *sched)
+{
+	struct wd_comp_setting *setting = priv;
+	int ret;
+
+	ret = wd_comp_setting_init(setting, config, sched);
+	if (ret)
+		return ret;
+
+	/* The sched polls the ctxs of the instance instead of the default ones */
+	wd_sched_set_poll(sched, wd_comp_inst_poll_ctx, setting);
+
+	return 0;
+}
+
+handle_t wd_comp_instance_create(char *alg, __u32 sched_type, int task_type,
+				 struct wd_ctx_params *ctx_params)
+{
+	struct wd_comp_setting *setting;
+	struct wd_comp_inst *inst;
+	int ret;
+
+	ret = wd_comp_check_init2(alg, sched_type, task_type);
+	if (ret)
+		return (handle_t)0;
+
+	inst = calloc(1, sizeof(struct wd_comp_inst));
+	if (!inst) {
+		WD_ERR("failed to alloc comp instance!\n");
+		return (handle_t)0;
+	}
+
+	setting = &inst->setting;
+	setting->env_config = &inst->env_config;
+
+	ret = wd_comp_open_driver(setting, WD_TYPE_V2);
+	if (ret)
+		goto out_free_inst;
+
+	inst->attrs.alg_init_priv = wd_comp_inst_init;
+	inst->attrs.priv = setting;
+	ret = wd_comp_attrs_init(setting, &inst->attrs, &inst->drv,
+				 alg, sched_type, task_type, ctx_params);
+	if (ret)
+		goto out_dlclose;
+
+	wd_alg_set_init(&setting->status);
+
+	return (handle_t)inst;
+
+out_dlclose:
+	wd_comp_close_driver(setting, WD_TYPE_V2);
+out_free_inst:
+	free(inst);
+	return (handle_t)0;
+}
+
+void wd_comp_instance_destroy(handle_t h_inst)
+{
+	struct wd_comp_inst *inst = (struct wd_comp_inst *)h_inst;
+	struct wd_comp_setting *setting;
+
+	if (!inst)
+		return;
+
+	setting = &inst->setting;
+	if (wd_comp_setting_uninit(setting))
+		return;
+
+	wd_alg_attrs_uninit(&inst->attrs);
+	wd_alg_drv_unbind(setting->driver);
+	wd_comp_close_driver(setting, WD_TYPE_V2);
+	free(inst);
+}
+
 struct wd_comp_msg *wd_comp_get_msg(__u32 idx, __u32 tag)
 {
-	return wd_find_msg_in_pool(&wd_comp_setting.pool, idx, tag);
+	struct wd_comp_setting *setting = wd_comp_poll_setting;
+
+	if (!setting)
+		setting = &wd_comp_setting;
+
+	return wd_find_msg_in_pool(&setting->pool, idx, tag);
 }
 
-int wd_comp_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
+static int wd_comp_setting_poll_ctx(struct wd_comp_setting *setting,
+				    __u32 idx, __u32 expt, __u32 *count)
 {
-	struct wd_ctx_config_internal *config = &wd_comp_setting.config;
+	struct wd_ctx_config_internal *config = &setting->config;
 	struct wd_ctx_internal *ctx;
 	struct wd_comp_msg resp_msg;
 	struct wd_comp_msg *msg;
@@ -375,9 +581,10 @@ int wd_comp_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 		return ret;
 
 	ctx = config->ctxs + idx;
+	wd_comp_poll_setting = setting;
 
 	do {
-		ret = wd_alg_driver_recv(wd_comp_setting.driver, ctx->ctx, &resp_msg);
+		ret = wd_alg_driver_recv(setting->driver, ctx->ctx, &resp_msg);
 		if (unlikely(ret < 0)) {
 			if (ret == -WD_HW_EACCESS)
 				WD_ERR("wd comp recv hw error!\n");
@@ -386,26 +593,32 @@ int wd_comp_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 
 		recv_count++;
 
-		msg = wd_find_msg_in_pool(&wd_comp_setting.pool, idx,
+		msg = wd_find_msg_in_pool(&setting->pool, idx,
 					  resp_msg.tag);
 		if (unlikely(!msg)) {
 			WD_ERR("failed to find msg from pool!\n");
 			return -WD_EINVAL;
 		}
 
+		wd_dfx_msg_done(config, idx, msg->in_cons, msg->produced);
 		req = &msg->req;
 		req->src_len = msg->in_cons;
 		req->dst_len = msg->produced;
 		req->cb(req, req->cb_param);
 
 		/* free msg cache to msg_pool */
-		wd_put_msg_to_pool(&wd_comp_setting.pool, idx, resp_msg.tag);
+		wd_put_msg_to_pool(&setting->pool, idx, resp_msg.tag);
 		*count = recv_count;
 	} while (--tmp);
 
 	return ret;
 }
 
+int wd_comp_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
+{
+	return wd_comp_setting_poll_ctx(&wd_comp_setting, idx, expt, count);
+}
+
 static int wd_comp_check_sess_params(struct wd_comp_sess_setup *setup)
 {
 	if (setup->alg_type >= WD_COMP_ALG_MAX)  {
@@ -434,7 +647,8 @@ static int wd_comp_check_sess_params(struct wd_comp_sess_setup *setup)
 	return WD_SUCCESS;
 }
 
-handle_t wd_comp_alloc_sess(struct wd_comp_sess_setup *setup)
+static handle_t wd_comp_setting_alloc_sess(struct wd_comp_setting *setting,
+					   struct wd_comp_sess_setup *setup)
 {
 	struct wd_comp_sess *sess;
 	int ret;
@@ -458,10 +672,15 @@ handle_t wd_comp_alloc_sess(struct wd_comp_sess_setup *setup)
 	sess->comp_lv = setup->comp_lv;
 	sess->win_sz = setup->win_sz;
 	sess->stream_pos = WD_COMP_STREAM_NEW;
+	sess->setting = setting;
+
+	/* The ops are optional, only the drivers which keep state need them */
+	if (setting->driver->get_extend_ops)
+		(void)setting->driver->get_extend_ops(&sess->ops);
 
 	/* Some simple scheduler don't need scheduling parameters */
-	sess->sched_key = (void *)wd_comp_setting.sched.sched_init(
-		     wd_comp_setting.sched.h_sched_ctx, setup->sched_param);
+	sess->sched_key = (void *)setting->sched.sched_init(
+		     setting->sched.h_sched_ctx, setup->sched_param);
 	if (WD_IS_ERR(sess->sched_key)) {
 		WD_ERR("failed to init session schedule key!\n");
 		goto sched_err;
@@ -476,6 +695,24 @@ sess_err:
 	return (handle_t)0;
 }
 
+handle_t wd_comp_alloc_sess(struct wd_comp_sess_setup *setup)
+{
+	return wd_comp_setting_alloc_sess(&wd_comp_setting, setup);
+}
+
+handle_t wd_comp_instance_alloc_sess(handle_t h_inst,
+				     struct wd_comp_sess_setup *setup)
+{
+	struct wd_comp_inst *inst = (struct wd_comp_inst *)h_inst;
+
+	if (!inst) {
+		WD_ERR("invalid: comp instance is NULL!\n");
+		return (handle_t)0;
+	}
+
+	return wd_comp_setting_alloc_sess(&inst->setting, setup);
+}
+
 void wd_comp_free_sess(handle_t h_sess)
 {
 	struct wd_comp_sess *sess = (struct wd_comp_sess *)h_sess;
@@ -483,8 +720,11 @@ void wd_comp_free_sess(handle_t h_sess)
 	if (!sess)
 		return;
 
-	if (sess->ctx_buf)
+	if (sess->ctx_buf) {
+		if (sess->ops.sess_reset)
+			sess->ops.sess_reset(sess->ctx_buf);
 		free(sess->ctx_buf);
+	}
 
 	if (sess->sched_key)
 		free(sess->sched_key);
@@ -502,6 +742,8 @@ int wd_comp_reset_sess(handle_t h_sess)
 	}
 
 	sess->stream_pos = WD_COMP_STREAM_NEW;
+	if (sess->ops.sess_reset)
+		sess->ops.sess_reset(sess->ctx_buf);
 	memset(sess->ctx_buf, 0, HW_CTX_SIZE);
 
 	return 0;
@@ -568,6 +810,14 @@ static int wd_comp_check_params(struct wd_comp_sess *sess,
 		return -WD_EINVAL;
 	}
 
+	/* A soft driver does the request in send, it has nothing to poll */
+	if (unlikely(mode == CTX_MODE_ASYNC &&
+		     sess->setting->driver->calc_type == UADK_ALG_SOFT)) {
+		WD_ERR("invalid: %s driver doesn't support async comp!\n",
+		       sess->setting->driver->drv_name);
+		return -WD_EINVAL;
+	}
+
 	if (unlikely(mode == CTX_MODE_ASYNC && !req->cb)) {
 		WD_ERR("invalid: async comp cb is NULL!\n");
 		return -WD_EINVAL;
@@ -590,30 +840,34 @@ static int wd_comp_sync_job(struct wd_comp_sess *sess,
 			    struct wd_comp_req *req,
 			    struct wd_comp_msg *msg)
 {
-	struct wd_ctx_config_internal *config = &wd_comp_setting.config;
-	handle_t h_sched_ctx = wd_comp_setting.sched.h_sched_ctx;
+	struct wd_comp_setting *setting = sess->setting;
+	struct wd_ctx_config_internal *config = &setting->config;
+	handle_t h_sched_ctx = setting->sched.h_sched_ctx;
 	struct wd_msg_handle msg_handle;
 	struct wd_ctx_internal *ctx;
 	__u32 idx;
 	int ret;
 
-	idx = wd_comp_setting.sched.pick_next_ctx(h_sched_ctx,
-						  sess->sched_key,
-						  CTX_MODE_SYNC);
+	idx = setting->sched.pick_next_ctx(h_sched_ctx, sess->sched_key,
+					   CTX_MODE_SYNC);
 	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
 	if (unlikely(ret))
 		return ret;
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ctx = config->ctxs + idx;
 
-	msg_handle.send = wd_comp_setting.driver->send;
-	msg_handle.recv = wd_comp_setting.driver->recv;
+	msg_handle.send = setting->driver->send;
+	msg_handle.recv = setting->driver->recv;
 
+	wd_ctx_inflight_add(ctx, 1);
 	pthread_spin_lock(&ctx->lock);
-	ret = wd_handle_msg_sync(wd_comp_setting.driver, &msg_handle, ctx->ctx,
-				 msg, NULL, config->epoll_en);
+	ret = wd_handle_msg_sync(setting->driver, &msg_handle, config,
+				 ctx, msg, msg->req.src_len, NULL);
 	pthread_spin_unlock(&ctx->lock);
+	wd_ctx_inflight_sub(ctx, 1);
+	if (likely(!ret))
+		wd_dfx_msg_done(config, idx, msg->in_cons, msg->produced);
 
 	return ret;
 }
@@ -640,6 +894,11 @@ int wd_do_comp_sync(handle_t h_sess, struct wd_comp_req *req)
 	msg.stream_mode = WD_COMP_STATELESS;
 
 	ret = wd_comp_sync_job(sess, req, &msg);
+	/* The stateless request has no hardware state, so it can overflow */
+	if (unlikely(ret == -WD_EBUSY) &&
+	    wd_alg_fallback_en(sess->setting->driver, &sess->setting->config))
+		ret = wd_alg_do_fallback(sess->setting->driver,
+					 &sess->setting->config, &msg);
 	if (unlikely(ret))
 		return ret;
 
@@ -650,6 +909,459 @@ int wd_do_comp_sync(handle_t h_sess, struct wd_comp_req *req)
 	return 0;
 }
 
+static int wd_comp_check_batch(struct wd_comp_sess *sess,
+			       struct wd_comp_req **reqs,
+			       __u32 num, __u8 mode)
+{
+	__u32 i;
+	int ret;
+
+	if (unlikely(!reqs || !num || num > WD_MAX_BATCH_NUM)) {
+		WD_ERR("invalid: comp batch reqs is NULL or num %u is error!\n", num);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < num; i++) {
+		ret = wd_comp_check_params(sess, reqs[i], mode);
+		if (unlikely(ret))
+			return ret;
+
+		if (unlikely(!reqs[i]->src_len)) {
+			WD_ERR("invalid: req src_len is 0!\n");
+			return -WD_EINVAL;
+		}
+
+		/* All requests of a batch are sent to the same ctx */
+		if (unlikely(reqs[i]->op_type != reqs[0]->op_type)) {
+			WD_ERR("invalid: comp batch op_type is not the same!\n");
+			return -WD_EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int wd_do_comp_sync_batch(handle_t h_sess, struct wd_comp_req **reqs, __u32 num)
+{
+	struct wd_comp_sess *sess = (struct wd_comp_sess *)h_sess;
+	struct wd_ctx_config_internal *config;
+	struct wd_comp_setting *setting;
+	handle_t h_sched_ctx;
+	struct wd_comp_msg msgs[WD_MAX_BATCH_NUM];
+	void *msg_list[WD_MAX_BATCH_NUM];
+	struct wd_msg_handle msg_handle;
+	struct wd_ctx_internal *ctx;
+	__u32 idx, i;
+	int ret;
+
+	ret = wd_comp_check_batch(sess, reqs, num, CTX_MODE_SYNC);
+	if (unlikely(ret))
+		return ret;
+
+	setting = sess->setting;
+	config = &setting->config;
+	h_sched_ctx = setting->sched.h_sched_ctx;
+
+	/* Stateless requests, the ctx_buf of the session is not needed. */
+	memset(msgs, 0, sizeof(struct wd_comp_msg) * num);
+	for (i = 0; i < num; i++) {
+		fill_comp_msg(sess, &msgs[i], reqs[i]);
+		msgs[i].stream_mode = WD_COMP_STATELESS;
+		msgs[i].tag = i;
+		msg_list[i] = &msgs[i];
+	}
+
+	idx = setting->sched.pick_next_ctx(h_sched_ctx, sess->sched_key,
+					   CTX_MODE_SYNC);
+	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
+	if (unlikely(ret))
+		return ret;
+
+	ctx = config->ctxs + idx;
+
+	msg_handle.send = setting->driver->send;
+	msg_handle.recv = setting->driver->recv;
+
+	wd_ctx_inflight_add(ctx, num);
+	pthread_spin_lock(&ctx->lock);
+	ret = wd_handle_msg_sync_batch(setting->driver, &msg_handle, config,
+				       ctx, msg_list, num, msgs[0].req.src_len, NULL);
+	pthread_spin_unlock(&ctx->lock);
+	wd_ctx_inflight_sub(ctx, num);
+	if (unlikely(ret))
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		reqs[i]->src_len = msgs[i].in_cons;
+		reqs[i]->dst_len = msgs[i].produced;
+		reqs[i]->status = msgs[i].req.status;
+		wd_dfx_msg_done(config, idx, msgs[i].in_cons, msgs[i].produced);
+	}
+
+	return 0;
+}
+
+static unsigned int bit_reverse(register unsigned int target)
+{
+	register unsigned int x = target;
+
+	x = (((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1));
+	x = (((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2));
+	x = (((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4));
+	x = (((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8));
+
+	return ((x >> 16) | (x << 16));
+}
+
+/* The adler32 of A followed by B, from the adler32 of each part */
+static __u32 wd_adler32_combine(__u32 adler1, __u32 adler2, __u64 len2)
+{
+	__u32 rem = len2 % ADLER_BASE;
+	__u32 sum1, sum2;
+
+	sum1 = adler1 & 0xffff;
+	sum2 = (rem * sum1) % ADLER_BASE;
+	sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+	sum2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+	if (sum1 >= ADLER_BASE)
+		sum1 -= ADLER_BASE;
+	if (sum1 >= ADLER_BASE)
+		sum1 -= ADLER_BASE;
+	if (sum2 >= (ADLER_BASE << 1))
+		sum2 -= (ADLER_BASE << 1);
+	if (sum2 >= ADLER_BASE)
+		sum2 -= ADLER_BASE;
+
+	return sum1 | (sum2 << 16);
+}
+
+/* a * b modulo the crc32 polynomial, in the reflected bit order */
+static __u32 wd_crc32_multmodp(__u32 a, __u32 b)
+{
+	__u32 m = 1U << 31;
+	__u32 p = 0;
+
+	while (m) {
+		if (a & m)
+			p ^= b;
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ CRC32_POLY : b >> 1;
+	}
+
+	return p;
+}
+
+/* The crc32 of A followed by B: shift crc1 over len2 zero bytes */
+static __u32 wd_crc32_combine(__u32 crc1, __u32 crc2, __u64 len2)
+{
+	/* x^8 is one byte, square it for each bit of len2 */
+	__u32 x2n = 1U << 23;
+	__u32 p = 1U << 31;
+
+	while (len2) {
+		if (len2 & 1)
+			p = wd_crc32_multmodp(x2n, p);
+		x2n = wd_crc32_multmodp(x2n, x2n);
+		len2 >>= 1;
+	}
+
+	return wd_crc32_multmodp(p, crc1) ^ crc2;
+}
+
+/* A chunk of wd_do_comp_sync2 which is compressed as an independent stream */
+struct wd_comp_par_chunk {
+	struct wd_comp_msg msg;
+	__u8 *ctx_buf;
+	__u8 *out;
+};
+
+/* A ctx which is held for a round of chunks */
+struct wd_comp_par_lane {
+	struct wd_ctx_internal *ctx;
+	void *msgs[PAR_MAX_NUM];
+	__u32 idx;
+	__u32 num;
+	__u32 sent;
+};
+
+/*
+ * Hold up to PAR_MAX_LANES ctxs picked by the scheduler. Only the first one
+ * waits for its lock, the others are skipped if they are busy, so that two
+ * parallel callers can not deadlock on each other.
+ */
+static __u32 wd_comp_par_hold(struct wd_comp_sess *sess,
+			      struct wd_comp_par_lane *lanes, __u32 max)
+{
+	struct wd_comp_setting *setting = sess->setting;
+	struct wd_ctx_config_internal *config = &setting->config;
+	__u32 num = 0;
+	__u32 i, j, idx;
+
+	for (i = 0; i < max; i++) {
+		idx = setting->sched.pick_next_ctx(setting->sched.h_sched_ctx,
+						   sess->sched_key, CTX_MODE_SYNC);
+		if (wd_check_ctx(config, CTX_MODE_SYNC, idx))
+			break;
+
+		for (j = 0; j < num; j++)
+			if (lanes[j].idx == idx)
+				break;
+		/* The scheduler has only j different ctxs */
+		if (j < num)
+			break;
+
+		lanes[num].ctx = config->ctxs + idx;
+		wd_ctx_inflight_add(lanes[num].ctx, 1);
+		if (!num) {
+			pthread_spin_lock(&lanes[num].ctx->lock);
+		} else if (pthread_spin_trylock(&lanes[num].ctx->lock)) {
+			wd_ctx_inflight_sub(lanes[num].ctx, 1);
+			continue;
+		}
+
+		lanes[num].idx = idx;
+		lanes[num].num = 0;
+		lanes[num].sent = 0;
+		num++;
+	}
+
+	return num;
+}
+
+/* Send the chunks to all lanes first, then recv them lane by lane */
+static int wd_comp_par_round(struct wd_comp_sess *sess,
+			     struct wd_comp_par_chunk *chunks, __u32 num)
+{
+	struct wd_comp_setting *setting = sess->setting;
+	struct wd_ctx_config_internal *config = &setting->config;
+	struct wd_comp_par_lane lanes[PAR_MAX_LANES];
+	struct wd_msg_handle msg_handle;
+	struct wd_comp_par_lane *lane;
+	__u32 lane_num, i, j;
+	int ret = 0;
+	int rret;
+
+	lane_num = wd_comp_par_hold(sess, lanes, num < PAR_MAX_LANES ?
+				    num : PAR_MAX_LANES);
+	if (unlikely(!lane_num)) {
+		WD_ERR("failed to get a sync ctx for parallel comp!\n");
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < num; i++) {
+		lane = &lanes[i % lane_num];
+		chunks[i].msg.tag = i;
+		lane->msgs[lane->num++] = &chunks[i].msg;
+	}
+
+	/* wd_comp_par_hold() counted one request per lane */
+	for (i = 0; i < lane_num; i++)
+		wd_ctx_inflight_add(lanes[i].ctx, lanes[i].num - 1);
+
+	for (i = 0; i < lane_num; i++) {
+		ret = wd_send_msg_batch_sync(setting->driver, lanes[i].ctx,
+					     lanes[i].msgs, lanes[i].num,
+					     &lanes[i].sent);
+		if (unlikely(ret))
+			break;
+	}
+
+	msg_handle.send = setting->driver->send;
+	msg_handle.recv = setting->driver->recv;
+
+	/* The sent chunks are drained even if the others fail */
+	for (i = 0; i < lane_num; i++) {
+		lane = &lanes[i];
+		if (lane->sent) {
+			rret = wd_recv_msg_batch_sync(setting->driver, &msg_handle,
+						      config, lane->ctx, lane->msgs,
+						      lane->sent, STREAM_CHUNK);
+			ret = ret ? ret : rret;
+		}
+
+		/* The queue was full, send the rest when it is drained */
+		if (!ret && lane->sent < lane->num)
+			ret = wd_handle_msg_sync_batch(setting->driver, &msg_handle,
+						       config, lane->ctx,
+						       lane->msgs + lane->sent,
+						       lane->num - lane->sent,
+						       STREAM_CHUNK, NULL);
+		pthread_spin_unlock(&lane->ctx->lock);
+		wd_ctx_inflight_sub(lane->ctx, lane->num);
+
+		if (ret)
+			continue;
+
+		for (j = 0; j < lane->num; j++) {
+			struct wd_comp_msg *msg = lane->msgs[j];
+
+			wd_dfx_msg_done(config, lane->idx, msg->in_cons,
+					msg->produced);
+		}
+	}
+
+	return ret;
+}
+
+static void wd_comp_par_fill(struct wd_comp_sess *sess,
+			     struct wd_comp_par_chunk *chunk,
+			     struct wd_comp_req *req, __u32 offset, __u32 len)
+{
+	struct wd_comp_msg *msg = &chunk->msg;
+
+	memset(msg, 0, sizeof(struct wd_comp_msg));
+	fill_comp_msg(sess, msg, req);
+	msg->req.src = req->src + offset;
+	msg->req.src_len = len;
+	msg->req.dst = chunk->out;
+	msg->req.dst_len = PAR_CHUNK_OUT;
+	msg->avail_out = PAR_CHUNK_OUT;
+	/* The chunks but the last end with a sync flush, so they can be joined */
+	msg->req.last = offset + len == req->src_len;
+	msg->stream_mode = WD_COMP_STATEFUL;
+	msg->stream_pos = WD_COMP_STREAM_NEW;
+	/* The stream of a non-last chunk is not ended by the driver */
+	if (sess->ops.sess_reset)
+		sess->ops.sess_reset(chunk->ctx_buf);
+	memset(chunk->ctx_buf, 0, HW_CTX_SIZE);
+	msg->ctx_buf = chunk->ctx_buf;
+}
+
+static void wd_comp_par_tail(struct wd_comp_sess *sess, __u8 *tail,
+			     __u32 checksum, __u32 isize)
+{
+	if (sess->alg_type == WD_ZLIB) {
+		checksum = (__u32)cpu_to_be32(checksum);
+		memcpy(tail, &checksum, sizeof(checksum));
+	} else if (sess->alg_type == WD_GZIP) {
+		memcpy(tail, &checksum, sizeof(checksum));
+		memcpy(tail + sizeof(checksum), &isize, sizeof(isize));
+	}
+}
+
+static bool wd_comp_par_check(struct wd_comp_sess *sess, struct wd_comp_req *req)
+{
+	return sess->setting->par_num > 1 && req->op_type == WD_DIR_COMPRESS &&
+	       req->data_fmt == WD_FLAT_BUF && sess->alg_type <= WD_GZIP &&
+	       sess->stream_pos == WD_COMP_STREAM_NEW &&
+	       req->src_len > STREAM_CHUNK;
+}
+
+/*
+ * Compress the chunks of a large request concurrently on several ctxs. Each
+ * chunk is a new stream, the chunks but the first lose the stream head, the
+ * last one loses its tail, and the tail is rebuilt with the checksum of the
+ * whole input, so the output is a single zlib, gzip or deflate stream.
+ */
+static int wd_comp_sync2_par(struct wd_comp_sess *sess, struct wd_comp_req *req)
+{
+	__u32 head = 0, tail = 0, checksum = 0, isize = 0;
+	__u32 par_num = sess->setting->par_num;
+	struct wd_comp_par_chunk *chunks;
+	__u32 in_off = 0, out_off = 0;
+	__u32 num, len, i;
+	bool first = true;
+	__u8 *bufs;
+	int ret = 0;
+
+	if (sess->alg_type == WD_ZLIB) {
+		head = ZLIB_HEAD_SIZE;
+		tail = ZLIB_TAIL_SIZE;
+		checksum = 1;
+	} else if (sess->alg_type == WD_GZIP) {
+		head = GZIP_HEAD_SIZE;
+		tail = GZIP_TAIL_SIZE;
+	}
+
+	chunks = calloc(par_num, sizeof(struct wd_comp_par_chunk));
+	if (!chunks)
+		return -WD_ENOMEM;
+
+	bufs = malloc((size_t)par_num * (HW_CTX_SIZE + PAR_CHUNK_OUT));
+	if (!bufs) {
+		free(chunks);
+		return -WD_ENOMEM;
+	}
+
+	for (i = 0; i < par_num; i++) {
+		chunks[i].ctx_buf = bufs + (size_t)i * (HW_CTX_SIZE + PAR_CHUNK_OUT);
+		chunks[i].out = chunks[i].ctx_buf + HW_CTX_SIZE;
+		memset(chunks[i].ctx_buf, 0, HW_CTX_SIZE);
+	}
+
+	while (in_off < req->src_len) {
+		for (num = 0; num < par_num && in_off < req->src_len; num++) {
+			len = req->src_len - in_off;
+			len = len > STREAM_CHUNK ? STREAM_CHUNK : len;
+			wd_comp_par_fill(sess, &chunks[num], req, in_off, len);
+			in_off += len;
+		}
+
+		ret = wd_comp_par_round(sess, chunks, num);
+		if (unlikely(ret))
+			goto out_free;
+
+		for (i = 0; i < num; i++) {
+			struct wd_comp_msg *msg = &chunks[i].msg;
+			__u8 *out = chunks[i].out;
+
+			len = msg->produced;
+			if (unlikely(msg->in_cons != msg->req.src_len ||
+				     msg->req.status == WD_IN_EPARA ||
+				     len < head + (msg->req.last ? tail : 0))) {
+				WD_ERR("invalid: parallel comp chunk is incomplete, status = %u!\n",
+				       msg->req.status);
+				ret = -WD_EINVAL;
+				goto out_free;
+			}
+
+			if (!first) {
+				out += head;
+				len -= head;
+			}
+			if (msg->req.last)
+				len -= tail;
+
+			if (unlikely(out_off + len + (msg->req.last ? tail : 0) >
+				     req->dst_len)) {
+				WD_ERR("invalid: dst_len %u is too small!\n", req->dst_len);
+				ret = -WD_EINVAL;
+				goto out_free;
+			}
+
+			memcpy(req->dst + out_off, out, len);
+			out_off += len;
+
+			if (sess->alg_type == WD_ZLIB) {
+				checksum = first ? msg->checksum :
+					   wd_adler32_combine(checksum, msg->checksum,
+							      msg->in_cons);
+			} else if (sess->alg_type == WD_GZIP) {
+				/* Get the crc32 value as append_store_block() */
+				__u32 crc = bit_reverse(~msg->checksum);
+
+				checksum = first ? crc :
+					   wd_crc32_combine(checksum, crc, msg->in_cons);
+			}
+			isize += msg->in_cons;
+			first = false;
+		}
+	}
+
+	wd_comp_par_tail(sess, req->dst + out_off, checksum, isize);
+	req->dst_len = out_off + tail;
+	req->status = 0;
+
+out_free:
+	if (sess->ops.sess_reset) {
+		for (i = 0; i < par_num; i++)
+			sess->ops.sess_reset(chunks[i].ctx_buf);
+	}
+	free(bufs);
+	free(chunks);
+	return ret;
+}
+
 int wd_do_comp_sync2(handle_t h_sess, struct wd_comp_req *req)
 {
 	struct wd_comp_sess *sess = (struct wd_comp_sess *)h_sess;
@@ -668,6 +1380,9 @@ int wd_do_comp_sync2(handle_t h_sess, struct wd_comp_req *req)
 		return -WD_EINVAL;
 	}
 
+	if (wd_comp_par_check(sess, req))
+		return wd_comp_sync2_par(sess, req);
+
 	total_avail_in = req->src_len;
 	total_avail_out = req->dst_len;
 	/* strm_req and req share the same src and dst buffer */
@@ -711,18 +1426,6 @@ int wd_do_comp_sync2(handle_t h_sess, struct wd_comp_req *req)
 	return 0;
 }
 
-static unsigned int bit_reverse(register unsigned int target)
-{
-	register unsigned int x = target;
-
-	x = (((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1));
-	x = (((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2));
-	x = (((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4));
-	x = (((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8));
-
-	return ((x >> 16) | (x << 16));
-}
-
 /**
  * append_store_block() - output an fixed store block when input
  * a empty block as last stream block. And supplement the packet
@@ -829,11 +1532,35 @@ int wd_do_comp_strm(handle_t h_sess, struct wd_comp_req *req)
 	return 0;
 }
 
+/* The overflow request is done by the fallback driver and called back at once */
+static int wd_comp_async_fallback(struct wd_comp_sess *sess,
+				  struct wd_comp_req *req)
+{
+	struct wd_comp_msg msg;
+	int ret;
+
+	memset(&msg, 0, sizeof(struct wd_comp_msg));
+	fill_comp_msg(sess, &msg, req);
+	msg.stream_mode = WD_COMP_STATELESS;
+
+	ret = wd_alg_do_fallback(sess->setting->driver,
+				 &sess->setting->config, &msg);
+	if (unlikely(ret))
+		return ret;
+
+	msg.req.src_len = msg.in_cons;
+	msg.req.dst_len = msg.produced;
+	msg.req.cb(&msg.req, msg.req.cb_param);
+
+	return 0;
+}
+
 int wd_do_comp_async(handle_t h_sess, struct wd_comp_req *req)
 {
-	struct wd_ctx_config_internal *config = &wd_comp_setting.config;
 	struct wd_comp_sess *sess = (struct wd_comp_sess *)h_sess;
-	handle_t h_sched_ctx = wd_comp_setting.sched.h_sched_ctx;
+	struct wd_ctx_config_internal *config;
+	struct wd_comp_setting *setting;
+	handle_t h_sched_ctx;
 	struct wd_ctx_internal *ctx;
 	struct wd_comp_msg *msg;
 	int tag, ret;
@@ -843,22 +1570,33 @@ int wd_do_comp_async(handle_t h_sess, struct wd_comp_req *req)
 	if (unlikely(ret))
 		return ret;
 
+	setting = sess->setting;
+	config = &setting->config;
+	h_sched_ctx = setting->sched.h_sched_ctx;
+
 	if (unlikely(!req->src_len)) {
 		WD_ERR("invalid: req src_len is 0!\n");
 		return -WD_EINVAL;
 	}
 
-	idx = wd_comp_setting.sched.pick_next_ctx(h_sched_ctx,
-						  sess->sched_key,
-						  CTX_MODE_ASYNC);
+	idx = setting->sched.pick_next_ctx(h_sched_ctx, sess->sched_key,
+					   CTX_MODE_ASYNC);
 	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
 	if (unlikely(ret))
 		return ret;
 
 	ctx = config->ctxs + idx;
 
-	tag = wd_get_msg_from_pool(&wd_comp_setting.pool, idx, (void **)&msg);
+	if (wd_alg_fallback_check(setting->driver, config,
+				  &setting->pool, idx))
+		return wd_comp_async_fallback(sess, req);
+
+	tag = wd_get_msg_from_pool(&setting->pool, idx, (void **)&msg);
 	if (unlikely(tag < 0)) {
+		if (tag == -WD_EBUSY &&
+		    wd_alg_fallback_en(setting->driver, config))
+			return wd_comp_async_fallback(sess, req);
+
 		WD_ERR("failed to get msg from pool!\n");
 		return tag;
 	}
@@ -866,26 +1604,92 @@ int wd_do_comp_async(handle_t h_sess, struct wd_comp_req *req)
 	msg->tag = tag;
 	msg->stream_mode = WD_COMP_STATELESS;
 
-	ret = wd_alg_driver_send(wd_comp_setting.driver, ctx->ctx, msg);
+	ret = wd_alg_driver_send(setting->driver, ctx->ctx, msg);
 	if (unlikely(ret < 0)) {
+		wd_dfx_msg_err(config, idx, ret);
+		if (ret == -WD_EBUSY &&
+		    wd_alg_fallback_en(setting->driver, config)) {
+			wd_put_msg_to_pool(&setting->pool, idx, msg->tag);
+			return wd_comp_async_fallback(sess, req);
+		}
+
 		WD_ERR("wd comp send error, ret = %d!\n", ret);
 		goto fail_with_msg;
 	}
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
-	ret = wd_add_task_to_async_queue(&wd_comp_env_config, idx);
+	wd_dfx_msg_cnt(config, idx);
+	ret = wd_add_task_to_async_queue(setting->env_config, idx);
 	if (unlikely(ret))
 		goto fail_with_msg;
 
 	return 0;
 
 fail_with_msg:
-	wd_put_msg_to_pool(&wd_comp_setting.pool, idx, msg->tag);
+	wd_put_msg_to_pool(&setting->pool, idx, msg->tag);
 
 	return ret;
 }
 
-int wd_comp_poll(__u32 expt, __u32 *count)
+int wd_do_comp_async_batch(handle_t h_sess, struct wd_comp_req **reqs,
+			   __u32 num, __u32 *count)
+{
+	struct wd_comp_sess *sess = (struct wd_comp_sess *)h_sess;
+	struct wd_ctx_config_internal *config;
+	struct wd_comp_setting *setting;
+	handle_t h_sched_ctx;
+	void *msg_list[WD_MAX_BATCH_NUM];
+	__u32 tags[WD_MAX_BATCH_NUM];
+	struct wd_comp_msg *msg;
+	__u32 idx, i;
+	int tag, ret;
+
+	if (unlikely(!count)) {
+		WD_ERR("invalid: comp batch count is NULL!\n");
+		return -WD_EINVAL;
+	}
+	*count = 0;
+
+	ret = wd_comp_check_batch(sess, reqs, num, CTX_MODE_ASYNC);
+	if (unlikely(ret))
+		return ret;
+
+	setting = sess->setting;
+	config = &setting->config;
+	h_sched_ctx = setting->sched.h_sched_ctx;
+
+	idx = setting->sched.pick_next_ctx(h_sched_ctx, sess->sched_key,
+					   CTX_MODE_ASYNC);
+	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
+	if (unlikely(ret))
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		tag = wd_get_msg_from_pool(&setting->pool, idx, (void **)&msg);
+		if (unlikely(tag < 0)) {
+			if (!i) {
+				WD_ERR("failed to get msg from pool!\n");
+				return tag;
+			}
+			/* Send the msgs got from the pool, the caller retries the rest */
+			break;
+		}
+		fill_comp_msg(sess, msg, reqs[i]);
+		msg->tag = tag;
+		msg->stream_mode = WD_COMP_STATELESS;
+		msg_list[i] = msg;
+		tags[i] = tag;
+	}
+
+	ret = wd_send_async_batch(setting->driver, config, &setting->pool,
+				  setting->env_config, idx, msg_list, tags, i, count);
+	if (unlikely(ret))
+		return ret;
+
+	return *count < num ? -WD_EBUSY : 0;
+}
+
+static int wd_comp_setting_poll(struct wd_comp_setting *setting,
+				__u32 expt, __u32 *count)
 {
 	handle_t h_sched_ctx;
 	struct wd_sched *sched;
@@ -895,12 +1699,35 @@ int wd_comp_poll(__u32 expt, __u32 *count)
 		return -WD_EINVAL;
 	}
 
-	h_sched_ctx = wd_comp_setting.sched.h_sched_ctx;
-	sched = &wd_comp_setting.sched;
+	/* A soft driver does the request in send, it has nothing to poll */
+	if (setting->driver && setting->driver->calc_type == UADK_ALG_SOFT) {
+		*count = 0;
+		return WD_SUCCESS;
+	}
+
+	h_sched_ctx = setting->sched.h_sched_ctx;
+	sched = &setting->sched;
 
 	return sched->poll_policy(h_sched_ctx, expt, count);
 }
 
+int wd_comp_poll(__u32 expt, __u32 *count)
+{
+	return wd_comp_setting_poll(&wd_comp_setting, expt, count);
+}
+
+int wd_comp_instance_poll(handle_t h_inst, __u32 expt, __u32 *count)
+{
+	struct wd_comp_inst *inst = (struct wd_comp_inst *)h_inst;
+
+	if (unlikely(!inst)) {
+		WD_ERR("invalid: comp instance is NULL!\n");
+		return -WD_EINVAL;
+	}
+
+	return wd_comp_setting_poll(&inst->setting, expt, count);
+}
+
 static const struct wd_config_variable table[] = {
 	{ .name = "WD_COMP_CTX_NUM",
 	  .def_val = "sync-comp:1@0,sync-decomp:1@0,async-comp:1@0,async-decomp:1@0",
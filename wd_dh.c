@@ -124,6 +124,10 @@ static int wd_dh_common_init(struct wd_ctx_config *config, struct wd_sched *sche
 	if (ret < 0)
 		return ret;
 
+	ret = wd_set_wait_policy("WD_DH_WAIT_POLICY", &wd_dh_setting.config);
+	if (ret < 0)
+		return ret;
+
 	ret = wd_init_ctx_config(&wd_dh_setting.config, config);
 	if (ret)
 		return ret;
@@ -132,6 +136,8 @@ static int wd_dh_common_init(struct wd_ctx_config *config, struct wd_sched *sche
 	if (ret)
 		goto out_clear_ctx_config;
 
+	wd_init_sched_load(sched, &wd_dh_setting.config, &wd_dh_setting.pool);
+
 	/* initialize async request pool */
 	ret = wd_init_async_request_pool(&wd_dh_setting.pool,
 					 config, WD_POOL_MAX_ENTRIES,
@@ -373,7 +379,7 @@ int wd_do_dh_sync(handle_t sess, struct wd_dh_req *req)
 	if (ret)
 		return ret;
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ctx = config->ctxs + idx;
 
 	memset(&msg, 0, sizeof(struct wd_dh_msg));
@@ -384,19 +390,86 @@ int wd_do_dh_sync(handle_t sess, struct wd_dh_req *req)
 	msg_handle.send = wd_dh_setting.driver->send;
 	msg_handle.recv = wd_dh_setting.driver->recv;
 
+	wd_ctx_inflight_add(ctx, 1);
 	pthread_spin_lock(&ctx->lock);
-	ret = wd_handle_msg_sync(wd_dh_setting.driver, &msg_handle, ctx->ctx,
-				 &msg, &balance, wd_dh_setting.config.epoll_en);
+	ret = wd_handle_msg_sync(wd_dh_setting.driver, &msg_handle,
+				 &wd_dh_setting.config, ctx, &msg, 0, &balance);
 	pthread_spin_unlock(&ctx->lock);
+	wd_ctx_inflight_sub(ctx, 1);
 	if (unlikely(ret))
 		return ret;
 
+	wd_dfx_msg_done(config, idx, msg.req.pbytes, msg.req.pri_bytes);
+
 	req->pri_bytes = msg.req.pri_bytes;
 	req->status = msg.result;
 
 	return GET_NEGATIVE(msg.result);
 }
 
+int wd_do_dh_sync_batch(handle_t h_sess, struct wd_dh_req **reqs, __u32 num)
+{
+	struct wd_ctx_config_internal *config = &wd_dh_setting.config;
+	handle_t h_sched_ctx = wd_dh_setting.sched.h_sched_ctx;
+	struct wd_dh_sess *sess = (struct wd_dh_sess *)h_sess;
+	struct wd_dh_msg msgs[WD_MAX_BATCH_NUM];
+	void *msg_list[WD_MAX_BATCH_NUM];
+	struct wd_msg_handle msg_handle;
+	struct wd_ctx_internal *ctx;
+	__u32 idx, i;
+	int ret;
+
+	if (unlikely(!h_sess || !reqs || !num || num > WD_MAX_BATCH_NUM)) {
+		WD_ERR("invalid: input param NULL or batch num %u is error!\n", num);
+		return -WD_EINVAL;
+	}
+
+	memset(msgs, 0, sizeof(struct wd_dh_msg) * num);
+	for (i = 0; i < num; i++) {
+		if (unlikely(!reqs[i])) {
+			WD_ERR("invalid: input param NULL!\n");
+			return -WD_EINVAL;
+		}
+
+		ret = fill_dh_msg(&msgs[i], reqs[i], sess);
+		if (unlikely(ret))
+			return ret;
+		msgs[i].tag = i;
+		msg_list[i] = &msgs[i];
+	}
+
+	idx = wd_dh_setting.sched.pick_next_ctx(h_sched_ctx,
+						 sess->sched_key,
+						 CTX_MODE_SYNC);
+	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
+	if (ret)
+		return ret;
+
+	ctx = config->ctxs + idx;
+
+	msg_handle.send = wd_dh_setting.driver->send;
+	msg_handle.recv = wd_dh_setting.driver->recv;
+
+	wd_ctx_inflight_add(ctx, num);
+	pthread_spin_lock(&ctx->lock);
+	ret = wd_handle_msg_sync_batch(wd_dh_setting.driver, &msg_handle, config,
+				       ctx, msg_list, num, 0, &balance);
+	pthread_spin_unlock(&ctx->lock);
+	wd_ctx_inflight_sub(ctx, num);
+	if (unlikely(ret))
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		reqs[i]->pri_bytes = msgs[i].req.pri_bytes;
+		reqs[i]->status = msgs[i].result;
+		wd_dfx_msg_done(config, idx, msgs[i].req.pbytes, msgs[i].req.pri_bytes);
+		if (!ret)
+			ret = GET_NEGATIVE(msgs[i].result);
+	}
+
+	return ret;
+}
+
 int wd_do_dh_async(handle_t sess, struct wd_dh_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_dh_setting.config;
@@ -434,13 +507,14 @@ int wd_do_dh_async(handle_t sess, struct wd_dh_req *req)
 
 	ret = wd_alg_driver_send(wd_dh_setting.driver, ctx->ctx, msg);
 	if (unlikely(ret)) {
+		wd_dfx_msg_err(config, idx, ret);
 		if (ret != -WD_EBUSY)
 			WD_ERR("failed to send dh BD, hw is err!\n");
 
 		goto fail_with_msg;
 	}
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ret = wd_add_task_to_async_queue(&wd_dh_env_config, idx);
 	if (ret)
 		goto fail_with_msg;
@@ -453,6 +527,72 @@ fail_with_msg:
 	return ret;
 }
 
+int wd_do_dh_async_batch(handle_t sess, struct wd_dh_req **reqs,
+			  __u32 num, __u32 *count)
+{
+	struct wd_ctx_config_internal *config = &wd_dh_setting.config;
+	handle_t h_sched_ctx = wd_dh_setting.sched.h_sched_ctx;
+	struct wd_dh_sess *sess_t = (struct wd_dh_sess *)sess;
+	void *msg_list[WD_MAX_BATCH_NUM];
+	__u32 tags[WD_MAX_BATCH_NUM];
+	struct wd_dh_msg *msg = NULL;
+	int ret, mid;
+	__u32 idx, i;
+
+	if (unlikely(!sess || !reqs || !count || !num || num > WD_MAX_BATCH_NUM)) {
+		WD_ERR("invalid: input param NULL or batch num %u is error!\n", num);
+		return -WD_EINVAL;
+	}
+	*count = 0;
+
+	for (i = 0; i < num; i++) {
+		if (unlikely(!reqs[i] || !reqs[i]->cb)) {
+			WD_ERR("invalid: input param NULL!\n");
+			return -WD_EINVAL;
+		}
+	}
+
+	idx = wd_dh_setting.sched.pick_next_ctx(h_sched_ctx,
+						 sess_t->sched_key,
+						 CTX_MODE_ASYNC);
+	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		mid = wd_get_msg_from_pool(&wd_dh_setting.pool, idx, (void **)&msg);
+		if (unlikely(mid < 0)) {
+			if (!i) {
+				WD_ERR("failed to get msg from pool!\n");
+				return mid;
+			}
+			break;
+		}
+
+		ret = fill_dh_msg(msg, reqs[i], sess_t);
+		if (unlikely(ret)) {
+			wd_put_msg_to_pool(&wd_dh_setting.pool, idx, mid);
+			goto fail_with_msgs;
+		}
+		msg->tag = mid;
+		msg_list[i] = msg;
+		tags[i] = mid;
+	}
+
+	ret = wd_send_async_batch(wd_dh_setting.driver, config,
+				  &wd_dh_setting.pool, &wd_dh_env_config,
+				  idx, msg_list, tags, i, count);
+	if (unlikely(ret))
+		return ret;
+
+	return *count < num ? -WD_EBUSY : WD_SUCCESS;
+
+fail_with_msgs:
+	while (i--)
+		wd_put_msg_to_pool(&wd_dh_setting.pool, idx, tags[i]);
+	return ret;
+}
+
 struct wd_dh_msg *wd_dh_get_msg(__u32 idx, __u32 tag)
 {
 	return wd_find_msg_in_pool(&wd_dh_setting.pool, idx, tag);
@@ -503,6 +643,7 @@ int wd_dh_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 
 		msg->req.pri_bytes = rcv_msg.req.pri_bytes;
 		msg->req.status = rcv_msg.result;
+		wd_dfx_msg_done(config, idx, msg->req.pbytes, msg->req.pri_bytes);
 		req = &msg->req;
 		req->cb(req);
 		wd_put_msg_to_pool(&wd_dh_setting.pool, idx, rcv_msg.tag);
@@ -261,6 +261,15 @@ static int wd_digest_init_nolock(struct wd_ctx_config *config,
 	if (ret < 0)
 		return ret;
 
+	ret = wd_set_wait_policy("WD_DIGEST_WAIT_POLICY", &wd_digest_setting.config);
+	if (ret < 0)
+		return ret;
+
+	ret = wd_set_fallback_depth("WD_DIGEST_FALLBACK_DEPTH",
+				    &wd_digest_setting.config.fb_depth);
+	if (ret < 0)
+		return ret;
+
 	ret = wd_init_ctx_config(&wd_digest_setting.config, config);
 	if (ret < 0)
 		return ret;
@@ -269,6 +278,8 @@ static int wd_digest_init_nolock(struct wd_ctx_config *config,
 	if (ret < 0)
 		goto out_clear_ctx_config;
 
+	wd_init_sched_load(sched, &wd_digest_setting.config, &wd_digest_setting.pool);
+
 	/* allocate async pool for every ctx */
 	ret = wd_init_async_request_pool(&wd_digest_setting.pool,
 					 config, WD_POOL_MAX_ENTRIES,
@@ -617,10 +628,13 @@ static int send_recv_sync(struct wd_ctx_internal *ctx, struct wd_digest_sess *ds
 	msg_handle.send = wd_digest_setting.driver->send;
 	msg_handle.recv = wd_digest_setting.driver->recv;
 
+	wd_ctx_inflight_add(ctx, 1);
 	wd_ctx_spin_lock(ctx, wd_digest_setting.driver->calc_type);
-	ret = wd_handle_msg_sync(wd_digest_setting.driver, &msg_handle, ctx->ctx,
-				 msg, NULL, wd_digest_setting.config.epoll_en);
+	ret = wd_handle_msg_sync(wd_digest_setting.driver, &msg_handle,
+				 &wd_digest_setting.config, ctx, msg,
+				 msg->in_bytes, NULL);
 	wd_ctx_spin_unlock(ctx, wd_digest_setting.driver->calc_type);
+	wd_ctx_inflight_sub(ctx, 1);
 	if (unlikely(ret))
 		return ret;
 
@@ -644,6 +658,19 @@ static int send_recv_sync(struct wd_ctx_internal *ctx, struct wd_digest_sess *ds
 	return 0;
 }
 
+/*
+ * The state of a stream message is kept in the format of the hardware,
+ * so only the block message can be done by the fallback driver.
+ */
+static bool wd_digest_fallback_en(struct wd_digest_sess *dsess,
+				  struct wd_digest_req *req)
+{
+	return req->has_next == WD_DIGEST_END &&
+	       dsess->stream_data.msg_state == WD_DIGEST_END &&
+	       wd_alg_fallback_en(wd_digest_setting.driver,
+				  &wd_digest_setting.config);
+}
+
 int wd_do_digest_sync(handle_t h_sess, struct wd_digest_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_digest_setting.config;
@@ -668,14 +695,40 @@ int wd_do_digest_sync(handle_t h_sess, struct wd_digest_req *req)
 	if (unlikely(ret))
 		return ret;
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ctx = config->ctxs + idx;
 	ret = send_recv_sync(ctx, dsess, &msg);
+	if (likely(!ret))
+		wd_dfx_msg_done(config, idx, msg.in_bytes, msg.out_bytes);
+	else if (ret == -WD_EBUSY && wd_digest_fallback_en(dsess, req))
+		ret = wd_alg_do_fallback(wd_digest_setting.driver,
+					 &wd_digest_setting.config, &msg);
 	req->state = msg.result;
 
 	return ret;
 }
 
+/* The overflow request is done by the fallback driver and called back at once */
+static int wd_digest_async_fallback(struct wd_digest_sess *dsess,
+				    struct wd_digest_req *req)
+{
+	struct wd_digest_msg msg;
+	int ret;
+
+	memset(&msg, 0, sizeof(struct wd_digest_msg));
+	fill_request_msg(&msg, req, dsess);
+
+	ret = wd_alg_do_fallback(wd_digest_setting.driver,
+				 &wd_digest_setting.config, &msg);
+	if (unlikely(ret))
+		return ret;
+
+	msg.req.state = msg.result;
+	msg.req.cb(&msg.req);
+
+	return 0;
+}
+
 int wd_do_digest_async(handle_t h_sess, struct wd_digest_req *req)
 {
 	struct wd_ctx_config_internal *config = &wd_digest_setting.config;
@@ -703,9 +756,17 @@ int wd_do_digest_async(handle_t h_sess, struct wd_digest_req *req)
 
 	ctx = config->ctxs + idx;
 
+	if (wd_digest_fallback_en(dsess, req) &&
+	    wd_alg_fallback_check(wd_digest_setting.driver, config,
+				  &wd_digest_setting.pool, idx))
+		return wd_digest_async_fallback(dsess, req);
+
 	msg_id = wd_get_msg_from_pool(&wd_digest_setting.pool, idx,
 				   (void **)&msg);
 	if (unlikely(msg_id < 0)) {
+		if (msg_id == -WD_EBUSY && wd_digest_fallback_en(dsess, req))
+			return wd_digest_async_fallback(dsess, req);
+
 		WD_ERR("failed to get msg from pool!\n");
 		return msg_id;
 	}
@@ -715,13 +776,19 @@ int wd_do_digest_async(handle_t h_sess, struct wd_digest_req *req)
 
 	ret = wd_alg_driver_send(wd_digest_setting.driver, ctx->ctx, msg);
 	if (unlikely(ret < 0)) {
+		wd_dfx_msg_err(config, idx, ret);
+		if (ret == -WD_EBUSY && wd_digest_fallback_en(dsess, req)) {
+			wd_put_msg_to_pool(&wd_digest_setting.pool, idx, msg->tag);
+			return wd_digest_async_fallback(dsess, req);
+		}
+
 		if (ret != -WD_EBUSY)
 			WD_ERR("failed to send BD, hw is err!\n");
 
 		goto fail_with_msg;
 	}
 
-	wd_dfx_msg_cnt(config, WD_CTX_CNT_NUM, idx);
+	wd_dfx_msg_cnt(config, idx);
 	ret = wd_add_task_to_async_queue(&wd_digest_env_config, idx);
 	if (ret)
 		goto fail_with_msg;
@@ -733,6 +800,148 @@ fail_with_msg:
 	return ret;
 }
 
+static int wd_digest_check_batch(struct wd_digest_sess *dsess,
+				 struct wd_digest_req **reqs,
+				 __u32 num, __u8 mode)
+{
+	__u32 i;
+	int ret;
+
+	if (unlikely(!reqs || !num || num > WD_MAX_BATCH_NUM)) {
+		WD_ERR("invalid: digest batch reqs is NULL or num %u is error!\n", num);
+		return -WD_EINVAL;
+	}
+
+	for (i = 0; i < num; i++) {
+		ret = wd_digest_param_check(dsess, reqs[i]);
+		if (unlikely(ret))
+			return -WD_EINVAL;
+
+		if (unlikely(mode == CTX_MODE_ASYNC && !reqs[i]->cb)) {
+			WD_ERR("invalid: digest input req cb is NULL!\n");
+			return -WD_EINVAL;
+		}
+
+		/* Stream messages depend on each other, they can't be in one batch */
+		if (unlikely(reqs[i]->has_next != WD_DIGEST_END)) {
+			WD_ERR("invalid: digest batch only supports block message!\n");
+			return -WD_EINVAL;
+		}
+	}
+
+	if (unlikely(dsess->stream_data.msg_state != WD_DIGEST_END)) {
+		WD_ERR("invalid: digest session is doing stream message!\n");
+		return -WD_EINVAL;
+	}
+
+	return 0;
+}
+
+int wd_do_digest_sync_batch(handle_t h_sess, struct wd_digest_req **reqs, __u32 num)
+{
+	struct wd_ctx_config_internal *config = &wd_digest_setting.config;
+	struct wd_digest_sess *dsess = (struct wd_digest_sess *)h_sess;
+	struct wd_digest_msg msgs[WD_MAX_BATCH_NUM];
+	void *msg_list[WD_MAX_BATCH_NUM];
+	struct wd_msg_handle msg_handle;
+	struct wd_ctx_internal *ctx;
+	__u32 idx, i;
+	int ret;
+
+	ret = wd_digest_check_batch(dsess, reqs, num, CTX_MODE_SYNC);
+	if (unlikely(ret))
+		return ret;
+
+	memset(msgs, 0, sizeof(struct wd_digest_msg) * num);
+	for (i = 0; i < num; i++) {
+		fill_request_msg(&msgs[i], reqs[i], dsess);
+		reqs[i]->state = 0;
+		msgs[i].tag = i;
+		msg_list[i] = &msgs[i];
+	}
+
+	idx = wd_digest_setting.sched.pick_next_ctx(
+		wd_digest_setting.sched.h_sched_ctx,
+		dsess->sched_key, CTX_MODE_SYNC);
+	ret = wd_check_ctx(config, CTX_MODE_SYNC, idx);
+	if (unlikely(ret))
+		return ret;
+
+	ctx = config->ctxs + idx;
+
+	msg_handle.send = wd_digest_setting.driver->send;
+	msg_handle.recv = wd_digest_setting.driver->recv;
+
+	wd_ctx_inflight_add(ctx, num);
+	wd_ctx_spin_lock(ctx, wd_digest_setting.driver->calc_type);
+	ret = wd_handle_msg_sync_batch(wd_digest_setting.driver, &msg_handle, config,
+				       ctx, msg_list, num, msgs[0].in_bytes, NULL);
+	wd_ctx_spin_unlock(ctx, wd_digest_setting.driver->calc_type);
+	wd_ctx_inflight_sub(ctx, num);
+
+	for (i = 0; i < num; i++) {
+		reqs[i]->state = msgs[i].result;
+		if (likely(!ret))
+			wd_dfx_msg_done(config, idx, msgs[i].in_bytes, msgs[i].out_bytes);
+	}
+
+	return ret;
+}
+
+int wd_do_digest_async_batch(handle_t h_sess, struct wd_digest_req **reqs,
+			     __u32 num, __u32 *count)
+{
+	struct wd_ctx_config_internal *config = &wd_digest_setting.config;
+	struct wd_digest_sess *dsess = (struct wd_digest_sess *)h_sess;
+	void *msg_list[WD_MAX_BATCH_NUM];
+	__u32 tags[WD_MAX_BATCH_NUM];
+	struct wd_digest_msg *msg;
+	int msg_id, ret;
+	__u32 idx, i;
+
+	if (unlikely(!count)) {
+		WD_ERR("invalid: digest batch count is NULL!\n");
+		return -WD_EINVAL;
+	}
+	*count = 0;
+
+	ret = wd_digest_check_batch(dsess, reqs, num, CTX_MODE_ASYNC);
+	if (unlikely(ret))
+		return ret;
+
+	idx = wd_digest_setting.sched.pick_next_ctx(
+		wd_digest_setting.sched.h_sched_ctx,
+		dsess->sched_key, CTX_MODE_ASYNC);
+	ret = wd_check_ctx(config, CTX_MODE_ASYNC, idx);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		msg_id = wd_get_msg_from_pool(&wd_digest_setting.pool, idx,
+					      (void **)&msg);
+		if (unlikely(msg_id < 0)) {
+			if (!i) {
+				WD_ERR("failed to get msg from pool!\n");
+				return msg_id;
+			}
+			break;
+		}
+
+		fill_request_msg(msg, reqs[i], dsess);
+		msg->tag = msg_id;
+		msg_list[i] = msg;
+		tags[i] = msg_id;
+	}
+
+	ret = wd_send_async_batch(wd_digest_setting.driver, config,
+				  &wd_digest_setting.pool, &wd_digest_env_config,
+				  idx, msg_list, tags, i, count);
+	if (unlikely(ret))
+		return ret;
+
+	return *count < num ? -WD_EBUSY : 0;
+}
+
 struct wd_digest_msg *wd_digest_get_msg(__u32 idx, __u32 tag)
 {
 	return wd_find_msg_in_pool(&wd_digest_setting.pool, idx, tag);
@@ -779,6 +988,7 @@ int wd_digest_poll_ctx(__u32 idx, __u32 expt, __u32 *count)
 			return -WD_EINVAL;
 		}
 
+		wd_dfx_msg_done(config, idx, msg->in_bytes, msg->out_bytes);
 		msg->req.state = recv_msg.result;
 		req = &msg->req;
 		if (likely(req))
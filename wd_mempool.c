@@ -35,6 +35,9 @@
 #define WD_MEMPOOL_SIZE_MASK		(WD_MEMPOOL_BLOCK_SIZE - 1)
 #define WD_HUNDRED			100
 #define PAGE_SIZE_OFFSET		10
+#define WD_BLK_MAG_SIZE			64
+#define WD_BLK_MAG_RATIO		16
+#define WD_BLK_MAG_MIN			2
 
 struct wd_ref {
 	__u32 ref;
@@ -93,6 +96,28 @@ struct memzone {
 };
 TAILQ_HEAD(memzone_list, memzone);
 
+/*
+ * Per-thread cache of free blocks, so that most of the allocs and frees
+ * don't touch the shared stack of blkpool.
+ * @lock: Lock of the magazine, only contended when the blkpool steals
+ *	  blocks, drains the magazine or dumps the stats
+ * @bp: The blkpool which the magazine belongs to
+ * @num: Number of blocks in the magazine
+ * @hit: Number of allocs which are done by the magazine
+ * @miss: Number of allocs which go to the shared stack
+ * @blks: The cached blocks
+ */
+struct blk_magazine {
+	pthread_spinlock_t lock;
+	struct blkpool *bp;
+	__u32 num;
+	unsigned long hit;
+	unsigned long miss;
+	TAILQ_ENTRY(blk_magazine) node;
+	void *blks[WD_BLK_MAG_SIZE];
+};
+TAILQ_HEAD(blk_magazine_list, blk_magazine);
+
 /*
  * @blk_elem: All the block unit addrs saved in blk_elem
  * @depth: The block pool deph, stack depth
@@ -100,9 +125,15 @@ TAILQ_HEAD(memzone_list, memzone);
  * @blk_size: The size of one block
  * @mp: Record from which mempool
  * @mz_list: List of memzone allocated from mempool
- * @free_block_num: Number of free blocks currently
+ * @free_block_num: Number of free blocks currently in the stack
  * @lock: lock of blkpool
- * @ref: ref of blkpool
+ * @ref: ref of blkpool, 1 + number of blocks out of the stack
+ * @mag_key: Thread key of the magazines
+ * @mag_size: Blocks one magazine can cache, 0 means no magazine
+ * @mag_off: The blkpool is being destroyed, magazines are not used
+ * @mag_list: Magazines of all threads, protected by lock
+ * @mag_hit: Magazine hits of the exited threads
+ * @mag_miss: Magazine misses of the exited threads
  */
 struct blkpool {
 	void **blk_elem;
@@ -114,6 +145,12 @@ struct blkpool {
 	unsigned long free_block_num;
 	pthread_spinlock_t lock;
 	struct wd_ref ref;
+	pthread_key_t mag_key;
+	__u32 mag_size;
+	bool mag_off;
+	struct blk_magazine_list mag_list;
+	unsigned long mag_hit;
+	unsigned long mag_miss;
 };
 
 struct sys_hugepage_config {
@@ -283,54 +320,206 @@ static int test_bit(struct bitmap *bm, unsigned int nr)
 	return !(*p & mask);
 }
 
-void *wd_block_alloc(handle_t blkpool)
+/* Put blocks back to the stack, return the number of blocks put */
+static __u32 blkpool_put_blks_nolock(struct blkpool *bp, void **blks, __u32 num)
 {
-	struct blkpool *bp = (struct blkpool*)blkpool;
-	void *p;
+	__u32 i;
 
-	if (!bp) {
-		WD_ERR("invalid: block pool is NULL!\n");
-		return NULL;
+	for (i = 0; i < num && bp->top < bp->depth; i++) {
+		bp->blk_elem[bp->top] = blks[i];
+		bp->top++;
+		bp->free_block_num++;
 	}
 
-	if (!wd_atomic_test_add(&bp->ref, 1, 0)) {
+	return i;
+}
+
+static void blkpool_put_blks(struct blkpool *bp, void **blks, __u32 num)
+{
+	__u32 cnt;
+
+	pthread_spin_lock(&bp->lock);
+	cnt = blkpool_put_blks_nolock(bp, blks, num);
+	pthread_spin_unlock(&bp->lock);
+
+	if (cnt)
+		wd_atomic_sub(&bp->ref, cnt);
+}
+
+/* Take the cached blocks of other threads when the stack is empty */
+static __u32 blkpool_steal_blks_nolock(struct blkpool *bp, void **blks, __u32 num)
+{
+	struct blk_magazine *mag;
+	__u32 cnt = 0;
+
+	TAILQ_FOREACH(mag, &bp->mag_list, node) {
+		pthread_spin_lock(&mag->lock);
+		while (mag->num && cnt < num)
+			blks[cnt++] = mag->blks[--mag->num];
+		pthread_spin_unlock(&mag->lock);
+		if (cnt == num)
+			break;
+	}
+
+	return cnt;
+}
+
+/* Get at most num blocks from the stack or other magazines */
+static __u32 blkpool_get_blks(struct blkpool *bp, void **blks, __u32 num)
+{
+	__u32 cnt, stolen = 0;
+
+	/* The blocks out of the stack are counted in ref before they are got */
+	if (!wd_atomic_test_add(&bp->ref, num, 0)) {
 		WD_ERR("failed to alloc block, block pool is busy now!\n");
-		return NULL;
+		return 0;
 	}
 
 	pthread_spin_lock(&bp->lock);
-	if (bp->top > 0) {
+	for (cnt = 0; cnt < num && bp->top > 0; cnt++) {
 		bp->top--;
 		bp->free_block_num--;
-		p = bp->blk_elem[bp->top];
-		pthread_spin_unlock(&bp->lock);
-		return p;
+		blks[cnt] = bp->blk_elem[bp->top];
 	}
 
+	if (!cnt)
+		stolen = blkpool_steal_blks_nolock(bp, blks, num);
 	pthread_spin_unlock(&bp->lock);
-	wd_atomic_sub(&bp->ref, 1);
 
+	/* The stolen blocks have been out of the stack */
+	if (cnt < num)
+		wd_atomic_sub(&bp->ref, num - cnt);
+
+	return cnt + stolen;
+}
+
+static void blkpool_mag_release(void *data)
+{
+	struct blk_magazine *mag = data;
+	struct blkpool *bp = mag->bp;
+	__u32 cnt;
+
+	pthread_spin_lock(&bp->lock);
+	TAILQ_REMOVE(&bp->mag_list, mag, node);
+	bp->mag_hit += mag->hit;
+	bp->mag_miss += mag->miss;
+	cnt = blkpool_put_blks_nolock(bp, mag->blks, mag->num);
+	pthread_spin_unlock(&bp->lock);
+
+	if (cnt)
+		wd_atomic_sub(&bp->ref, cnt);
+	pthread_spin_destroy(&mag->lock);
+	free(mag);
+}
+
+static struct blk_magazine *blkpool_get_mag(struct blkpool *bp)
+{
+	struct blk_magazine *mag;
+
+	if (!bp->mag_size || __atomic_load_n(&bp->mag_off, __ATOMIC_RELAXED))
+		return NULL;
+
+	mag = pthread_getspecific(bp->mag_key);
+	if (likely(mag))
+		return mag;
+
+	/* Work without the magazine if it can't be created */
+	mag = calloc(1, sizeof(struct blk_magazine));
+	if (!mag)
+		return NULL;
+
+	if (pthread_spin_init(&mag->lock, PTHREAD_PROCESS_PRIVATE))
+		goto free_mag;
+
+	mag->bp = bp;
+	if (pthread_setspecific(bp->mag_key, mag))
+		goto destroy_lock;
+
+	pthread_spin_lock(&bp->lock);
+	TAILQ_INSERT_TAIL(&bp->mag_list, mag, node);
+	pthread_spin_unlock(&bp->lock);
+
+	return mag;
+
+destroy_lock:
+	pthread_spin_destroy(&mag->lock);
+free_mag:
+	free(mag);
 	return NULL;
 }
 
+/*
+ * The owner thread never holds the lock of its magazine while it takes the
+ * lock of blkpool, so the lock order is always blkpool and then magazine.
+ */
+void *wd_block_alloc(handle_t blkpool)
+{
+	struct blkpool *bp = (struct blkpool*)blkpool;
+	void *blks[WD_BLK_MAG_SIZE];
+	struct blk_magazine *mag;
+	__u32 cnt, i;
+	void *p;
+
+	if (!bp) {
+		WD_ERR("invalid: block pool is NULL!\n");
+		return NULL;
+	}
+
+	mag = blkpool_get_mag(bp);
+	if (!mag)
+		return blkpool_get_blks(bp, &p, 1) ? p : NULL;
+
+	pthread_spin_lock(&mag->lock);
+	if (mag->num) {
+		p = mag->blks[--mag->num];
+		mag->hit++;
+		pthread_spin_unlock(&mag->lock);
+		return p;
+	}
+	mag->miss++;
+	pthread_spin_unlock(&mag->lock);
+
+	/* Refill half of the magazine, so that frees don't flush it at once */
+	cnt = blkpool_get_blks(bp, blks, bp->mag_size >> 1);
+	if (!cnt)
+		return NULL;
+
+	pthread_spin_lock(&mag->lock);
+	for (i = 1; i < cnt; i++)
+		mag->blks[mag->num++] = blks[i];
+	pthread_spin_unlock(&mag->lock);
+
+	return blks[0];
+}
+
 void wd_block_free(handle_t blkpool, void *addr)
 {
 	struct blkpool *bp = (struct blkpool*)blkpool;
+	void *blks[WD_BLK_MAG_SIZE];
+	struct blk_magazine *mag;
+	__u32 cnt = 0;
 
 	if (!bp || !addr)
 		return;
 
-	pthread_spin_lock(&bp->lock);
-	if (bp->top < bp->depth) {
-		bp->blk_elem[bp->top] = addr;
-		bp->top++;
-		bp->free_block_num++;
-		pthread_spin_unlock(&bp->lock);
-		wd_atomic_sub(&bp->ref, 1);
+	mag = blkpool_get_mag(bp);
+	if (!mag) {
+		blkpool_put_blks(bp, &addr, 1);
 		return;
 	}
 
-	pthread_spin_unlock(&bp->lock);
+	pthread_spin_lock(&mag->lock);
+	/* Flush half of the full magazine to the stack */
+	if (mag->num == bp->mag_size) {
+		cnt = bp->mag_size >> 1;
+		mag->num -= cnt;
+		memcpy(blks, &mag->blks[mag->num], cnt * sizeof(void *));
+	}
+	mag->blks[mag->num++] = addr;
+	pthread_spin_unlock(&mag->lock);
+
+	if (cnt)
+		blkpool_put_blks(bp, blks, cnt);
 }
 
 static int alloc_memzone(struct blkpool *bp, void *addr, size_t blk_num,
@@ -564,6 +753,13 @@ handle_t wd_blockpool_create(handle_t mempool, size_t block_size,
 	if (ret < 0)
 		goto err_free_bp;
 
+	/* Small blkpools are not worth caching, blocks may hide in magazines */
+	TAILQ_INIT(&bp->mag_list);
+	bp->mag_size = MIN(WD_BLK_MAG_SIZE, block_num / WD_BLK_MAG_RATIO);
+	if (bp->mag_size < WD_BLK_MAG_MIN ||
+	    pthread_key_create(&bp->mag_key, blkpool_mag_release))
+		bp->mag_size = 0;
+
 	ret = alloc_mem_from_mempool(mp, bp);
 	if (ret < 0)
 		goto err_uninit_lock;
@@ -578,6 +774,8 @@ handle_t wd_blockpool_create(handle_t mempool, size_t block_size,
 err_free_mem:
 	free_mem_to_mempool(bp);
 err_uninit_lock:
+	if (bp->mag_size)
+		pthread_key_delete(bp->mag_key);
 	pthread_spin_destroy(&bp->lock);
 err_free_bp:
 	free(bp);
@@ -586,6 +784,36 @@ err_sub_ref:
 	return (handle_t)(-WD_ENOMEM);
 }
 
+static void blkpool_drain_mags(struct blkpool *bp)
+{
+	struct blk_magazine *mag;
+	__u32 cnt = 0;
+
+	pthread_spin_lock(&bp->lock);
+	TAILQ_FOREACH(mag, &bp->mag_list, node) {
+		pthread_spin_lock(&mag->lock);
+		cnt += blkpool_put_blks_nolock(bp, mag->blks, mag->num);
+		mag->num = 0;
+		pthread_spin_unlock(&mag->lock);
+	}
+	pthread_spin_unlock(&bp->lock);
+
+	if (cnt)
+		wd_atomic_sub(&bp->ref, cnt);
+}
+
+/* The magazines of living threads are freed here as the key is deleted */
+static void blkpool_free_mags(struct blkpool *bp)
+{
+	struct blk_magazine *mag;
+
+	while ((mag = TAILQ_FIRST(&bp->mag_list))) {
+		TAILQ_REMOVE(&bp->mag_list, mag, node);
+		pthread_spin_destroy(&mag->lock);
+		free(mag);
+	}
+}
+
 void wd_blockpool_destroy(handle_t blkpool)
 {
 	struct blkpool *bp = (struct blkpool *)blkpool;
@@ -598,8 +826,17 @@ void wd_blockpool_destroy(handle_t blkpool)
 
 	mp = bp->mp;
 	wd_atomic_sub(&bp->ref, 1);
-	while (wd_atomic_load(&bp->ref))
+	__atomic_store_n(&bp->mag_off, true, __ATOMIC_RELAXED);
+	while (wd_atomic_load(&bp->ref)) {
+		/* A free may still go to a magazine before it sees mag_off */
+		blkpool_drain_mags(bp);
 		sched_yield();
+	}
+
+	if (bp->mag_size) {
+		pthread_key_delete(bp->mag_key);
+		blkpool_free_mags(bp);
+	}
 
 	free_mem_to_mempool(bp);
 	pthread_spin_destroy(&bp->lock);
@@ -981,6 +1218,7 @@ void wd_mempool_stats(handle_t mempool, struct wd_mempool_stats *stats)
 void wd_blockpool_stats(handle_t blkpool, struct wd_blockpool_stats *stats)
 {
 	struct blkpool *bp = (struct blkpool*)blkpool;
+	struct blk_magazine *mag;
 	unsigned long size = 0;
 	struct memzone *iter;
 
@@ -994,7 +1232,12 @@ void wd_blockpool_stats(handle_t blkpool, struct wd_blockpool_stats *stats)
 	stats->block_size = bp->blk_size;
 	stats->block_num = bp->depth;
 	stats->free_block_num = bp->free_block_num;
-	stats->block_usage_rate = (bp->depth - bp->free_block_num) /
+	TAILQ_FOREACH(mag, &bp->mag_list, node) {
+		pthread_spin_lock(&mag->lock);
+		stats->free_block_num += mag->num;
+		pthread_spin_unlock(&mag->lock);
+	}
+	stats->block_usage_rate = (bp->depth - stats->free_block_num) /
 				  bp->depth * WD_HUNDRED;
 
 	TAILQ_FOREACH(iter, &bp->mz_list, node)
@@ -1011,3 +1254,27 @@ void wd_blockpool_stats(handle_t blkpool, struct wd_blockpool_stats *stats)
 
 	pthread_spin_unlock(&bp->lock);
 }
+
+void wd_blockpool_mag_stats(handle_t blkpool, struct wd_blockpool_mag_stats *stats)
+{
+	struct blkpool *bp = (struct blkpool*)blkpool;
+	struct blk_magazine *mag;
+
+	if (!bp || !stats) {
+		WD_ERR("invalid: blkpool or stats is NULL!\n");
+		return;
+	}
+
+	pthread_spin_lock(&bp->lock);
+
+	stats->mag_hit_num = bp->mag_hit;
+	stats->mag_miss_num = bp->mag_miss;
+	TAILQ_FOREACH(mag, &bp->mag_list, node) {
+		pthread_spin_lock(&mag->lock);
+		stats->mag_hit_num += mag->hit;
+		stats->mag_miss_num += mag->miss;
+		pthread_spin_unlock(&mag->lock);
+	}
+
+	pthread_spin_unlock(&bp->lock);
+}
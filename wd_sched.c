@@ -39,16 +39,14 @@ struct sched_key {
  * struct sched_ctx_range - define one ctx pos.
  * @begin: the start pos in ctxs of config.
  * @end: the end pos in ctxx of config.
- * @last: the last one which be distributed.
+ * @last: the RR cursor, counts the ctxs which have been distributed.
  * @valid: the region used flag.
- * @lock: lock the currentscheduling region.
  */
 struct sched_ctx_region {
 	__u32 begin;
 	__u32 end;
 	__u32 last;
 	bool valid;
-	pthread_mutex_t lock;
 };
 
 /*
@@ -71,6 +69,10 @@ struct wd_sched_info {
  * @type_num: the max operation types of the scheduler.
  * @poll_func: the task's poll operation function.
  * @numa_map: a map of cpus to devices.
+ * @load_func: get the in-flight requests of a ctx, used by the load policy.
+ * @load_priv: the private data of load_func.
+ * @poll_priv_func: the poll function with private data, used if it is set.
+ * @poll_priv: the private data of poll_priv_func.
  * @sched_info: the context of the scheduler.
  */
 struct wd_sched_ctx {
@@ -79,6 +81,10 @@ struct wd_sched_ctx {
 	__u16  numa_num;
 	user_poll_func poll_func;
 	int numa_map[NUMA_NUM_NODES];
+	wd_sched_load_func load_func;
+	void *load_priv;
+	wd_sched_poll_func poll_priv_func;
+	void *poll_priv;
 	struct wd_sched_info sched_info[0];
 };
 
@@ -120,23 +126,18 @@ static struct sched_ctx_region *sched_get_ctx_range(struct wd_sched_ctx *sched_c
 /*
  * sched_get_next_pos_rr - Get next resource pos by RR schedule.
  * The second para is reserved for future.
+ *
+ * The cursor is moved by one atomic add, so picking takes no lock and
+ * every caller gets a different ctx until the region wraps.
  */
 static __u32 sched_get_next_pos_rr(struct sched_ctx_region *region, void *para)
 {
-	__u32 pos;
-
-	pthread_mutex_lock(&region->lock);
+	__u32 num = region->end - region->begin + 1;
+	__u32 ticket;
 
-	pos = region->last;
-
-	if (pos < region->end)
-		region->last++;
-	else
-		region->last = region->begin;
+	ticket = __atomic_fetch_add(&region->last, 1, __ATOMIC_RELAXED);
 
-	pthread_mutex_unlock(&region->lock);
-
-	return pos;
+	return region->begin + ticket % num;
 }
 
 /*
@@ -244,6 +245,67 @@ static __u32 session_sched_pick_next_ctx(handle_t h_sched_ctx, void *sched_key,
 	return key->async_ctxid;
 }
 
+/*
+ * sched_load_pick_next_ctx - Get the ctx with the fewest in-flight requests
+ * in the region of the session.
+ * @sched_ctx: Schedule ctx, reference the struct sample_sched_ctx.
+ * @sched_key: The key of schedule region.
+ * @sched_mode: The sched async/sync mode.
+ *
+ * The scan starts from the ctx bound by session_sched_init, so the session
+ * keeps its ctx until another one is less loaded.
+ */
+static __u32 sched_load_pick_next_ctx(handle_t h_sched_ctx, void *sched_key,
+				      const int sched_mode)
+{
+	struct wd_sched_ctx *sched_ctx = (struct wd_sched_ctx *)h_sched_ctx;
+	struct sched_key *key = (struct sched_key *)sched_key;
+	struct sched_ctx_region *region;
+	__u32 pos, best, load, min_load;
+	struct sched_key tmp;
+	__u32 i, num;
+
+	if (unlikely(!sched_ctx || !key)) {
+		WD_ERR("invalid: sched ctx or key is NULL!\n");
+		return INVALID_POS;
+	}
+
+	best = sched_mode == CTX_MODE_SYNC ? key->sync_ctxid : key->async_ctxid;
+	if (!sched_ctx->load_func || best == INVALID_POS)
+		return best;
+
+	/* The key may be shared by the threads of one session */
+	tmp = *key;
+	tmp.mode = sched_mode;
+	region = sched_get_ctx_range(sched_ctx, &tmp);
+	if (unlikely(!region))
+		return best;
+
+	min_load = sched_ctx->load_func(sched_ctx->load_priv, best);
+	num = region->end - region->begin + 1;
+	pos = best;
+	for (i = 1; i < num && min_load; i++) {
+		pos = pos < region->end ? pos + 1 : region->begin;
+		load = sched_ctx->load_func(sched_ctx->load_priv, pos);
+		if (load < min_load) {
+			min_load = load;
+			best = pos;
+		}
+	}
+
+	return best;
+}
+
+static int sched_poll_ctx(struct wd_sched_ctx *sched_ctx, __u32 pos,
+			  __u32 expect, __u32 *count)
+{
+	if (sched_ctx->poll_priv_func)
+		return sched_ctx->poll_priv_func(sched_ctx->poll_priv, pos,
+						 expect, count);
+
+	return sched_ctx->poll_func(pos, expect, count);
+}
+
 static int session_poll_region(struct wd_sched_ctx *sched_ctx, __u32 begin,
 			       __u32 end, __u32 expect, __u32 *count)
 {
@@ -257,7 +319,7 @@ static int session_poll_region(struct wd_sched_ctx *sched_ctx, __u32 begin,
 		 * RR schedule, one time poll one package,
 		 * poll_num is always not more than one here.
 		 */
-		ret = sched_ctx->poll_func(i, 1, &poll_num);
+		ret = sched_poll_ctx(sched_ctx, i, 1, &poll_num);
 		if ((ret < 0) && (ret != -EAGAIN))
 			return ret;
 		else if (ret == -EAGAIN)
@@ -383,7 +445,7 @@ static int sched_none_poll_policy(handle_t h_sched_ctx,
 	while (loop_times > 0) {
 		/* Default use ctx 0 */
 		loop_times--;
-		ret = sched_ctx->poll_func(0, 1, &poll_num);
+		ret = sched_poll_ctx(sched_ctx, 0, 1, &poll_num);
 		if ((ret < 0) && (ret != -EAGAIN))
 			return ret;
 		else if (ret == -EAGAIN)
@@ -430,7 +492,7 @@ static int sched_single_poll_policy(handle_t h_sched_ctx,
 	while (loop_times > 0) {
 		/* Default async mode use ctx 1 */
 		loop_times--;
-		ret = sched_ctx->poll_func(1, 1, &poll_num);
+		ret = sched_poll_ctx(sched_ctx, 1, 1, &poll_num);
 		if ((ret < 0) && (ret != -EAGAIN))
 			return ret;
 		else if (ret == -EAGAIN)
@@ -463,6 +525,12 @@ static struct wd_sched sched_table[SCHED_POLICY_BUTT] = {
 		.sched_init = sched_single_init,
 		.pick_next_ctx = sched_single_pick_next_ctx,
 		.poll_policy = sched_single_poll_policy,
+	}, {
+		.name = "Load scheduler",
+		.sched_policy = SCHED_POLICY_LOAD,
+		.sched_init = session_sched_init,
+		.pick_next_ctx = sched_load_pick_next_ctx,
+		.poll_policy = session_sched_poll_policy,
 	}
 };
 
@@ -549,18 +617,47 @@ int wd_sched_rr_instance(const struct wd_sched *sched, struct sched_params *para
 
 	sched_info[numa_id].ctx_region[mode][type].begin = param->begin;
 	sched_info[numa_id].ctx_region[mode][type].end = param->end;
-	sched_info[numa_id].ctx_region[mode][type].last = param->begin;
+	sched_info[numa_id].ctx_region[mode][type].last = 0;
 	sched_info[numa_id].ctx_region[mode][type].valid = true;
 	sched_info[numa_id].valid = true;
 
 	wd_sched_map_cpus_to_dev(sched_ctx);
 
-	pthread_mutex_init(&sched_info[numa_id].ctx_region[mode][type].lock,
-			   NULL);
-
 	return 0;
 }
 
+void wd_sched_set_load(struct wd_sched *sched, wd_sched_load_func func,
+		       void *priv)
+{
+	struct wd_sched_ctx *sched_ctx;
+
+	if (!sched || sched->sched_policy != SCHED_POLICY_LOAD)
+		return;
+
+	sched_ctx = (struct wd_sched_ctx *)sched->h_sched_ctx;
+	if (!sched_ctx)
+		return;
+
+	sched_ctx->load_priv = priv;
+	sched_ctx->load_func = func;
+}
+
+void wd_sched_set_poll(struct wd_sched *sched, wd_sched_poll_func func,
+		       void *priv)
+{
+	struct wd_sched_ctx *sched_ctx;
+
+	if (!sched)
+		return;
+
+	sched_ctx = (struct wd_sched_ctx *)sched->h_sched_ctx;
+	if (!sched_ctx)
+		return;
+
+	sched_ctx->poll_priv = priv;
+	sched_ctx->poll_priv_func = func;
+}
+
 void wd_sched_rr_release(struct wd_sched *sched)
 {
 	struct wd_sched_info *sched_info;
@@ -0,0 +1,520 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/*
+ * Copyright 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ */
+
+/*
+ * Userspace emulation of a HiSilicon QM queue. It stands in for the uacce
+ * char device of a device directory which has the "emulate" attribute, so
+ * the hisi drivers run their real sq/cq protocol without hardware. The dus
+ * region holds the sq, the cq and the queue statuses as on the device, the
+ * doorbells are delivered by wd_ctx_emu_db(), and a worker thread per queue
+ * completes the sqes with the selected engine.
+ */
+
+#define _GNU_SOURCE
+#include <asm/byteorder.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "wd.h"
+#include "wd_uacce_emu.h"
+
+#define SYS_CLASS_DIR		"/sys/class/uacce"
+#define EMU_Q_DEPTH		1024
+#define EMU_QP_NUM		1024
+#define EMU_DBELL_CMD_SQ	0
+#define EMU_DBELL_CMD_CQ	1
+/* The sq and cq statuses at the end of dus */
+#define EMU_DS_SIZE		(2 * sizeof(__u32))
+#define NSEC_PER_SEC		1000000000ULL
+#define NSEC_PER_MSEC		1000000ULL
+#define EMU_HADDR_SHIFT		32
+
+/* The sqe fields completed by the engines, see the hisi drivers */
+#define EMU_ZIP_DECOMP		1
+#define EMU_ZIP_STATUS_MASK	0xff
+#define EMU_ZIP_LSTBLK		0x100
+#define EMU_ZIP_BUF_TYPE_MASK	0xf00
+#define EMU_ZIP_CTX_ST_MASK	0xf
+#define EMU_ZIP_BAD_REQ		0x1
+#define EMU_ZIP_DECOMP_END	0x13
+#define EMU_SEC_DONE_OFFSET	112
+#define EMU_SEC_DONE		0x1
+#define EMU_SEC_DONE_ICV_MASK	0xf
+#define EMU_HPRE_DONE		0xc0000000
+#define EMU_HPRE_ETYPE_MASK	0x3fffffe0
+#define EMU_DAE_DONE_OFFSET	28
+#define EMU_DAE_DONE		0x1
+#define EMU_DAE_OUTPUT_END	0x8
+
+/* The same layouts as include/uapi/misc/uacce/hisi_qm.h */
+struct emu_qp_ctx {
+	__u16 id;
+	__u16 qc_type;
+};
+
+struct emu_qp_info {
+	__u32 sqe_size;
+	__u16 sq_depth;
+	__u16 cq_depth;
+	__u64 reserved;
+};
+
+#define EMU_CMD_QM_SET_QP_CTX	_IOWR('H', 10, struct emu_qp_ctx)
+#define EMU_CMD_QM_SET_QP_INFO	_IOWR('H', 11, struct emu_qp_info)
+
+struct emu_cqe {
+	__u32 rsvd0;
+	__u16 cmd_id;
+	__u16 rsvd1;
+	__u16 sq_head;
+	__u16 sq_num;
+	__u16 rsvd2;
+	__u16 w7;
+};
+
+struct emu_zip_sqe {
+	__u32 consumed;
+	__u32 produced;
+	__u32 comp_data_length;
+	/* status: 0~7 bits, lstblk: 8 bit */
+	__u32 dw3;
+	__u32 input_data_length;
+	__u32 dw5_8[4];
+	/* buffer_type: 8~11 bits */
+	__u32 dw9;
+	__u32 dw10_13[4];
+	__u32 dest_avail_out;
+	/* ctx_st: 0~3 bits */
+	__u32 ctx_dw0;
+	__u32 dw16_17[2];
+	__u32 source_addr_l;
+	__u32 source_addr_h;
+	__u32 dest_addr_l;
+	__u32 dest_addr_h;
+	__u32 dw22_29[8];
+	__u32 isize;
+	__u32 checksum;
+};
+
+struct wd_emu_engine {
+	const char *name;
+	/* Complete the sqe in place, it is copied back as the response */
+	void (*process)(struct wd_emu_qp *qp, void *sqe);
+};
+
+struct wd_emu_qp {
+	const struct wd_emu_engine *engine;
+	__u64 delay_ns;
+	__u32 sqe_size;
+	__u16 depth;
+	__u16 sqn;
+	/* The sqc type set by the driver, it is the op type for zip */
+	__u16 qc_type;
+	void *dus;
+	size_t dus_size;
+	/* The time when each sqe is done, 0 means at once */
+	__u64 *due;
+	__u16 sq_head;
+	__u16 sq_tail;
+	__u16 cq_head;
+	__u16 cq_tail;
+	bool cq_phase;
+	bool started;
+	bool stop;
+	pthread_t worker;
+	pthread_mutex_t lock;
+	/* Signaled when sqes come, cqes are freed or the queue is stopped */
+	pthread_cond_t sq_cond;
+	/* Signaled when cqes are ready */
+	pthread_cond_t cq_cond;
+};
+
+static __u16 emu_sqn;
+
+/*
+ * The null engine leaves the sqe as it is, it only costs the delay. It is
+ * used to measure the overhead of the framework and the drivers.
+ */
+static void emu_null_process(struct wd_emu_qp *qp, void *sqe)
+{
+}
+
+static void *emu_addr(__u32 low, __u32 high)
+{
+	return (void *)(uintptr_t)((__u64)high << EMU_HADDR_SHIFT | low);
+}
+
+/*
+ * The zip engine copies the input to the output as far as it fits, so
+ * compression and decompression run through a stored copy of the data.
+ * A decompression request ends the stream once its input is consumed.
+ * Only flat buffers are supported, a sgl request is completed as bad.
+ */
+static void emu_zip_process(struct wd_emu_qp *qp, void *sqe)
+{
+	struct emu_zip_sqe *zip = sqe;
+	__u32 len;
+
+	zip->dw3 &= ~(EMU_ZIP_STATUS_MASK | EMU_ZIP_LSTBLK);
+	zip->ctx_dw0 &= ~EMU_ZIP_CTX_ST_MASK;
+	zip->consumed = 0;
+	zip->produced = 0;
+	if (zip->dw9 & EMU_ZIP_BUF_TYPE_MASK) {
+		zip->dw3 |= EMU_ZIP_BAD_REQ;
+		return;
+	}
+
+	len = zip->input_data_length < zip->dest_avail_out ?
+	      zip->input_data_length : zip->dest_avail_out;
+	if (len)
+		memmove(emu_addr(zip->dest_addr_l, zip->dest_addr_h),
+			emu_addr(zip->source_addr_l, zip->source_addr_h), len);
+	zip->consumed = len;
+	zip->produced = len;
+
+	if (qp->qc_type == EMU_ZIP_DECOMP && len == zip->input_data_length)
+		zip->dw3 |= EMU_ZIP_DECOMP_END | EMU_ZIP_LSTBLK;
+}
+
+/* The sec engine marks the bd2 or bd3 done without error, the data is kept */
+static void emu_sec_process(struct wd_emu_qp *qp, void *sqe)
+{
+	__u8 *done = (__u8 *)sqe + EMU_SEC_DONE_OFFSET;
+
+	/* done: 0 bit, icv: 1~3 bits, the error type is the next byte */
+	done[0] = (done[0] & ~EMU_SEC_DONE_ICV_MASK) | EMU_SEC_DONE;
+	done[2] = 0;
+}
+
+/* The hpre engine marks the sqe done without error, the output is kept */
+static void emu_hpre_process(struct wd_emu_qp *qp, void *sqe)
+{
+	__u32 *dw0 = sqe;
+
+	*dw0 = (*dw0 & ~EMU_HPRE_ETYPE_MASK) | EMU_HPRE_DONE;
+}
+
+/* The dae engine consumes all the input rows and has no output rows */
+static void emu_dae_process(struct wd_emu_qp *qp, void *sqe)
+{
+	__u32 *dw = sqe;
+
+	dw[EMU_DAE_DONE_OFFSET] = EMU_DAE_DONE | EMU_DAE_OUTPUT_END;
+	dw[EMU_DAE_DONE_OFFSET + 1] = 0;
+}
+
+static const struct wd_emu_engine emu_engines[] = {
+	{
+		.name		= "null",
+		.process	= emu_null_process,
+	}, {
+		.name		= "zip",
+		.process	= emu_zip_process,
+	}, {
+		.name		= "sec",
+		.process	= emu_sec_process,
+	}, {
+		.name		= "hpre",
+		.process	= emu_hpre_process,
+	}, {
+		.name		= "dae",
+		.process	= emu_dae_process,
+	},
+};
+
+const char *wd_uacce_class_dir(void)
+{
+	const char *dir = secure_getenv("WD_UACCE_SYSFS_DIR");
+
+	if (!dir)
+		return SYS_CLASS_DIR;
+
+	if (dir[0] != '/' || strlen(dir) >= MAX_DEV_NAME_LEN - WD_NAME_SIZE) {
+		WD_ERR("invalid: WD_UACCE_SYSFS_DIR %s is not used!\n", dir);
+		return SYS_CLASS_DIR;
+	}
+
+	return dir;
+}
+
+static __u64 emu_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (__u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void emu_ns_to_ts(__u64 ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+static void *emu_sqe(struct wd_emu_qp *qp, __u16 idx)
+{
+	return (void *)((uintptr_t)qp->dus + (size_t)idx * qp->sqe_size);
+}
+
+static struct emu_cqe *emu_cqe(struct wd_emu_qp *qp, __u16 idx)
+{
+	struct emu_cqe *cq_base;
+
+	cq_base = (void *)((uintptr_t)qp->dus + (size_t)qp->depth * qp->sqe_size);
+
+	return cq_base + idx;
+}
+
+static bool emu_cq_full(struct wd_emu_qp *qp)
+{
+	return (qp->cq_tail + 1) % qp->depth == qp->cq_head;
+}
+
+/* Called with lock held */
+static void emu_post_cqe(struct wd_emu_qp *qp, __u16 sq_head)
+{
+	struct emu_cqe *cqe = emu_cqe(qp, qp->cq_tail);
+
+	cqe->sq_head = __cpu_to_le16(sq_head);
+	cqe->sq_num = __cpu_to_le16(qp->sqn);
+	/* The phase is the last to be seen, after the sqe and the cqe fields */
+	__atomic_store_n(&cqe->w7, __cpu_to_le16(qp->cq_phase), __ATOMIC_RELEASE);
+
+	qp->cq_tail++;
+	if (qp->cq_tail == qp->depth) {
+		qp->cq_tail = 0;
+		qp->cq_phase = !qp->cq_phase;
+	}
+}
+
+static void *emu_worker(void *arg)
+{
+	struct wd_emu_qp *qp = arg;
+	struct timespec ts;
+	__u16 idx;
+	__u64 due;
+
+	pthread_mutex_lock(&qp->lock);
+	while (!qp->stop) {
+		if (qp->sq_head == qp->sq_tail || emu_cq_full(qp)) {
+			pthread_cond_wait(&qp->sq_cond, &qp->lock);
+			continue;
+		}
+
+		idx = qp->sq_head;
+		due = qp->due[idx];
+		pthread_mutex_unlock(&qp->lock);
+
+		/* The sqes sent together are done together after one sleep */
+		if (due > emu_get_ns()) {
+			emu_ns_to_ts(due, &ts);
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					       &ts, NULL) == EINTR)
+				;
+		}
+		qp->engine->process(qp, emu_sqe(qp, idx));
+
+		pthread_mutex_lock(&qp->lock);
+		emu_post_cqe(qp, idx);
+		qp->sq_head = (idx + 1) % qp->depth;
+		pthread_cond_broadcast(&qp->cq_cond);
+	}
+	pthread_mutex_unlock(&qp->lock);
+
+	return NULL;
+}
+
+static int emu_start(struct wd_emu_qp *qp)
+{
+	size_t need = (size_t)qp->depth * (qp->sqe_size + sizeof(struct emu_cqe)) +
+		      EMU_DS_SIZE;
+	int ret;
+
+	if (qp->started)
+		return 0;
+
+	if (!qp->dus || qp->dus_size < need) {
+		WD_ERR("invalid: emulated dus size %zu is less than %zu!\n",
+		       qp->dus_size, need);
+		return -WD_EINVAL;
+	}
+
+	qp->stop = false;
+	ret = pthread_create(&qp->worker, NULL, emu_worker, qp);
+	if (ret) {
+		WD_ERR("failed to create emulated queue worker, ret = %d!\n", ret);
+		return -WD_EINVAL;
+	}
+	qp->started = true;
+
+	return 0;
+}
+
+static void emu_stop(struct wd_emu_qp *qp)
+{
+	if (!qp->started)
+		return;
+
+	pthread_mutex_lock(&qp->lock);
+	qp->stop = true;
+	pthread_cond_broadcast(&qp->sq_cond);
+	pthread_mutex_unlock(&qp->lock);
+
+	pthread_join(qp->worker, NULL);
+	qp->started = false;
+}
+
+struct wd_emu_qp *wd_emu_create(struct wd_emu_cfg *cfg)
+{
+	const struct wd_emu_engine *engine = NULL;
+	pthread_condattr_t attr;
+	struct wd_emu_qp *qp;
+	size_t i;
+
+	for (i = 0; i < sizeof(emu_engines) / sizeof(emu_engines[0]); i++) {
+		if (!strcmp(cfg->engine, emu_engines[i].name)) {
+			engine = &emu_engines[i];
+			break;
+		}
+	}
+
+	if (!engine) {
+		WD_ERR("invalid: emulated engine %s is not supported!\n", cfg->engine);
+		return NULL;
+	}
+
+	if (!cfg->sqe_size || cfg->sqe_size % sizeof(__u32)) {
+		WD_ERR("invalid: emulated sqe size %u is wrong!\n", cfg->sqe_size);
+		return NULL;
+	}
+
+	qp = calloc(1, sizeof(*qp));
+	if (!qp)
+		return NULL;
+
+	qp->due = calloc(EMU_Q_DEPTH, sizeof(__u64));
+	if (!qp->due)
+		goto free_qp;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&qp->lock, NULL);
+	pthread_cond_init(&qp->sq_cond, &attr);
+	pthread_cond_init(&qp->cq_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	qp->engine = engine;
+	qp->delay_ns = cfg->delay_ns;
+	qp->sqe_size = cfg->sqe_size;
+	qp->depth = EMU_Q_DEPTH;
+	qp->sqn = __atomic_fetch_add(&emu_sqn, 1, __ATOMIC_RELAXED) % EMU_QP_NUM;
+	qp->cq_phase = true;
+
+	return qp;
+
+free_qp:
+	free(qp);
+	return NULL;
+}
+
+void wd_emu_destroy(struct wd_emu_qp *qp)
+{
+	emu_stop(qp);
+	pthread_cond_destroy(&qp->cq_cond);
+	pthread_cond_destroy(&qp->sq_cond);
+	pthread_mutex_destroy(&qp->lock);
+	free(qp->due);
+	free(qp);
+}
+
+void *wd_emu_mmap(struct wd_emu_qp *qp, int qfrt, size_t size)
+{
+	void *addr;
+
+	addr = mmap(0, size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	if (qfrt == UACCE_QFRT_DUS) {
+		qp->dus = addr;
+		qp->dus_size = size;
+	}
+
+	return addr;
+}
+
+int wd_emu_ioctl(struct wd_emu_qp *qp, unsigned long cmd, void *arg)
+{
+	struct emu_qp_info *info;
+	struct emu_qp_ctx *ctx;
+
+	switch (cmd) {
+	case UACCE_CMD_START:
+		return emu_start(qp);
+	case UACCE_CMD_PUT_Q:
+		emu_stop(qp);
+		return 0;
+	case EMU_CMD_QM_SET_QP_CTX:
+		ctx = arg;
+		qp->qc_type = ctx->qc_type;
+		ctx->id = qp->sqn;
+		return 0;
+	case EMU_CMD_QM_SET_QP_INFO:
+		info = arg;
+		info->sqe_size = qp->sqe_size;
+		info->sq_depth = qp->depth;
+		info->cq_depth = qp->depth;
+		return 0;
+	default:
+		WD_ERR("invalid: emulated queue cmd 0x%lx is not supported!\n", cmd);
+		return -WD_EINVAL;
+	}
+}
+
+int wd_emu_wait(struct wd_emu_qp *qp, __u16 ms)
+{
+	struct timespec ts;
+	int ret = 0;
+
+	emu_ns_to_ts(emu_get_ns() + ms * NSEC_PER_MSEC, &ts);
+
+	pthread_mutex_lock(&qp->lock);
+	while (qp->cq_tail == qp->cq_head && !ret)
+		ret = pthread_cond_timedwait(&qp->cq_cond, &qp->lock, &ts);
+	ret = qp->cq_tail != qp->cq_head;
+	pthread_mutex_unlock(&qp->lock);
+
+	return ret;
+}
+
+void wd_emu_doorbell(struct wd_emu_qp *qp, __u8 cmd, __u16 index)
+{
+	__u64 due = 0;
+	__u16 i;
+
+	if (index >= qp->depth)
+		return;
+
+	if (cmd == EMU_DBELL_CMD_SQ && qp->delay_ns)
+		due = emu_get_ns() + qp->delay_ns;
+
+	pthread_mutex_lock(&qp->lock);
+	if (cmd == EMU_DBELL_CMD_SQ) {
+		for (i = qp->sq_tail; i != index; i = (i + 1) % qp->depth)
+			qp->due[i] = due;
+		qp->sq_tail = index;
+	} else if (cmd == EMU_DBELL_CMD_CQ) {
+		qp->cq_head = index;
+	}
+	pthread_cond_signal(&qp->sq_cond);
+	pthread_mutex_unlock(&qp->lock);
+}
@@ -7,18 +7,35 @@
 #define _GNU_SOURCE
 #include <dirent.h>
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "wd_sched.h"
 #include "wd_util.h"
 
 #define WD_ASYNC_DEF_POLL_NUM		1
-#define WD_ASYNC_DEF_QUEUE_DEPTH	1024
+/* Max responses got from one ctx at a time, so other ctxs are not starved */
+#define WD_ASYNC_POLL_BATCH		64
 #define WD_BALANCE_THRHD		1280
 #define WD_RECV_MAX_CNT_SLEEP		60000000
 #define WD_RECV_MAX_CNT_NOSLEEP		200000000
+/* Longer waits sleep on the interrupt, as a wakeup costs less than spinning */
+#define WD_WAIT_SPIN_MAX_NS		100000
+#define WD_WAIT_SPIN_MIN_NS		2000
+/* Read the clock once per this number of receiving tries while spinning */
+#define WD_WAIT_CLOCK_CNT		16
+/* The weight of a new sample in the EWMA is 1 / (1 << WD_WAIT_EWMA_SHIFT) */
+#define WD_WAIT_EWMA_SHIFT		3
+/* Size classes of the wait time are 512B, 2KB, 8KB ... 2MB and larger */
+#define WD_WAIT_LEN_SHIFT		9
+#define WD_WAIT_LEN_STEP		2
+#define WD_NSEC_PER_SEC			1000000000ULL
 #define PRIVILEGE_FLAG			0600
 #define MIN(a, b)			((a) > (b) ? (b) : (a))
 #define MAX(a, b)			((a) > (b) ? (a) : (b))
@@ -33,6 +50,18 @@
 #define WD_SOFT_ASYNC_CTX		1
 
 #define WD_DRV_LIB_DIR			"uadk"
+#define WD_CACHE_LINE_SIZE		64
+
+/*
+ * The free tags of a msg pool are kept in a bounded MPMC ring. Each slot
+ * has a sequence number which tells whether it is ready to be got (seq is
+ * pos + 1) or put (seq is pos) at a ring position, so both operations are
+ * O(1) with one CAS on the head or tail.
+ */
+struct msg_pool_slot {
+	__u32 seq;
+	__u32 tag;
+};
 
 struct msg_pool {
 	/* message array allocated dynamically */
@@ -40,7 +69,12 @@ struct msg_pool {
 	int *used;
 	__u32 msg_num;
 	__u32 msg_size;
-	int tail;
+	struct msg_pool_slot *slots;
+	__u32 mask;
+	/* get position of the free ring */
+	__u32 head __attribute__((aligned(WD_CACHE_LINE_SIZE)));
+	/* put position of the free ring */
+	__u32 tail __attribute__((aligned(WD_CACHE_LINE_SIZE)));
 };
 
 /* parse wd env begin */
@@ -65,25 +99,33 @@ static const char *wd_env_name[WD_TYPE_MAX] = {
 	"WD_AGG_CTX_NUM",
 };
 
-struct async_task {
+/*
+ * The async tasks of a polling thread are kept in a bounded MPSC ring of ctx
+ * indexes. A ctx is in the ring only while it has pending responses, the one
+ * who makes its pending count leave 0 pushes it. So the ring never holds more
+ * entries than ctxs, and the polling thread gets all the pending responses of
+ * a ctx with one pop.
+ */
+struct async_task_slot {
+	__u32 seq;
 	__u32 idx;
 };
 
 struct async_task_queue {
-	struct async_task *head;
-	int depth;
-	/* the producer offset of task queue */
-	int prod;
-	/* the consumer offset of task queue */
-	int cons;
-	int cur_task;
-	int left_task;
+	struct async_task_slot *slots;
+	__u32 mask;
+	/* pending responses of each ctx, indexed by the ctx index */
+	__u32 *pending;
 	int end;
-	sem_t empty_sem;
+	/* the polling thread is going to sleep on full_sem */
+	int sleeping;
 	sem_t full_sem;
-	pthread_mutex_t lock;
 	pthread_t tid;
 	int (*alg_poll_ctx)(__u32, __u32, __u32 *);
+	/* push position of senders */
+	__u32 tail __attribute__((aligned(WD_CACHE_LINE_SIZE)));
+	/* pop position of the polling thread */
+	__u32 head __attribute__((aligned(WD_CACHE_LINE_SIZE)));
 };
 
 struct drv_lib_list {
@@ -170,45 +212,172 @@ static void clone_ctx_to_internal(struct wd_ctx *ctx,
 	ctx_in->ctx_mode = ctx->ctx_mode;
 }
 
-static int wd_shm_create(struct wd_ctx_config_internal *in)
+__thread __u32 wd_stats_tid;
+static __u32 wd_stats_tid_next;
+
+static struct wd_stats_region *wd_stats_region;
+static char wd_stats_name[NAME_MAX];
+static __u32 wd_stats_users;
+static pthread_mutex_t wd_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+__u32 wd_stats_new_tid(void)
 {
-	int shm_size = sizeof(unsigned long) * WD_CTX_CNT_NUM;
-	void *ptr;
-	int shmid;
+	__u32 tid = __atomic_add_fetch(&wd_stats_tid_next, 1, __ATOMIC_RELAXED);
 
-	if (!wd_need_info())
-		return 0;
+	/* 0 means no slot is picked yet */
+	return tid ? tid : __atomic_add_fetch(&wd_stats_tid_next, 1, __ATOMIC_RELAXED);
+}
 
-	shmid = shmget(WD_IPC_KEY, shm_size, IPC_CREAT | PRIVILEGE_FLAG);
-	if (shmid < 0) {
-		WD_ERR("failed to get shared memory id(%d).\n", errno);
-		return -WD_EINVAL;
+static bool wd_stats_need(void)
+{
+	const char *s = secure_getenv("WD_STATS_EN");
+
+	if (s && !strcmp(s, "1"))
+		return true;
+
+	return wd_need_info();
+}
+
+/* Each copy of wd_util in the process creates a region of its own */
+static int wd_stats_map(void)
+{
+	struct wd_stats_region *region;
+	int fd = -1;
+	int i;
+
+	for (i = 0; i < WD_STATS_CTX_MAX && fd < 0; i++) {
+		snprintf(wd_stats_name, sizeof(wd_stats_name), "/%s%d.%d",
+			 WD_STATS_PREFIX, getpid(), i);
+		fd = shm_open(wd_stats_name, O_CREAT | O_EXCL | O_RDWR, PRIVILEGE_FLAG);
+		if (fd < 0 && errno != EEXIST)
+			break;
 	}
 
-	ptr = shmat(shmid, NULL, 0);
-	if (ptr == (void *)-1) {
-		WD_ERR("failed to get shared memory addr(%d).\n", errno);
+	if (fd < 0) {
+		WD_ERR("failed to create statistics region(%d).\n", errno);
 		return -WD_EINVAL;
 	}
 
-	memset(ptr, 0, shm_size);
+	if (ftruncate(fd, sizeof(*region))) {
+		WD_ERR("failed to size statistics region(%d).\n", errno);
+		goto err_unlink;
+	}
+
+	region = mmap(NULL, sizeof(*region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (region == MAP_FAILED) {
+		WD_ERR("failed to map statistics region(%d).\n", errno);
+		goto err_unlink;
+	}
+	close(fd);
 
-	in->shmid = shmid;
-	in->msg_cnt = ptr;
+	region->version = WD_STATS_VERSION;
+	region->pid = getpid();
+	region->ctx_max = WD_STATS_CTX_MAX;
+	/* Readers check the magic before they read the region */
+	__atomic_store_n(&region->magic, WD_STATS_MAGIC, __ATOMIC_RELEASE);
+	wd_stats_region = region;
 
 	return 0;
+
+err_unlink:
+	close(fd);
+	shm_unlink(wd_stats_name);
+	return -WD_EINVAL;
+}
+
+static void wd_stats_unmap(void)
+{
+	munmap(wd_stats_region, sizeof(*wd_stats_region));
+	shm_unlink(wd_stats_name);
+	wd_stats_region = NULL;
+}
+
+static void wd_stats_get_alg(const char *alg_name, char *alg)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(alg_options); i++) {
+		if (!strcmp(alg_name, alg_options[i].name)) {
+			alg_name = alg_options[i].algtype;
+			break;
+		}
+	}
+
+	snprintf(alg, WD_STATS_NAME_LEN, "%s", alg_name);
+}
+
+static void wd_stats_fill_ctx(struct wd_stats_ctx *stats, struct wd_ctx_internal *ctx,
+			      struct wd_alg_driver *driver)
+{
+	const char *dev = NULL;
+
+	stats->numa = -1;
+	if (driver->calc_type == UADK_ALG_HW) {
+		dev = wd_ctx_get_dev_name(ctx->ctx);
+		stats->numa = wd_get_numa_id(ctx->ctx);
+	}
+
+	wd_stats_get_alg(driver->alg_name, stats->alg);
+	snprintf(stats->dev, sizeof(stats->dev), "%s", dev ? dev : driver->drv_name);
+	stats->mode = ctx->ctx_mode;
+	stats->op_type = ctx->op_type;
+	memset(stats->slots, 0, sizeof(stats->slots));
 }
 
-static void wd_shm_delete(struct wd_ctx_config_internal *in)
+/* Give the ctxs entries in the statistics region, the ctxs without one aren't counted */
+static void wd_stats_register(struct wd_ctx_config_internal *config,
+			      struct wd_alg_driver *driver)
 {
-	if (!wd_need_info())
+	struct wd_stats_ctx *stats;
+	__u32 i, pos = 0;
+
+	if (!wd_stats_need())
 		return;
 
-	/* deleted shared memory */
-	shmctl(in->shmid, IPC_RMID, NULL);
+	pthread_mutex_lock(&wd_stats_mutex);
+	if (!wd_stats_region && wd_stats_map())
+		goto out;
+
+	for (i = 0; i < config->ctx_num; i++) {
+		while (pos < WD_STATS_CTX_MAX && wd_stats_region->ctxs[pos].in_use)
+			pos++;
+		if (pos == WD_STATS_CTX_MAX) {
+			WD_INFO("statistics region is full, %u ctxs are not counted.\n",
+				config->ctx_num - i);
+			break;
+		}
+
+		stats = &wd_stats_region->ctxs[pos];
+		wd_stats_fill_ctx(stats, config->ctxs + i, driver);
+		stats->gen++;
+		__atomic_store_n(&stats->in_use, 1, __ATOMIC_RELEASE);
+		config->ctxs[i].stats = stats;
+		wd_stats_users++;
+	}
+
+	if (!wd_stats_users)
+		wd_stats_unmap();
+out:
+	pthread_mutex_unlock(&wd_stats_mutex);
+}
+
+static void wd_stats_unregister(struct wd_ctx_config_internal *config)
+{
+	__u32 i;
+
+	pthread_mutex_lock(&wd_stats_mutex);
+	for (i = 0; i < config->ctx_num; i++) {
+		if (!config->ctxs[i].stats)
+			continue;
+
+		__atomic_store_n(&config->ctxs[i].stats->in_use, 0, __ATOMIC_RELEASE);
+		config->ctxs[i].stats = NULL;
+		wd_stats_users--;
+	}
 
-	in->shmid = 0;
-	in->msg_cnt = NULL;
+	if (wd_stats_region && !wd_stats_users)
+		wd_stats_unmap();
+	pthread_mutex_unlock(&wd_stats_mutex);
 }
 
 int wd_init_ctx_config(struct wd_ctx_config_internal *in,
@@ -223,15 +392,10 @@ int wd_init_ctx_config(struct wd_ctx_config_internal *in,
 		return -WD_EINVAL;
 	}
 
-	ret = wd_shm_create(in);
-	if (ret)
-		return ret;
-
 	ctxs = calloc(1, cfg->ctx_num * sizeof(struct wd_ctx_internal));
 	if (!ctxs) {
 		WD_ERR("failed to alloc memory for internal ctxs!\n");
-		ret = -WD_ENOMEM;
-		goto err_shm_del;
+		return -WD_ENOMEM;
 	}
 
 	for (i = 0; i < cfg->ctx_num; i++) {
@@ -258,8 +422,6 @@ err_out:
 	for (j = 0; j < i; j++)
 		pthread_spin_destroy(&ctxs[j].lock);
 	free(ctxs);
-err_shm_del:
-	wd_shm_delete(in);
 	return ret;
 }
 
@@ -280,6 +442,32 @@ int wd_init_sched(struct wd_sched *in, struct wd_sched *from)
 	return 0;
 }
 
+static __u32 wd_ctx_load(void *priv, __u32 idx)
+{
+	struct wd_ctx_config_internal *config = priv;
+	struct wd_ctx_internal *ctx;
+
+	if (unlikely(idx >= config->ctx_num))
+		return UINT32_MAX;
+
+	ctx = config->ctxs + idx;
+	if (ctx->ctx_mode == CTX_MODE_ASYNC) {
+		if (unlikely(!config->pool || !config->pool->pools))
+			return 0;
+		return wd_get_msg_pool_depth(config->pool, idx);
+	}
+
+	return __atomic_load_n(&ctx->inflight, __ATOMIC_RELAXED);
+}
+
+void wd_init_sched_load(struct wd_sched *sched,
+			struct wd_ctx_config_internal *config,
+			struct wd_async_msg_pool *pool)
+{
+	config->pool = pool;
+	wd_sched_set_load(sched, wd_ctx_load, config);
+}
+
 void wd_clear_sched(struct wd_sched *in)
 {
 	char *name = (char *)in->name;
@@ -297,6 +485,7 @@ void wd_clear_ctx_config(struct wd_ctx_config_internal *in)
 {
 	__u32 i;
 
+	wd_stats_unregister(in);
 	for (i = 0; i < in->ctx_num; i++)
 		pthread_spin_destroy(&in->ctxs[i].lock);
 
@@ -306,8 +495,6 @@ void wd_clear_ctx_config(struct wd_ctx_config_internal *in)
 		free(in->ctxs);
 		in->ctxs = NULL;
 	}
-
-	wd_shm_delete(in);
 }
 
 void wd_memset_zero(void *data, __u32 size)
@@ -338,6 +525,12 @@ static void get_ctx_msg_num(struct wd_cap_config *cap, __u32 *msg_num)
 
 static int init_msg_pool(struct msg_pool *pool, __u32 msg_num, __u32 msg_size)
 {
+	__u32 slot_num = 1;
+	__u32 i;
+
+	while (slot_num < msg_num)
+		slot_num <<= 1;
+
 	pool->msgs = calloc(1, msg_num * msg_size);
 	if (!pool->msgs) {
 		WD_ERR("failed to alloc memory for msgs arrary of msg pool!\n");
@@ -346,17 +539,41 @@ static int init_msg_pool(struct msg_pool *pool, __u32 msg_num, __u32 msg_size)
 
 	pool->used = calloc(1, msg_num * sizeof(int));
 	if (!pool->used) {
-		free(pool->msgs);
-		pool->msgs = NULL;
 		WD_ERR("failed to alloc memory for used arrary of msg pool!\n");
-		return -WD_ENOMEM;
+		goto free_msgs;
+	}
+
+	pool->slots = calloc(1, slot_num * sizeof(struct msg_pool_slot));
+	if (!pool->slots) {
+		WD_ERR("failed to alloc memory for free ring of msg pool!\n");
+		goto free_used;
+	}
+
+	/* All the tags are free at first, tag value start from 1 */
+	for (i = 0; i < slot_num; i++) {
+		if (i < msg_num) {
+			pool->slots[i].tag = i + 1;
+			pool->slots[i].seq = i + 1;
+		} else {
+			pool->slots[i].seq = i;
+		}
 	}
 
 	pool->msg_size = msg_size;
 	pool->msg_num = msg_num;
-	pool->tail = 0;
+	pool->mask = slot_num - 1;
+	pool->head = 0;
+	pool->tail = msg_num;
 
 	return 0;
+
+free_used:
+	free(pool->used);
+	pool->used = NULL;
+free_msgs:
+	free(pool->msgs);
+	pool->msgs = NULL;
+	return -WD_ENOMEM;
 }
 
 static void uninit_msg_pool(struct msg_pool *pool)
@@ -366,8 +583,10 @@ static void uninit_msg_pool(struct msg_pool *pool)
 
 	free(pool->msgs);
 	free(pool->used);
+	free(pool->slots);
 	pool->msgs = NULL;
 	pool->used = NULL;
+	pool->slots = NULL;
 	memset(pool, 0, sizeof(*pool));
 }
 
@@ -380,14 +599,18 @@ int wd_init_async_request_pool(struct wd_async_msg_pool *pool, struct wd_ctx_con
 
 	pool->pool_num = pool_num;
 
-	pool->pools = calloc(1, pool_num * sizeof(struct msg_pool));
+	/* Keep the get and put positions of each pool in their own cache lines */
+	pool->pools = aligned_alloc(WD_CACHE_LINE_SIZE,
+				    pool_num * sizeof(struct msg_pool));
 	if (!pool->pools) {
 		WD_ERR("failed to alloc memory for async msg pools!\n");
 		return -WD_ENOMEM;
 	}
+	memset(pool->pools, 0, pool_num * sizeof(struct msg_pool));
 
 	/* If user set valid msg num, use user's. */
 	get_ctx_msg_num(config->cap, &msg_num);
+	pool->msg_num = msg_num;
 	for (i = 0; i < pool_num; i++) {
 		if (config->ctxs[i].ctx_mode == CTX_MODE_SYNC)
 			continue;
@@ -416,6 +639,7 @@ void wd_uninit_async_request_pool(struct wd_async_msg_pool *pool)
 	free(pool->pools);
 	pool->pools = NULL;
 	pool->pool_num = 0;
+	pool->msg_num = 0;
 }
 
 void *wd_find_msg_in_pool(struct wd_async_msg_pool *pool,
@@ -444,32 +668,54 @@ int wd_get_msg_from_pool(struct wd_async_msg_pool *pool,
 			 int ctx_idx, void **msg)
 {
 	struct msg_pool *p = &pool->pools[ctx_idx];
-	__u32 msg_num = p->msg_num;
-	__u32 msg_size = p->msg_size;
-	__u32 cnt = 0;
-	__u32 idx = p->tail;
+	struct msg_pool_slot *slot;
+	__u32 pos, seq, tag, tail;
+	int diff;
 
 	/* Scheduler set a sync ctx */
-	if (!msg_num)
+	if (!p->msg_num)
 		return -WD_EINVAL;
 
-	while (__atomic_test_and_set(&p->used[idx], __ATOMIC_ACQUIRE)) {
-		idx = (idx + 1) % msg_num;
-		cnt++;
-		if (cnt == msg_num)
-			return -WD_EBUSY;
+	pos = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+	while (true) {
+		slot = &p->slots[pos & p->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		diff = (int)(seq - (pos + 1));
+		if (!diff) {
+			if (__atomic_compare_exchange_n(&p->head, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			/*
+			 * The pool is full only if no put has taken this slot.
+			 * Otherwise the put is not finished yet, it will be done
+			 * soon, so wait for it rather than report a full pool.
+			 */
+			tail = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+			if ((int)(tail - pos) <= 0)
+				return -WD_EBUSY;
+			pos = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+		} else {
+			pos = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+		}
 	}
 
-	p->tail = (idx + 1) % msg_num;
-	*msg = (void *)((uintptr_t)p->msgs + msg_size * idx);
+	tag = slot->tag;
+	/* Free the slot for the put one lap later */
+	__atomic_store_n(&slot->seq, pos + p->mask + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&p->used[tag - 1], 1, __ATOMIC_RELAXED);
+	*msg = (void *)((uintptr_t)p->msgs + p->msg_size * (tag - 1));
 
-	return idx + 1;
+	return tag;
 }
 
 void wd_put_msg_to_pool(struct wd_async_msg_pool *pool, int ctx_idx, __u32 tag)
 {
 	struct msg_pool *p = &pool->pools[ctx_idx];
+	struct msg_pool_slot *slot;
 	__u32 msg_num = p->msg_num;
+	__u32 pos, seq;
+	int diff;
 
 	/* tag value start from 1 */
 	if (!tag || tag > msg_num) {
@@ -477,7 +723,44 @@ void wd_put_msg_to_pool(struct wd_async_msg_pool *pool, int ctx_idx, __u32 tag)
 		return;
 	}
 
-	__atomic_clear(&p->used[tag - 1], __ATOMIC_RELEASE);
+	/* A tag in the free ring twice would be got by two requests */
+	if (!__atomic_exchange_n(&p->used[tag - 1], 0, __ATOMIC_RELAXED)) {
+		WD_ERR("invalid: message cache idx %u is already free!\n", tag);
+		return;
+	}
+
+	/* The ring can hold all the tags, so there is always a slot to put */
+	pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+	while (true) {
+		slot = &p->slots[pos & p->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		diff = (int)(seq - pos);
+		if (!diff) {
+			if (__atomic_compare_exchange_n(&p->tail, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else {
+			pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->tag = tag;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+__u32 wd_get_msg_pool_depth(struct wd_async_msg_pool *pool, int ctx_idx)
+{
+	struct msg_pool *p = &pool->pools[ctx_idx];
+	__u32 head, tail;
+
+	head = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+
+	/* The two positions are not read at once, it is only an estimate */
+	if ((int)(tail - head) <= 0)
+		return p->msg_num;
+
+	return tail - head >= p->msg_num ? 0 : p->msg_num - (tail - head);
 }
 
 int wd_check_src_dst(void *src, __u32 in_bytes, void *dst, __u32 out_bytes)
@@ -1373,11 +1656,88 @@ static struct async_task_queue *find_async_queue(struct wd_env_config *config,
 	return head + offset;
 }
 
+static void async_task_push(struct async_task_queue *task_queue, __u32 idx)
+{
+	struct async_task_slot *slot;
+	__u32 pos, seq;
+
+	/* The ring can hold all the ctxs, so there is always a slot to push */
+	pos = __atomic_load_n(&task_queue->tail, __ATOMIC_RELAXED);
+	while (true) {
+		slot = &task_queue->slots[pos & task_queue->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&task_queue->tail, &pos, pos + 1,
+							true, __ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else {
+			pos = __atomic_load_n(&task_queue->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->idx = idx;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+/* Only the polling thread pops, so the head is not shared */
+static bool async_task_pop(struct async_task_queue *task_queue, __u32 *idx)
+{
+	__u32 pos = task_queue->head;
+	struct async_task_slot *slot;
+
+	slot = &task_queue->slots[pos & task_queue->mask];
+	if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+		return false;
+
+	*idx = slot->idx;
+	__atomic_store_n(&slot->seq, pos + task_queue->mask + 1, __ATOMIC_RELEASE);
+	task_queue->head = pos + 1;
+
+	return true;
+}
+
+static bool async_task_empty(struct async_task_queue *task_queue)
+{
+	struct async_task_slot *slot;
+	__u32 pos = task_queue->head;
+
+	slot = &task_queue->slots[pos & task_queue->mask];
+
+	return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1;
+}
+
+static void async_task_wake(struct async_task_queue *task_queue)
+{
+	/* Pair with the fence in async_task_sleep(), so one side sees the other */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&task_queue->sleeping, __ATOMIC_RELAXED) &&
+	    __atomic_exchange_n(&task_queue->sleeping, 0, __ATOMIC_ACQ_REL))
+		sem_post(&task_queue->full_sem);
+}
+
+static void async_task_sleep(struct async_task_queue *task_queue)
+{
+	__atomic_store_n(&task_queue->sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	/*
+	 * A task may be pushed before the flag is seen. Then take the flag
+	 * back, if a sender has taken it, its post must be consumed.
+	 */
+	if (!async_task_empty(task_queue) ||
+	    __atomic_load_n(&task_queue->end, __ATOMIC_ACQUIRE)) {
+		if (__atomic_exchange_n(&task_queue->sleeping, 0, __ATOMIC_ACQ_REL))
+			return;
+	}
+
+	while (sem_wait(&task_queue->full_sem) && errno == EINTR)
+		;
+}
+
 int wd_add_task_to_async_queue(struct wd_env_config *config, __u32 idx)
 {
 	struct async_task_queue *task_queue;
-	struct async_task *task;
-	int curr_prod, ret;
 
 	if (!config->enable_internal_poll)
 		return 0;
@@ -1386,136 +1746,83 @@ int wd_add_task_to_async_queue(struct wd_env_config *config, __u32 idx)
 	if (!task_queue)
 		return -WD_EINVAL;
 
-	ret = sem_wait(&task_queue->empty_sem);
-	if (ret) {
-		WD_ERR("failed to wait empty_sem!\n");
-		return ret;
-	}
-
-	pthread_mutex_lock(&task_queue->lock);
-
-	/* get an available async task and fill ctx idx */
-	curr_prod = task_queue->prod;
-	task = task_queue->head + curr_prod;
-	task->idx = idx;
-
-	/* update global information of task queue */
-	task_queue->prod = (curr_prod + 1) % task_queue->depth;
-	task_queue->cur_task++;
-	task_queue->left_task--;
-
-	pthread_mutex_unlock(&task_queue->lock);
+	/* The ctx is in the ring already, its polling covers this task */
+	if (__atomic_fetch_add(&task_queue->pending[idx], 1, __ATOMIC_ACQ_REL))
+		return 0;
 
-	ret = sem_post(&task_queue->full_sem);
-	if (ret) {
-		WD_ERR("failed to post full_sem!\n");
-		goto err_out;
-	}
+	async_task_push(task_queue, idx);
+	async_task_wake(task_queue);
 
 	return 0;
-
-err_out:
-	pthread_mutex_lock(&task_queue->lock);
-	task_queue->left_task++;
-	task_queue->cur_task--;
-	task_queue->prod = curr_prod;
-	pthread_mutex_unlock(&task_queue->lock);
-	sem_post(&task_queue->empty_sem);
-
-	return ret;
 }
 
 static void *async_poll_process_func(void *args)
 {
 	struct async_task_queue *task_queue = args;
-	struct async_task *head, *task;
-	__u32 count;
-	int cons, ret;
-
-	while (1) {
-		if (sem_wait(&task_queue->full_sem)) {
-			if (errno == EINTR) {
-				continue;
-			}
-		}
-		if (__atomic_load_n(&task_queue->end, __ATOMIC_ACQUIRE)) {
-			__atomic_store_n(&task_queue->end, 0, __ATOMIC_RELEASE);
-			goto out;
-		}
-
-		pthread_mutex_lock(&task_queue->lock);
+	__u32 idx, expt, count;
+	int ret;
 
-		/* async sending message isn't submitted yet */
-		if (task_queue->cons == task_queue->prod) {
-			pthread_mutex_unlock(&task_queue->lock);
-			sem_post(&task_queue->full_sem);
+	while (!__atomic_load_n(&task_queue->end, __ATOMIC_ACQUIRE)) {
+		if (!async_task_pop(task_queue, &idx)) {
+			async_task_sleep(task_queue);
 			continue;
 		}
 
-		cons = task_queue->cons;
-		head = task_queue->head;
-		task = head + cons;
-
-		task_queue->cons = (cons + 1) % task_queue->depth;
-		task_queue->cur_task--;
-		task_queue->left_task++;
-
-		pthread_mutex_unlock(&task_queue->lock);
-
-		ret = task_queue->alg_poll_ctx(task->idx, 1, &count);
-		if (ret < 0) {
-			pthread_mutex_lock(&task_queue->lock);
-			task_queue->cons = cons;
-			task_queue->cur_task++;
-			task_queue->left_task--;
-			pthread_mutex_unlock(&task_queue->lock);
-			if (ret == -WD_EAGAIN) {
-				sem_post(&task_queue->full_sem);
-				continue;
-			} else
-				goto out;
-		}
-
-		if (sem_post(&task_queue->empty_sem))
-			goto out;
-	}
-out:
+		/* Get the responses of all the tasks of the ctx in one call */
+		expt = __atomic_load_n(&task_queue->pending[idx], __ATOMIC_ACQUIRE);
+		expt = MIN(expt, WD_ASYNC_POLL_BATCH);
+		count = 0;
+		ret = task_queue->alg_poll_ctx(idx, expt, &count);
+		/*
+		 * The responses reaped before an error are accounted as well,
+		 * and the ctx is polled again for the remaining tasks.
+		 */
+		if (unlikely(ret < 0 && ret != -WD_EAGAIN))
+			WD_ERR("failed to poll ctx %u, ret = %d!\n", idx, ret);
+
+		/* Put the ctx back if some responses are not ready yet */
+		if (!count || __atomic_sub_fetch(&task_queue->pending[idx], count,
+						 __ATOMIC_ACQ_REL))
+			async_task_push(task_queue, idx);
+	}
+
+	__atomic_store_n(&task_queue->end, 0, __ATOMIC_RELEASE);
 	pthread_exit(NULL);
 	return NULL;
 }
 
 static int wd_init_one_task_queue(struct async_task_queue *task_queue,
-				  void *alg_poll_ctx)
-
+				  void *alg_poll_ctx, __u32 ctx_num)
 {
-	struct async_task *head;
 	pthread_t thread_id;
 	pthread_attr_t attr;
-	int depth, ret;
+	__u32 slot_num = 1;
+	__u32 i;
+	int ret;
 
-	task_queue->depth = depth = WD_ASYNC_DEF_QUEUE_DEPTH;
+	while (slot_num < ctx_num)
+		slot_num <<= 1;
 
-	head = calloc(task_queue->depth, sizeof(*head));
-	if (!head)
+	task_queue->slots = calloc(slot_num, sizeof(*task_queue->slots));
+	if (!task_queue->slots)
 		return -WD_ENOMEM;
 
-	task_queue->head = head;
-	task_queue->left_task = depth;
-	task_queue->alg_poll_ctx = alg_poll_ctx;
+	for (i = 0; i < slot_num; i++)
+		task_queue->slots[i].seq = i;
+	task_queue->mask = slot_num - 1;
 
-	if (sem_init(&task_queue->empty_sem, 0, depth)) {
-		WD_ERR("failed to init empty_sem!\n");
-		goto err_free_head;
+	task_queue->pending = calloc(ctx_num, sizeof(*task_queue->pending));
+	if (!task_queue->pending) {
+		ret = -WD_ENOMEM;
+		goto err_free_slots;
 	}
 
+	task_queue->alg_poll_ctx = alg_poll_ctx;
+
 	if (sem_init(&task_queue->full_sem, 0, 0)) {
 		WD_ERR("failed to init full_sem!\n");
-		goto err_uninit_empty_sem;
-	}
-
-	if (pthread_mutex_init(&task_queue->lock, NULL)) {
-		WD_ERR("failed to init task queue's mutex lock!\n");
-		goto err_uninit_full_sem;
+		ret = -errno;
+		goto err_free_pending;
 	}
 
 	pthread_attr_init(&attr);
@@ -1524,7 +1831,8 @@ static int wd_init_one_task_queue(struct async_task_queue *task_queue,
 	if (pthread_create(&thread_id, &attr, async_poll_process_func,
 			   task_queue)) {
 		WD_ERR("failed to create poll thread!\n");
-		goto err_destory_mutex;
+		ret = -errno;
+		goto err_destroy_sem;
 	}
 
 	task_queue->tid = thread_id;
@@ -1532,16 +1840,13 @@ static int wd_init_one_task_queue(struct async_task_queue *task_queue,
 
 	return 0;
 
-err_destory_mutex:
+err_destroy_sem:
 	pthread_attr_destroy(&attr);
-	pthread_mutex_destroy(&task_queue->lock);
-err_uninit_full_sem:
 	sem_destroy(&task_queue->full_sem);
-err_uninit_empty_sem:
-	sem_destroy(&task_queue->empty_sem);
-err_free_head:
-	free(head);
-	ret = -errno;
+err_free_pending:
+	free(task_queue->pending);
+err_free_slots:
+	free(task_queue->slots);
 	return ret;
 }
 
@@ -1552,16 +1857,16 @@ static void wd_uninit_one_task_queue(struct async_task_queue *task_queue)
 	 * on task_queue->full_sem. It'll cause that threads could not
 	 * be end and memory leak.
 	 */
-	sem_post(&task_queue->full_sem);
 	__atomic_store_n(&task_queue->end, 1, __ATOMIC_RELEASE);
+	async_task_wake(task_queue);
 	while (__atomic_load_n(&task_queue->end, __ATOMIC_ACQUIRE))
 		sched_yield();
 
-	pthread_mutex_destroy(&task_queue->lock);
 	sem_destroy(&task_queue->full_sem);
-	sem_destroy(&task_queue->empty_sem);
-	free(task_queue->head);
-	task_queue->head = NULL;
+	free(task_queue->pending);
+	task_queue->pending = NULL;
+	free(task_queue->slots);
+	task_queue->slots = NULL;
 }
 
 static int wd_init_async_polling_thread_per_numa(struct wd_env_config *config,
@@ -1569,6 +1874,7 @@ static int wd_init_async_polling_thread_per_numa(struct wd_env_config *config,
 						 void *alg_poll_ctx)
 {
 	struct async_task_queue *task_queue, *queue_head;
+	__u32 ctx_num = config->ctx_config->ctx_num;
 	int i, j, ret;
 	double num;
 
@@ -1585,16 +1891,18 @@ static int wd_init_async_polling_thread_per_numa(struct wd_env_config *config,
 	num = MIN(config_numa->async_poll_num, config_numa->async_ctx_num);
 
 	/* make max task queues as the number of async ctxs */
-	queue_head = calloc(config_numa->async_ctx_num, sizeof(*queue_head));
+	queue_head = aligned_alloc(WD_CACHE_LINE_SIZE,
+				   config_numa->async_ctx_num * sizeof(*queue_head));
 	if (!queue_head)
 		return -WD_ENOMEM;
+	memset(queue_head, 0, config_numa->async_ctx_num * sizeof(*queue_head));
 
 	task_queue = queue_head;
 	for (i = 0; i < num; task_queue++, i++) {
-		ret = wd_init_one_task_queue(task_queue, alg_poll_ctx);
+		ret = wd_init_one_task_queue(task_queue, alg_poll_ctx, ctx_num);
 		if (ret) {
-			for (j = 0; j < i; task_queue++, j++)
-				wd_uninit_one_task_queue(task_queue);
+			for (j = 0; j < i; j++)
+				wd_uninit_one_task_queue(queue_head + j);
 			free(queue_head);
 			return ret;
 		}
@@ -1821,30 +2129,192 @@ int wd_set_epoll_en(const char *var_name, bool *epoll_en)
 	return 0;
 }
 
-int wd_handle_msg_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
-		       handle_t ctx, void *msg, __u64 *balance, bool epoll_en)
+int wd_set_wait_policy(const char *var_name,
+		       struct wd_ctx_config_internal *config)
 {
+	static const char *const policy_name[WD_WAIT_POLICY_MAX] = {
+		"poll", "epoll", "hybrid",
+	};
+	const char *s;
+	__u8 i;
+
+	s = secure_getenv(var_name);
+	if (!s || !strlen(s)) {
+		config->wait_policy = config->epoll_en ? WD_WAIT_EPOLL : WD_WAIT_POLL;
+		return 0;
+	}
+
+	for (i = 0; i < WD_WAIT_POLICY_MAX; i++) {
+		if (!strcmp(s, policy_name[i]))
+			break;
+	}
+
+	if (i == WD_WAIT_POLICY_MAX) {
+		WD_ERR("failed to parse %s, it should be poll, epoll or hybrid!\n",
+		       var_name);
+		return -WD_EINVAL;
+	}
+
+	config->wait_policy = i;
+	config->epoll_en = i != WD_WAIT_POLL;
+
+	return 0;
+}
+
+int wd_set_fallback_depth(const char *var_name, __u32 *depth)
+{
+	const char *s;
+	int val;
+
+	*depth = 0;
+	s = secure_getenv(var_name);
+	if (!s || !strlen(s))
+		return 0;
+
+	val = strtol(s, NULL, 10);
+	if (val < 0 || val > WD_POOL_MAX_ENTRIES) {
+		WD_ERR("invalid: %s is %s, must be 0 ~ %d!\n", var_name, s,
+		       WD_POOL_MAX_ENTRIES);
+		return -WD_EINVAL;
+	}
+
+	*depth = val;
+	if (*depth)
+		WD_INFO("overflow to the fallback driver is enabled, depth = %u!\n",
+			*depth);
+
+	return 0;
+}
+
+bool wd_alg_fallback_en(struct wd_alg_driver *drv,
+			struct wd_ctx_config_internal *config)
+{
+	return drv->fallback && config->fb_depth;
+}
+
+bool wd_alg_fallback_check(struct wd_alg_driver *drv,
+			   struct wd_ctx_config_internal *config,
+			   struct wd_async_msg_pool *pool, __u32 idx)
+{
+	if (!wd_alg_fallback_en(drv, config))
+		return false;
+
+	return wd_get_msg_pool_depth(pool, idx) >= config->fb_depth;
+}
+
+int wd_alg_do_fallback(struct wd_alg_driver *drv,
+		       struct wd_ctx_config_internal *config, void *msg)
+{
+	struct wd_alg_driver *fb_drv = (struct wd_alg_driver *)drv->fallback;
+	handle_t ctx;
+	int ret;
+
+	if (unlikely(!config->fb_config)) {
+		WD_ERR("invalid: fallback driver isn't inited!\n");
+		return -WD_EINVAL;
+	}
+
+	/* The fallback driver finishes the request in the caller's thread */
+	ctx = config->fb_config->ctxs[0].ctx;
+	ret = fb_drv->send(fb_drv, ctx, msg);
+	if (unlikely(ret < 0))
+		return ret;
+
+	ret = fb_drv->recv(fb_drv, ctx, msg);
+	if (unlikely(ret < 0))
+		return ret;
+
+	return 0;
+}
+
+static __u64 wd_wait_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (__u64)ts.tv_sec * WD_NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static __u32 wd_wait_len_class(__u32 len)
+{
+	__u32 class = 0;
+
+	len >>= WD_WAIT_LEN_SHIFT;
+	while (len && class < WD_WAIT_LEN_NUM - 1) {
+		len >>= WD_WAIT_LEN_STEP;
+		class++;
+	}
+
+	return class;
+}
+
+/*
+ * The spin window covers the usual completion time of the packet with some
+ * margin. A packet which is not seen yet spins for the longest window, and
+ * a packet which usually takes longer than it sleeps at once.
+ */
+static __u64 wd_wait_spin_ns(__u32 expect_ns)
+{
+	__u64 spin_ns;
+
+	if (!expect_ns)
+		return WD_WAIT_SPIN_MAX_NS;
+
+	if (expect_ns > WD_WAIT_SPIN_MAX_NS)
+		return 0;
+
+	spin_ns = ((__u64)expect_ns << 1) + WD_WAIT_SPIN_MIN_NS;
+
+	return MIN(spin_ns, WD_WAIT_SPIN_MAX_NS);
+}
+
+static void wd_wait_update(__u32 *expect_ns, __u64 cost_ns)
+{
+	__s64 delta;
+
+	cost_ns = MIN(cost_ns, UINT32_MAX);
+	if (!*expect_ns) {
+		*expect_ns = cost_ns ? cost_ns : 1;
+		return;
+	}
+
+	delta = (__s64)cost_ns - *expect_ns;
+	*expect_ns += delta / (1 << WD_WAIT_EWMA_SHIFT);
+	if (!*expect_ns)
+		*expect_ns = 1;
+}
+
+static int wd_recv_msg_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
+			    struct wd_ctx_config_internal *config,
+			    struct wd_ctx_internal *ctx, void *msg, __u32 len,
+			    __u64 *balance)
+{
+	__u8 policy = config->epoll_en ? config->wait_policy : WD_WAIT_POLL;
 	__u64 timeout = WD_RECV_MAX_CNT_NOSLEEP;
+	__u64 start = 0, spin_ns = 0;
+	bool wait_en = policy == WD_WAIT_EPOLL;
+	__u32 *expect_ns = NULL;
 	__u64 rx_cnt = 0;
 	int ret;
 
 	if (balance)
 		timeout = WD_RECV_MAX_CNT_SLEEP;
 
-	ret = msg_handle->send(drv, ctx, msg);
-	if (unlikely(ret < 0)) {
-		WD_ERR("failed to send msg to hw, ret = %d!\n", ret);
-		return ret;
+	if (policy == WD_WAIT_HYBRID) {
+		expect_ns = &ctx->wait_ns[wd_wait_len_class(len)];
+		spin_ns = wd_wait_spin_ns(*expect_ns);
+		start = wd_wait_get_ns();
 	}
 
 	do {
-		if (epoll_en) {
-			ret = wd_ctx_wait(ctx, POLL_TIME);
+		if (wait_en) {
+			ret = wd_ctx_wait(ctx->ctx, POLL_TIME);
 			if (unlikely(ret < 0))
 				WD_ERR("wd ctx wait timeout(%d)!\n", ret);
 		}
 
-		ret = msg_handle->recv(drv, ctx, msg);
+		ret = msg_handle->recv(drv, ctx->ctx, msg);
 		if (ret != -WD_EAGAIN) {
 			if (unlikely(ret < 0)) {
 				WD_ERR("failed to recv msg: error = %d!\n", ret);
@@ -1859,16 +2329,216 @@ int wd_handle_msg_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_hand
 			return -WD_ETIMEDOUT;
 		}
 
+		/* The spin window is over, sleep until the interrupt comes */
+		if (expect_ns && !wait_en && (!spin_ns ||
+		    (!(rx_cnt % WD_WAIT_CLOCK_CNT) &&
+		    wd_wait_get_ns() - start >= spin_ns)))
+			wait_en = true;
+
 		if (balance && *balance > WD_BALANCE_THRHD)
 			usleep(1);
 	} while (1);
 
+	if (expect_ns)
+		wd_wait_update(expect_ns, wd_wait_get_ns() - start);
+
 	if (balance)
 		*balance = rx_cnt;
 
 	return ret;
 }
 
+int wd_handle_msg_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
+		       struct wd_ctx_config_internal *config,
+		       struct wd_ctx_internal *ctx, void *msg, __u32 len,
+		       __u64 *balance)
+{
+	__u64 start = 0;
+	int ret;
+
+	if (ctx->stats)
+		start = wd_wait_get_ns();
+
+	ret = msg_handle->send(drv, ctx->ctx, msg);
+	if (unlikely(ret < 0)) {
+		WD_ERR("failed to send msg to hw, ret = %d!\n", ret);
+		goto out;
+	}
+
+	ret = wd_recv_msg_sync(drv, msg_handle, config, ctx, msg, len, balance);
+	if (!ret && start) {
+		wd_stats_add(ctx, WD_STATS_LAT_NS, wd_wait_get_ns() - start);
+		wd_stats_add(ctx, WD_STATS_LAT_CNT, 1);
+	}
+
+out:
+	wd_stats_add_err(ctx, ret);
+	return ret;
+}
+
+int wd_send_msg_batch(struct wd_alg_driver *drv, handle_t ctx,
+		      void **msgs, __u32 num, __u32 *count)
+{
+	int ret = 0;
+	__u32 i;
+
+	if (drv->send_batch)
+		return drv->send_batch(drv, ctx, msgs, num, count);
+
+	for (i = 0; i < num; i++) {
+		ret = drv->send(drv, ctx, msgs[i]);
+		if (unlikely(ret < 0))
+			break;
+	}
+	*count = i;
+
+	return ret;
+}
+
+/*
+ * Recv all the @num sent msgs. A failed msg doesn't stop the others, or
+ * their responses are left in the queue for the next task of the ctx. Only
+ * a timeout or a queue error stops it, as the queue doesn't respond then,
+ * and the driver drops the late responses. The first error is returned.
+ */
+static int wd_drain_msg_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
+			     struct wd_ctx_config_internal *config,
+			     struct wd_ctx_internal *ctx, void **msgs, __u32 num,
+			     __u32 len, __u64 *balance, __u64 start)
+{
+	int ret = 0;
+	int rret;
+	__u32 i;
+
+	for (i = 0; i < num; i++) {
+		rret = wd_recv_msg_sync(drv, msg_handle, config, ctx, msgs[i],
+					len, balance);
+		if (unlikely(rret < 0)) {
+			ret = ret ? ret : rret;
+			if (rret == -WD_ETIMEDOUT || rret == -WD_HW_EACCESS)
+				break;
+			continue;
+		}
+
+		/* The latency of a msg in the batch is from the start of the batch */
+		if (start) {
+			wd_stats_add(ctx, WD_STATS_LAT_NS, wd_wait_get_ns() - start);
+			wd_stats_add(ctx, WD_STATS_LAT_CNT, 1);
+		}
+	}
+
+	return ret;
+}
+
+int wd_handle_msg_sync_batch(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
+			     struct wd_ctx_config_internal *config,
+			     struct wd_ctx_internal *ctx, void **msgs, __u32 num,
+			     __u32 len, __u64 *balance)
+{
+	__u64 start = 0;
+	__u32 sent = 0;
+	int send_ret;
+	int ret = 0;
+	__u32 cnt;
+
+	if (ctx->stats)
+		start = wd_wait_get_ns();
+
+	while (sent < num) {
+		cnt = 0;
+		send_ret = wd_send_msg_batch(drv, ctx->ctx, msgs + sent, num - sent, &cnt);
+		wd_stats_add(ctx, WD_STATS_SEND, cnt);
+		/* The queue may be partly full, recv what is sent and try again */
+		if (send_ret == -WD_EBUSY && cnt)
+			send_ret = 0;
+		else if (unlikely(send_ret < 0))
+			WD_ERR("failed to send batch msgs to hw, ret = %d!\n", send_ret);
+
+		/*
+		 * Sent msgs must be drained even if the remaining ones fail,
+		 * otherwise the next sync task on the ctx gets stale responses.
+		 */
+		ret = wd_drain_msg_sync(drv, msg_handle, config, ctx, msgs + sent,
+					cnt, len, balance, start);
+		if (unlikely(ret < 0))
+			break;
+
+		if (unlikely(send_ret < 0)) {
+			ret = send_ret;
+			break;
+		}
+
+		sent += cnt;
+	}
+
+	wd_stats_add_err(ctx, ret);
+	return ret;
+}
+
+int wd_send_msg_batch_sync(struct wd_alg_driver *drv, struct wd_ctx_internal *ctx,
+			   void **msgs, __u32 num, __u32 *count)
+{
+	int ret;
+
+	*count = 0;
+	ret = wd_send_msg_batch(drv, ctx->ctx, msgs, num, count);
+	wd_stats_add(ctx, WD_STATS_SEND, *count);
+	/* The queue may be partly full, the caller sends the rest later */
+	if (ret == -WD_EBUSY && *count)
+		return 0;
+
+	if (unlikely(ret < 0)) {
+		WD_ERR("failed to send batch msgs to hw, ret = %d!\n", ret);
+		wd_stats_add_err(ctx, ret);
+	}
+
+	return ret;
+}
+
+int wd_recv_msg_batch_sync(struct wd_alg_driver *drv, struct wd_msg_handle *msg_handle,
+			   struct wd_ctx_config_internal *config,
+			   struct wd_ctx_internal *ctx, void **msgs, __u32 num,
+			   __u32 len)
+{
+	int ret;
+
+	/* The msgs after a failed one are still in the queue, drain them too */
+	ret = wd_drain_msg_sync(drv, msg_handle, config, ctx, msgs, num, len,
+				NULL, 0);
+	wd_stats_add_err(ctx, ret);
+	return ret;
+}
+
+int wd_send_async_batch(struct wd_alg_driver *drv, struct wd_ctx_config_internal *config,
+			struct wd_async_msg_pool *pool, struct wd_env_config *env_config,
+			__u32 idx, void **msgs, __u32 *tags, __u32 num, __u32 *count)
+{
+	struct wd_ctx_internal *ctx = config->ctxs + idx;
+	__u32 cnt = 0;
+	int send_ret, ret;
+	__u32 i;
+
+	send_ret = wd_send_msg_batch(drv, ctx->ctx, msgs, num, &cnt);
+	if (unlikely(send_ret < 0 && send_ret != -WD_EBUSY))
+		WD_ERR("failed to send async batch msgs, ret = %d!\n", send_ret);
+	wd_stats_add_err(ctx, send_ret);
+
+	for (i = cnt; i < num; i++)
+		wd_put_msg_to_pool(pool, idx, tags[i]);
+
+	for (i = 0; i < cnt; i++) {
+		wd_dfx_msg_cnt(config, idx);
+		ret = wd_add_task_to_async_queue(env_config, idx);
+		if (unlikely(ret)) {
+			*count = i;
+			return ret;
+		}
+	}
+
+	*count = cnt;
+	return send_ret;
+}
+
 int wd_init_param_check(struct wd_ctx_config *config, struct wd_sched *sched)
 {
 	if (!config || !config->ctxs || !config->ctxs[0].ctx) {
@@ -1930,26 +2600,70 @@ static int file_check_valid(char *lib_file)
 	return 0;
 }
 
-static int wd_alg_init_fallback(struct wd_alg_driver *fb_driver)
+static void wd_alg_free_fallback_config(struct wd_ctx_config_internal *fb_config)
+{
+	free((struct wd_soft_ctx *)fb_config->ctxs[0].ctx);
+	free(fb_config->ctxs);
+	free(fb_config);
+}
+
+static int wd_alg_init_fallback(struct wd_ctx_config_internal *config,
+				struct wd_alg_driver *fb_driver)
 {
+	struct wd_ctx_config_internal *fb_config;
+	int ret;
+
 	if (!fb_driver->init) {
 		WD_ERR("soft acc driver have no init interface.\n");
 		return -WD_EINVAL;
 	}
 
-	fb_driver->init(NULL, NULL);
+	/* The overflow msgs are done synchronously on a soft ctx of its own */
+	fb_config = calloc(1, sizeof(*fb_config));
+	if (!fb_config)
+		return -WD_ENOMEM;
+
+	fb_config->ctxs = calloc(1, sizeof(struct wd_ctx_internal));
+	if (!fb_config->ctxs)
+		goto free_config;
+
+	fb_config->ctxs[0].ctx = (handle_t)calloc(1, sizeof(struct wd_soft_ctx));
+	if (!fb_config->ctxs[0].ctx)
+		goto free_ctxs;
+
+	fb_config->ctxs[0].ctx_mode = CTX_MODE_SYNC;
+	fb_config->ctx_num = 1;
+
+	ret = fb_driver->init(fb_driver, fb_config);
+	if (ret) {
+		wd_alg_free_fallback_config(fb_config);
+		return ret;
+	}
+
+	config->fb_config = fb_config;
 
 	return 0;
+
+free_ctxs:
+	free(fb_config->ctxs);
+free_config:
+	free(fb_config);
+	return -WD_ENOMEM;
 }
 
-static void wd_alg_uninit_fallback(struct wd_alg_driver *fb_driver)
+static void wd_alg_uninit_fallback(struct wd_ctx_config_internal *config,
+				   struct wd_alg_driver *fb_driver)
 {
-	if (!fb_driver->exit) {
-		WD_ERR("soft acc driver have no exit interface.\n");
+	if (!config->fb_config)
 		return;
-	}
 
-	fb_driver->exit(NULL);
+	if (fb_driver->exit)
+		fb_driver->exit(fb_driver);
+	else
+		WD_ERR("soft acc driver have no exit interface.\n");
+
+	wd_alg_free_fallback_config(config->fb_config);
+	config->fb_config = NULL;
 }
 
 int wd_alg_init_driver(struct wd_ctx_config_internal *config,
@@ -1971,13 +2685,16 @@ int wd_alg_init_driver(struct wd_ctx_config_internal *config,
 	}
 
 	if (driver->fallback) {
-		ret = wd_alg_init_fallback((struct wd_alg_driver *)driver->fallback);
+		ret = wd_alg_init_fallback(config,
+					   (struct wd_alg_driver *)driver->fallback);
 		if (ret) {
 			driver->fallback = 0;
 			WD_ERR("soft alg driver init failed.\n");
 		}
 	}
 
+	wd_stats_register(config, driver);
+
 	return 0;
 
 err_alloc:
@@ -1993,7 +2710,8 @@ void wd_alg_uninit_driver(struct wd_ctx_config_internal *config,
 	wd_clear_ctx_config(config);
 
 	if (driver->fallback)
-		wd_alg_uninit_fallback((struct wd_alg_driver *)driver->fallback);
+		wd_alg_uninit_fallback(config,
+				       (struct wd_alg_driver *)driver->fallback);
 }
 
 void wd_dlclose_drv(void *dlh_list)
@@ -2727,10 +3445,19 @@ static void wd_alg_uninit_sve_ctx(struct wd_ctx_config *ctx_config)
 	free(ctx_config->ctxs);
 }
 
+static int wd_alg_attrs_call_init(struct wd_init_attrs *attrs,
+				  struct wd_ctx_config *ctx_config,
+				  struct wd_sched *alg_sched)
+{
+	if (attrs->alg_init_priv)
+		return attrs->alg_init_priv(attrs->priv, ctx_config, alg_sched);
+
+	return attrs->alg_init(ctx_config, alg_sched);
+}
+
 int wd_alg_attrs_init(struct wd_init_attrs *attrs)
 {
 	wd_alg_poll_ctx alg_poll_func = attrs->alg_poll_ctx;
-	wd_alg_init alg_init_func = attrs->alg_init;
 	__u32 sched_type = attrs->sched_type;
 	struct wd_ctx_config *ctx_config = NULL;
 	struct wd_sched *alg_sched = NULL;
@@ -2746,7 +3473,6 @@ int wd_alg_attrs_init(struct wd_init_attrs *attrs)
 		driver_type = attrs->driver->calc_type;
 
 	switch (driver_type) {
-	case UADK_ALG_SOFT:
 	case UADK_ALG_CE_INSTR:
 		ctx_config = calloc(1, sizeof(*ctx_config));
 		if (!ctx_config) {
@@ -2770,11 +3496,12 @@ int wd_alg_attrs_init(struct wd_init_attrs *attrs)
 			goto out_freesched;
 		}
 
-		ret = alg_init_func(ctx_config, alg_sched);
+		ret = wd_alg_attrs_call_init(attrs, ctx_config, alg_sched);
 		if (ret)
 			goto out_pre_init;
 
 		break;
+	case UADK_ALG_SOFT:
 	case UADK_ALG_SVE_INSTR:
 		/* Use default sched_type to alloc scheduler */
 		alg_sched = wd_sched_rr_alloc(SCHED_POLICY_SINGLE, 1, 1, alg_poll_func);
@@ -2793,12 +3520,12 @@ int wd_alg_attrs_init(struct wd_init_attrs *attrs)
 
 		ret = wd_alg_init_sve_ctx(ctx_config);
 		if (ret) {
-			WD_ERR("fail to init sve ctx!\n");
+			WD_ERR("fail to init soft ctx!\n");
 			goto out_freesched;
 		}
 
 		ctx_config->cap = attrs->ctx_params->cap;
-		ret = alg_init_func(ctx_config, alg_sched);
+		ret = wd_alg_attrs_call_init(attrs, ctx_config, alg_sched);
 		if (ret) {
 			wd_alg_uninit_sve_ctx(ctx_config);
 			goto out_freesched;
@@ -2830,7 +3557,7 @@ int wd_alg_attrs_init(struct wd_init_attrs *attrs)
 		}
 
 		ctx_config->cap = attrs->ctx_params->cap;
-		ret = alg_init_func(ctx_config, alg_sched);
+		ret = wd_alg_attrs_call_init(attrs, ctx_config, alg_sched);
 		if (ret)
 			goto out_pre_init;
 		break;
@@ -2842,7 +3569,7 @@ int wd_alg_attrs_init(struct wd_init_attrs *attrs)
 	return 0;
 
 out_pre_init:
-	if (driver_type == UADK_ALG_CE_INSTR || driver_type == UADK_ALG_SOFT)
+	if (driver_type == UADK_ALG_CE_INSTR)
 		wd_alg_ce_ctx_uninit(ctx_config);
 	else
 		wd_alg_ctx_uninit(ctx_config);
@@ -2866,10 +3593,10 @@ void wd_alg_attrs_uninit(struct wd_init_attrs *attrs)
 	}
 
 	switch (driver_type) {
-	case UADK_ALG_SOFT:
 	case UADK_ALG_CE_INSTR:
 		wd_alg_ce_ctx_uninit(ctx_config);
 		break;
+	case UADK_ALG_SOFT:
 	case UADK_ALG_SVE_INSTR:
 		wd_alg_uninit_sve_ctx(ctx_config);
 		break;